@@ -0,0 +1,26 @@
+#include "AI.h"
+#include "RandomAI.h"
+#include "SearchAI.h"
+#include "PlannerAI.h"
+#include "NetAI.h"
+
+AI* AI::create(const std::string& name, unsigned seed, unsigned threads)
+{
+	if (name == "random")
+	{
+		return new RandomAI(seed);
+	}
+	if (name == "search")
+	{
+		return new SearchAI(100, 8, "groundwar.gwt", "groundwar.gwb", threads);
+	}
+	if (name == "planner")
+	{
+		return new PlannerAI(seed);
+	}
+	if (name == "net")
+	{
+		return new NetAI(seed);
+	}
+	return nullptr;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include "Board.h"
+#include "Action.h"
+
+/*
+Something that can play Ground War. Given a board, picks the next action for the
+current player.
+*/
+class AI
+{
+public:
+	virtual ~AI() {}
+
+	/*
+	Chooses an action for the current player on the given board. The board may be
+	used as scratch space, but must be left in the state it was given in. The returned
+	action must be legal; at worst it can be ending the turn.
+	*/
+	virtual Action chooseAction(Board& board) = 0;
+
+	/*
+	Chooses an action the same way, but should return soon after stop is set, with the
+	best action found so far. It still has to be legal. The default ignores stop, for AIs
+	that are quick anyway.
+	*/
+	virtual Action chooseAction(Board& board, const std::atomic<bool>& stop)
+	{
+		return chooseAction(board);
+	}
+
+	/*
+	Uses the other player's thinking time. Called with the board as it is during the
+	other player's turn, and should return soon after stop is set. AIs that keep what
+	they learn between calls can get a head start on their own turn this way. The
+	default does nothing.
+	*/
+	virtual void ponder(Board& board, const std::atomic<bool>& stop) {}
+
+	/*
+	Gets a short name for this AI, used in logs and result tables.
+	*/
+	virtual const char* name() = 0;
+
+	/*
+	Creates an AI by name, seeding any randomness it uses with the given seed. Search runs
+	on the given number of threads (0 means one per hardware thread), which only makes
+	sense when a single game has the machine to itself. Returns nullptr if there's no AI
+	with that name. The AI needs to be deleted later on.
+	*/
+	static AI* create(const std::string& name, unsigned seed, unsigned threads = 1);
+};
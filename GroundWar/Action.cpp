@@ -0,0 +1,166 @@
+#include "Action.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include "Rules.h"
+
+static const char* UNIT_NAMES[UNIT_TYPES] = { "marines", "antitank", "tank" }; // Indexed by Unit::UnitType
+
+/*
+Builds an action with every field set, so unused fields compare equal.
+*/
+static Action makeAction(Action::ActionType type, int fromX, int fromY, int toX, int toY, Unit::UnitType unitType)
+{
+	Action action;
+	action.type = type;
+	action.fromX = fromX;
+	action.fromY = fromY;
+	action.toX = toX;
+	action.toY = toY;
+	action.unitType = unitType;
+	return action;
+}
+
+Action Action::move(int fromX, int fromY, int toX, int toY)
+{
+	return makeAction(MOVE, fromX, fromY, toX, toY, Unit::MARINES);
+}
+
+Action Action::attack(int fromX, int fromY, int toX, int toY)
+{
+	return makeAction(ATTACK, fromX, fromY, toX, toY, Unit::MARINES);
+}
+
+Action Action::spawn(Unit::UnitType unitType, int x, int y)
+{
+	return makeAction(SPAWN, -1, -1, x, y, unitType);
+}
+
+Action Action::endTurn()
+{
+	return makeAction(END_TURN, -1, -1, -1, -1, Unit::MARINES);
+}
+
+std::string Action::toString() const
+{
+	char text[MAX_TEXT];
+	format(text);
+	return text;
+}
+
+void Action::format(char* text) const
+{
+	switch (type)
+	{
+	case MOVE:
+		sprintf(text, "move %d %d %d %d", fromX, fromY, toX, toY);
+		break;
+	case ATTACK:
+		sprintf(text, "attack %d %d %d %d", fromX, fromY, toX, toY);
+		break;
+	case SPAWN:
+		sprintf(text, "spawn %s %d %d", UNIT_NAMES[unitType], toX, toY);
+		break;
+	default:
+		sprintf(text, "end");
+		break;
+	}
+}
+
+static const char* skipSpaces(const char* text)
+{
+	while (*text == ' ' || *text == '\t')
+	{
+		++text;
+	}
+	return text;
+}
+
+/*
+Checks if the next word is the given one, and if so skips past it.
+*/
+static bool readWord(const char*& text, const char* word)
+{
+	const char* at = skipSpaces(text);
+	size_t length = strlen(word);
+	if (strncmp(at, word, length) != 0 || (at[length] != '\0' && !isspace((unsigned char)at[length])))
+	{
+		return false;
+	}
+	text = at + length;
+	return true;
+}
+
+static bool readInt(const char*& text, int& value)
+{
+	const char* at = skipSpaces(text);
+	char* end;
+	long number = strtol(at, &end, 10);
+	if (end == at || (*end != '\0' && !isspace((unsigned char)*end)))
+	{
+		return false;
+	}
+	value = (int)number;
+	text = end;
+	return true;
+}
+
+const char* Action::parseFrom(const char* text, Action& action)
+{
+	int fromX, fromY, toX, toY;
+	bool isMove = readWord(text, "move");
+	if (isMove || readWord(text, "attack"))
+	{
+		if (!readInt(text, fromX) || !readInt(text, fromY) || !readInt(text, toX) || !readInt(text, toY))
+		{
+			return nullptr;
+		}
+		action = isMove ? move(fromX, fromY, toX, toY) : attack(fromX, fromY, toX, toY);
+	}
+	else if (readWord(text, "spawn"))
+	{
+		int type = 0;
+		while (type < UNIT_TYPES && !readWord(text, UNIT_NAMES[type]))
+		{
+			++type;
+		}
+		if (type == UNIT_TYPES || !readInt(text, toX) || !readInt(text, toY))
+		{
+			return nullptr;
+		}
+		action = spawn(Unit::UnitType(type), toX, toY);
+	}
+	else if (readWord(text, "end"))
+	{
+		action = endTurn();
+	}
+	else
+	{
+		return nullptr;
+	}
+	return text;
+}
+
+bool Action::parse(const std::string& text, Action& action)
+{
+	Action parsed;
+	const char* end = parseFrom(text.c_str(), parsed);
+	if (!end || *skipSpaces(end) != '\0') // Nothing left over
+	{
+		return false;
+	}
+	action = parsed;
+	return true;
+}
+
+bool Action::operator==(const Action& other) const
+{
+	return type == other.type && fromX == other.fromX && fromY == other.fromY &&
+		toX == other.toX && toY == other.toY && unitType == other.unitType;
+}
+
+bool Action::operator!=(const Action& other) const
+{
+	return !(*this == other);
+}
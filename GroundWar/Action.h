@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include "Unit.h"
+
+/*
+A single thing the current player can do on their turn. Tiles are referred to by
+their board indices so an action can outlive the Board it was made for.
+*/
+struct Action
+{
+	enum ActionType
+	{
+		MOVE, ATTACK, SPAWN, END_TURN
+	};
+
+	ActionType type;
+	int fromX, fromY; // Unused for SPAWN and END_TURN
+	int toX, toY; // Unused for END_TURN
+	Unit::UnitType unitType; // Only used for SPAWN
+
+	static Action move(int fromX, int fromY, int toX, int toY);
+	static Action attack(int fromX, int fromY, int toX, int toY);
+	static Action spawn(Unit::UnitType unitType, int x, int y);
+	static Action endTurn();
+
+	/*
+	Converts to and from text: "move fx fy tx ty", "attack fx fy tx ty",
+	"spawn <marines|antitank|tank> x y" or "end". parse returns false if the text isn't
+	one of those, and doesn't check whether the action is legal.
+	*/
+	std::string toString() const;
+	static bool parse(const std::string& text, Action& action);
+
+	static const int MAX_TEXT = 32; // Longest text of an action, with the terminating 0
+
+	/*
+	Same as toString and parse, without allocating. format writes up to MAX_TEXT chars.
+	parseFrom reads one action from the front of the text, which may have more after
+	it, and returns where the action ends, or nullptr if the text doesn't start with one.
+	*/
+	void format(char* text) const;
+	static const char* parseFrom(const char* text, Action& action);
+
+	bool operator==(const Action& other) const;
+	bool operator!=(const Action& other) const;
+};
@@ -0,0 +1,135 @@
+#include "Analysis.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+static const float WIN_CHANCE_SCALE = 6; // Gold ahead that makes winning e (2.7) times as likely as losing
+static const int MAX_DEPTH = 64;
+
+Analysis::Analysis(const char* tablebase) :
+	m_search(1000, MAX_DEPTH, tablebase, nullptr, 1), m_generation(0), m_worker(1) {}
+
+Analysis::~Analysis()
+{
+	stop();
+	m_worker.wait();
+	m_eval.detach();
+	m_threats.detach();
+	delete m_board;
+}
+
+void Analysis::update(Board& board)
+{
+	// Pick up results first, so a position that hasn't changed keeps the newest one
+	Message message;
+	while (m_results.pop(message))
+	{
+		if (message.generation == m_generation)
+		{
+			m_result = message.result;
+			m_hasResult = true;
+		}
+	}
+
+	BoardState state;
+	board.saveState(state);
+	if (m_stop && state == m_state)
+	{
+		return;
+	}
+	if (!m_board)
+	{
+		m_board = new Board(board.rules(), 0);
+		m_eval.attach(*m_board);
+		m_threats.attach(*m_board);
+	}
+
+	stop();
+	std::shared_ptr<std::atomic<bool>> stop = std::make_shared<std::atomic<bool>>(false);
+	m_stop = stop;
+	m_state = state;
+	const int generation = m_generation;
+	m_worker.submit([this, state, stop, generation]()
+	{
+		if (*stop)
+		{
+			return; // The position changed before it started
+		}
+		Message message;
+		message.generation = generation;
+		AnalysisResult& result = message.result;
+		auto send = [&]()
+		{
+			while (!m_results.push(message) && !*stop)
+			{
+				std::this_thread::yield(); // The main thread empties it every frame
+			}
+		};
+
+		m_board->loadState(state);
+		if (m_board->gameOver())
+		{
+			return;
+		}
+		result.depth = 0;
+		result.value = m_eval.score(RED);
+		result.redChance = winChance(result.value);
+		std::fill(result.best, result.best + BOARD_TILES, -1.0f);
+		for (int x = 0; x < BOARD_WIDTH; ++x)
+		{
+			for (int y = 0; y < BOARD_HEIGHT; ++y)
+			{
+				Tile* tile = m_board->getTile(x, y);
+				Unit* unit = tile ? tile->unit() : nullptr;
+				result.danger[x * BOARD_HEIGHT + y] = unit ? m_threats.threat(unit->owner(), unit->type(), x, y) : 0;
+			}
+		}
+		send();
+
+		const float sign = state.player == RED ? 1.0f : -1.0f;
+		m_search.analyze(*m_board, *stop, [&](int depth, const std::vector<SearchAI::ActionValue>& values)
+		{
+			float bestValue = -2.0f * Evaluation::WIN_SCORE;
+			for (size_t i = 0; i < values.size(); ++i)
+			{
+				bestValue = std::max(bestValue, sign * values[i].value);
+			}
+			result.depth = depth;
+			result.value = sign * bestValue;
+			result.redChance = winChance(result.value);
+			std::fill(result.best, result.best + BOARD_TILES, -1.0f);
+			for (size_t i = 0; i < values.size(); ++i)
+			{
+				const Action& action = values[i].action;
+				if (action.type != Action::END_TURN)
+				{
+					float& best = result.best[action.toX * BOARD_HEIGHT + action.toY];
+					float loss = bestValue - sign * values[i].value;
+					best = best < 0 ? loss : std::min(best, loss);
+				}
+			}
+			send();
+		});
+	});
+}
+
+void Analysis::stop()
+{
+	if (m_stop)
+	{
+		*m_stop = true;
+		m_stop.reset();
+	}
+	++m_generation;
+	m_hasResult = false;
+}
+
+const AnalysisResult* Analysis::result() const
+{
+	return m_hasResult ? &m_result : nullptr;
+}
+
+float Analysis::winChance(float value)
+{
+	return (float)(1 / (1 + exp(-value / WIN_CHANCE_SCALE)));
+}
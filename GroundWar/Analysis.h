@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include "Board.h"
+#include "BoardState.h"
+#include "Evaluation.h"
+#include "SearchAI.h"
+#include "SpscQueue.h"
+#include "ThreadPool.h"
+#include "ThreatMap.h"
+
+/*
+What the analysis has found out about a position so far.
+*/
+struct AnalysisResult
+{
+	int depth; // Of the search behind it; 0 until the first depth is done
+	float value; // From red's point of view
+	float redChance; // Chance red wins, guessed from value
+	float best[BOARD_TILES]; // How much worse than the best action the best one ending on each tile is, in gold, or -1 for none
+	float danger[BOARD_TILES]; // Chance the unit on each tile falls if every enemy that can reach it attacks (see ThreatMap), or 0 for none
+};
+
+/*
+Searches the position on the board in the background, so the interface can show what
+the search thinks of it as it goes. Like AsyncAI, the search runs on a worker thread with
+its own board, loaded from a snapshot, and results come back through a lock-free queue,
+so the main thread never waits on it. Each depth the search finishes sends back a better
+result.
+
+When the board changes, the search of the old position is stopped and the new one
+started. The search's transposition table is kept, so positions already searched, as most
+of the new position's subtree will have been, come straight from it.
+*/
+class Analysis
+{
+public:
+	/*
+	Uses the endgame table in the given file, if it can be loaded.
+	*/
+	Analysis(const char* tablebase = "groundwar.gwt");
+
+	/*
+	Stops the search, and waits for the worker to finish.
+	*/
+	~Analysis();
+
+	/*
+	Starts analyzing the board as it is now, if it's changed since the last call, and
+	picks up any results that have come in. Fine to call every frame. Only call from the
+	main thread.
+	*/
+	void update(Board& board);
+
+	/*
+	Stops the search, and forgets the last result. The next update starts over.
+	*/
+	void stop();
+
+	/*
+	Gets the latest result for the board given to update, or nullptr if there isn't one
+	yet.
+	*/
+	const AnalysisResult* result() const;
+
+	/*
+	Guesses red's chance of winning from a search value.
+	*/
+	static float winChance(float value);
+
+private:
+	struct Message
+	{
+		int generation; // Which position this is for
+		AnalysisResult result;
+	};
+
+	SearchAI m_search;
+	Board* m_board = nullptr; // The worker's own board, made on the first update
+	Evaluation m_eval; // For the worker's board, to have a value before the search has one
+	ThreatMap m_threats; // For the worker's board
+	std::atomic<int> m_generation; // Bumped each time the position changes
+	std::shared_ptr<std::atomic<bool>> m_stop; // Stops the current search; each gets its own
+	BoardState m_state; // What's being analyzed
+	AnalysisResult m_result; // Main thread only
+	bool m_hasResult = false;
+	SpscQueue<Message, 16> m_results;
+	ThreadPool m_worker;
+};
@@ -0,0 +1,143 @@
+#include "AsyncAI.h"
+#include <vector>
+#include "BoardState.h"
+
+AsyncAI::AsyncAI(AI* ai, Player side) :
+	m_ai(ai), m_side(side), m_generation(0), m_worker(1) {}
+
+AsyncAI::~AsyncAI()
+{
+	cancel();
+	m_worker.wait();
+	delete m_board;
+	delete m_ai;
+}
+
+Player AsyncAI::side()
+{
+	return m_side;
+}
+
+AI* AsyncAI::ai()
+{
+	return m_ai;
+}
+
+void AsyncAI::think(Board& board)
+{
+	if (!m_board)
+	{
+		m_board = new Board(board.rules(), 0);
+	}
+
+	stopPondering();
+	BoardState state;
+	board.saveState(state);
+	const int generation = ++m_generation;
+	std::shared_ptr<std::atomic<bool>> stop = std::make_shared<std::atomic<bool>>(false);
+	m_thinkStop = stop;
+	m_thinking = true;
+	m_worker.submit([this, state, generation, stop]()
+	{
+		if (generation != m_generation)
+		{
+			return; // Cancelled before it started
+		}
+		m_board->loadState(state);
+		Action action = m_ai->chooseAction(*m_board, *stop);
+
+		// Try it out on the snapshot, so the main thread only ever gets legal actions
+		m_board->loadState(state);
+		if (!m_board->doAction(action))
+		{
+			std::vector<Action> legal;
+			m_board->loadState(state);
+			m_board->legalActions(legal);
+			action = legal.empty() ? Action::endTurn() : legal[0];
+		}
+
+		Result result = { generation, action };
+		m_results.push(result); // Only one search runs at a time, so this never fills up
+	});
+}
+
+bool AsyncAI::thinking()
+{
+	return m_thinking;
+}
+
+bool AsyncAI::poll(Action& action)
+{
+	Result result;
+	while (m_results.pop(result))
+	{
+		if (result.generation == m_generation)
+		{
+			m_thinking = false;
+			action = result.action;
+			return true;
+		}
+	}
+	return false;
+}
+
+void AsyncAI::ponder(Board& board)
+{
+	BoardState state;
+	board.saveState(state);
+	if (m_thinking || (m_ponderStop && state == m_ponderState))
+	{
+		return;
+	}
+	if (!m_board)
+	{
+		m_board = new Board(board.rules(), 0);
+	}
+
+	stopPondering();
+	std::shared_ptr<std::atomic<bool>> stop = std::make_shared<std::atomic<bool>>(false);
+	m_ponderStop = stop;
+	m_ponderState = state;
+	m_worker.submit([this, state, stop]()
+	{
+		if (!*stop)
+		{
+			m_board->loadState(state);
+			m_ai->ponder(*m_board, *stop);
+		}
+	});
+}
+
+bool AsyncAI::pondering()
+{
+	return m_ponderStop != nullptr;
+}
+
+void AsyncAI::hurry()
+{
+	if (m_thinking && m_thinkStop)
+	{
+		*m_thinkStop = true;
+	}
+}
+
+void AsyncAI::cancel()
+{
+	stopPondering();
+	if (m_thinkStop)
+	{
+		*m_thinkStop = true;
+		m_thinkStop.reset();
+	}
+	++m_generation;
+	m_thinking = false;
+}
+
+void AsyncAI::stopPondering()
+{
+	if (m_ponderStop)
+	{
+		*m_ponderStop = true;
+		m_ponderStop.reset();
+	}
+}
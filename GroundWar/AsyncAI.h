@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include "AI.h"
+#include "Board.h"
+#include "ThreadPool.h"
+#include "SpscQueue.h"
+#include "BoardState.h"
+
+/*
+Runs an AI on a worker thread so the interface keeps drawing while it thinks. Each call
+to think hands the worker a snapshot of the board, which it loads onto a board of its
+own to search on; the real board is never touched off the main thread. Chosen actions
+come back through a lock-free queue and are picked up with poll, so the main thread
+never waits on the worker.
+
+Actions are chosen one at a time, since attacks are random and the AI needs to see how
+each one turned out before picking the next.
+
+While the other player is deciding, the AI can ponder the board in the background (see
+AI::ponder), and any search it does then is there to reuse once it's its turn.
+*/
+class AsyncAI
+{
+public:
+	/*
+	Takes ownership of the AI, which plays the given side.
+	*/
+	AsyncAI(AI* ai, Player side);
+
+	/*
+	Waits for the worker to finish whatever it's doing.
+	*/
+	~AsyncAI();
+
+	Player side();
+	AI* ai();
+
+	/*
+	Starts choosing an action for the board as it is now. Only call from the main thread.
+	*/
+	void think(Board& board);
+
+	/*
+	Checks if the worker is still choosing an action asked for with think.
+	*/
+	bool thinking();
+
+	/*
+	Gets the action chosen by the last call to think, if it's ready. Never blocks. Only
+	call from the main thread.
+	*/
+	bool poll(Action& action);
+
+	/*
+	Lets the AI ponder the board as it is now, until the next call to think or cancel.
+	Only starts over if the board has changed since the last call, so it's fine to call
+	every frame. Only call from the main thread.
+	*/
+	void ponder(Board& board);
+	bool pondering();
+
+	/*
+	Asks the AI to stop the current search and play the best action it's found so far,
+	which still comes back through poll. Does nothing if it isn't thinking.
+	*/
+	void hurry();
+
+	/*
+	Gives up on the current search or ponder. The AI is asked to stop, but its action is
+	thrown away.
+	*/
+	void cancel();
+
+private:
+	struct Result
+	{
+		int generation; // Which call to think this answers
+		Action action;
+	};
+
+	AI* m_ai;
+	Player m_side;
+	Board* m_board = nullptr; // The worker's own board, made on the first call to think
+	std::atomic<int> m_generation; // Bumped by each think and cancel
+	bool m_thinking = false; // Main thread only
+	SpscQueue<Result, 16> m_results;
+	std::shared_ptr<std::atomic<bool>> m_thinkStop; // Stops the current search, like m_ponderStop
+	std::shared_ptr<std::atomic<bool>> m_ponderStop; // Stops the current ponder; each ponder gets its own
+	BoardState m_ponderState; // What the current ponder is searching
+
+	void stopPondering();
+	ThreadPool m_worker;
+};
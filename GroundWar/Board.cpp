@@ -1,6 +1,8 @@
 #include <cstdlib>
 #include <cmath>
 #include <time.h>
+#include <algorithm>
+#include <cstring>
 #include "Board.h"
 #include "MountainTile.h"
 #include "GoldTile.h"
@@ -11,7 +13,9 @@
 #include "Antitank.h"
 #include "Tank.h"
 
-Board::Board()
+Board::Board() : Board(Rules::standard(), (unsigned)time(nullptr)) {}
+
+Board::Board(const Rules& rules, unsigned seed) : m_rules(rules), m_seed(seed), m_rng(seed)
 {
 	m_tiles = new Tile**[BOARD_WIDTH];
 	for (int x = 0; x < BOARD_WIDTH; x++)
@@ -33,10 +37,9 @@ Board::Board()
 	}
 
 	m_money = new int[2];
-	m_money[0] = START_MONEY;
-	m_money[1] = START_MONEY;
-
-	srand(time(nullptr)); // Initialize seed for RNG
+	m_money[0] = m_rules.startMoney;
+	m_money[1] = m_rules.startMoney;
+	m_movementPoints = m_rules.movementPoints;
 }
 
 
@@ -55,6 +58,30 @@ Board::~Board()
 	delete m_winner;
 }
 
+const Rules& Board::rules()
+{
+	return m_rules;
+}
+
+unsigned Board::rolls()
+{
+	return m_rolls;
+}
+
+void Board::setRolls(unsigned rolls)
+{
+	if (rolls < m_rolls)
+	{
+		// The RNG only runs forward, so go back to the start and catch up from there
+		m_rng.seed(m_seed);
+		m_rolls = 0;
+	}
+	while (m_rolls < rolls)
+	{
+		roll();
+	}
+}
+
 Tile* Board::getTile(int x, int y)
 {
 	if (0 <= x && x < BOARD_WIDTH && 0 <= y && y < BOARD_HEIGHT)
@@ -66,7 +93,7 @@ Tile* Board::getTile(int x, int y)
 
 bool Board::canMove(Unit* unit)
 {
-	return unit && unit->owner() == m_currentPlayer && m_movementPoints >= unit->movementCost();
+	return unit && unit->owner() == m_currentPlayer && m_movementPoints >= m_rules.movementCost[unit->type()];
 }
 
 bool Board::validMove(Tile* from, Tile* to)
@@ -79,10 +106,12 @@ bool Board::moveUnit(Tile* from, Tile* to)
 	if (validMove(from, to))
 	{
 		Unit* unit = from->unit();
-		m_movementPoints -= unit->movementCost();
+		m_movementPoints -= m_rules.movementCost[unit->type()];
 		to->setUnit(unit);
 		from->setUnit(nullptr);
 		m_selectedTile = nullptr;
+		notifyTileChanged(from);
+		notifyTileChanged(to);
 
 		// Check for victory
 		if (to->type() == Tile::BASE && unit->flag() && ((BaseTile*)to)->spawnableFor(unit->owner()))
@@ -90,14 +119,33 @@ bool Board::moveUnit(Tile* from, Tile* to)
 			endGame(unit->owner());
 		}
 
+		notifyStateChanged();
 		return true;
 	}
 	return false;
 }
 
+bool Board::moveAlongPath(Tile* from, Tile* to)
+{
+	if (!from || !canMove(from->unit()) || !m_pathFinder.find(*this, from, to, m_movementPoints))
+	{
+		return false;
+	}
+
+	// Every step was checked by the search, so the moves only fail if the game ends
+	const std::vector<Tile*>& path = m_pathFinder.path();
+	Tile* at = from;
+	for (size_t i = 0; i < path.size() && !gameOver(); ++i)
+	{
+		moveUnit(at, path[i]);
+		at = path[i];
+	}
+	return true;
+}
+
 bool Board::canSpawn(Unit* unit)
 {
-	return unit && unit->owner() == m_currentPlayer && m_money[m_currentPlayer] >= unit->goldCost();
+	return unit && unit->owner() == m_currentPlayer && m_money[m_currentPlayer] >= m_rules.goldCost[unit->type()];
 }
 
 bool Board::canSpawnOn(Unit* unit, Tile* tile)
@@ -114,7 +162,7 @@ void Board::prepareToSpawn(Unit::UnitType type)
 		m_spawningUnit = nullptr;
 		return;
 	}
-	Unit* unit = unitForType(type);
+	Unit* unit = unitForType(type, m_currentPlayer);
 	if (canSpawn(unit))
 	{
 		// If another unit was already spawning, delete it.
@@ -136,9 +184,11 @@ bool Board::spawnUnit(Tile* tile)
 {
 	if (canSpawnOn(m_spawningUnit, tile))
 	{
-		m_money[m_currentPlayer] -= m_spawningUnit->goldCost();
+		m_money[m_currentPlayer] -= m_rules.goldCost[m_spawningUnit->type()];
 		tile->setUnit(m_spawningUnit);
 		m_spawningUnit = nullptr;
+		notifyTileChanged(tile);
+		notifyStateChanged();
 		return true;
 	}
 	return false;
@@ -151,14 +201,30 @@ bool Board::canAttack(Tile* from, Tile* to)
 		to->unit()->owner() != m_currentPlayer && from->isAdjacent(to);
 }
 
+float Board::roll()
+{
+	++m_rolls;
+	return std::uniform_real_distribution<float>(0.0f, 1.0f)(m_rng);
+}
+
 bool Board::attack(Tile* from, Tile* to)
 {
 	if (canAttack(from, to))
 	{
-		float odds = from->unit()->odds(to->unit());
-		if ((float)rand() / (float)RAND_MAX < odds) // Attacker wins
+		float odds = m_rules.odds[from->unit()->type()][to->unit()->type()];
+		return resolveAttack(from, to, roll() < odds);
+	}
+	return false;
+}
+
+bool Board::resolveAttack(Tile* from, Tile* to, bool attackerWins)
+{
+	if (canAttack(from, to))
+	{
+		if (attackerWins)
 		{
 			to->killUnit();
+			notifyTileChanged(to);
 			moveUnit(from, to);
 			++m_money[m_currentPlayer];
 			checkStalemate(Player(1 - m_currentPlayer));
@@ -166,10 +232,12 @@ bool Board::attack(Tile* from, Tile* to)
 		else // Defender wins
 		{
 			from->killUnit();
+			notifyTileChanged(from);
 			m_selectedTile = nullptr;
 			++m_money[1 - m_currentPlayer];
 			checkStalemate(m_currentPlayer);
 		}
+		notifyStateChanged();
 		return true;
 	}
 	return false;
@@ -177,7 +245,12 @@ bool Board::attack(Tile* from, Tile* to)
 
 void Board::nextTurn()
 {
-	if (m_movementPoints < MOVEMENT_POINTS) // Only allow next turn if a move has been made or no possible moves
+	std::vector<Action> actions;
+	if (m_movementPoints >= m_rules.movementPoints)
+	{
+		addPlayActions(actions);
+	}
+	if (m_movementPoints < m_rules.movementPoints || actions.empty()) // Only allow next turn if a move has been made or no possible moves
 	{
 		// Check all tiles
 		for (int x = 0; x < BOARD_WIDTH; x++) {
@@ -190,12 +263,132 @@ void Board::nextTurn()
 		}
 
 		m_currentPlayer = Player(1 - m_currentPlayer);
-		m_movementPoints = MOVEMENT_POINTS;
+		m_movementPoints = m_rules.movementPoints;
 		m_selectedTile = nullptr;
+		delete m_spawningUnit;
 		m_spawningUnit = nullptr;
+		++m_turn;
+		notifyStateChanged();
 	}
 }
 
+void Board::legalActions(std::vector<Action>& actions)
+{
+	actions.clear();
+	if (gameOver())
+	{
+		return;
+	}
+	addPlayActions(actions);
+	if (m_movementPoints < m_rules.movementPoints || actions.empty())
+	{
+		actions.push_back(Action::endTurn());
+	}
+}
+
+void Board::addPlayActions(std::vector<Action>& actions)
+{
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = m_tiles[x][y];
+			if (!tile || !canMove(tile->unit()))
+			{
+				continue;
+			}
+			for (int i = 0; i < 6; ++i)
+			{
+				int adjX, adjY;
+				if (!adjacentPosition(x, y, i, adjX, adjY) || !m_tiles[adjX][adjY])
+				{
+					continue;
+				}
+				Tile* adjacent = m_tiles[adjX][adjY];
+				if (validMove(tile, adjacent))
+				{
+					actions.push_back(Action::move(x, y, adjX, adjY));
+				}
+				else if (canAttack(tile, adjacent))
+				{
+					actions.push_back(Action::attack(x, y, adjX, adjY));
+				}
+			}
+		}
+	}
+
+	for (int type = 0; type < UNIT_TYPES; ++type)
+	{
+		Unit* unit = unitForType(Unit::UnitType(type), m_currentPlayer);
+		if (canSpawn(unit))
+		{
+			for (int x = 0; x < BOARD_WIDTH; ++x)
+			{
+				for (int y = 0; y < BOARD_HEIGHT; ++y)
+				{
+					if (canSpawnOn(unit, m_tiles[x][y]))
+					{
+						actions.push_back(Action::spawn(Unit::UnitType(type), x, y));
+					}
+				}
+			}
+		}
+		delete unit;
+	}
+}
+
+bool Board::doAction(const Action& action)
+{
+	return performAction(action, -1);
+}
+
+bool Board::doAction(const Action& action, bool attackerWins)
+{
+	return performAction(action, attackerWins ? 1 : 0);
+}
+
+bool Board::performAction(const Action& action, int outcome)
+{
+	if (gameOver())
+	{
+		return false;
+	}
+
+	Tile* from = getTile(action.fromX, action.fromY);
+	Tile* to = getTile(action.toX, action.toY);
+	switch (action.type)
+	{
+	case Action::MOVE:
+		return from && to && moveUnit(from, to);
+	case Action::ATTACK:
+		// Same as clicking: only units that could be selected can attack
+		return from && to && canMove(from->unit()) &&
+			(outcome < 0 ? attack(from, to) : resolveAttack(from, to, outcome != 0));
+	case Action::SPAWN:
+		if (!to)
+		{
+			return false;
+		}
+		delete m_spawningUnit;
+		m_spawningUnit = unitForType(action.unitType, m_currentPlayer);
+		m_selectedTile = nullptr;
+		if (!spawnUnit(to))
+		{
+			delete m_spawningUnit;
+			m_spawningUnit = nullptr;
+			return false;
+		}
+		return true;
+	case Action::END_TURN:
+	{
+		int turn = m_turn;
+		nextTurn();
+		return m_turn != turn;
+	}
+	}
+	return false;
+}
+
 void Board::checkStalemate(Player p) {
 	for (int x = 0; x < BOARD_WIDTH; x++) {
 		for (int y = 0; y < BOARD_HEIGHT; y++) {
@@ -223,35 +416,7 @@ Tile** Board::findAdjacents(int x, int y)
 	int adjX, adjY;
 	for (int i = 0; i < 6; ++i)
 	{
-		switch (i)
-		{
-		case 0:
-			adjX = x;
-			adjY = y - 1;
-			break;
-		case 1:
-			adjX = x + 1;
-			adjY = y - (x % 2 == 0 ? 0 : 1);
-			break;
-		case 2:
-			adjX = x + 1;
-			adjY = y + (x % 2 == 0 ? 1 : 0);
-			break;
-		case 3:
-			adjX = x;
-			adjY = y + 1;
-			break;
-		case 4:
-			adjX = x - 1;
-			adjY = y + (x % 2 == 0 ? 1 : 0);
-			break;
-		case 5:
-			adjX = x - 1;
-			adjY = y - (x % 2 == 0 ? 0 : 1);
-			break;
-		}
-
-		if (0 <= adjX && adjX < BOARD_WIDTH && 0 <= adjY && adjY < BOARD_HEIGHT)
+		if (adjacentPosition(x, y, i, adjX, adjY))
 		{
 			// If adjX and adjY are in bounds, set adjacents[i] to m_tiles[adjX][adjY]
 			adjacents[i] = m_tiles[adjX][adjY];
@@ -265,6 +430,40 @@ Tile** Board::findAdjacents(int x, int y)
 	return adjacents;
 }
 
+bool Board::adjacentPosition(int x, int y, int direction, int& adjX, int& adjY)
+{
+	switch (direction)
+	{
+	case 0:
+		adjX = x;
+		adjY = y - 1;
+		break;
+	case 1:
+		adjX = x + 1;
+		adjY = y - (x % 2 == 0 ? 0 : 1);
+		break;
+	case 2:
+		adjX = x + 1;
+		adjY = y + (x % 2 == 0 ? 1 : 0);
+		break;
+	case 3:
+		adjX = x;
+		adjY = y + 1;
+		break;
+	case 4:
+		adjX = x - 1;
+		adjY = y + (x % 2 == 0 ? 1 : 0);
+		break;
+	case 5:
+		adjX = x - 1;
+		adjY = y - (x % 2 == 0 ? 0 : 1);
+		break;
+	default:
+		return false;
+	}
+	return 0 <= adjX && adjX < BOARD_WIDTH && 0 <= adjY && adjY < BOARD_HEIGHT;
+}
+
 bool Board::onMouseClick(const int& mouseX, const int& mouseY)
 {
 	Tile* tile = tileUnderMouse(mouseX, mouseY);
@@ -287,6 +486,10 @@ bool Board::onMouseClick(const int& mouseX, const int& mouseY)
 					attack(m_selectedTile, tile); // ... then try to attack.
 				}
 			}
+			else // Further away, so take the whole route there in one go
+			{
+				moveAlongPath(m_selectedTile, tile);
+			}
 		}
 		else if (tile->unit() && canMove(tile->unit()))
 		{
@@ -297,6 +500,30 @@ bool Board::onMouseClick(const int& mouseX, const int& mouseY)
 	return false;
 }
 
+void Board::onMouseMove(const int& mouseX, const int& mouseY)
+{
+	m_hoveredTile = tileUnderMouse(mouseX, mouseY);
+}
+
+const std::vector<Tile*>& Board::routePreview()
+{
+	Tile* from = m_spawningUnit ? nullptr : m_selectedTile;
+	if (from != m_previewFrom || m_hoveredTile != m_previewTo || m_changes != m_previewChanges)
+	{
+		m_previewFrom = from;
+		m_previewTo = m_hoveredTile;
+		m_previewChanges = m_changes;
+		m_pathFinder.find(*this, from, m_hoveredTile, m_movementPoints); // Clears the path if it fails
+	}
+	return m_pathFinder.path();
+}
+
+int Board::routePreviewCost()
+{
+	routePreview();
+	return m_pathFinder.cost();
+}
+
 Tile* Board::tileUnderMouse(const int& mouseX, const int& mouseY)
 {
 	for (int tileX = 0; tileX < BOARD_WIDTH; ++tileX)
@@ -329,6 +556,10 @@ void Board::loadBoard()
 		for (int y = 0; y < BOARD_HEIGHT; ++y)
 		{
 			m_tiles[x][y] = getTileForChar(BOARD[y][x]);
+			if (m_tiles[x][y])
+			{
+				m_tiles[x][y]->setPosition(x, y);
+			}
 		}
 	}
 }
@@ -374,6 +605,24 @@ Tile* Board::selectedTile()
 	return m_selectedTile;
 }
 
+int Board::highlight(int x, int y)
+{
+	const int spawning = m_spawningUnit ? m_spawningUnit->type() : -1;
+	if (m_selectedTile != m_highlightSelected || spawning != m_highlightSpawning || m_changes != m_highlightChanges)
+	{
+		m_highlightSelected = m_selectedTile;
+		m_highlightSpawning = spawning;
+		m_highlightChanges = m_changes;
+		updateHighlights();
+	}
+	return m_highlights[x * BOARD_HEIGHT + y];
+}
+
+Tile* Board::hoveredTile()
+{
+	return m_hoveredTile;
+}
+
 Unit* Board::spawningUnit()
 {
 	return m_spawningUnit;
@@ -385,16 +634,16 @@ SDL_Point* Board::tilePosition(const int& tileX, const int& tileY)
 		BOARD_POS.y + tileY * TILE_HEIGHT + (tileX % 2 == 1 ? 0 : TILE_HEIGHT / 2) };
 }
 
-Unit* Board::unitForType(Unit::UnitType type)
+Unit* Board::unitForType(Unit::UnitType type, Player owner)
 {
 	switch (type)
 	{
 	case Unit::MARINES:
-		return new Marines(m_currentPlayer);
+		return new Marines(owner);
 	case Unit::ANTITANK:
-		return new AntiTank(m_currentPlayer);
+		return new AntiTank(owner);
 	case Unit::TANK:
-		return new Tank(m_currentPlayer);
+		return new Tank(owner);
 	}
 	return nullptr;
 }
@@ -414,6 +663,11 @@ Player Board::currentPlayer()
 	return m_currentPlayer;
 }
 
+int Board::turn()
+{
+	return m_turn;
+}
+
 bool Board::gameOver()
 {
 	return m_winner != nullptr;
@@ -422,4 +676,136 @@ bool Board::gameOver()
 Player Board::winner()
 {
 	return *m_winner;
+}
+
+void Board::saveState(BoardState& state)
+{
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			state.tiles[x * BOARD_HEIGHT + y] = BoardState::encodeTile(m_tiles[x][y]);
+		}
+	}
+	state.money[RED] = m_money[RED];
+	state.money[BLUE] = m_money[BLUE];
+	state.movementPoints = m_movementPoints;
+	state.player = m_currentPlayer;
+	state.turn = m_turn;
+	state.winner = m_winner ? *m_winner : -1;
+}
+
+void Board::loadState(const BoardState& state)
+{
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = m_tiles[x][y];
+			unsigned char bits = state.tiles[x * BOARD_HEIGHT + y];
+			if (!tile || BoardState::encodeTile(tile) == bits)
+			{
+				continue;
+			}
+
+			// Clear the tile, then put the unit down before the lying flag so it doesn't pick it up
+			Unit* unit = tile->unit();
+			tile->setUnit(nullptr);
+			delete unit; // Takes any flag it was carrying with it
+			tile->setLyingFlag(nullptr);
+			if (bits & BoardState::UNIT_MASK)
+			{
+				unit = unitForType(Unit::UnitType((bits & BoardState::UNIT_MASK) - 1),
+					bits & BoardState::UNIT_BLUE ? BLUE : RED);
+				if (bits & BoardState::CARRIED_FLAG)
+				{
+					unit->setFlag(new Flag(bits & BoardState::CARRIED_BLUE ? BLUE : RED));
+				}
+				tile->setUnit(unit);
+			}
+			if (bits & BoardState::LYING_FLAG)
+			{
+				tile->setLyingFlag(new Flag(bits & BoardState::LYING_BLUE ? BLUE : RED));
+			}
+			notifyTileChanged(tile);
+		}
+	}
+
+	m_money[RED] = state.money[RED];
+	m_money[BLUE] = state.money[BLUE];
+	m_movementPoints = state.movementPoints;
+	m_currentPlayer = Player(state.player);
+	m_turn = state.turn;
+	delete m_winner;
+	m_winner = state.winner < 0 ? nullptr : new Player(Player(state.winner));
+	m_selectedTile = nullptr;
+	delete m_spawningUnit;
+	m_spawningUnit = nullptr;
+	notifyStateChanged();
+}
+
+void Board::addListener(BoardListener* listener)
+{
+	m_listeners.push_back(listener);
+}
+
+void Board::removeListener(BoardListener* listener)
+{
+	m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
+}
+
+void Board::notifyTileChanged(Tile* tile)
+{
+	++m_changes;
+	for (size_t i = 0; i < m_listeners.size(); ++i)
+	{
+		m_listeners[i]->tileChanged(*this, tile->x(), tile->y());
+	}
+}
+
+void Board::notifyStateChanged()
+{
+	++m_changes;
+	for (size_t i = 0; i < m_listeners.size(); ++i)
+	{
+		m_listeners[i]->stateChanged(*this);
+	}
+}
+
+void Board::updateHighlights()
+{
+	memset(m_highlights, 0, sizeof(m_highlights));
+	if (m_selectedTile)
+	{
+		// Only the selected tile's neighbours can be moved onto or attacked
+		const int x = m_selectedTile->x();
+		const int y = m_selectedTile->y();
+		m_highlights[x * BOARD_HEIGHT + y] = SELECTED;
+		for (int dir = 0; dir < 6; ++dir)
+		{
+			int adjX, adjY;
+			Tile* tile = adjacentPosition(x, y, dir, adjX, adjY) ? getTile(adjX, adjY) : nullptr;
+			if (tile && tile->openForMovement())
+			{
+				m_highlights[adjX * BOARD_HEIGHT + adjY] = MOVABLE;
+			}
+			else if (tile && canAttack(m_selectedTile, tile))
+			{
+				m_highlights[adjX * BOARD_HEIGHT + adjY] = ATTACKABLE;
+			}
+		}
+	}
+	if (m_spawningUnit)
+	{
+		for (int x = 0; x < BOARD_WIDTH; ++x)
+		{
+			for (int y = 0; y < BOARD_HEIGHT; ++y)
+			{
+				if (canSpawnOn(m_spawningUnit, getTile(x, y)))
+				{
+					m_highlights[x * BOARD_HEIGHT + y] |= SPAWNABLE_HIGHLIGHT;
+				}
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -1,15 +1,42 @@
 #pragma once
+#include <vector>
+#include <random>
 #include "Tile.h"
 #include "Player.h"
 #include "Constants.h"
 #include "Unit.h"
+#include "Rules.h"
+#include "Action.h"
+#include "BoardListener.h"
+#include "PathFinder.h"
+#include "BoardState.h"
 
 class Board
 {
 public:
 	Board();
+
+	/*
+	Creates a board that plays by the given rules, with combat rolls drawn from an RNG
+	seeded with the given seed. Two boards with the same rules and seed that see the
+	same actions play out identically.
+	*/
+	Board(const Rules& rules, unsigned seed);
 	~Board();
 
+	/*
+	Gets the rules this board plays by.
+	*/
+	const Rules& rules();
+
+	/*
+	Gets how many combat rolls this board has made, or puts its RNG back to how it was
+	after the given number of them. Going back to an earlier count before making an attack
+	again gives the attack the same roll it had the first time.
+	*/
+	unsigned rolls();
+	void setRolls(unsigned rolls);
+
 	/*
 	Gets a pointer to the tile at the given x and y. Returns NULL if x or y is out of bounds.
 	*/
@@ -38,6 +65,13 @@ public:
 	 */
 	bool moveUnit(Tile*, Tile*);
 
+	/*
+	Moves the unit on the first tile to the second along the cheapest route the current
+	player's movement points allow, one moveUnit step at a time. Stops early if a step
+	wins the game. Returns true if the unit moved, false if there's no such route.
+	*/
+	bool moveAlongPath(Tile*, Tile*);
+
 	/*
 	Can the given unit be spawned by the current player? Criteria include:
 	- Unit isn't null
@@ -83,12 +117,37 @@ public:
 	*/
 	bool attack(Tile*, Tile*);
 
+	/*
+	Same as attack, but with the given outcome instead of a roll. Lets a search look at
+	both ways an attack can go.
+	*/
+	bool resolveAttack(Tile* from, Tile* to, bool attackerWins);
+
 	/*
 	Ends the current player's turn. Updates m_currentPlayer to the next player
-	and resets m_movementPoints.
+	and resets m_movementPoints. Only allowed once a move has been made, or if the
+	current player has no possible moves.
 	*/
 	void nextTurn();
 
+	/*
+	Fills the given vector with every action the current player can take right now.
+	The vector is cleared first. Empty if the game is over.
+	*/
+	void legalActions(std::vector<Action>& actions);
+
+	/*
+	Performs the given action for the current player, if it's valid.
+	Returns true if the action happened, false otherwise.
+	*/
+	bool doAction(const Action& action);
+
+	/*
+	Same as doAction, except an attack has the given outcome instead of a roll. Other
+	actions ignore the outcome.
+	*/
+	bool doAction(const Action& action, bool attackerWins);
+
 	/*
 	Gets an array of Tile* for the tiles adjacent to the tile at (x, y).
 	The array will always be of size 6, with the tile at 0 being the tile directly
@@ -98,12 +157,36 @@ public:
 	*/
 	Tile** findAdjacents(int x, int y);
 
+	/*
+	Gets the indices of the tile next to (x, y) in the given direction, using the same
+	directions as findAdjacents. Returns false if that position is off the board.
+	*/
+	static bool adjacentPosition(int x, int y, int direction, int& adjX, int& adjY);
+
 	/*
 	Called when the mouse is clicked on the screen. Returns true if a tile was clicked,
 	or false if the click was outside the board.
 	*/
 	bool onMouseClick(const int& mouseX, const int& mouseY);
 
+	/*
+	Called when the mouse moves. Remembers the tile under the mouse for routePreview.
+	*/
+	void onMouseMove(const int& mouseX, const int& mouseY);
+
+	/*
+	Gets the route the selected unit would take to the tile under the mouse, not
+	including the selected tile. Empty if there's no selection or no route within the
+	remaining movement points. Only searches again when the selection, the tile under
+	the mouse or the board has changed since the last call.
+	*/
+	const std::vector<Tile*>& routePreview();
+
+	/*
+	Gets the movement points the route from routePreview costs.
+	*/
+	int routePreviewCost();
+
 	/*
 	Returns true if the given tile is selected, false otherwise.
 	*/
@@ -114,6 +197,20 @@ public:
 	*/
 	Tile* selectedTile();
 
+	/*
+	Gets the highlight modes for the tile at (x, y): SELECTED for the selected tile, MOVABLE
+	or ATTACKABLE for the tiles next to it the selected unit could move onto or attack, and
+	SPAWNABLE_HIGHLIGHT for the tiles the unit waiting to be spawned could be placed on.
+	The masks are only worked out again when the selection, the unit waiting to be spawned
+	or the board has changed since the last call.
+	*/
+	int highlight(int x, int y);
+
+	/*
+	Gets the tile under the mouse, or nullptr if there isn't one.
+	*/
+	Tile* hoveredTile();
+
 	/*
 	Gets the spawning unit.
 	*/
@@ -140,6 +237,11 @@ public:
 	*/
 	Player currentPlayer();
 
+	/*
+	Gets the number of turns that have been ended so far.
+	*/
+	int turn();
+
 	/*
 	True if the game is over, false if it is still going.
 	*/
@@ -150,20 +252,73 @@ public:
 	*/
 	Player winner();
 
+	/*
+	Copies the state of the game (units, flags, money, whose turn it is) into the given
+	struct, or replaces it with one saved earlier. Loading clears the selection and any
+	unit waiting to be spawned, and tells listeners about every tile that changed.
+	*/
+	void saveState(BoardState& state);
+	void loadState(const BoardState& state);
+
+	/*
+	Starts telling the given listener about changes to this board. The listener isn't
+	owned by the board, and has to be removed before it's deleted.
+	*/
+	void addListener(BoardListener* listener);
+	void removeListener(BoardListener* listener);
+
 private:
+	Rules m_rules;
+	unsigned m_seed;
+	std::mt19937 m_rng; // Used for combat rolls
+	unsigned m_rolls = 0; // Made with m_rng so far
 	int* m_money; // Array of 2 ints, one for each player
 	Tile*** m_tiles; // 2D array of pointers to Tiles
 	Tile* m_selectedTile = nullptr;
 	Player m_currentPlayer = RED;
-	int m_movementPoints = MOVEMENT_POINTS;
+	int m_movementPoints;
+	int m_turn = 0;
 	Unit* m_spawningUnit = nullptr;
 	Player* m_winner = nullptr;
+	std::vector<BoardListener*> m_listeners;
+	int m_changes = 0; // Bumped on every notification, so cached results can tell they're stale
+
+	// Route planning for the mouse
+	PathFinder m_pathFinder;
+	Tile* m_hoveredTile = nullptr;
+	Tile* m_previewFrom = nullptr;
+	Tile* m_previewTo = nullptr;
+	int m_previewChanges = -1;
+
+	// Highlights for the selection, by x * BOARD_HEIGHT + y
+	unsigned char m_highlights[BOARD_TILES];
+	Tile* m_highlightSelected = nullptr;
+	int m_highlightSpawning = -1; // Type of the unit waiting to be spawned, or -1 for none
+	int m_highlightChanges = -1;
 
 	void loadBoard();
-	Unit* unitForType(Unit::UnitType type);
+	Unit* unitForType(Unit::UnitType type, Player owner);
+	bool performAction(const Action& action, int outcome); // Outcome is -1 to roll for attacks
 	double distance(const int& x1, const int& y1, const int& x2, const int& y2);
 	Tile* getTileForChar(const char& c);
 	Tile* tileUnderMouse(const int& mouseX, const int& mouseY);
+	float roll(); // Next combat roll, in [0, 1)
+
+	/*
+	Adds every move, attack and spawn the current player can make to the given vector.
+	*/
+	void addPlayActions(std::vector<Action>& actions);
+
+	/*
+	Tells the listeners about a change to the given tile, or to the rest of the state.
+	*/
+	void notifyTileChanged(Tile* tile);
+	void notifyStateChanged();
+
+	/*
+	Works out m_highlights again for the current selection.
+	*/
+	void updateHighlights();
 
 	/*
 	Checks if given player has no units and not enough gold for units.
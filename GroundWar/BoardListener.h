@@ -0,0 +1,25 @@
+#pragma once
+
+class Board;
+
+/*
+Gets told about changes to a Board, so it can keep derived data up to date without
+rescanning the whole board. Changes made directly through Tile, rather than through
+Board, aren't reported.
+*/
+class BoardListener
+{
+public:
+	virtual ~BoardListener() {}
+
+	/*
+	Called after the contents of the tile at (x, y) changed: a unit arrived, left
+	or died, or a flag was picked up or dropped.
+	*/
+	virtual void tileChanged(Board& board, int x, int y) = 0;
+
+	/*
+	Called after money, movement points, the current player or the winner changed.
+	*/
+	virtual void stateChanged(Board& board) {}
+};
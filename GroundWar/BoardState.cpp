@@ -0,0 +1,113 @@
+#include "BoardState.h"
+#include <cstring>
+#include <random>
+#include "Tile.h"
+
+/*
+Random keys for each possible value of each part of the state, made once with a fixed
+seed so hashes are the same from run to run.
+*/
+struct ZobristKeys
+{
+	unsigned long long tiles[BOARD_TILES][128]; // Tile bytes only use the low 7 bits
+	unsigned long long money[2][64];
+	unsigned long long movement[32];
+	unsigned long long blue; // Blue to move
+	unsigned long long winner[3];
+
+	ZobristKeys()
+	{
+		std::mt19937_64 rng(0x5a0b1c2d);
+		for (int i = 0; i < BOARD_TILES; ++i)
+		{
+			for (int j = 0; j < 128; ++j)
+			{
+				tiles[i][j] = j == 0 ? 0 : rng(); // Empty tiles hash to nothing
+			}
+		}
+		for (int p = 0; p < 2; ++p)
+		{
+			for (int i = 0; i < 64; ++i)
+			{
+				money[p][i] = rng();
+			}
+		}
+		for (int i = 0; i < 32; ++i)
+		{
+			movement[i] = rng();
+		}
+		blue = rng();
+		for (int i = 0; i < 3; ++i)
+		{
+			winner[i] = rng();
+		}
+	}
+};
+
+static const ZobristKeys keys;
+
+/*
+Looks up the key for a value, mixing the value itself into the last key if it's past
+the end of the table.
+*/
+static unsigned long long keyFor(const unsigned long long* table, int size, int value)
+{
+	if (value >= 0 && value < size)
+	{
+		return table[value];
+	}
+	return table[size - 1] ^ ((unsigned long long)value * 0x9e3779b97f4a7c15ull);
+}
+
+unsigned char BoardState::encodeTile(Tile* tile)
+{
+	if (!tile)
+	{
+		return 0;
+	}
+
+	unsigned char bits = 0;
+	Unit* unit = tile->unit();
+	if (unit)
+	{
+		bits |= unit->type() + 1;
+		bits |= unit->owner() == BLUE ? UNIT_BLUE : 0;
+		if (unit->flag())
+		{
+			bits |= CARRIED_FLAG | (unit->flag()->owner() == BLUE ? CARRIED_BLUE : 0);
+		}
+	}
+
+	if (Flag* lying = tile->lyingFlag())
+	{
+		bits |= LYING_FLAG | (lying->owner() == BLUE ? LYING_BLUE : 0);
+	}
+	return bits;
+}
+
+unsigned long long BoardState::hash() const
+{
+	unsigned long long h = 0;
+	for (int i = 0; i < BOARD_TILES; ++i)
+	{
+		h ^= keys.tiles[i][tiles[i] & 0x7f];
+	}
+	h ^= keyFor(keys.money[0], 64, money[0]);
+	h ^= keyFor(keys.money[1], 64, money[1]);
+	h ^= keyFor(keys.movement, 32, movementPoints);
+	h ^= player == BLUE ? keys.blue : 0;
+	h ^= keys.winner[winner + 1];
+	return h;
+}
+
+bool BoardState::operator==(const BoardState& other) const
+{
+	return memcmp(tiles, other.tiles, sizeof(tiles)) == 0 && money[0] == other.money[0] &&
+		money[1] == other.money[1] && movementPoints == other.movementPoints &&
+		player == other.player && turn == other.turn && winner == other.winner;
+}
+
+bool BoardState::operator!=(const BoardState& other) const
+{
+	return !(*this == other);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "Constants.h"
+
+class Tile;
+
+static const int BOARD_TILES = BOARD_WIDTH * BOARD_HEIGHT;
+
+/*
+Everything about a board that changes during a game, in a small flat struct that can
+be copied, compared and stored. The map itself isn't included, since it never changes.
+*/
+struct BoardState
+{
+	// Bits of a tile's byte
+	static const unsigned char UNIT_MASK = 0x03; // Unit type + 1, 0 for no unit
+	static const unsigned char UNIT_BLUE = 0x04;
+	static const unsigned char CARRIED_FLAG = 0x08;
+	static const unsigned char CARRIED_BLUE = 0x10;
+	static const unsigned char LYING_FLAG = 0x20;
+	static const unsigned char LYING_BLUE = 0x40;
+
+	unsigned char tiles[BOARD_TILES]; // By x * BOARD_HEIGHT + y, 0 for empty or missing tiles
+	int money[2];
+	int movementPoints;
+	int player;
+	int turn;
+	int winner; // -1 while the game is still going
+
+	/*
+	Packs what's on a tile (unit, and carried or lying flags) into one byte.
+	*/
+	static unsigned char encodeTile(Tile* tile);
+
+	/*
+	Gets a 64-bit Zobrist hash of everything but the turn number, so positions reached
+	in different orders or on different turns hash the same. For transposition tables.
+	*/
+	unsigned long long hash() const;
+
+	bool operator==(const BoardState& other) const;
+	bool operator!=(const BoardState& other) const;
+};
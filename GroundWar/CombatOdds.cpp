@@ -0,0 +1,176 @@
+#include "CombatOdds.h"
+#include <algorithm>
+
+CombatOdds::CombatOdds() {}
+
+CombatOdds::~CombatOdds()
+{
+	delete m_board;
+}
+
+float CombatOdds::winChance(const Rules& rules, Unit::UnitType attacker, Unit::UnitType defender)
+{
+	return std::min(1.0f, std::max(0.0f, rules.odds[attacker][defender])); // A roll in [0, 1) below the odds wins
+}
+
+float CombatOdds::winChance(Board& board, Tile* from, Tile* to)
+{
+	if (!from || !to || !board.canAttack(from, to))
+	{
+		return 0.0f;
+	}
+	return winChance(board.rules(), from->unit()->type(), to->unit()->type());
+}
+
+std::vector<CombatOutcome> CombatOdds::distribution(Board& board, const std::vector<Action>& actions)
+{
+	if (!m_board)
+	{
+		m_board = new Board(board.rules(), 0);
+	}
+	BoardState start;
+	board.saveState(start);
+	m_board->loadState(start);
+	Player player = board.currentPlayer();
+
+	std::vector<Branch> layer(1);
+	layer[0].state = start;
+	layer[0].probability = 1.0;
+	m_positions = 1;
+
+	std::vector<Branch> next;
+	std::unordered_map<unsigned long long, size_t> index;
+	BoardState after;
+	for (size_t i = 0; i < actions.size(); ++i)
+	{
+		const Action& action = actions[i];
+		next.clear();
+		index.clear();
+		for (size_t j = 0; j < layer.size(); ++j)
+		{
+			const Branch& branch = layer[j];
+			m_board->loadState(branch.state);
+			if (action.type != Action::ATTACK)
+			{
+				m_board->doAction(action); // Moves, spawns and ending the turn always go the same way
+				m_board->saveState(after);
+				add(next, index, after, branch.probability);
+				continue;
+			}
+
+			Tile* from = m_board->getTile(action.fromX, action.fromY);
+			Tile* to = m_board->getTile(action.toX, action.toY);
+			if (!from || !to || !from->unit() || !to->unit())
+			{
+				add(next, index, branch.state, branch.probability); // Nothing left to attack with or at
+				continue;
+			}
+			float win = winChance(m_board->rules(), from->unit()->type(), to->unit()->type());
+			if (!m_board->doAction(action, true))
+			{
+				add(next, index, branch.state, branch.probability);
+				continue;
+			}
+			m_board->saveState(after);
+			add(next, index, after, branch.probability * win);
+
+			m_board->loadState(branch.state);
+			m_board->doAction(action, false);
+			m_board->saveState(after);
+			add(next, index, after, branch.probability * (1.0 - win));
+		}
+		layer.swap(next);
+		m_positions += (int)layer.size();
+	}
+
+	// Add up the positions by what they mean for the player
+	std::vector<CombatOutcome> outcomes;
+	for (size_t i = 0; i < layer.size(); ++i)
+	{
+		CombatOutcome outcome = summarize(start, layer[i].state, player);
+		outcome.probability = layer[i].probability;
+		std::vector<CombatOutcome>::iterator same = outcomes.begin();
+		for (; same != outcomes.end(); ++same)
+		{
+			if (same->unitsLost == outcome.unitsLost && same->unitsKilled == outcome.unitsKilled &&
+				same->goldChange == outcome.goldChange && same->enemyGoldChange == outcome.enemyGoldChange &&
+				same->flagCaptured == outcome.flagCaptured && same->won == outcome.won)
+			{
+				break;
+			}
+		}
+		if (same == outcomes.end())
+		{
+			outcomes.push_back(outcome);
+		}
+		else
+		{
+			same->probability += outcome.probability;
+		}
+	}
+	std::stable_sort(outcomes.begin(), outcomes.end(), [](const CombatOutcome& a, const CombatOutcome& b)
+	{
+		return a.probability > b.probability;
+	});
+	return outcomes;
+}
+
+int CombatOdds::positions()
+{
+	return m_positions;
+}
+
+void CombatOdds::add(std::vector<Branch>& layer, std::unordered_map<unsigned long long, size_t>& index,
+	const BoardState& state, double probability)
+{
+	if (probability <= 0.0)
+	{
+		return; // Can't happen under these odds
+	}
+	unsigned long long hash = state.hash();
+	std::unordered_map<unsigned long long, size_t>::iterator found = index.find(hash);
+	if (found != index.end())
+	{
+		layer[found->second].probability += probability;
+		return;
+	}
+	index[hash] = layer.size();
+	Branch branch;
+	branch.state = state;
+	branch.probability = probability;
+	layer.push_back(branch);
+}
+
+CombatOutcome CombatOdds::summarize(const BoardState& start, const BoardState& end, Player player)
+{
+	int units[2][2] = {}; // [start/end][player]
+	int carriers[2] = {}; // [start/end], units of the player carrying the other flag
+	const BoardState* states[2] = { &start, &end };
+	for (int s = 0; s < 2; ++s)
+	{
+		for (int i = 0; i < BOARD_TILES; ++i)
+		{
+			unsigned char bits = states[s]->tiles[i];
+			if (bits & BoardState::UNIT_MASK)
+			{
+				int owner = bits & BoardState::UNIT_BLUE ? BLUE : RED;
+				int flagOwner = bits & BoardState::CARRIED_BLUE ? BLUE : RED;
+				++units[s][owner];
+				if (owner == player && (bits & BoardState::CARRIED_FLAG) && flagOwner != player)
+				{
+					++carriers[s];
+				}
+			}
+		}
+	}
+
+	CombatOutcome outcome;
+	outcome.probability = 0.0;
+	outcome.unitsLost = std::max(0, units[0][player] - units[1][player]);
+	outcome.unitsKilled = std::max(0, units[0][1 - player] - units[1][1 - player]);
+	outcome.goldChange = end.money[player] - start.money[player];
+	outcome.enemyGoldChange = end.money[1 - player] - start.money[1 - player];
+	outcome.won = end.winner == player;
+	outcome.flagCaptured = carriers[1] > carriers[0] || outcome.won;
+	return outcome;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "Board.h"
+#include "Rules.h"
+
+/*
+One way a list of attacks can turn out, from the side of the player making them.
+*/
+struct CombatOutcome
+{
+	double probability;
+	int unitsLost; // Attacking player's units killed
+	int unitsKilled; // Other player's units killed
+	int goldChange; // Change in the attacking player's gold
+	int enemyGoldChange; // Change in the other player's gold
+	bool flagCaptured; // One of the attacking player's units picks up the other flag, or wins
+	bool won; // The attacking player wins the game
+};
+
+/*
+Works out exactly how attacks can turn out, instead of rolling them. Each attack has two
+outcomes whose chances come from the board's Rules::odds.
+
+A list of attacks is followed one attack at a time, keeping every position it could have
+reached so far along with its chance. Different outcomes that leave the same position
+(by BoardState::hash) are merged, so the work depends on how many positions there are,
+not on the 2^n ways n attacks can go.
+*/
+class CombatOdds
+{
+public:
+	CombatOdds();
+	~CombatOdds();
+
+	/*
+	Gets the chance that a unit of the first type beats one of the second when it attacks,
+	under the given rules.
+	*/
+	float winChance(const Rules& rules, Unit::UnitType attacker, Unit::UnitType defender);
+
+	/*
+	Gets the chance that the unit on the first tile beats the unit on the second, or 0 if
+	it can't attack it.
+	*/
+	float winChance(Board& board, Tile* from, Tile* to);
+
+	/*
+	Gets every way the given actions, done in order by the current player, can turn out,
+	with the chance of each. Outcomes are merged by what they add up to (units lost and
+	killed, gold, flag and win) and sorted by chance, most likely first. The chances add up
+	to 1.
+
+	The list will usually be attacks, but moves and spawns can be in it too, such as
+	moving up to attack a second unit. An action that can't be done in some outcome (the
+	attacker already died, or the target is gone) is skipped in that outcome. The board
+	isn't changed.
+	*/
+	std::vector<CombatOutcome> distribution(Board& board, const std::vector<Action>& actions);
+
+	/*
+	Number of positions the last distribution went through, after merging.
+	*/
+	int positions();
+
+private:
+	struct Branch
+	{
+		BoardState state;
+		double probability;
+	};
+
+	Board* m_board = nullptr; // Scratch board for following the actions
+	int m_positions = 0;
+
+	/*
+	Adds a branch to a layer, merging it with a branch that reached the same position.
+	*/
+	static void add(std::vector<Branch>& layer, std::unordered_map<unsigned long long, size_t>& index,
+		const BoardState& state, double probability);
+
+	/*
+	Sums up how a position differs from where the actions started, for the given player.
+	*/
+	static CombatOutcome summarize(const BoardState& start, const BoardState& end, Player player);
+};
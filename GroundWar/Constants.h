@@ -8,6 +8,11 @@ static const SDL_Point RED_INFO = { 10, 200 };
 static const SDL_Point BLUE_INFO = { 1110, RED_INFO.y };
 static const SDL_Point NEUTRAL_INFO = { 10, 10 };
 static const SDL_Point VICTORY_POS = { 350, 250 };
+static const SDL_Point REPLAY_INFO = { 10, 400 };
+static const SDL_Rect REPLAY_BAR = { 10, 450, 150, 12 }; // Seek bar shown when watching a replay
+static const SDL_Point ANALYSIS_INFO = { 10, 500 }; // Position database results
+static const SDL_Point SEARCH_INFO = { 10, 590 }; // Live analysis depth and win chance
+static const SDL_Rect WIN_BAR = { 10, 640, 150, 12 }; // Red's share of the live analysis win chance
 static const SDL_Color RED_COLOR = { 0xff, 0x00, 0x00 };
 static const SDL_Color BLUE_COLOR = { 0x00, 0x00, 0xff };
 static const char* TILE_BG = "TileBackground";
@@ -28,6 +33,8 @@ static const int MOVEMENT_POINTS = 12;
 static const int SELECTED = 1;
 static const int MOVABLE = 2;
 static const int ATTACKABLE = 4;
+static const int ROUTE = 8;
+static const int SPAWNABLE_HIGHLIGHT = 16;
 
 static const char* BOARD[] = {  "----SLTTTBW--",
 								"--TLLLTTTTTBB",
@@ -0,0 +1,323 @@
+#include "Delta.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+// First byte of a record
+static const unsigned char KEYFRAME = 0x80;
+static const unsigned char RED_MONEY = 0x01;
+static const unsigned char BLUE_MONEY = 0x02;
+static const unsigned char MOVEMENT = 0x04;
+static const unsigned char NEXT_TURN = 0x08; // Turn goes up by one and the other player is up
+static const unsigned char WINNER = 0x10;
+static const unsigned char PREVIOUS_TURN = 0x20; // Turn goes down by one and the other player is up, for undoing
+static const unsigned char MAX_WINNER = BLUE + 1; // Winners are stored plus one, so 0 is none
+
+static const char REPLAY_MAGIC[4] = { 'G', 'W', 'R', '1' };
+
+/*
+Writes a non-negative number 7 bits at a time, low bits first, with the top bit of each
+byte set if more follow. Numbers under 128 take one byte.
+*/
+static void writeNumber(unsigned value, std::vector<unsigned char>& out)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+/*
+Reads a number written by writeNumber. Returns false if the data runs out first.
+*/
+static bool readNumber(const unsigned char*& data, const unsigned char* end, int& value)
+{
+	unsigned result = 0;
+	for (int shift = 0; data < end && shift < 32; shift += 7)
+	{
+		unsigned char byte = *data++;
+		result |= (unsigned)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+		{
+			value = (int)result;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+Writes the tiles that differ between two states as a count, then index and contents pairs.
+*/
+static void writeTiles(const unsigned char* before, const unsigned char* after, std::vector<unsigned char>& out)
+{
+	size_t countAt = out.size();
+	out.push_back(0);
+	int count = 0;
+	for (int i = 0; i < BOARD_TILES; ++i)
+	{
+		if (before[i] != after[i])
+		{
+			out.push_back((unsigned char)i);
+			out.push_back(after[i]);
+			++count;
+		}
+	}
+	out[countAt] = (unsigned char)count; // At most BOARD_TILES, which fits
+}
+
+static bool readTiles(const unsigned char*& data, const unsigned char* end, unsigned char* tiles)
+{
+	if (data >= end)
+	{
+		return false;
+	}
+	int count = *data++;
+	if (end - data < count * 2)
+	{
+		return false;
+	}
+	for (int i = 0; i < count; ++i, data += 2)
+	{
+		if (data[0] >= BOARD_TILES)
+		{
+			return false;
+		}
+		tiles[data[0]] = data[1];
+	}
+	return true;
+}
+
+DeltaEncoder::DeltaEncoder(int keyframeInterval) :
+	m_interval(keyframeInterval) {}
+
+bool DeltaEncoder::encode(Board& board, std::vector<unsigned char>& out)
+{
+	BoardState now;
+	board.saveState(now);
+
+	bool keyframe = !m_started || (m_interval > 0 && m_sinceKeyframe >= m_interval);
+	if (!keyframe && encodeDelta(m_last, now, out))
+	{
+		++m_sinceKeyframe;
+	}
+	else
+	{
+		keyframe = true;
+		encodeKeyframe(now, out);
+		m_sinceKeyframe = 1;
+	}
+
+	m_last = now;
+	m_started = true;
+	return keyframe;
+}
+
+void DeltaEncoder::reset()
+{
+	m_started = false;
+}
+
+void DeltaEncoder::encodeKeyframe(const BoardState& state, std::vector<unsigned char>& out)
+{
+	static const unsigned char empty[BOARD_TILES] = {};
+	out.push_back(KEYFRAME);
+	writeNumber(state.turn, out);
+	out.push_back((unsigned char)state.player);
+	out.push_back((unsigned char)(state.winner + 1));
+	writeNumber(state.money[RED], out);
+	writeNumber(state.money[BLUE], out);
+	writeNumber(state.movementPoints, out);
+	writeTiles(empty, state.tiles, out);
+}
+
+bool encodeDelta(const BoardState& from, const BoardState& to, std::vector<unsigned char>& out)
+{
+	bool nextTurn = to.turn == from.turn + 1 && to.player != from.player;
+	bool previousTurn = to.turn == from.turn - 1 && to.player != from.player;
+	if (!nextTurn && !previousTurn && (to.turn != from.turn || to.player != from.player))
+	{
+		return false; // Not something a single action does
+	}
+
+	unsigned char flags = 0;
+	flags |= to.money[RED] != from.money[RED] ? RED_MONEY : 0;
+	flags |= to.money[BLUE] != from.money[BLUE] ? BLUE_MONEY : 0;
+	flags |= to.movementPoints != from.movementPoints ? MOVEMENT : 0;
+	flags |= nextTurn ? NEXT_TURN : 0;
+	flags |= previousTurn ? PREVIOUS_TURN : 0;
+	flags |= to.winner != from.winner ? WINNER : 0;
+	out.push_back(flags);
+	writeTiles(from.tiles, to.tiles, out);
+	if (flags & RED_MONEY)
+	{
+		writeNumber(to.money[RED], out);
+	}
+	if (flags & BLUE_MONEY)
+	{
+		writeNumber(to.money[BLUE], out);
+	}
+	if (flags & MOVEMENT)
+	{
+		writeNumber(to.movementPoints, out);
+	}
+	if (flags & WINNER)
+	{
+		out.push_back((unsigned char)(to.winner + 1));
+	}
+	return true;
+}
+
+size_t applyRecord(BoardState& state, const unsigned char* data, size_t size)
+{
+	const unsigned char* start = data;
+	const unsigned char* end = data + size;
+	if (size == 0)
+	{
+		return 0;
+	}
+
+	unsigned char flags = *data++;
+	if (flags == KEYFRAME)
+	{
+		if (!readNumber(data, end, state.turn) || end - data < 2 || data[0] > BLUE || data[1] > MAX_WINNER)
+		{
+			return 0; // Truncated, or a player or winner Board can't hold
+		}
+		state.player = data[0];
+		state.winner = data[1] - 1;
+		data += 2;
+		for (int i = 0; i < BOARD_TILES; ++i)
+		{
+			state.tiles[i] = 0;
+		}
+		if (!readNumber(data, end, state.money[RED]) || !readNumber(data, end, state.money[BLUE]) ||
+			!readNumber(data, end, state.movementPoints) || !readTiles(data, end, state.tiles))
+		{
+			return 0;
+		}
+		return data - start;
+	}
+
+	if (flags & ~(RED_MONEY | BLUE_MONEY | MOVEMENT | NEXT_TURN | PREVIOUS_TURN | WINNER))
+	{
+		return 0;
+	}
+	if (!readTiles(data, end, state.tiles) ||
+		((flags & RED_MONEY) && !readNumber(data, end, state.money[RED])) ||
+		((flags & BLUE_MONEY) && !readNumber(data, end, state.money[BLUE])) ||
+		((flags & MOVEMENT) && !readNumber(data, end, state.movementPoints)))
+	{
+		return 0;
+	}
+	if (flags & (NEXT_TURN | PREVIOUS_TURN))
+	{
+		if (state.player != RED && state.player != BLUE)
+		{
+			return 0;
+		}
+		state.turn += flags & NEXT_TURN ? 1 : -1;
+		state.player = 1 - state.player;
+	}
+	if (flags & WINNER)
+	{
+		if (data >= end || *data > MAX_WINNER)
+		{
+			return 0;
+		}
+		state.winner = *data++ - 1;
+	}
+	return data - start;
+}
+
+size_t applyRecord(Board& board, const unsigned char* data, size_t size)
+{
+	BoardState state;
+	board.saveState(state);
+	size_t read = applyRecord(state, data, size);
+	if (read)
+	{
+		board.loadState(state);
+	}
+	return read;
+}
+
+bool isKeyframe(const unsigned char* data, size_t size)
+{
+	return size > 0 && data[0] == KEYFRAME;
+}
+
+std::string toHex(const std::vector<unsigned char>& data)
+{
+	std::string text;
+	appendHex(data, text);
+	return text;
+}
+
+void appendHex(const std::vector<unsigned char>& data, std::string& text)
+{
+	static const char digits[] = "0123456789abcdef";
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		text += digits[data[i] >> 4];
+		text += digits[data[i] & 0xf];
+	}
+}
+
+static int hexDigit(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+bool fromHex(const std::string& text, std::vector<unsigned char>& data)
+{
+	return fromHex(text.c_str(), text.size(), data);
+}
+
+bool fromHex(const char* text, size_t length, std::vector<unsigned char>& data)
+{
+	data.clear();
+	if (length % 2 != 0)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < length; i += 2)
+	{
+		int high = hexDigit(text[i]);
+		int low = hexDigit(text[i + 1]);
+		if (high < 0 || low < 0)
+		{
+			return false;
+		}
+		data.push_back((unsigned char)(high << 4 | low));
+	}
+	return true;
+}
+
+bool saveReplay(const char* path, const std::vector<unsigned char>& records)
+{
+	std::ofstream out(path, std::ios::binary);
+	out.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+	if (!records.empty())
+	{
+		out.write((const char*)&records[0], records.size());
+	}
+	return out.good();
+}
+
+bool loadReplay(const char* path, std::vector<unsigned char>& records)
+{
+	std::ifstream in(path, std::ios::binary);
+	char magic[sizeof(REPLAY_MAGIC)];
+	if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), REPLAY_MAGIC))
+	{
+		return false;
+	}
+	records.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Board.h"
+#include "BoardState.h"
+
+/*
+A compact binary encoding of how a board changes, for keeping clients in sync and for
+replay files. The stream is a series of records, one per action:
+
+- A keyframe holds a whole BoardState (about 10 bytes plus 2 per occupied tile), so a
+  reader can start from it without anything before it.
+- A delta holds only what changed since the previous record: the tiles whose contents
+  changed (2 bytes each), and any of money, movement points, turn or winner that changed.
+  A move is 7 bytes.
+
+The first byte of a record says which kind it is and, for deltas, which fields follow.
+*/
+class DeltaEncoder
+{
+public:
+	/*
+	Writes a keyframe every keyframeInterval records. 0 means only the first record.
+	*/
+	DeltaEncoder(int keyframeInterval = 32);
+
+	/*
+	Appends a record of everything that changed on the board since the last call. The
+	first call writes a keyframe, and so does every keyframeInterval-th one after, or
+	any call where the change can't be written as a delta (such as a loaded state more
+	than a turn away). Returns true if it wrote a keyframe.
+	*/
+	bool encode(Board& board, std::vector<unsigned char>& out);
+
+	/*
+	Makes the next call to encode write a keyframe.
+	*/
+	void reset();
+
+	/*
+	Appends a keyframe of the given state.
+	*/
+	static void encodeKeyframe(const BoardState& state, std::vector<unsigned char>& out);
+
+private:
+	BoardState m_last;
+	bool m_started = false;
+	int m_interval;
+	int m_sinceKeyframe = 0;
+};
+
+/*
+Appends a delta record that turns one state into the other. Returns false, writing
+nothing, if they're more than one turn apart. Deltas work in either direction, so the
+reverse of any delta can be written too.
+*/
+bool encodeDelta(const BoardState& from, const BoardState& to, std::vector<unsigned char>& out);
+
+/*
+Reads one record from the front of the data and applies it to the given state. Deltas
+only make sense applied to the state they were made from. Returns the number of bytes
+read, or 0 if the data is truncated or malformed (in which case the state may be
+partly changed).
+*/
+size_t applyRecord(BoardState& state, const unsigned char* data, size_t size);
+
+/*
+Same as above, applying the record to a board with Board::loadState.
+*/
+size_t applyRecord(Board& board, const unsigned char* data, size_t size);
+
+/*
+Checks if the record at the front of the data is a keyframe.
+*/
+bool isKeyframe(const unsigned char* data, size_t size);
+
+/*
+Converts records to and from hex text, for sending over a text protocol.
+*/
+std::string toHex(const std::vector<unsigned char>& data);
+bool fromHex(const std::string& text, std::vector<unsigned char>& data);
+
+/*
+Same as above, for the given number of chars of text, and appending to text instead of
+making a new string.
+*/
+void appendHex(const std::vector<unsigned char>& data, std::string& text);
+bool fromHex(const char* text, size_t length, std::vector<unsigned char>& data);
+
+/*
+Replay files are the 4 bytes "GWR1" followed by records, one per action, starting with a
+keyframe. Return false if the file can't be written or read, or isn't a replay.
+*/
+bool saveReplay(const char* path, const std::vector<unsigned char>& records);
+bool loadReplay(const char* path, std::vector<unsigned char>& records);
@@ -0,0 +1,366 @@
+#include "DistanceFields.h"
+#include <algorithm>
+
+DistanceFields::DistanceFields() {}
+
+DistanceFields::~DistanceFields()
+{
+	detach();
+}
+
+void DistanceFields::compute(Board& board)
+{
+	detach();
+
+	// Tile adjacency, with mountains left out so the searches never step onto them
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = board.getTile(x, y);
+			int i = index(x, y);
+			m_walkable[i] = tile && (tile->unit() || tile->openForMovement());
+			m_occupied[i] = tile && tile->unit();
+			m_inRegion[i] = false;
+			m_fieldAt[i] = -1;
+		}
+	}
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			for (int dir = 0; dir < 6; ++dir)
+			{
+				int adjX, adjY;
+				int& neighbor = m_neighbors[index(x, y)][dir];
+				neighbor = -1;
+				if (Board::adjacentPosition(x, y, dir, adjX, adjY) && m_walkable[index(adjX, adjY)])
+				{
+					neighbor = index(adjX, adjY);
+				}
+			}
+		}
+	}
+
+	// One field per base and gold tile, then the combined ones
+	m_fields.clear();
+	Field combined[3];
+	combined[0].kind = combined[1].kind = HOME;
+	combined[2].kind = ANY_GOLD;
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = board.getTile(x, y);
+			if (!tile || (tile->type() != Tile::BASE && tile->type() != Tile::GOLD))
+			{
+				continue;
+			}
+			int i = index(x, y);
+			Field field;
+			field.kind = tile->type() == Tile::BASE ? BASE_TILE : GOLD_TILE;
+			field.x = x;
+			field.y = y;
+			field.sources.push_back(i);
+			m_fieldAt[i] = (int)m_fields.size();
+			m_fields.push_back(field);
+
+			if (field.kind == GOLD_TILE)
+			{
+				combined[2].sources.push_back(i);
+			}
+			for (int p = 0; p < 2; ++p)
+			{
+				if (field.kind == BASE_TILE && tile->spawnableFor(Player(p)))
+				{
+					combined[p].sources.push_back(i);
+				}
+			}
+		}
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		combined[i].x = combined[i].y = -1;
+		if (i < 2)
+		{
+			m_homeField[i] = (int)m_fields.size();
+		}
+		else
+		{
+			m_goldField = (int)m_fields.size();
+		}
+		m_fields.push_back(combined[i]);
+	}
+
+	for (size_t i = 0; i < m_fields.size(); ++i)
+	{
+		fill(m_fields[i], m_fields[i].terrain, false);
+		fill(m_fields[i], m_fields[i].blocked, true);
+	}
+}
+
+void DistanceFields::attach(Board& board)
+{
+	compute(board);
+	m_board = &board;
+	board.addListener(this);
+}
+
+void DistanceFields::detach()
+{
+	if (m_board)
+	{
+		m_board->removeListener(this);
+		m_board = nullptr;
+	}
+}
+
+int DistanceFields::fieldCount()
+{
+	return (int)m_fields.size();
+}
+
+DistanceFields::FieldKind DistanceFields::fieldKind(int field)
+{
+	return m_fields[field].kind;
+}
+
+int DistanceFields::fieldX(int field)
+{
+	return m_fields[field].x;
+}
+
+int DistanceFields::fieldY(int field)
+{
+	return m_fields[field].y;
+}
+
+int DistanceFields::homeField(Player player)
+{
+	return m_homeField[player];
+}
+
+int DistanceFields::goldField()
+{
+	return m_goldField;
+}
+
+int DistanceFields::fieldAt(int x, int y)
+{
+	return m_fieldAt[index(x, y)];
+}
+
+int DistanceFields::terrainDistance(int field, int x, int y)
+{
+	return m_fields[field].terrain[index(x, y)];
+}
+
+int DistanceFields::distance(int field, int x, int y)
+{
+	return m_fields[field].blocked[index(x, y)];
+}
+
+int DistanceFields::homeDistance(Player player, int x, int y)
+{
+	return m_fields[m_homeField[player]].blocked[index(x, y)];
+}
+
+int DistanceFields::terrainHomeDistance(Player player, int x, int y)
+{
+	return m_fields[m_homeField[player]].terrain[index(x, y)];
+}
+
+void DistanceFields::tileChanged(Board& board, int x, int y)
+{
+	int i = index(x, y);
+	Tile* tile = board.getTile(x, y);
+	bool occupied = tile && tile->unit();
+	if (!m_walkable[i] || occupied == m_occupied[i])
+	{
+		return; // Nothing that affects walking changed, e.g. a unit just lost a flag
+	}
+
+	m_occupied[i] = occupied;
+	for (size_t f = 0; f < m_fields.size(); ++f)
+	{
+		if (occupied)
+		{
+			block(m_fields[f].blocked, i);
+		}
+		else
+		{
+			unblock(m_fields[f].blocked, i);
+		}
+	}
+}
+
+int DistanceFields::index(int x, int y)
+{
+	return x * BOARD_HEIGHT + y;
+}
+
+bool DistanceFields::canPass(int tile)
+{
+	return !m_occupied[tile];
+}
+
+void DistanceFields::fill(Field& field, unsigned char* distance, bool useUnits)
+{
+	std::fill(distance, distance + TILES, (unsigned char)UNREACHABLE);
+	m_queue.clear();
+	for (size_t i = 0; i < field.sources.size(); ++i)
+	{
+		distance[field.sources[i]] = 0;
+		m_queue.push_back(field.sources[i]);
+	}
+
+	for (size_t head = 0; head < m_queue.size(); ++head)
+	{
+		int tile = m_queue[head];
+		if (useUnits && !canPass(tile))
+		{
+			continue; // Has a distance itself, but nothing can walk through it
+		}
+		for (int dir = 0; dir < 6; ++dir)
+		{
+			int adj = m_neighbors[tile][dir];
+			if (adj >= 0 && distance[adj] == UNREACHABLE)
+			{
+				distance[adj] = distance[tile] + 1;
+				m_queue.push_back(adj);
+			}
+		}
+	}
+}
+
+void DistanceFields::unblock(unsigned char* distance, int tile)
+{
+	if (distance[tile] == UNREACHABLE)
+	{
+		return;
+	}
+
+	// The tile can be walked through again, so shorten any paths that now go through it
+	m_queue.clear();
+	m_queue.push_back(tile);
+	for (size_t head = 0; head < m_queue.size(); ++head)
+	{
+		int from = m_queue[head];
+		for (int dir = 0; dir < 6; ++dir)
+		{
+			int adj = m_neighbors[from][dir];
+			if (adj >= 0 && distance[from] + 1 < distance[adj])
+			{
+				distance[adj] = distance[from] + 1;
+				if (canPass(adj))
+				{
+					m_queue.push_back(adj);
+				}
+			}
+		}
+	}
+}
+
+void DistanceFields::block(unsigned char* distance, int tile)
+{
+	if (distance[tile] == UNREACHABLE)
+	{
+		return;
+	}
+
+	// Find every tile whose shortest paths all went through the blocked tile. Going out
+	// in order of distance means any other neighbour that could still lead home has
+	// already been looked at by the time a tile is checked.
+	m_region.clear();
+	m_queue.clear();
+	m_queue.push_back(tile);
+	for (size_t head = 0; head < m_queue.size(); ++head)
+	{
+		int from = m_queue[head];
+		for (int dir = 0; dir < 6; ++dir)
+		{
+			int adj = m_neighbors[from][dir];
+			if (adj < 0 || m_inRegion[adj] || distance[adj] != distance[from] + 1)
+			{
+				continue;
+			}
+			bool supported = false;
+			for (int i = 0; i < 6 && !supported; ++i)
+			{
+				int other = m_neighbors[adj][i];
+				supported = other >= 0 && other != tile && !m_inRegion[other] && canPass(other) &&
+					distance[other] + 1 == distance[adj];
+			}
+			if (!supported)
+			{
+				m_inRegion[adj] = true;
+				m_region.push_back(adj);
+				if (canPass(adj))
+				{
+					m_queue.push_back(adj);
+				}
+			}
+		}
+	}
+	if (m_region.empty())
+	{
+		return;
+	}
+
+	// Start each tile in the region from its best neighbour outside it...
+	for (size_t i = 0; i < m_region.size(); ++i)
+	{
+		distance[m_region[i]] = UNREACHABLE;
+	}
+	for (size_t i = 0; i < m_region.size(); ++i)
+	{
+		int t = m_region[i];
+		for (int dir = 0; dir < 6; ++dir)
+		{
+			int adj = m_neighbors[t][dir];
+			if (adj >= 0 && !m_inRegion[adj] && canPass(adj) && distance[adj] + 1 < distance[t])
+			{
+				distance[t] = distance[adj] + 1;
+			}
+		}
+	}
+
+	// ...then spread those through the region in order of distance. The starting values
+	// are sorted, and anything relaxed along the way only grows by one per step, so
+	// merging the two queues keeps the order.
+	std::sort(m_region.begin(), m_region.end(),
+		[distance](int a, int b) { return distance[a] < distance[b]; });
+	m_queue.clear();
+	size_t seed = 0, head = 0;
+	while (seed < m_region.size() || head < m_queue.size())
+	{
+		int from;
+		if (head >= m_queue.size() ||
+			(seed < m_region.size() && distance[m_region[seed]] <= distance[m_queue[head]]))
+		{
+			from = m_region[seed++];
+		}
+		else
+		{
+			from = m_queue[head++];
+		}
+		if (distance[from] == UNREACHABLE || !canPass(from))
+		{
+			continue;
+		}
+		for (int dir = 0; dir < 6; ++dir)
+		{
+			int adj = m_neighbors[from][dir];
+			if (adj >= 0 && m_inRegion[adj] && distance[from] + 1 < distance[adj])
+			{
+				distance[adj] = distance[from] + 1;
+				m_queue.push_back(adj);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < m_region.size(); ++i)
+	{
+		m_inRegion[m_region[i]] = false;
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <vector>
+#include "Board.h"
+#include "BoardListener.h"
+
+/*
+Walking distances (in moves) from every tile to the bases and gold tiles of a map,
+computed once with breadth-first searches and then looked up in O(1).
+
+Each field has two versions. The terrain version only treats mountains as walls. The
+blocked version also can't step onto tiles with units on them, and is kept up to date
+incrementally as units come and go while attached to a board. A tile with a unit on it
+still has a distance of its own; it just can't be walked through.
+*/
+class DistanceFields :
+	public BoardListener
+{
+public:
+	/*
+	Which tiles a field measures the distance to. Besides one field per base and gold
+	tile, there are combined fields for "any base of this player" and "any gold tile".
+	*/
+	enum FieldKind
+	{
+		BASE_TILE, GOLD_TILE, HOME, ANY_GOLD
+	};
+
+	static const int UNREACHABLE = 255;
+
+	DistanceFields();
+	~DistanceFields();
+
+	/*
+	Computes the fields for the given board's map and current units, without listening
+	for changes.
+	*/
+	void compute(Board& board);
+
+	/*
+	Computes the fields and keeps the blocked versions up to date as the board changes.
+	The board has to outlive this object, or be detached from it first.
+	*/
+	void attach(Board& board);
+	void detach();
+
+	/*
+	Gets the number of fields, and what each one measures the distance to.
+	Combined fields have a position of (-1, -1).
+	*/
+	int fieldCount();
+	FieldKind fieldKind(int field);
+	int fieldX(int field);
+	int fieldY(int field);
+
+	/*
+	Gets the field index of the combined field for the given player's bases, or of
+	all gold tiles.
+	*/
+	int homeField(Player player);
+	int goldField();
+
+	/*
+	Gets the field index for the base or gold tile at (x, y), or -1 if there isn't one.
+	*/
+	int fieldAt(int x, int y);
+
+	/*
+	Distance from (x, y) to the field's tiles, treating only mountains as walls.
+	*/
+	int terrainDistance(int field, int x, int y);
+
+	/*
+	Distance from (x, y) to the field's tiles without walking through any units.
+	*/
+	int distance(int field, int x, int y);
+
+	/*
+	Shorthand for the distance from (x, y) to the nearest base of the given player.
+	*/
+	int homeDistance(Player player, int x, int y);
+	int terrainHomeDistance(Player player, int x, int y);
+
+	void tileChanged(Board& board, int x, int y);
+
+private:
+	static const int TILES = BOARD_WIDTH * BOARD_HEIGHT;
+
+	struct Field
+	{
+		FieldKind kind;
+		int x, y;
+		std::vector<int> sources; // Tile indices at distance 0
+		unsigned char terrain[TILES];
+		unsigned char blocked[TILES];
+	};
+
+	Board* m_board = nullptr;
+	std::vector<Field> m_fields;
+	int m_homeField[2];
+	int m_goldField;
+	int m_fieldAt[TILES];
+	int m_neighbors[TILES][6]; // Tile index of each neighbour, -1 if there's none or it's a mountain
+	bool m_walkable[TILES]; // Real tile that isn't a mountain
+	bool m_occupied[TILES]; // Has a unit on it
+
+	// Scratch space for the incremental updates, kept around to avoid reallocating
+	std::vector<int> m_queue;
+	std::vector<int> m_region;
+	bool m_inRegion[TILES];
+
+	static int index(int x, int y);
+	bool canPass(int tile);
+	void fill(Field& field, unsigned char* distance, bool useUnits);
+	void unblock(unsigned char* distance, int tile);
+	void block(unsigned char* distance, int tile);
+};
@@ -0,0 +1,364 @@
+#include "EngineProtocol.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Delta.h"
+#include "SearchAI.h"
+
+static const char* AI_NAMES[] = { "random", "search", "planner", "net" };
+static const int DEFAULT_MOVETIME = 1000; // Milliseconds
+
+static const char* skipSpaces(const char* text)
+{
+	while (*text == ' ' || *text == '\t')
+	{
+		++text;
+	}
+	return text;
+}
+
+/*
+Gets the length of the word at the front of the text.
+*/
+static size_t wordLength(const char* text)
+{
+	size_t length = 0;
+	while (text[length] && text[length] != ' ' && text[length] != '\t')
+	{
+		++length;
+	}
+	return length;
+}
+
+/*
+Checks if the next word is the given one, and if so skips past it.
+*/
+static bool readWord(const char*& text, const char* word)
+{
+	const char* at = skipSpaces(text);
+	size_t length = wordLength(at);
+	if (length != strlen(word) || strncmp(at, word, length) != 0)
+	{
+		return false;
+	}
+	text = at + length;
+	return true;
+}
+
+/*
+Reads the number after a word, and skips past it.
+*/
+static int readNumber(const char*& text)
+{
+	text = skipSpaces(text);
+	int value = atoi(text);
+	text += wordLength(text);
+	return value;
+}
+
+EngineProtocol::EngineProtocol() :
+	m_rules(Rules::standard()), m_aiName("search")
+{
+	newGame();
+}
+
+EngineProtocol::~EngineProtocol()
+{
+	m_eval.detach();
+	delete m_ai;
+	delete m_board;
+}
+
+Board& EngineProtocol::board()
+{
+	return *m_board;
+}
+
+void EngineProtocol::newGame()
+{
+	m_eval.detach();
+	delete m_board;
+	m_board = new Board(m_rules, m_seed);
+	m_board->saveState(m_start);
+	m_eval.attach(*m_board);
+
+	// A fresh AI picks up the seed, and doesn't keep anything it set up for the old rules
+	delete m_ai;
+	m_ai = AI::create(m_aiName, m_seed, m_threads);
+}
+
+bool EngineProtocol::handle(const char* line, std::string& reply)
+{
+	const char* text = line;
+	char number[64];
+	if (readWord(text, "engine"))
+	{
+		reply += "id name GroundWar\n";
+		for (int i = 0; i < (int)(sizeof(AI_NAMES) / sizeof(AI_NAMES[0])); ++i)
+		{
+			reply += "option ai ";
+			reply += AI_NAMES[i];
+			reply += '\n';
+		}
+		reply += "engineok\n";
+	}
+	else if (readWord(text, "isready"))
+	{
+		reply += "readyok\n";
+	}
+	else if (readWord(text, "setoption"))
+	{
+		setOption(text, reply);
+	}
+	else if (readWord(text, "map"))
+	{
+		if (readWord(text, "standard"))
+		{
+			newGame(); // The only map there is, so loading it starts over
+		}
+		else
+		{
+			reply += "error unknown map\n";
+		}
+	}
+	else if (readWord(text, "newgame"))
+	{
+		newGame();
+	}
+	else if (readWord(text, "position"))
+	{
+		setPosition(text, reply);
+	}
+	else if (readWord(text, "action"))
+	{
+		playActions(text, reply);
+	}
+	else if (readWord(text, "go"))
+	{
+		go(text, reply);
+	}
+	else if (readWord(text, "eval"))
+	{
+		sprintf(number, "eval %.2f\n", m_eval.score(m_board->currentPlayer()));
+		reply += number;
+	}
+	else if (readWord(text, "state"))
+	{
+		BoardState state;
+		m_board->saveState(state);
+		m_bytes.clear();
+		DeltaEncoder::encodeKeyframe(state, m_bytes);
+		reply += "state ";
+		appendHex(m_bytes, reply);
+		reply += '\n';
+	}
+	else if (readWord(text, "legal"))
+	{
+		char action[Action::MAX_TEXT];
+		m_board->legalActions(m_actions);
+		reply += "legal";
+		for (size_t i = 0; i < m_actions.size(); ++i)
+		{
+			m_actions[i].format(action);
+			reply += ' ';
+			reply += action;
+		}
+		reply += '\n';
+	}
+	else if (readWord(text, "quit"))
+	{
+		return false;
+	}
+	else if (*skipSpaces(line) != '\0') // Blank lines are ignored
+	{
+		reply += "error unknown command\n";
+	}
+	return true;
+}
+
+bool EngineProtocol::setOption(const char* text, std::string& reply)
+{
+	text = skipSpaces(text);
+	const char* name = text;
+	size_t nameLength = wordLength(name);
+	const char* value = skipSpaces(name + nameLength);
+	size_t valueLength = wordLength(value);
+	if (nameLength == 0 || valueLength == 0)
+	{
+		reply += "error setoption needs a name and a value\n";
+		return false;
+	}
+
+	if (readWord(text, "ai"))
+	{
+		for (int i = 0; i < (int)(sizeof(AI_NAMES) / sizeof(AI_NAMES[0])); ++i)
+		{
+			if (strlen(AI_NAMES[i]) == valueLength && strncmp(AI_NAMES[i], value, valueLength) == 0)
+			{
+				delete m_ai;
+				m_aiName = AI_NAMES[i];
+				m_ai = AI::create(m_aiName, m_seed, m_threads);
+				return true;
+			}
+		}
+		reply += "error unknown ai\n";
+		return false;
+	}
+	if (readWord(text, "seed"))
+	{
+		m_seed = (unsigned)strtoul(value, nullptr, 10);
+		return true;
+	}
+	if (readWord(text, "threads"))
+	{
+		delete m_ai;
+		m_threads = (unsigned)strtoul(value, nullptr, 10);
+		m_ai = AI::create(m_aiName, m_seed, m_threads);
+		return true;
+	}
+
+	// Rule names are short, so they fit in a buffer instead of needing a string
+	char rule[64];
+	if (nameLength >= sizeof(rule))
+	{
+		reply += "error unknown option\n";
+		return false;
+	}
+	memcpy(rule, name, nameLength);
+	rule[nameLength] = '\0';
+	if (!m_rules.set(rule, atof(value)))
+	{
+		reply += "error unknown option\n";
+		return false;
+	}
+	return true;
+}
+
+bool EngineProtocol::setPosition(const char* text, std::string& reply)
+{
+	if (readWord(text, "start"))
+	{
+		m_board->loadState(m_start);
+	}
+	else
+	{
+		text = skipSpaces(text);
+		size_t length = wordLength(text);
+		BoardState state = m_start;
+		if (!fromHex(text, length, m_bytes) || m_bytes.empty() || !isKeyframe(&m_bytes[0], m_bytes.size()) ||
+			applyRecord(state, &m_bytes[0], m_bytes.size()) != m_bytes.size())
+		{
+			reply += "error bad position\n";
+			return false;
+		}
+		m_board->loadState(state);
+		text += length;
+	}
+
+	if (readWord(text, "actions"))
+	{
+		return playActions(text, reply);
+	}
+	if (*skipSpaces(text) != '\0')
+	{
+		reply += "error expected actions\n";
+		return false;
+	}
+	return true;
+}
+
+bool EngineProtocol::playActions(const char* text, std::string& reply)
+{
+	for (text = skipSpaces(text); *text; text = skipSpaces(text))
+	{
+		Action action;
+		text = Action::parseFrom(text, action);
+		if (!text)
+		{
+			reply += "error bad action\n";
+			return false;
+		}
+		bool played;
+		if (action.type == Action::ATTACK && readWord(text, "won"))
+		{
+			played = m_board->doAction(action, true);
+		}
+		else if (action.type == Action::ATTACK && readWord(text, "lost"))
+		{
+			played = m_board->doAction(action, false);
+		}
+		else
+		{
+			played = m_board->doAction(action);
+		}
+		if (!played)
+		{
+			reply += "error illegal action\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+void EngineProtocol::go(const char* text, std::string& reply)
+{
+	int movetime = DEFAULT_MOVETIME, turntime = -1, gametime = -1, increment = 0;
+	for (;;)
+	{
+		if (readWord(text, "movetime"))
+		{
+			movetime = readNumber(text);
+		}
+		else if (readWord(text, "turntime"))
+		{
+			turntime = readNumber(text);
+		}
+		else if (readWord(text, "gametime"))
+		{
+			gametime = readNumber(text);
+		}
+		else if (readWord(text, "increment"))
+		{
+			increment = readNumber(text);
+		}
+		else
+		{
+			break;
+		}
+	}
+	SearchAI* search = m_aiName == "search" ? static_cast<SearchAI*>(m_ai) : nullptr;
+	if (search)
+	{
+		if (gametime >= 0)
+		{
+			search->setGameTime(gametime, increment);
+		}
+		else if (turntime >= 0)
+		{
+			search->setTurnTime(turntime);
+		}
+		else
+		{
+			search->setMilliseconds(movetime > 0 ? movetime : 1);
+		}
+	}
+
+	float eval = m_eval.score(m_board->currentPlayer());
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Action best = m_ai->chooseAction(*m_board);
+	long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	char line[128];
+	sprintf(line, "info time %lld eval %.2f", elapsed, eval);
+	reply += line;
+	if (search)
+	{
+		sprintf(line, " depth %d nodes %lld", search->depth(), search->nodes());
+		reply += line;
+	}
+	best.format(line);
+	reply += "\nbestaction ";
+	reply += line;
+	reply += '\n';
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Board.h"
+#include "BoardState.h"
+#include "Evaluation.h"
+#include "AI.h"
+#include "Rules.h"
+
+/*
+A line protocol for driving an AI from another program, in the style of UCI, so bots,
+GUIs and tournament managers can run it as a separate process. Commands, one per line:
+
+	engine                  Replies "id name GroundWar", "option ai <name>" for each AI,
+	                        then "engineok"
+	isready                 Replies "readyok", once everything before it is done
+	setoption ai <name>     Picks the AI go uses: random, search (the default), planner or net
+	setoption seed <n>      Seeds combat rolls and the AI, from the next newgame
+	setoption threads <n>   Sets how many threads search uses, 1 by default; 0 means one
+	                        per hardware thread, for when the engine has the machine to itself
+	setoption <rule> <n>    Sets any Rules::set parameter, from the next newgame
+	map <name>              Loads a map. Only "standard" exists
+	newgame                 Starts a fresh game
+	position start|<hex> [actions <action>...]
+	                        Sets the position: the start of the game, or a keyframe from
+	                        Delta.h in hex, then plays the actions in order
+	action <action>         Plays one action
+	go [movetime <ms>]      Searches for the player to move, replying with "info time <ms>
+	                        eval <score>" (plus "depth" and "nodes" for search), then
+	                        "bestaction <action>"
+	go turntime <ms>        Searches with the given time for the whole turn, shared between
+	                        its actions; the engine keeps track of what's left of it
+	go gametime <ms> [increment <ms>]
+	                        Searches with the given time left on the player's game clock,
+	                        and what's added to it each turn
+	eval                    Replies "eval <score>": the evaluation for the player to move
+	state                   Replies "state <hex>" with the position as a keyframe
+	legal                   Replies "legal" followed by every legal action
+	quit                    Ends the session
+
+Actions are written as for Action::parse, and since each kind has a fixed number of words
+they can follow each other on a line. An attack rolls for its outcome, unless it's
+followed by "won" or "lost". Commands that fail reply "error <reason>"; others only
+reply as described.
+
+Replies go into a string the caller passes in, and nothing is allocated for parsing, so
+once the buffers have grown to size a command costs about what its work does.
+*/
+class EngineProtocol
+{
+public:
+	EngineProtocol();
+	~EngineProtocol();
+
+	/*
+	Handles one command, without its line ending, appending any reply lines. Returns
+	false once the session should end.
+	*/
+	bool handle(const char* line, std::string& reply);
+
+	Board& board();
+
+private:
+	Rules m_rules;
+	unsigned m_seed = 1;
+	unsigned m_threads = 1; // For search
+	Board* m_board = nullptr;
+	BoardState m_start; // Position a new game starts from
+	Evaluation m_eval;
+	std::string m_aiName;
+	AI* m_ai = nullptr;
+	std::vector<unsigned char> m_bytes; // Scratch for hex keyframes
+	std::vector<Action> m_actions; // Scratch for legal
+
+	void newGame();
+	bool setOption(const char* text, std::string& reply);
+	bool setPosition(const char* text, std::string& reply);
+	void go(const char* text, std::string& reply);
+
+	/*
+	Plays the actions in the text, stopping at the first one that can't be read or
+	played.
+	*/
+	bool playActions(const char* text, std::string& reply);
+};
@@ -0,0 +1,182 @@
+#include "Evaluation.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+bool EvalWeights::set(const std::string& name, float value)
+{
+	if (name == "material") material = value;
+	else if (name == "money") money = value;
+	else if (name == "income") income = value;
+	else if (name == "spawnControl") spawnControl = value;
+	else if (name == "flagCarried") flagCarried = value;
+	else if (name == "flagDistance") flagDistance = value;
+	else return false;
+	return true;
+}
+
+bool EvalWeights::load(const char* path)
+{
+	std::ifstream in(path);
+	if (!in)
+	{
+		std::cout << "Can't open weights file " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::istringstream words(line);
+		std::string name;
+		float value;
+		if (!(words >> name) || name[0] == '#')
+		{
+			continue;
+		}
+		if (!(words >> value) || !set(name, value))
+		{
+			std::cout << "Bad weight in " << path << ": " << line << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+Evaluation::Evaluation() {}
+
+Evaluation::~Evaluation()
+{
+	detach();
+}
+
+void Evaluation::attach(Board& board)
+{
+	detach();
+	m_board = &board;
+	for (int i = 0; i < UNIT_TYPES; ++i)
+	{
+		m_goldCost[i] = board.rules().goldCost[i];
+	}
+	computeMap();
+
+	for (int p = 0; p < 2; ++p)
+	{
+		m_material[p] = m_income[p] = m_spawnControl[p] = m_carrying[p] = m_carrierDistance[p] = 0;
+	}
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			m_seen[x][y].owner = -1;
+			tileChanged(board, x, y);
+		}
+	}
+	board.addListener(this);
+}
+
+void Evaluation::detach()
+{
+	if (m_board)
+	{
+		m_board->removeListener(this);
+		m_board = nullptr;
+	}
+}
+
+void Evaluation::setWeights(const EvalWeights& weights)
+{
+	m_weights = weights;
+}
+
+const EvalWeights& Evaluation::weights()
+{
+	return m_weights;
+}
+
+float Evaluation::score(Player perspective)
+{
+	if (m_board->gameOver())
+	{
+		return m_board->winner() == perspective ? (float)WIN_SCORE : (float)-WIN_SCORE;
+	}
+
+	int me = perspective;
+	int them = 1 - perspective;
+	return m_weights.material * (m_material[me] - m_material[them])
+		+ m_weights.money * (m_board->money(perspective) - m_board->money(Player(them)))
+		+ m_weights.income * (m_income[me] - m_income[them])
+		+ m_weights.spawnControl * (m_spawnControl[me] - m_spawnControl[them])
+		+ m_weights.flagCarried * (m_carrying[me] - m_carrying[them])
+		- m_weights.flagDistance * (m_carrierDistance[me] - m_carrierDistance[them]);
+}
+
+int Evaluation::homeDistance(Player player, int x, int y)
+{
+	return m_distances.terrainHomeDistance(player, x, y);
+}
+
+void Evaluation::tileChanged(Board& board, int x, int y)
+{
+	Tile* tile = board.getTile(x, y);
+	if (!tile)
+	{
+		return;
+	}
+
+	// Take back what the tile used to be worth, then add what it's worth now
+	addTile(x, y, -1);
+	TileSeen& seen = m_seen[x][y];
+	Unit* unit = tile->unit();
+	seen.owner = unit ? (signed char)unit->owner() : -1;
+	seen.type = unit ? (unsigned char)unit->type() : 0;
+	seen.carrying = unit && unit->flag();
+	addTile(x, y, 1);
+}
+
+void Evaluation::addTile(int x, int y, int sign)
+{
+	const TileSeen& seen = m_seen[x][y];
+	if (seen.owner < 0)
+	{
+		return;
+	}
+	int p = seen.owner;
+	m_material[p] += sign * m_goldCost[seen.type];
+	m_income[p] += sign * m_gold[x][y];
+	m_spawnControl[p] += sign * m_spawnValue[x][y];
+	if (seen.carrying)
+	{
+		m_carrying[p] += sign;
+		m_carrierDistance[p] += sign * m_distances.terrainHomeDistance(Player(p), x, y);
+	}
+}
+
+void Evaluation::computeMap()
+{
+	Board& board = *m_board;
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = board.getTile(x, y);
+			m_gold[x][y] = tile && tile->type() == Tile::GOLD;
+			m_spawnValue[x][y] = 0;
+			if (tile && tile->type() == Tile::SPAWN)
+			{
+				// Worth one per spawnable tile next to it (that's what SpawnableTile looks at)
+				for (int i = 0; i < 6; ++i)
+				{
+					int adjX, adjY;
+					if (Board::adjacentPosition(x, y, i, adjX, adjY) && board.getTile(adjX, adjY) &&
+						board.getTile(adjX, adjY)->type() == Tile::SPAWNABLE)
+					{
+						++m_spawnValue[x][y];
+					}
+				}
+			}
+		}
+	}
+
+	m_distances.compute(board);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <string>
+#include "Board.h"
+#include "BoardListener.h"
+#include "DistanceFields.h"
+
+/*
+How much each term of the evaluation is worth. All terms are measured in gold.
+*/
+struct EvalWeights
+{
+	float material = 1.0f; // Per gold of units on the board (Rules::goldCost)
+	float money = 1.0f; // Per gold in the bank
+	float income = 3.0f; // Per gold tile occupied
+	float spawnControl = 0.5f; // Per spawnable tile unlocked by holding its spawn tile
+	float flagCarried = 6.0f; // For carrying the enemy flag at all
+	float flagDistance = 0.75f; // Per step the flag carrier still has to go to reach home
+
+	/*
+	Reads weights from a file of "name value" lines, where name is one of the fields
+	above. Lines starting with # are ignored, and missing names keep their current value.
+	Returns false if the file can't be read or has an unknown name.
+	*/
+	bool load(const char* path);
+
+	/*
+	Sets a weight by name. Returns false if there's no weight with that name.
+	*/
+	bool set(const std::string& name, float value);
+};
+
+/*
+A fast heuristic score for a position, for use at the leaves of a search. The terms
+are kept up to date incrementally as the board changes, so score() is just a handful
+of multiply-adds instead of a pass over every tile.
+*/
+class Evaluation :
+	public BoardListener
+{
+public:
+	Evaluation();
+	~Evaluation();
+
+	/*
+	Computes every term from scratch for the given board and starts listening to it for
+	changes. Detaches from any board this was attached to before. The board has to
+	outlive this evaluation, or be detached from it first.
+	*/
+	void attach(Board& board);
+
+	/*
+	Stops listening to the attached board, if any.
+	*/
+	void detach();
+
+	/*
+	Sets the weights. Takes effect immediately; the terms don't depend on the weights.
+	*/
+	void setWeights(const EvalWeights& weights);
+	const EvalWeights& weights();
+
+	/*
+	Gets the score of the attached board from the given player's point of view.
+	Positive is good for that player. A won game scores plus or minus WIN_SCORE.
+	*/
+	float score(Player perspective);
+
+	/*
+	Gets the distance from (x, y) to the nearest base tile of the given player,
+	walking around mountains. Returns UNREACHABLE if there's no way there.
+	*/
+	int homeDistance(Player player, int x, int y);
+
+	static const int UNREACHABLE = DistanceFields::UNREACHABLE;
+	static const int WIN_SCORE = 100000;
+
+	void tileChanged(Board& board, int x, int y);
+
+private:
+	/*
+	What this evaluation last saw on a tile. Used to take back the old contribution
+	when the tile changes.
+	*/
+	struct TileSeen
+	{
+		signed char owner; // -1 if there's no unit
+		unsigned char type;
+		bool carrying;
+	};
+
+	Board* m_board = nullptr;
+	EvalWeights m_weights;
+	int m_goldCost[UNIT_TYPES];
+
+	// Static per-tile data for the attached board's map
+	bool m_gold[BOARD_WIDTH][BOARD_HEIGHT];
+	int m_spawnValue[BOARD_WIDTH][BOARD_HEIGHT]; // Spawnable tiles a spawn tile unlocks, 0 elsewhere
+	DistanceFields m_distances; // Terrain-only, so the carrier terms don't shift as other units move
+
+	// Running totals per player
+	TileSeen m_seen[BOARD_WIDTH][BOARD_HEIGHT];
+	int m_material[2];
+	int m_income[2];
+	int m_spawnControl[2];
+	int m_carrying[2];
+	int m_carrierDistance[2];
+
+	void computeMap();
+	void addTile(int x, int y, int sign);
+};
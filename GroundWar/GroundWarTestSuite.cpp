@@ -1,8 +1,41 @@
 #include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include <thread>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <cmath>
 #include "Board.h"
 #include "Marines.h"
 #include "AntiTank.h"
 #include "Tank.h"
+#include "PlayoutBatch.h"
+#include "Evaluation.h"
+#include "DistanceFields.h"
+#include "RandomAI.h"
+#include "PathFinder.h"
+#include "Match.h"
+#include "Delta.h"
+#include "Replay.h"
+#include "SelfPlay.h"
+#include "EngineProtocol.h"
+#include "History.h"
+#include "AsyncAI.h"
+#include "SearchAI.h"
+#include "TurnPlanner.h"
+#include "PlannerAI.h"
+#include "CombatOdds.h"
+#include "PolicyNet.h"
+#include "InferenceQueue.h"
+#include "NetAI.h"
+#include "SampleFile.h"
+#include "Tournament.h"
+#include "Tablebase.h"
+#include "OpeningBook.h"
+#include "PositionDatabase.h"
+#include "TimeManager.h"
+#include "Analysis.h"
+#include "ThreatMap.h"
 
 class GroundWarTestSuite : public CxxTest::TestSuite
 {
@@ -80,6 +113,1487 @@ public:
 		TS_ASSERT_EQUALS(board.spawningUnit(), nullptr);
 	}
 
+	void testRules()
+	{
+		Rules rules = Rules::standard();
+		TS_ASSERT_EQUALS(rules.startMoney, START_MONEY);
+		TS_ASSERT_EQUALS(rules.movementPoints, MOVEMENT_POINTS);
+		TS_ASSERT_EQUALS(rules.goldCost[Unit::TANK], 3);
+		TS_ASSERT_EQUALS(rules.movementCost[Unit::MARINES], 6);
+		TS_ASSERT_EQUALS(rules.odds[Unit::TANK][Unit::ANTITANK], 2.0f / 6.0f);
+
+		TS_ASSERT(rules.set("tank.gold", 5));
+		TS_ASSERT(rules.set("odds.marines.tank", 0.25));
+		TS_ASSERT(!rules.set("tank.armor", 1));
+		TS_ASSERT_EQUALS(rules.get("tank.gold"), 5);
+		TS_ASSERT_EQUALS(rules.odds[Unit::MARINES][Unit::TANK], 0.25f);
+
+		// A board plays by the rules it was given
+		rules.set("startMoney", 2);
+		Board custom(rules, 1);
+		TS_ASSERT_EQUALS(custom.money(RED), 2);
+		TS_ASSERT(!custom.canSpawn(redTank));
+	}
+
+	void testLegalActions()
+	{
+		// At the start, red can only spawn: 3 unit types on 4 open base tiles, and can't end the turn yet
+		Board game(Rules::standard(), 0);
+		std::vector<Action> actions;
+		game.legalActions(actions);
+		TS_ASSERT_EQUALS(actions.size(), 12u);
+		for (size_t i = 0; i < actions.size(); ++i)
+		{
+			TS_ASSERT_EQUALS(actions[i].type, Action::SPAWN);
+		}
+
+		TS_ASSERT(game.doAction(Action::spawn(Unit::TANK, 0, 7)));
+		TS_ASSERT_EQUALS(game.money(RED), START_MONEY - 3);
+		TS_ASSERT(!game.doAction(Action::move(0, 7, 5, 5))); // Not adjacent
+		TS_ASSERT(game.doAction(Action::move(0, 7, 0, 6)));
+		TS_ASSERT_EQUALS(game.movementPoints(), MOVEMENT_POINTS - 3);
+
+		game.legalActions(actions);
+		TS_ASSERT(std::find(actions.begin(), actions.end(), Action::endTurn()) != actions.end());
+		TS_ASSERT(game.doAction(Action::endTurn()));
+		TS_ASSERT_EQUALS(game.currentPlayer(), BLUE);
+		TS_ASSERT_EQUALS(game.turn(), 1);
+	}
+
+	void testPlayoutBatch()
+	{
+		Board game(Rules::standard(), 0);
+		PlayoutBatch batch(20, 7);
+		TS_ASSERT_EQUALS(batch.lanes(), 24); // Rounded up to a multiple of 8
+		batch.load(game);
+		batch.run(100);
+		int undecided = 0;
+		for (int lane = 0; lane < batch.lanes(); ++lane)
+		{
+			undecided += batch.winner(lane) == -1;
+		}
+		TS_ASSERT_EQUALS(batch.wins(RED) + batch.wins(BLUE) + undecided, batch.lanes());
+
+		// The SIMD kernels make the same choices as the scalar code for the same seed
+		if (PlayoutBatch::simdAvailable())
+		{
+			PlayoutBatch scalar(64, 3), simd(64, 3);
+			scalar.setUseSimd(false);
+			scalar.load(game);
+			simd.load(game);
+			scalar.run(60);
+			simd.run(60);
+			for (int lane = 0; lane < 64; ++lane)
+			{
+				TS_ASSERT_EQUALS(scalar.winner(lane), simd.winner(lane));
+			}
+		}
+
+		// A red marine carrying the blue flag next to the red base should win most playouts
+		game.getTile(2, 7)->spawnFlag(BLUE);
+		game.getTile(2, 7)->setUnit(new Marines(RED));
+		game.getTile(1, 7)->setUnit(new Tank(BLUE)); // Give blue something so it isn't a stalemate
+		batch.load(game);
+		batch.run(400);
+		TS_ASSERT(batch.wins(RED) > batch.lanes() / 2);
+	}
+
+	void testEvaluation()
+	{
+		Board game(Rules::standard(), 0);
+		Evaluation eval;
+		eval.attach(game);
+		TS_ASSERT_EQUALS(eval.score(RED), 0.0f); // The start is symmetric
+		TS_ASSERT_EQUALS(eval.homeDistance(RED, 0, 7), 0);
+		TS_ASSERT_EQUALS(eval.homeDistance(RED, 1, 7), 1);
+		TS_ASSERT_EQUALS(eval.homeDistance(BLUE, 4, 4), Evaluation::UNREACHABLE); // Mountain
+
+		// Spawning moves gold from the bank onto the game, which is worth the same
+		game.doAction(Action::spawn(Unit::TANK, 0, 7));
+		TS_ASSERT_EQUALS(eval.score(RED), 0.0f);
+		game.doAction(Action::move(0, 7, 0, 6));
+		game.doAction(Action::endTurn());
+		game.doAction(Action::spawn(Unit::MARINES, 9, 0));
+		game.doAction(Action::move(9, 0, 8, 0));
+
+		// The incrementally updated score matches one computed from scratch
+		Evaluation fresh;
+		fresh.attach(game);
+		TS_ASSERT_EQUALS(eval.score(RED), fresh.score(RED));
+		TS_ASSERT_EQUALS(eval.score(BLUE), -eval.score(RED));
+
+		EvalWeights weights;
+		TS_ASSERT(weights.set("income", 10.0f));
+		TS_ASSERT(!weights.set("luck", 1.0f));
+	}
+
+	void testDistanceFields()
+	{
+		Board start(Rules::standard(), 0);
+		DistanceFields fields;
+		fields.attach(start);
+		TS_ASSERT_EQUALS(fields.terrainHomeDistance(RED, 0, 7), 0);
+		TS_ASSERT_EQUALS(fields.terrainHomeDistance(RED, 4, 5), 4);
+		TS_ASSERT_EQUALS(fields.terrainHomeDistance(BLUE, 4, 4), DistanceFields::UNREACHABLE); // Mountain
+		TS_ASSERT_EQUALS(fields.fieldKind(fields.goldField()), DistanceFields::ANY_GOLD);
+		int field = fields.fieldAt(0, 7);
+		TS_ASSERT_EQUALS(fields.fieldKind(field), DistanceFields::BASE_TILE);
+		TS_ASSERT_EQUALS(fields.terrainDistance(field, 1, 7), 1);
+
+		// A unit on a base blocks the way onto it, but not onto the other bases
+		start.doAction(Action::spawn(Unit::MARINES, 0, 7));
+		TS_ASSERT_EQUALS(fields.distance(field, 1, 7), DistanceFields::UNREACHABLE);
+		TS_ASSERT_EQUALS(fields.terrainDistance(field, 1, 7), 1);
+		TS_ASSERT_EQUALS(fields.homeDistance(RED, 1, 7), 1);
+		start.doAction(Action::move(0, 7, 0, 6));
+		TS_ASSERT_EQUALS(fields.distance(field, 1, 7), 1);
+
+		// Random games keep the incrementally updated fields equal to fresh ones
+		Board game(Rules::standard(), 7);
+		fields.attach(game);
+		RandomAI ai(11);
+		for (int i = 0; i < 400 && !game.gameOver(); ++i)
+		{
+			game.doAction(ai.chooseAction(game));
+			DistanceFields fresh;
+			fresh.compute(game);
+			for (int f = 0; f < fields.fieldCount(); ++f)
+			{
+				for (int x = 0; x < BOARD_WIDTH; ++x)
+				{
+					for (int y = 0; y < BOARD_HEIGHT; ++y)
+					{
+						TS_ASSERT_EQUALS(fields.distance(f, x, y), fresh.distance(f, x, y));
+					}
+				}
+			}
+		}
+		fields.detach(); // The game goes out of scope first
+	}
+
+	void testMoveAlongPath()
+	{
+		TS_ASSERT_EQUALS(PathFinder::hexDistance(7, 7, 8, 6), 1);
+		TS_ASSERT_EQUALS(PathFinder::hexDistance(0, 7, 4, 5), 4);
+
+		Board game(Rules::standard(), 0);
+		// A tank (3 points a step) can go 4 steps with 12 points
+		game.doAction(Action::spawn(Unit::TANK, 0, 7));
+		PathFinder paths;
+		TS_ASSERT(paths.find(game, game.getTile(0, 7), game.getTile(4, 5), 12));
+		TS_ASSERT_EQUALS(paths.cost(), 12);
+		TS_ASSERT_EQUALS(paths.path().size(), 4u);
+		TS_ASSERT_EQUALS(paths.path().back(), game.getTile(4, 5));
+		TS_ASSERT(!paths.find(game, game.getTile(0, 7), game.getTile(4, 5), 11));
+		TS_ASSERT(!paths.find(game, game.getTile(0, 7), game.getTile(4, 4), 12)); // Mountain
+
+		TS_ASSERT(game.moveAlongPath(game.getTile(0, 7), game.getTile(4, 5)));
+		TS_ASSERT(game.getTile(4, 5)->unit());
+		TS_ASSERT_EQUALS(game.movementPoints(), 0);
+		TS_ASSERT(!game.moveAlongPath(game.getTile(4, 5), game.getTile(5, 5)));
+	}
+
+	void testHighlights()
+	{
+		Board game(Rules::standard(), 0);
+		auto click = [&](int x, int y)
+		{
+			SDL_Point* p = game.tilePosition(x, y);
+			game.onMouseClick(p->x + TILE_WIDTH / 2, p->y + TILE_HEIGHT / 2);
+			delete p;
+		};
+
+		// Only red's base can take a unit waiting to be spawned
+		game.prepareToSpawn(Unit::TANK);
+		TS_ASSERT_EQUALS(game.highlight(0, 7), SPAWNABLE_HIGHLIGHT);
+		TS_ASSERT_EQUALS(game.highlight(9, 0), 0);
+		TS_ASSERT_EQUALS(game.highlight(0, 2), 0);
+		click(0, 7);
+		TS_ASSERT(game.getTile(0, 7)->unit());
+		TS_ASSERT_EQUALS(game.highlight(0, 7), 0);
+
+		// The selected tank can move next to itself, or attack the enemy there
+		int enemyX = -1, enemyY = -1;
+		for (int dir = 0; dir < 6 && enemyX < 0; ++dir)
+		{
+			int x, y;
+			if (Board::adjacentPosition(0, 7, dir, x, y) && game.getTile(x, y) && game.getTile(x, y)->openForMovement())
+			{
+				game.getTile(x, y)->setUnit(new Marines(BLUE));
+				enemyX = x;
+				enemyY = y;
+			}
+		}
+		TS_ASSERT(enemyX >= 0);
+		if (enemyX < 0)
+		{
+			return;
+		}
+		click(0, 7);
+		TS_ASSERT_EQUALS(game.highlight(0, 7), SELECTED);
+		TS_ASSERT_EQUALS(game.highlight(enemyX, enemyY), ATTACKABLE);
+		for (int x = 0; x < BOARD_WIDTH; ++x)
+		{
+			for (int y = 0; y < BOARD_HEIGHT; ++y)
+			{
+				Tile* tile = game.getTile(x, y);
+				bool movable = tile && tile->isAdjacent(game.getTile(0, 7)) && tile->openForMovement();
+				TS_ASSERT_EQUALS(game.highlight(x, y) == MOVABLE, movable);
+			}
+		}
+
+		// Moving changes the game, so the masks follow the tank
+		int toX = -1, toY = -1;
+		for (int dir = 0; dir < 6 && toX < 0; ++dir)
+		{
+			if (Board::adjacentPosition(0, 7, dir, toX, toY) && game.highlight(toX, toY) != MOVABLE)
+			{
+				toX = -1;
+			}
+		}
+		TS_ASSERT(toX >= 0);
+		if (toX < 0)
+		{
+			return;
+		}
+		click(toX, toY);
+		TS_ASSERT(game.getTile(toX, toY)->unit());
+		TS_ASSERT_EQUALS(game.highlight(toX, toY), 0);
+		click(toX, toY);
+		TS_ASSERT_EQUALS(game.highlight(toX, toY), SELECTED);
+		TS_ASSERT_EQUALS(game.highlight(0, 7), MOVABLE);
+	}
+
+	void testMatch()
+	{
+		Action action;
+		TS_ASSERT(Action::parse("spawn antitank 0 7", action));
+		TS_ASSERT(action == Action::spawn(Unit::ANTITANK, 0, 7));
+		TS_ASSERT_EQUALS(action.toString(), "spawn antitank 0 7");
+		TS_ASSERT(Action::parse(Action::move(1, 2, 3, 4).toString(), action));
+		TS_ASSERT(action == Action::move(1, 2, 3, 4));
+		TS_ASSERT(!Action::parse("move 1 2 3", action));
+		TS_ASSERT(!Action::parse("end now", action));
+
+		Match match(0, 1);
+		TS_ASSERT(match.join(10, Match::PLAY_RED));
+		TS_ASSERT(match.join(11, Match::WATCH));
+
+		// A side that's taken can't be joined as by anyone else until it's free again
+		TS_ASSERT(!match.join(11, Match::PLAY_RED));
+		TS_ASSERT(!match.join(12, Match::PLAY_BOTH));
+		TS_ASSERT_EQUALS(match.sidesOf(11), Match::WATCH);
+		TS_ASSERT(match.join(12, Match::PLAY_BLUE));
+		TS_ASSERT(match.join(10, Match::PLAY_RED, true)); // Rejoining keeps its own side
+		match.leave(12);
+		TS_ASSERT(match.join(11, Match::PLAY_BLUE));
+		TS_ASSERT(match.join(11, Match::WATCH));
+		std::string changes, delta, error;
+		TS_ASSERT(!match.apply(11, Action::spawn(Unit::TANK, 0, 7), changes, delta, error));
+		TS_ASSERT_EQUALS(error, "not your turn");
+		TS_ASSERT(!match.apply(10, Action::spawn(Unit::TANK, 0, 6), changes, delta, error));
+		TS_ASSERT_EQUALS(error, "can't spawn there");
+
+		// Only the tile that changed and the state go out
+		TS_ASSERT(match.apply(10, Action::spawn(Unit::TANK, 0, 7), changes, delta, error));
+		TS_ASSERT_EQUALS(changes, "tile 0 7 rt\nstate 0 red 12 7 10 -\n");
+		changes.clear();
+		TS_ASSERT(!match.apply(10, Action::move(0, 7, 4, 4), changes, delta, error));
+		TS_ASSERT_EQUALS(error, "can't move there");
+		TS_ASSERT(match.apply(10, Action::move(0, 7, 0, 6), changes, delta, error));
+		TS_ASSERT_EQUALS(delta.size(), std::string("delta \n").size() + 14); // 7 bytes as hex
+		TS_ASSERT(match.apply(10, Action::endTurn(), changes, delta, error));
+		TS_ASSERT(!match.apply(10, Action::endTurn(), changes, delta, error));
+		TS_ASSERT_EQUALS(error, "not your turn");
+	}
+
+	void testDelta()
+	{
+		Board game(Rules::standard(), 5);
+		Board copy(Rules::standard(), 5);
+		RandomAI ai(3);
+		DeltaEncoder encoder(16);
+		std::vector<unsigned char> records;
+		BoardState expected, actual;
+
+		int keyframes = 0;
+		for (int i = 0; i < 300 && !game.gameOver(); ++i)
+		{
+			if (i > 0)
+			{
+				TS_ASSERT(game.doAction(ai.chooseAction(game)));
+			}
+			std::vector<unsigned char> record;
+			keyframes += encoder.encode(game, record);
+			TS_ASSERT_EQUALS(isKeyframe(&record[0], record.size()), i % 16 == 0);
+			if (!isKeyframe(&record[0], record.size()))
+			{
+				TS_ASSERT_LESS_THAN(record.size(), 16u);
+			}
+
+			// Applying the record brings the copy up to date
+			TS_ASSERT_EQUALS(applyRecord(copy, &record[0], record.size()), record.size());
+			game.saveState(expected);
+			copy.saveState(actual);
+			TS_ASSERT(expected == actual);
+			records.insert(records.end(), record.begin(), record.end());
+		}
+		TS_ASSERT_LESS_THAN(1, keyframes);
+
+		// The stream replays from any keyframe, and the last state comes out the same
+		BoardState replayed = BoardState();
+		size_t offset = 0;
+		while (offset < records.size())
+		{
+			size_t read = applyRecord(replayed, &records[offset], records.size() - offset);
+			TS_ASSERT_LESS_THAN(0u, read);
+			if (!read)
+			{
+				break;
+			}
+			offset += read;
+		}
+		TS_ASSERT(replayed == expected);
+
+		// Records with a player or winner Board can't hold are turned down
+		std::vector<unsigned char> bad;
+		TS_ASSERT(fromHex("8000010001010c00", bad));
+		TS_ASSERT_EQUALS(applyRecord(replayed, &bad[0], bad.size()), bad.size());
+		TS_ASSERT(fromHex("8000050001010c00", bad));
+		TS_ASSERT_EQUALS(applyRecord(replayed, &bad[0], bad.size()), 0u);
+		TS_ASSERT(fromHex("8000010501010c00", bad));
+		TS_ASSERT_EQUALS(applyRecord(replayed, &bad[0], bad.size()), 0u);
+		TS_ASSERT(fromHex("100005", bad));
+		TS_ASSERT_EQUALS(applyRecord(replayed, &bad[0], bad.size()), 0u);
+		replayed.player = 5;
+		TS_ASSERT(fromHex("0800", bad));
+		TS_ASSERT_EQUALS(applyRecord(replayed, &bad[0], bad.size()), 0u);
+
+		// Loading an older state puts the board back
+		Board fresh;
+		fresh.saveState(actual);
+		game.loadState(actual);
+		game.saveState(expected);
+		TS_ASSERT(expected == actual);
+		TS_ASSERT(game.getTile(0, 7)->unit() == nullptr);
+	}
+
+	void testReplay()
+	{
+		RandomAI red(1), blue(2);
+		std::vector<unsigned char> records;
+		GameResult result = playGame(Rules::standard(), red, blue, 9, 60, &records);
+
+		// Go through the game record by record to get the state after every action
+		std::vector<BoardState> states;
+		BoardState state;
+		for (size_t offset = 0; offset < records.size();)
+		{
+			offset += applyRecord(state, &records[offset], records.size() - offset);
+			states.push_back(state);
+		}
+
+		Board game;
+		Replay replay(game, 8);
+		TS_ASSERT(replay.load(records));
+		TS_ASSERT_EQUALS(replay.length(), result.actions);
+		TS_ASSERT_EQUALS((int)states.size(), result.actions + 1);
+
+		// Jumping around lands on the same state as playing through
+		int targets[] = { 5, 40, 3, 3, 4, result.actions, 17, 0, 1000, -2 };
+		for (int i = 0; i < 10; ++i)
+		{
+			replay.seek(targets[i]);
+			int expected = std::max(0, std::min(targets[i], result.actions));
+			TS_ASSERT_EQUALS(replay.position(), expected);
+			game.saveState(state);
+			TS_ASSERT(state == states[expected]);
+		}
+
+		// Playback stops at the end
+		replay.setSpeed(10);
+		replay.setPlaying(true);
+		replay.update(0.25);
+		TS_ASSERT_EQUALS(replay.position(), 2);
+		replay.update(1000);
+		TS_ASSERT_EQUALS(replay.position(), result.actions);
+		TS_ASSERT(!replay.playing());
+
+		std::vector<unsigned char> broken(records.begin() + 1, records.end());
+		TS_ASSERT(!replay.load(broken));
+		TS_ASSERT_EQUALS(replay.length(), 0);
+	}
+
+	void testHistory()
+	{
+		Board game(Rules::standard(), 4);
+		RandomAI ai(6);
+		History history(game, true);
+		std::vector<BoardState> states(1);
+		game.saveState(states[0]);
+		while (states.size() < 400 && !game.gameOver())
+		{
+			TS_ASSERT(game.doAction(ai.chooseAction(game)));
+			history.record();
+			states.push_back(BoardState());
+			game.saveState(states.back());
+		}
+		history.record(); // Nothing changed, so no new step
+		TS_ASSERT_EQUALS(history.steps(), (int)states.size() - 1);
+		TS_ASSERT_LESS_THAN(history.bytes(), states.size() * 40);
+
+		// All the way back and forward again
+		BoardState state;
+		for (int i = (int)states.size() - 2; i >= 0; --i)
+		{
+			TS_ASSERT(history.undo());
+			game.saveState(state);
+			TS_ASSERT(state == states[i]);
+		}
+		TS_ASSERT(!history.undo());
+		for (size_t i = 1; i < states.size(); ++i)
+		{
+			TS_ASSERT(history.redo());
+			game.saveState(state);
+			TS_ASSERT(state == states[i]);
+		}
+		TS_ASSERT(!history.redo());
+
+		// A new action after undoing drops the redo steps
+		Board fresh;
+		History turn(fresh);
+		TS_ASSERT(fresh.doAction(Action::spawn(Unit::MARINES, 0, 7)));
+		turn.record();
+		TS_ASSERT(fresh.doAction(Action::move(0, 7, 0, 6)));
+		turn.record();
+		TS_ASSERT(turn.undo());
+		TS_ASSERT(fresh.doAction(Action::move(0, 7, 1, 7)));
+		turn.record();
+		TS_ASSERT(!turn.canRedo());
+		TS_ASSERT_EQUALS(turn.steps(), 2);
+
+		// Without acrossTurns, ending the turn can't be taken back
+		fresh.nextTurn();
+		turn.record();
+		TS_ASSERT(!turn.undo());
+		TS_ASSERT_EQUALS(fresh.currentPlayer(), BLUE);
+
+		// Undoing an attack doesn't give it a new roll, whichever way it went
+		for (unsigned seed = 0; seed < 8; ++seed)
+		{
+			Board fight(Rules::standard(), seed);
+			fight.getTile(5, 4)->setUnit(new Marines(RED));
+			fight.getTile(5, 5)->setUnit(new Marines(BLUE));
+			fight.getTile(6, 4)->setUnit(new Marines(BLUE));
+			History rolls(fight);
+			BoardState first, again;
+			TS_ASSERT(fight.doAction(Action::attack(5, 4, 5, 5)));
+			rolls.record();
+			fight.saveState(first);
+			TS_ASSERT(rolls.undo());
+			TS_ASSERT(fight.doAction(Action::attack(5, 4, 5, 5)));
+			rolls.record();
+			fight.saveState(again);
+			TS_ASSERT(first == again);
+
+			// Redoing brings the roll after it back too
+			TS_ASSERT(rolls.undo());
+			TS_ASSERT(rolls.redo());
+			TS_ASSERT_EQUALS(fight.rolls(), 1u);
+		}
+	}
+
+	void testAsyncAI()
+	{
+		// Everything pushed on one thread comes out in order on the other
+		SpscQueue<int, 8> queue;
+		std::thread producer([&queue]()
+		{
+			for (int i = 0; i < 10000; ++i)
+			{
+				while (!queue.push(i))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+		int expected = 0;
+		while (expected < 10000)
+		{
+			int item;
+			if (queue.pop(item))
+			{
+				TS_ASSERT_EQUALS(item, expected);
+				++expected;
+			}
+		}
+		producer.join();
+
+		// The AI plays from a snapshot; the real board only changes when its actions are applied
+		Board game;
+		AsyncAI ai(new RandomAI(2), RED);
+		BoardState before, after;
+		for (int i = 0; i < 20 && game.currentPlayer() == RED; ++i)
+		{
+			game.saveState(before);
+			ai.think(game);
+			Action action;
+			while (!ai.poll(action))
+			{
+				TS_ASSERT(ai.thinking());
+				std::this_thread::yield();
+			}
+			TS_ASSERT(!ai.thinking());
+			game.saveState(after);
+			TS_ASSERT(before == after);
+			TS_ASSERT(game.doAction(action));
+		}
+
+		// A cancelled search's action never shows up
+		ai.think(game);
+		ai.cancel();
+		TS_ASSERT(!ai.thinking());
+		ai.think(game);
+		Action action;
+		while (!ai.poll(action))
+		{
+			std::this_thread::yield();
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		TS_ASSERT(!ai.poll(action));
+	}
+
+	void testSearchAI()
+	{
+		// Attacks can be made to go either way
+		Board won, lost;
+		won.getTile(5, 4)->setUnit(new Marines(RED));
+		won.getTile(5, 5)->setUnit(new Marines(BLUE));
+		lost.getTile(5, 4)->setUnit(new Marines(RED));
+		lost.getTile(5, 5)->setUnit(new Marines(BLUE));
+		TS_ASSERT(won.doAction(Action::attack(5, 4, 5, 5), true));
+		TS_ASSERT_EQUALS(won.getTile(5, 5)->unit()->owner(), RED);
+		TS_ASSERT(lost.doAction(Action::attack(5, 4, 5, 5), false));
+		TS_ASSERT(lost.getTile(5, 4)->unit() == nullptr);
+		TS_ASSERT_EQUALS(lost.money(BLUE), START_MONEY + 1);
+
+		// The same position reached in a different order hashes the same
+		Board first, second;
+		BoardState a, b;
+		first.doAction(Action::spawn(Unit::TANK, 0, 7));
+		first.doAction(Action::spawn(Unit::MARINES, 1, 8));
+		second.doAction(Action::spawn(Unit::MARINES, 1, 8));
+		second.doAction(Action::spawn(Unit::TANK, 0, 7));
+		first.saveState(a);
+		second.saveState(b);
+		TS_ASSERT_EQUALS(a.hash(), b.hash());
+		second.doAction(Action::move(0, 7, 0, 6));
+		second.saveState(b);
+		TS_ASSERT_DIFFERS(a.hash(), b.hash());
+
+		// Takes a win when there is one, with helper threads searching alongside
+		Board winning;
+		winning.getTile(2, 7)->spawnFlag(BLUE);
+		winning.getTile(2, 7)->setUnit(new Marines(RED));
+		SearchAI parallel(100000, 4, nullptr, nullptr, 3);
+		TS_ASSERT_EQUALS(parallel.threads(), 3u);
+		TS_ASSERT(winning.doAction(parallel.chooseAction(winning)));
+		TS_ASSERT(winning.gameOver());
+		TS_ASSERT_EQUALS(winning.winner(), RED);
+		TS_ASSERT_EQUALS(parallel.depth(), 4);
+
+		// Pondering a position gets a head start on the turn that follows, if the other
+		// player plays the way it guessed
+		Board game(Rules::standard(), 1);
+		RandomAI random(5);
+		for (int i = 0; i < 11 || game.currentPlayer() != RED; ++i)
+		{
+			game.doAction(random.chooseAction(game));
+		}
+		SearchAI pondering(100000, 3), fresh(100000, 3), other(100000, 2);
+		std::atomic<bool> stop(false);
+		pondering.ponder(game, stop);
+		while (game.currentPlayer() == RED && !game.gameOver())
+		{
+			game.doAction(other.chooseAction(game), true);
+		}
+		TS_ASSERT(game.doAction(pondering.chooseAction(game)));
+		fresh.chooseAction(game);
+		TS_ASSERT_LESS_THAN(0, pondering.tableHits());
+		TS_ASSERT_LESS_THAN(pondering.nodes() * 2, fresh.nodes());
+	}
+
+	void testTimeManager()
+	{
+		// A turn with gold and movement points left is expected to take several actions,
+		// and one with nothing left just the one that ends it
+		Board game;
+		BoardState state;
+		game.saveState(state);
+		const Rules& rules = game.rules();
+		int actions = TimeManager::expectedActions(state, rules);
+		TS_ASSERT_LESS_THAN(2, actions);
+		BoardState broke = state;
+		broke.money[RED] = 0;
+		TS_ASSERT_EQUALS(TimeManager::expectedActions(broke, rules), 1);
+		TS_ASSERT_LESS_THAN(TimeManager::expectedTurns(broke, rules), TimeManager::expectedTurns(state, rules));
+
+		// A turn's time is shared between its actions, with the hard limit leaving some for the rest
+		TimeManager time;
+		time.setTurnTime(1200);
+		time.startAction(state, rules);
+		TS_ASSERT_DELTA(time.softLimit(), 1200.0 / actions, 0.001);
+		TS_ASSERT_LESS_THAN(time.softLimit(), time.hardLimit());
+		TS_ASSERT_LESS_THAN(time.hardLimit(), 1200.0);
+		TS_ASSERT(time.worthDeepening(0, 0));
+		TS_ASSERT(!time.worthDeepening(time.hardLimit(), 1));
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		time.finishAction();
+		time.startAction(state, rules);
+		TS_ASSERT_LESS_THAN(time.softLimit(), 1180.0 / actions + 0.001);
+
+		// The next turn starts over, and a game clock gives a turn at most half of what's left
+		time.finishAction();
+		TS_ASSERT(game.doAction(Action::spawn(Unit::TANK, 0, 7)));
+		TS_ASSERT(game.doAction(Action::move(0, 7, 0, 6)));
+		TS_ASSERT(game.doAction(Action::endTurn()));
+		game.saveState(state);
+		time.startAction(state, rules);
+		TS_ASSERT_DELTA(time.softLimit(), 1200.0 / TimeManager::expectedActions(state, rules), 0.001);
+		time.finishAction();
+		time.setGameTime(1000, 10);
+		time.startAction(state, rules);
+		TS_ASSERT_LESS_THAN(time.softLimit(), 500.0 / TimeManager::expectedActions(state, rules) + 0.001);
+		TS_ASSERT_LESS_THAN(0, time.hardLimit());
+		time.finishAction();
+
+		// A search stops soon after it's told to, and still plays a legal action
+		Board midgame(Rules::standard(), 3);
+		RandomAI random(3);
+		for (int i = 0; i < 30 || midgame.currentPlayer() != RED; ++i)
+		{
+			midgame.doAction(random.chooseAction(midgame));
+		}
+		SearchAI slow(100000, 64, nullptr, nullptr, 2);
+		std::atomic<bool> stop(false);
+		std::thread stopper([&stop]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			stop = true;
+		});
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Action action = slow.chooseAction(midgame, stop);
+		stopper.join();
+		TS_ASSERT_LESS_THAN(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+		midgame.saveState(state);
+		Board copy(Rules::standard(), 0);
+		copy.loadState(state);
+		TS_ASSERT(copy.doAction(action));
+
+		// With a turn budget, every action keeps to its hard limit
+		SearchAI timed(100, 64, nullptr, nullptr);
+		timed.setTurnTime(60);
+		for (int i = 0; i < 8 && !midgame.gameOver(); ++i)
+		{
+			start = std::chrono::steady_clock::now();
+			action = timed.chooseAction(midgame);
+			double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			TS_ASSERT_LESS_THAN(elapsed, timed.timeManager().hardLimit() + 25);
+			TS_ASSERT(midgame.doAction(action, true));
+		}
+
+		// Hurrying an AI gets its best action so far
+		AsyncAI async(new SearchAI(100000, 64, nullptr, nullptr), midgame.currentPlayer());
+		async.think(midgame);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		async.hurry();
+		while (!async.poll(action))
+		{
+			std::this_thread::yield();
+		}
+		TS_ASSERT(midgame.doAction(action, true));
+	}
+
+	void testThreatMap()
+	{
+		// A unit's threat is the chance that at least one of the enemies that can reach it wins
+		Board game;
+		game.getTile(2, 4)->setUnit(new Marines(RED));
+		game.getTile(2, 5)->setUnit(new Tank(BLUE));
+		game.getTile(3, 4)->setUnit(new AntiTank(BLUE));
+		ThreatMap threats;
+		threats.compute(game);
+		const Rules& rules = game.rules();
+		float survives = (1 - rules.odds[Unit::TANK][Unit::MARINES]) * (1 - rules.odds[Unit::ANTITANK][Unit::MARINES]);
+		TS_ASSERT_DELTA(threats.threat(RED, Unit::MARINES, 2, 4), 1 - survives, 0.0001f);
+		TS_ASSERT_DELTA(threats.threat(BLUE, Unit::TANK, 2, 5), rules.odds[Unit::MARINES][Unit::TANK], 0.0001f);
+		TS_ASSERT_EQUALS(threats.attackers(BLUE, 2, 4), 2);
+		TS_ASSERT_EQUALS(threats.attackers(RED, 2, 5), 1);
+
+		// Units can only attack as far as their movement points take them, and can't walk through other units
+		Rules slow = Rules::standard();
+		slow.movementPoints = 1;
+		std::fill(slow.movementCost, slow.movementCost + UNIT_TYPES, 1);
+		Board near(slow, 0);
+		near.getTile(2, 5)->setUnit(new Marines(BLUE));
+		threats.compute(near);
+		TS_ASSERT_LESS_THAN(0.0f, threats.threat(RED, Unit::TANK, 2, 4));
+		TS_ASSERT_EQUALS(threats.threat(RED, Unit::TANK, 2, 3), 0.0f);
+		slow.movementPoints = 2;
+		Board far(slow, 0);
+		far.getTile(2, 5)->setUnit(new Marines(BLUE));
+		threats.compute(far);
+		TS_ASSERT_LESS_THAN(0.0f, threats.threat(RED, Unit::TANK, 2, 3));
+		far.getTile(2, 4)->setUnit(new Marines(RED));
+		threats.compute(far);
+		TS_ASSERT_EQUALS(threats.threat(RED, Unit::TANK, 2, 3), 0.0f);
+
+		// Kept up to date through a game, the maps match ones made from scratch, with or without AVX2
+		Board played(Rules::standard(), 4);
+		RandomAI random(4);
+		ThreatMap attached, scalar;
+		attached.attach(played);
+		scalar.setUseSimd(false);
+		for (int i = 0; i < 300 && !played.gameOver(); ++i)
+		{
+			played.doAction(random.chooseAction(played));
+			threats.compute(played);
+			scalar.compute(played);
+			for (int player = 0; player < 2; ++player)
+			{
+				for (int type = 0; type < UNIT_TYPES; ++type)
+				{
+					const float* expected = threats.threats(Player(player), Unit::UnitType(type));
+					TS_ASSERT(std::equal(expected, expected + BOARD_TILES, attached.threats(Player(player), Unit::UnitType(type))));
+					TS_ASSERT(std::equal(expected, expected + BOARD_TILES, scalar.threats(Player(player), Unit::UnitType(type))));
+				}
+				TS_ASSERT_EQUALS(attached.attackers(Player(player), 6, 4), threats.attackers(Player(player), 6, 4));
+			}
+		}
+	}
+
+	void testAnalysis()
+	{
+		TS_ASSERT_EQUALS(Analysis::winChance(0), 0.5f);
+		TS_ASSERT_LESS_THAN(0.99f, Analysis::winChance((float)Evaluation::WIN_SCORE));
+
+		// A winning position comes back as a sure win, with the winning move's tile marked best
+		Board winning;
+		winning.getTile(2, 7)->spawnFlag(BLUE);
+		winning.getTile(2, 7)->setUnit(new Marines(RED));
+		Analysis analysis(nullptr);
+		TS_ASSERT(analysis.result() == nullptr);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		while ((!analysis.result() || analysis.result()->depth < 2) &&
+			std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+		{
+			analysis.update(winning);
+			std::this_thread::yield();
+		}
+		const AnalysisResult* result = analysis.result();
+		TS_ASSERT(result && result->depth >= 2);
+		if (result)
+		{
+			TS_ASSERT_LESS_THAN(0.99f, result->redChance);
+			int best = 0;
+			for (int i = 0; i < BOARD_TILES; ++i)
+			{
+				best += result->best[i] == 0 ? 1 : 0;
+			}
+			TS_ASSERT_LESS_THAN(0, best);
+		}
+
+		// Once the position changes, the old results are dropped
+		winning.doAction(Action::spawn(Unit::TANK, 0, 7));
+		analysis.update(winning);
+		TS_ASSERT(analysis.result() == nullptr);
+		while (!analysis.result() && std::chrono::steady_clock::now() - start < std::chrono::seconds(20))
+		{
+			analysis.update(winning);
+			std::this_thread::yield();
+		}
+		TS_ASSERT(analysis.result() != nullptr);
+		analysis.stop();
+		TS_ASSERT(analysis.result() == nullptr);
+	}
+
+	void testTurnPlanner()
+	{
+		// Spawning the same units in a different order reaches the same position, so
+		// there are far fewer positions than sequences
+		Board game;
+		TurnPlanner single(1, 100), parallel(3, 100);
+		TurnPlan plan = single.plan(game);
+		TS_ASSERT_LESS_THAN(0, single.duplicates());
+		TS_ASSERT(!plan.actions.empty());
+		TS_ASSERT_EQUALS(plan.actions.size(), plan.positions.size());
+
+		// Splitting the work between threads doesn't change the answer
+		TurnPlan same = parallel.plan(game);
+		TS_ASSERT_EQUALS(same.value, plan.value);
+		TS_ASSERT_EQUALS(same.actions.size(), plan.actions.size());
+		for (size_t i = 0; i < plan.actions.size() && i < same.actions.size(); ++i)
+		{
+			TS_ASSERT(same.actions[i] == plan.actions[i]);
+		}
+		TS_ASSERT_EQUALS(parallel.positions(), single.positions());
+
+		// The plan can be played out as it is, and the AI plays it
+		PlannerAI ai(1, 1, 100);
+		for (size_t i = 0; i < plan.actions.size(); ++i)
+		{
+			BoardState state;
+			game.saveState(state);
+			TS_ASSERT_EQUALS(state.hash(), plan.positions[i]);
+			TS_ASSERT(ai.chooseAction(game) == plan.actions[i]);
+			TS_ASSERT(game.doAction(plan.actions[i]));
+		}
+
+		// Takes a win when there is one
+		Board winning;
+		winning.getTile(2, 7)->spawnFlag(BLUE);
+		winning.getTile(2, 7)->setUnit(new Marines(RED));
+		plan = single.plan(winning);
+		TS_ASSERT_EQUALS(plan.value, (float)Evaluation::WIN_SCORE);
+		for (size_t i = 0; i < plan.actions.size(); ++i)
+		{
+			TS_ASSERT(winning.doAction(plan.actions[i]));
+		}
+		TS_ASSERT(winning.gameOver());
+		TS_ASSERT_EQUALS(winning.winner(), RED);
+	}
+
+	void testCombatOdds()
+	{
+		Board game(Rules::standard(), 0);
+		CombatOdds combat;
+		game.getTile(5, 4)->setUnit(new Marines(RED));
+		game.getTile(5, 5)->spawnFlag(BLUE);
+		game.getTile(5, 5)->setUnit(new AntiTank(BLUE)); // Guarding its flag
+		game.getTile(5, 6)->setUnit(new Tank(BLUE));
+		TS_ASSERT_EQUALS(combat.winChance(game, game.getTile(5, 4), game.getTile(5, 5)), 2.0f / 3.0f);
+		TS_ASSERT_EQUALS(combat.winChance(game, game.getTile(5, 4), game.getTile(5, 6)), 0.0f); // Not adjacent
+
+		// The second attack only happens if the first one is won, and the flag is only kept
+		// if both are
+		std::vector<Action> attacks;
+		attacks.push_back(Action::attack(5, 4, 5, 5));
+		attacks.push_back(Action::attack(5, 5, 5, 6));
+		BoardState before, after;
+		game.saveState(before);
+		std::vector<CombatOutcome> outcomes = combat.distribution(game, attacks);
+		game.saveState(after);
+		TS_ASSERT(before == after);
+		TS_ASSERT_EQUALS(outcomes.size(), 3u);
+		double total = 0;
+		for (size_t i = 0; i < outcomes.size(); ++i)
+		{
+			const CombatOutcome& outcome = outcomes[i];
+			total += outcome.probability;
+			TS_ASSERT_EQUALS(outcome.goldChange, outcome.unitsKilled);
+			TS_ASSERT_EQUALS(outcome.enemyGoldChange, outcome.unitsLost);
+			TS_ASSERT_EQUALS(outcome.flagCaptured, outcome.unitsKilled == 2);
+			if (outcome.unitsKilled == 2)
+			{
+				TS_ASSERT_DELTA(outcome.probability, 2.0 / 3.0 * 1.0 / 3.0, 1e-6);
+			}
+			else if (outcome.unitsKilled == 1)
+			{
+				TS_ASSERT_DELTA(outcome.probability, 2.0 / 3.0 * 2.0 / 3.0, 1e-6);
+				TS_ASSERT_EQUALS(outcome.unitsLost, 1);
+			}
+			else
+			{
+				TS_ASSERT_DELTA(outcome.probability, 1.0 / 3.0, 1e-6);
+				TS_ASSERT_EQUALS(outcome.unitsLost, 1);
+			}
+		}
+		TS_ASSERT_DELTA(total, 1.0, 1e-9);
+		TS_ASSERT_DELTA(outcomes[0].probability, 4.0 / 9.0, 1e-6); // Most likely first
+	}
+
+	void testPolicyNet()
+	{
+		// A few different positions
+		Board game;
+		std::vector<BoardState> states;
+		std::vector<Action> actions;
+		for (int i = 0; i < 6; ++i)
+		{
+			states.push_back(BoardState());
+			game.saveState(states.back());
+			game.legalActions(actions);
+			game.doAction(actions[i % actions.size()]);
+		}
+
+		// Batches give the same answers as one position at a time, in every kernel
+		PolicyNet net(7);
+		std::vector<NetOutput> batch(states.size());
+		net.evaluate(&states[0], (int)states.size(), &batch[0]);
+		for (int quantized = 0; quantized < 2; ++quantized)
+		{
+			for (int simd = 0; simd < 2; ++simd)
+			{
+				PolicyNet other(7);
+				other.setPrecision(quantized ? PolicyNet::INT8 : PolicyNet::FLOAT);
+				other.setUseSimd(simd != 0);
+				for (size_t i = 0; i < states.size(); ++i)
+				{
+					NetOutput single;
+					other.evaluate(&states[i], 1, &single);
+					TS_ASSERT_DELTA(single.value, batch[i].value, quantized ? 0.05f : 1e-4f);
+					TS_ASSERT_DELTA(single.from[3], batch[i].from[3], quantized ? 0.05f : 1e-4f);
+				}
+			}
+		}
+
+		// Priors are a distribution over the legal actions
+		std::vector<float> priors;
+		game.legalActions(actions);
+		NetOutput output;
+		BoardState now;
+		game.saveState(now);
+		net.evaluate(&now, 1, &output);
+		PolicyNet::priors(output, actions, priors);
+		TS_ASSERT_EQUALS(priors.size(), actions.size());
+		float total = 0;
+		for (size_t i = 0; i < priors.size(); ++i)
+		{
+			TS_ASSERT_LESS_THAN(0.0f, priors[i]);
+			total += priors[i];
+		}
+		TS_ASSERT_DELTA(total, 1.0f, 1e-5f);
+
+		// Weights survive a round trip through a file, and other files are turned down
+		const char* path = "policynet-test.gwn";
+		TS_ASSERT(net.save(path));
+		PolicyNet loaded(8);
+		TS_ASSERT(loaded.load(path));
+		NetOutput reloaded;
+		loaded.evaluate(&now, 1, &reloaded);
+		TS_ASSERT_EQUALS(reloaded.value, output.value);
+		std::ofstream(path) << "not a network";
+		TS_ASSERT(!loaded.load(path));
+		std::remove(path);
+
+		// Positions from several threads come out of the queue the same as straight from the net
+		InferenceQueue queue(net, 4, 100000);
+		std::vector<NetOutput> queued(4);
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; ++i)
+		{
+			threads.push_back(std::thread([&, i]()
+			{
+				queue.evaluate(states[i], queued[i]);
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); ++i)
+		{
+			threads[i].join();
+		}
+		TS_ASSERT_EQUALS(queue.positions(), 4);
+		TS_ASSERT_EQUALS(queue.batches(), 1); // Waited long enough for everyone
+		for (int i = 0; i < 4; ++i)
+		{
+			TS_ASSERT_DELTA(queued[i].value, batch[i].value, 1e-4f);
+		}
+
+		// The search plays legal actions
+		NetAI ai(1, 32, 2, nullptr);
+		Action chosen = ai.chooseAction(game);
+		TS_ASSERT(std::find(actions.begin(), actions.end(), chosen) != actions.end());
+		TS_ASSERT_EQUALS(ai.playouts(), 32);
+		TS_ASSERT(game.doAction(chosen));
+	}
+
+	void testSampleFile()
+	{
+		// A couple of short self-play games, one per shard
+		NetAI ai(1, 8, 1, nullptr);
+		std::vector<Sample> first, second;
+		playTrainingGame(ai, 1, 3, 4, first);
+		playTrainingGame(ai, 2, 3, 4, second);
+		TS_ASSERT(!first.empty());
+		TS_ASSERT_EQUALS(first[0].actions.size(), first[0].policy.size());
+
+		std::vector<std::string> paths;
+		paths.push_back(SampleWriter::shardPath("samplefile-test", 0));
+		paths.push_back(SampleWriter::shardPath("samplefile-test", 1));
+		TS_ASSERT_EQUALS(paths[1], "samplefile-test-0001.gws");
+		std::remove(paths[0].c_str());
+		std::remove(paths[1].c_str());
+		{
+			SampleWriter a(paths[0]), b(paths[1]);
+			TS_ASSERT(a.write(first));
+			TS_ASSERT(b.write(second));
+			TS_ASSERT_LESS_THAN(a.bytes(), (long long)(first.size() * sizeof(BoardState))); // Deltas are smaller than states
+		}
+		{
+			SampleWriter again(paths[0]); // Appending adds another block to the same file
+			TS_ASSERT(again.write(first));
+		}
+
+		// Everything comes back, shuffled through a small buffer, with the same contents
+		SampleReader reader(paths, 5, 3);
+		Sample sample;
+		size_t count = 0;
+		bool matched = false;
+		while (reader.next(sample))
+		{
+			++count;
+			if (sample.state == first.back().state)
+			{
+				matched = sample.actions == first.back().actions && sample.result == first.back().result &&
+					std::fabs(sample.policy[0] - first.back().policy[0]) < 1e-4f;
+			}
+		}
+		TS_ASSERT_EQUALS(count, first.size() * 2 + second.size());
+		TS_ASSERT(matched);
+		TS_ASSERT_EQUALS(reader.skipped(), 0);
+
+		// A block cut short by a crash is skipped, and the rest still read
+		std::ofstream(paths[1].c_str(), std::ios::binary | std::ios::app).write("\x40\0\0\0\1\2", 6);
+		reader.rewind();
+		count = 0;
+		while (reader.next(sample))
+		{
+			++count;
+		}
+		TS_ASSERT_EQUALS(count, first.size() * 2 + second.size());
+		TS_ASSERT_EQUALS(reader.skipped(), 1);
+
+		// Games written after a crash are all read back: the torn block is cut off first
+		{
+			std::ifstream in(paths[0].c_str(), std::ios::binary);
+			std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			in.close();
+			std::ofstream(paths[0].c_str(), std::ios::binary | std::ios::trunc).write(data.data(), data.size() - 10);
+		}
+		{
+			SampleWriter again(paths[0]);
+			TS_ASSERT(again.good());
+			for (int i = 0; i < 10; ++i)
+			{
+				TS_ASSERT(again.write(second));
+			}
+		}
+		reader.rewind();
+		count = 0;
+		while (reader.next(sample))
+		{
+			++count;
+		}
+		TS_ASSERT_EQUALS(count, first.size() + second.size() * 11);
+		TS_ASSERT_EQUALS(reader.skipped(), 2); // The block cut short in the other shard, once more
+		std::ofstream(paths[1].c_str(), std::ios::binary) << "not samples";
+		TS_ASSERT(!SampleWriter(paths[1]).good());
+		std::remove(paths[0].c_str());
+		std::remove(paths[1].c_str());
+	}
+
+	void testEngineProtocol()
+	{
+		// Actions read without allocating, one after another on a line
+		Action action;
+		const char* rest = Action::parseFrom("spawn tank 0 7 move 0 7 0 6", action);
+		TS_ASSERT(rest && action == Action::spawn(Unit::TANK, 0, 7));
+		TS_ASSERT(Action::parseFrom(rest, action) && action == Action::move(0, 7, 0, 6));
+		TS_ASSERT(!Action::parse("move 0 7 0 6 end", action));
+		TS_ASSERT(!Action::parse("move 0 7 0 x", action));
+
+		EngineProtocol engine;
+		std::string reply;
+		TS_ASSERT(engine.handle("engine", reply));
+		TS_ASSERT(reply.find("option ai search\n") != std::string::npos);
+		TS_ASSERT(reply.find("engineok\n") != std::string::npos);
+
+		// Positions can be set up from actions, and the state read back and set again
+		reply.clear();
+		engine.handle("position start actions spawn marines 0 7 move 0 7 0 6 end", reply);
+		TS_ASSERT_EQUALS(reply, "");
+		TS_ASSERT_EQUALS(engine.board().currentPlayer(), BLUE);
+		TS_ASSERT(engine.board().getTile(0, 6)->unit());
+		engine.handle("state", reply);
+		std::string state = reply.substr(6, reply.size() - 7);
+		reply.clear();
+		engine.handle("position start", reply);
+		TS_ASSERT(!engine.board().getTile(0, 6)->unit());
+		engine.handle(("position " + state).c_str(), reply);
+		TS_ASSERT_EQUALS(reply, "");
+		TS_ASSERT(engine.board().getTile(0, 6)->unit());
+
+		// Attacks can be given an outcome
+		engine.handle("newgame", reply);
+		engine.board().getTile(5, 4)->setUnit(new Marines(RED));
+		engine.board().getTile(5, 5)->setUnit(new Marines(BLUE));
+		engine.handle("action attack 5 4 5 5 lost", reply);
+		TS_ASSERT_EQUALS(reply, "");
+		TS_ASSERT(!engine.board().getTile(5, 4)->unit());
+
+		// Search can be given more threads, and still answers
+		engine.handle("setoption threads 2", reply);
+		engine.handle("go movetime 10", reply);
+		TS_ASSERT_EQUALS(reply.find("error"), std::string::npos);
+		TS_ASSERT(reply.find("bestaction ") != std::string::npos);
+		reply.clear();
+
+		// Searching gives a legal action
+		engine.handle("newgame", reply);
+		engine.handle("setoption ai random", reply);
+		engine.handle("go movetime 10", reply);
+		TS_ASSERT_EQUALS(reply.find("info time "), 0u);
+		size_t at = reply.find("bestaction ");
+		TS_ASSERT(at != std::string::npos);
+		TS_ASSERT(Action::parse(reply.substr(at + 11, reply.size() - at - 12), action));
+		std::vector<Action> legal;
+		engine.board().legalActions(legal);
+		TS_ASSERT(std::find(legal.begin(), legal.end(), action) != legal.end());
+
+		// A new game gets a new AI, so the seed reaches it whichever order the options came in
+		auto choices = [](const char* first, const char* second)
+		{
+			EngineProtocol seeded;
+			std::string out;
+			seeded.handle(first, out);
+			seeded.handle(second, out);
+			seeded.handle("newgame", out);
+			std::string actions;
+			for (int i = 0; i < 3; ++i)
+			{
+				out.clear();
+				seeded.handle("go", out);
+				actions += out.substr(out.find("bestaction "));
+			}
+			return actions;
+		};
+		std::string seedFirst = choices("setoption seed 5", "setoption ai random");
+		TS_ASSERT_EQUALS(choices("setoption ai random", "setoption seed 5"), seedFirst);
+		TS_ASSERT_DIFFERS(choices("setoption ai random", "setoption seed 1"), seedFirst);
+
+		// and it plays by the rules the new game was set up with, not the ones it first saw
+		EngineProtocol changed;
+		changed.handle("go movetime 20", reply);
+		changed.handle("setoption marines.gold 20", reply);
+		changed.handle("setoption antitank.gold 20", reply);
+		changed.handle("newgame", reply);
+		reply.clear();
+		changed.handle("go movetime 20", reply);
+		at = reply.find("bestaction ");
+		TS_ASSERT(at != std::string::npos);
+		TS_ASSERT(Action::parse(reply.substr(at + 11, reply.size() - at - 12), action));
+		TS_ASSERT_EQUALS(action.unitType, Unit::TANK);
+
+		// Mistakes are reported, and quit ends the session
+		const char* bad[] = { "dance", "action move 0 0 0 0", "setoption ai nobody", "position zz", "map moon" };
+		for (int i = 0; i < 5; ++i)
+		{
+			reply.clear();
+			TS_ASSERT(engine.handle(bad[i], reply));
+			TS_ASSERT_EQUALS(reply.find("error "), 0u);
+		}
+		TS_ASSERT(!engine.handle("quit", reply));
+	}
+
+	void testTournament()
+	{
+		// Elo and score convert back and forth, and an even score is no difference
+		TS_ASSERT_DELTA(TournamentStats::scoreToElo(TournamentStats::eloToScore(50)), 50, 1e-9);
+		TS_ASSERT_DELTA(TournamentStats::eloToScore(0), 0.5, 1e-12);
+
+		// Pairs are counted by the first AI's points, and games by their own results
+		TournamentStats stats;
+		stats.addPair(1, 0);
+		stats.addPair(1, 0.5);
+		stats.addPair(0, 0);
+		TS_ASSERT_EQUALS(stats.pairs[2], 1);
+		TS_ASSERT_EQUALS(stats.pairs[3], 1);
+		TS_ASSERT_EQUALS(stats.pairs[0], 1);
+		TS_ASSERT_EQUALS(stats.wins, 2);
+		TS_ASSERT_EQUALS(stats.draws, 1);
+		TS_ASSERT_EQUALS(stats.losses, 3);
+		TS_ASSERT_DELTA(stats.score(), 2.5 / 6, 1e-12);
+
+		// More of the same results narrow the error bars and push the SPRT further
+		TournamentStats more = stats;
+		for (int i = 0; i < 99; ++i)
+		{
+			more.addPair(1, 0);
+			more.addPair(1, 0.5);
+			more.addPair(0, 0);
+		}
+		TS_ASSERT_DELTA(more.elo(), stats.elo(), 1e-9);
+		TS_ASSERT_LESS_THAN(more.eloMargin(), stats.eloMargin());
+		TS_ASSERT_LESS_THAN(more.llr(0, 10), stats.llr(0, 10));
+		TS_ASSERT_LESS_THAN(more.llr(0, 10), 0);
+
+		// A short paired run plays both colors on each seed, and is the same every time
+		TournamentSettings settings;
+		settings.first = "random";
+		settings.second = "random";
+		settings.maxPairs = 8;
+		settings.maxTurns = 20;
+		settings.threads = 2;
+		Tournament tournament(settings);
+		TS_ASSERT(tournament.run());
+		TS_ASSERT_EQUALS(tournament.stats().pairCount(), 8);
+		TS_ASSERT_EQUALS(tournament.stats().games(), 16);
+		Tournament again(settings);
+		again.run();
+		for (int i = 0; i < 5; ++i)
+		{
+			TS_ASSERT_EQUALS(again.stats().pairs[i], tournament.stats().pairs[i]);
+		}
+
+		// An SPRT for a difference the two don't have stops early, rejecting it
+		settings.second = "nothing";
+		TS_ASSERT(!Tournament(settings).run());
+
+		// Search stays on one thread unless a spec asks for more, and only search can
+		AI* single = AI::create("search", 0);
+		TS_ASSERT_EQUALS(static_cast<SearchAI*>(single)->threads(), 1u);
+		delete single;
+		AI* wide = Tournament::createAI("search:50:2", 0);
+		TS_ASSERT(wide && static_cast<SearchAI*>(wide)->threads() == 2);
+		delete wide;
+		TS_ASSERT(!Tournament::createAI("search:50:0", 0));
+		TS_ASSERT(!Tournament::createAI("planner:10:2", 0));
+		settings.second = "random";
+		settings.maxTurns = 200;
+		settings.maxPairs = 200;
+		settings.sprt = true;
+		settings.elo0 = 100;
+		settings.elo1 = 200;
+		Tournament sprt(settings);
+		sprt.run();
+		TS_ASSERT_EQUALS(sprt.verdict(), Tournament::REJECTED);
+		TS_ASSERT_LESS_THAN(sprt.stats().pairCount(), 200);
+	}
+
+	void testTablebase()
+	{
+		Tablebase table;
+		table.build(Rules::standard(), 2);
+		TS_ASSERT(table.ready());
+		TS_ASSERT(table.matches(Rules::standard()));
+		Rules changed = Rules::standard();
+		changed.movementPoints = 10;
+		TS_ASSERT(!table.matches(changed));
+
+		// Positions with gold in the bank or more than one unit a side aren't covered
+		Board game;
+		BoardState state;
+		float value;
+		game.saveState(state);
+		TS_ASSERT(!table.probe(state, value));
+
+		// A red marine a step from home with the blue flag wins on the spot, and can't be
+		// stopped by a blue tank on the other side of the board
+		game.getTile(10, 0)->setLyingFlag(nullptr);
+		game.getTile(2, 7)->spawnFlag(BLUE);
+		game.getTile(2, 7)->setUnit(new Marines(RED));
+		game.getTile(10, 2)->setUnit(new Tank(BLUE));
+		game.saveState(state);
+		state.money[RED] = state.money[BLUE] = 0;
+		Action best;
+		TS_ASSERT(table.probe(state, value, &best));
+		TS_ASSERT_DELTA(value, 1, 1e-4);
+		game.loadState(state);
+		TS_ASSERT(game.doAction(best));
+		TS_ASSERT(game.gameOver());
+		state.player = BLUE;
+		TS_ASSERT(table.probe(state, value));
+		TS_ASSERT_DELTA(value, -1, 1e-4);
+
+		// A tank next to marines can at least take its odds, partway through a turn too
+		Board fight;
+		fight.getTile(5, 4)->setUnit(new Tank(RED));
+		fight.getTile(5, 6)->setUnit(new Marines(BLUE));
+		fight.saveState(state);
+		state.money[RED] = state.money[BLUE] = 0;
+		fight.loadState(state);
+		TS_ASSERT(fight.doAction(Action::move(5, 4, 5, 5)));
+		fight.saveState(state);
+		TS_ASSERT(table.probe(state, value, &best));
+		TS_ASSERT_LESS_THAN(2 * Rules::standard().odds[Unit::TANK][Unit::MARINES] - 1 - 1e-4, value);
+
+		// Saved tables are mapped back in, and the search plays straight from them
+		const char* path = "tablebase-test.gwt";
+		TS_ASSERT(table.save(path));
+		Tablebase loaded;
+		TS_ASSERT(loaded.load(path));
+		float loadedValue;
+		TS_ASSERT(loaded.probe(state, loadedValue));
+		TS_ASSERT_EQUALS(loadedValue, value);
+		SearchAI search(100000, 8, path);
+		TS_ASSERT_EQUALS(search.chooseAction(fight), best);
+		TS_ASSERT_EQUALS(search.nodes(), 0);
+		std::remove(path);
+		{
+			std::ofstream out(path, std::ios::binary);
+			out << "not a table";
+		}
+		TS_ASSERT(!loaded.load(path));
+		TS_ASSERT(loaded.probe(state, loadedValue)); // Still has the table it had
+		std::remove(path);
+	}
+
+	void testOpeningBook()
+	{
+		Board game;
+		BoardState start;
+		game.saveState(start);
+		Action tank = Action::spawn(Unit::TANK, 0, 7);
+		Action marines = Action::spawn(Unit::MARINES, 0, 7);
+		OpeningBookBuilder builder(Rules::standard());
+		for (int i = 0; i < 10; ++i)
+		{
+			builder.add(start, tank, i < 4 ? 1.0f : 0.0f);
+		}
+		OpeningBookBuilder other(Rules::standard());
+		for (int i = 0; i < 9; ++i)
+		{
+			other.add(start, marines, 0.5f);
+		}
+		other.add(start, Action::endTurn(), 1.0f);
+		builder.merge(other);
+		TS_ASSERT_EQUALS(builder.positions(), 1);
+
+		const char* path = "book-test.gwb";
+		TS_ASSERT(builder.save(path, 2));
+		OpeningBook book;
+		TS_ASSERT(!book.ready());
+		TS_ASSERT(book.load(path));
+		TS_ASSERT(book.ready());
+		TS_ASSERT(book.matches(Rules::standard()));
+		Rules changed = Rules::standard();
+		changed.startMoney = 5;
+		TS_ASSERT(!book.matches(changed));
+		TS_ASSERT_EQUALS(book.positions(), 1);
+
+		// Most played first, and the single game ending the turn was left out
+		std::vector<BookMove> moves;
+		TS_ASSERT(book.probe(start, moves));
+		TS_ASSERT_EQUALS(moves.size(), 2u);
+		TS_ASSERT_EQUALS(moves[0].action, tank);
+		TS_ASSERT_EQUALS(moves[0].games, 10);
+		TS_ASSERT_DELTA(moves[0].score, 0.4f, 1e-6);
+		TS_ASSERT_EQUALS(moves[1].action, marines);
+		TS_ASSERT_DELTA(moves[1].score, 0.5f, 1e-6);
+
+		// The best score wins, from actions played often enough
+		Action chosen;
+		TS_ASSERT(book.choose(start, chosen));
+		TS_ASSERT_EQUALS(chosen, marines);
+		TS_ASSERT(book.choose(start, chosen, 10));
+		TS_ASSERT_EQUALS(chosen, tank);
+		TS_ASSERT(!book.choose(start, chosen, 11));
+		BoardState later = start;
+		later.player = BLUE;
+		TS_ASSERT(!book.probe(later, moves));
+		TS_ASSERT(!book.choose(later, chosen));
+
+		// The search plays book moves without searching
+		SearchAI search(100000, 8, nullptr, path);
+		TS_ASSERT_EQUALS(search.chooseAction(game), marines);
+		TS_ASSERT_EQUALS(search.nodes(), 0);
+		std::remove(path);
+		{
+			std::ofstream out(path, std::ios::binary);
+			out << "not a book";
+		}
+		TS_ASSERT(!book.load(path));
+		TS_ASSERT(book.probe(start, moves)); // Still has the book it had
+		std::remove(path);
+	}
+
+	void testPositionDatabase()
+	{
+		// Two games from the same start: one where red buys a tank and wins, one where red
+		// buys marines and moves them
+		Board game;
+		BoardState start, tank, marines;
+		game.saveState(start);
+		std::vector<unsigned char> first, second;
+		DeltaEncoder encoder;
+		encoder.encode(game, first);
+		TS_ASSERT(game.doAction(Action::spawn(Unit::TANK, 0, 7)));
+		encoder.encode(game, first);
+		game.saveState(tank);
+		BoardState won = tank;
+		won.winner = RED;
+		DeltaEncoder::encodeKeyframe(won, first);
+
+		Board other;
+		DeltaEncoder otherEncoder;
+		otherEncoder.encode(other, second);
+		TS_ASSERT(other.doAction(Action::spawn(Unit::MARINES, 0, 7)));
+		otherEncoder.encode(other, second);
+		other.saveState(marines);
+		TS_ASSERT(other.doAction(Action::move(0, 7, 0, 6)));
+		otherEncoder.encode(other, second);
+
+		TS_ASSERT(saveReplay("database-test-1.gwr", first));
+		TS_ASSERT(saveReplay("database-test-2.gwr", second));
+		std::vector<std::string> paths;
+		paths.push_back("database-test-1.gwr");
+		paths.push_back("database-test-missing.gwr");
+		paths.push_back("database-test-2.gwr");
+		PositionDatabaseBuilder builder;
+		TS_ASSERT_EQUALS(builder.add(paths, 2), 2);
+		const char* path = "database-test.gwd";
+		TS_ASSERT(builder.save(path, 2));
+		std::remove("database-test-1.gwr");
+		std::remove("database-test-2.gwr");
+
+		PositionDatabase database;
+		TS_ASSERT(!database.ready());
+		TS_ASSERT(database.load(path));
+		TS_ASSERT(database.ready());
+		TS_ASSERT_EQUALS(database.games(), 2);
+		TS_ASSERT_EQUALS(database.positions(), 5);
+		TS_ASSERT_EQUALS(std::string(database.gamePath(1)), "database-test-2.gwr");
+		TS_ASSERT_EQUALS(database.gameLength(0), 2);
+		TS_ASSERT_EQUALS(database.gameWinner(0), (int)RED);
+		TS_ASSERT_EQUALS(database.gameWinner(1), -1);
+
+		// The start came up in both games, in the order they were added
+		PositionStats stats;
+		TS_ASSERT(database.lookup(start, stats));
+		TS_ASSERT_EQUALS(stats.games, 2);
+		TS_ASSERT_EQUALS(stats.wins[RED], 1);
+		TS_ASSERT_EQUALS(stats.wins[BLUE], 0);
+		TS_ASSERT_EQUALS(stats.draws, 1);
+		TS_ASSERT_DELTA(stats.score(RED), 0.75f, 1e-6);
+		std::vector<Occurrence> found;
+		TS_ASSERT(database.occurrences(start, found));
+		TS_ASSERT_EQUALS(found.size(), 2u);
+		TS_ASSERT_EQUALS(found[0].game, 0);
+		TS_ASSERT_EQUALS(found[1].game, 1);
+		TS_ASSERT(database.occurrences(start, found, 1));
+		TS_ASSERT_EQUALS(found.size(), 1u);
+
+		// Each purchase only came up in its own game, at the position after it
+		TS_ASSERT(database.occurrences(marines, found));
+		TS_ASSERT_EQUALS(found.size(), 1u);
+		TS_ASSERT_EQUALS(found[0].game, 1);
+		TS_ASSERT_EQUALS(found[0].position, 1);
+		TS_ASSERT(database.lookup(tank, stats));
+		TS_ASSERT_EQUALS(stats.wins[RED], 1);
+		BoardState unseen = start;
+		unseen.money[RED] = 3;
+		TS_ASSERT(!database.lookup(unseen, stats));
+		TS_ASSERT(!database.occurrences(unseen, found));
+
+		std::remove(path);
+		{
+			std::ofstream out(path, std::ios::binary);
+			out << "not a database";
+		}
+		TS_ASSERT(!database.load(path));
+		TS_ASSERT(database.lookup(start, stats)); // Still has the database it had
+		std::remove(path);
+	}
+
 	// Tile tests
 	void testOpenForMovement()
 	{
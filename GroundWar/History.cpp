@@ -0,0 +1,101 @@
+#include "History.h"
+#include "Delta.h"
+
+History::History(Board& board, bool acrossTurns) :
+	m_board(board), m_acrossTurns(acrossTurns)
+{
+	m_board.saveState(m_current);
+	m_rolls = m_board.rolls();
+}
+
+void History::record()
+{
+	BoardState now;
+	m_board.saveState(now);
+	if (now == m_current)
+	{
+		return;
+	}
+
+	// Anything undone can't be redone once something new happens
+	m_records.resize(m_position < m_steps.size() ? m_steps[m_position].offset : m_records.size());
+	m_steps.resize(m_position);
+
+	Step step;
+	step.offset = (unsigned)m_records.size();
+	step.turn = m_current.turn;
+	step.rollsBefore = m_rolls;
+	step.rollsAfter = m_board.rolls();
+	if (!encodeDelta(m_current, now, m_records))
+	{
+		// The board was loaded from somewhere else rather than played, so start over
+		m_records.resize(step.offset);
+		clear();
+		return;
+	}
+	step.forward = (unsigned short)(m_records.size() - step.offset);
+	encodeDelta(now, m_current, m_records);
+	step.backward = (unsigned short)(m_records.size() - step.offset - step.forward);
+
+	m_steps.push_back(step);
+	m_position = m_steps.size();
+	m_current = now;
+	m_rolls = step.rollsAfter;
+}
+
+bool History::canUndo()
+{
+	return m_position > 0 && (m_acrossTurns || m_steps[m_position - 1].turn == m_current.turn);
+}
+
+bool History::canRedo()
+{
+	return m_position < m_steps.size();
+}
+
+bool History::undo()
+{
+	if (!canUndo())
+	{
+		return false;
+	}
+	const Step& step = m_steps[--m_position];
+	applyRecord(m_current, &m_records[step.offset + step.forward], step.backward);
+	m_board.loadState(m_current);
+	m_rolls = step.rollsBefore;
+	m_board.setRolls(m_rolls);
+	return true;
+}
+
+bool History::redo()
+{
+	if (!canRedo())
+	{
+		return false;
+	}
+	const Step& step = m_steps[m_position++];
+	applyRecord(m_current, &m_records[step.offset], step.forward);
+	m_board.loadState(m_current);
+	m_rolls = step.rollsAfter;
+	m_board.setRolls(m_rolls);
+	return true;
+}
+
+void History::clear()
+{
+	m_records.clear();
+	m_steps.clear();
+	m_position = 0;
+	m_board.saveState(m_current);
+	m_rolls = m_board.rolls();
+}
+
+int History::steps()
+{
+	return (int)m_steps.size();
+}
+
+size_t History::bytes()
+{
+	return m_records.size() + m_steps.size() * sizeof(Step);
+}
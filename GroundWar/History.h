@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include "Board.h"
+#include "BoardState.h"
+
+/*
+Unlimited undo and redo for interactive play. Call record after anything that might have
+changed the board; each change is kept as a pair of delta records (see Delta.h), one going
+forward and one going back, so a step costs a few bytes and undoing or redoing one applies
+a single record no matter how long the game has been going.
+
+Each step also keeps how many combat rolls the board had made before and after it, and
+undo and redo put the board's RNG back to match (see Board::setRolls). Undoing an attack
+and making it again rolls the same, so undo can't be used to reroll a fight.
+
+By default only the current player's actions this turn can be undone. With acrossTurns,
+undo keeps going back through earlier turns too, which is for hot-seat games where both
+players share the screen.
+*/
+class History
+{
+public:
+	History(Board& board, bool acrossTurns = false);
+
+	/*
+	Adds a step if the board has changed since the last call (or undo or redo), dropping
+	anything that could have been redone. Does nothing if the board hasn't changed.
+	*/
+	void record();
+
+	bool canUndo();
+	bool canRedo();
+
+	/*
+	Steps the board back or forward. Return false if there's nothing to undo or redo.
+	*/
+	bool undo();
+	bool redo();
+
+	/*
+	Forgets every step, starting over from the board as it is now.
+	*/
+	void clear();
+
+	/*
+	Gets the number of steps recorded, and the bytes their records take up.
+	*/
+	int steps();
+	size_t bytes();
+
+private:
+	struct Step
+	{
+		unsigned offset; // Where the forward record starts; the backward one follows it
+		unsigned short forward; // Sizes of the two records
+		unsigned short backward;
+		int turn; // Turn the step was taken in
+		unsigned rollsBefore; // Board::rolls at each end of the step
+		unsigned rollsAfter;
+	};
+
+	Board& m_board;
+	bool m_acrossTurns;
+	BoardState m_current; // What the board looked like after the last step
+	unsigned m_rolls; // Board::rolls after the last step
+	std::vector<unsigned char> m_records;
+	std::vector<Step> m_steps;
+	size_t m_position = 0; // Number of steps that are done, the rest can be redone
+};
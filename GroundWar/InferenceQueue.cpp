@@ -0,0 +1,75 @@
+#include "InferenceQueue.h"
+#include <chrono>
+
+InferenceQueue::InferenceQueue(const PolicyNet& net, int maxBatch, int waitMicroseconds) :
+	m_net(net), m_maxBatch(maxBatch < 1 ? 1 : maxBatch), m_waitMicroseconds(waitMicroseconds) {}
+
+void InferenceQueue::evaluate(const BoardState& state, NetOutput& output)
+{
+	Request request = { &state, &output, false, false };
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_pending.push_back(&request);
+	std::chrono::steady_clock::time_point deadline =
+		std::chrono::steady_clock::now() + std::chrono::microseconds(m_waitMicroseconds);
+	while (!request.done)
+	{
+		if (!request.taken && ((int)m_pending.size() >= m_maxBatch || std::chrono::steady_clock::now() >= deadline))
+		{
+			runBatch(lock);
+		}
+		else if (request.taken)
+		{
+			m_finished.wait(lock); // Someone else is running it
+		}
+		else
+		{
+			m_finished.wait_until(lock, deadline);
+		}
+	}
+}
+
+void InferenceQueue::runBatch(std::unique_lock<std::mutex>& lock)
+{
+	std::vector<Request*> batch;
+	batch.swap(m_pending);
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		batch[i]->taken = true;
+	}
+	lock.unlock();
+
+	std::vector<BoardState> states(batch.size());
+	std::vector<NetOutput> outputs(batch.size());
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		states[i] = *batch[i]->state;
+	}
+	m_net.evaluate(&states[0], (int)states.size(), &outputs[0]);
+
+	lock.lock();
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		*batch[i]->output = outputs[i];
+		batch[i]->done = true;
+	}
+	m_positions += batch.size();
+	++m_batches;
+	m_finished.notify_all();
+}
+
+const PolicyNet& InferenceQueue::net()
+{
+	return m_net;
+}
+
+long long InferenceQueue::positions()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_positions;
+}
+
+long long InferenceQueue::batches()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_batches;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "PolicyNet.h"
+
+/*
+Gathers positions from any number of search threads into batches for a PolicyNet, which
+evaluates a batch in much less time than the same positions one at a time. A thread
+asking for an evaluation waits until the batch is full or it has waited long enough,
+and then whichever thread notices runs the batch for everyone in it. There's no thread
+of its own, so nothing runs while no one is asking.
+*/
+class InferenceQueue
+{
+public:
+	/*
+	Runs batches of up to maxBatch positions, or fewer once the first one in has waited
+	waitMicroseconds.
+	*/
+	InferenceQueue(const PolicyNet& net, int maxBatch = 16, int waitMicroseconds = 200);
+
+	/*
+	Evaluates a position, waiting for it to go through in a batch. Safe to call from
+	any thread.
+	*/
+	void evaluate(const BoardState& state, NetOutput& output);
+
+	const PolicyNet& net();
+
+	/*
+	Stats since this queue was made: positions evaluated and batches run.
+	*/
+	long long positions();
+	long long batches();
+
+private:
+	struct Request
+	{
+		const BoardState* state;
+		NetOutput* output;
+		bool taken; // Part of a batch that's being run
+		bool done;
+	};
+
+	const PolicyNet& m_net;
+	int m_maxBatch;
+	int m_waitMicroseconds;
+	std::mutex m_mutex;
+	std::condition_variable m_finished;
+	std::vector<Request*> m_pending;
+	long long m_positions = 0;
+	long long m_batches = 0;
+
+	/*
+	Runs everything pending. Called with the lock held, which is let go while the
+	network runs.
+	*/
+	void runBatch(std::unique_lock<std::mutex>& lock);
+};
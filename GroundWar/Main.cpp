@@ -1,6 +1,8 @@
+#include <iostream>
+#include <cstring>
 #include "Main.h"
 
-int main(int, char**) {
+int main(int argc, char** argv) {
 	board = new Board();
 	renderer = new Renderer();
 
@@ -10,8 +12,45 @@ int main(int, char**) {
 		return 1;
 	}
 
+	if (argc > 2 && strcmp(argv[1], "--ai") == 0)
+	{
+		AI* ai = AI::create(argv[2], SDL_GetTicks(), 0); // The only game running, so it can use every core
+		if (!ai)
+		{
+			std::cerr << "Unknown AI " << argv[2] << std::endl;
+			cleanup();
+			return 1;
+		}
+		opponent = new AsyncAI(ai, argc > 3 && strcmp(argv[3], "red") == 0 ? RED : BLUE);
+		history = new History(*board, true);
+	}
+	else if (argc > 1)
+	{
+		replay = new Replay(*board);
+		if (!replay->load(argv[1]))
+		{
+			std::cerr << "Couldn't load replay " << argv[1] << std::endl;
+			cleanup();
+			return 1;
+		}
+	}
+	else
+	{
+		history = new History(*board, true); // Both players share the screen, so undo can go back across turns
+	}
+
+	database = new PositionDatabase();
+	if (!database->load("groundwar.gwd"))
+	{
+		delete database;
+		database = nullptr;
+	}
+
+	analysis = new Analysis();
+
 	bool runGame = true;
 	SDL_Event event;
+	Uint32 lastFrame = SDL_GetTicks();
 
 	while (runGame)
 	{
@@ -21,7 +60,51 @@ int main(int, char**) {
 			{
 				runGame = false;
 			}
-			else if (!board->gameOver()) // If the game isn't over, look for KB/M input
+			else if (database && event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_TAB)
+			{
+				showAnalysis = !showAnalysis;
+			}
+			else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_h)
+			{
+				showSearch = !showSearch;
+				if (!showSearch)
+				{
+					analysis->stop(); // Don't keep a core busy for nothing
+				}
+			}
+			else if (replay)
+			{
+				onReplayEvent(event);
+			}
+			else if (event.type == SDL_KEYDOWN && (event.key.keysym.mod & KMOD_CTRL))
+			{
+				// Ctrl+Z and Ctrl+Y work even once the game is over, to take back the winning move.
+				// Undoing goes back past the AI's actions, to the last thing the player did.
+				if (event.key.keysym.sym == SDLK_z)
+				{
+					if (opponent)
+					{
+						opponent->cancel();
+					}
+					while (history->undo() && opponentsTurn())
+					{
+					}
+				}
+				else if (event.key.keysym.sym == SDLK_y)
+				{
+					history->redo();
+				}
+			}
+			else if (opponent && event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)
+			{
+				opponent->cancel();
+				opponentPaused = !opponentPaused;
+			}
+			else if (opponentsTurn() && event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_RETURN)
+			{
+				opponent->hurry(); // Play the best action found so far
+			}
+			else if (!board->gameOver() && !opponentsTurn()) // If the game isn't over, look for KB/M input
 			{
 				switch (event.type)
 				{
@@ -31,6 +114,9 @@ int main(int, char**) {
 						board->onMouseClick(event.button.x, event.button.y);
 					}
 					break;
+				case SDL_MOUSEMOTION:
+					board->onMouseMove(event.motion.x, event.motion.y);
+					break;
 				case SDL_KEYDOWN:
 					switch (event.key.keysym.sym)
 					{
@@ -49,18 +135,119 @@ int main(int, char**) {
 					}
 					break;
 				}
+				history->record();
 			}
 		}
 
-		renderer->draw(board);
+		Uint32 now = SDL_GetTicks();
+		if (replay)
+		{
+			replay->update((now - lastFrame) / 1000.0);
+		}
+		updateOpponent();
+		if (showSearch)
+		{
+			analysis->update(*board);
+		}
+		lastFrame = now;
+		renderer->draw(board, replay, opponentsTurn() ? opponent : nullptr, showAnalysis ? database : nullptr,
+			showSearch ? analysis : nullptr);
 	}
 
 	cleanup();
 	return 0;
 }
 
+void onReplayEvent(const SDL_Event& event)
+{
+	switch (event.type)
+	{
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEMOTION:
+	{
+		int x = event.type == SDL_MOUSEMOTION ? event.motion.x : event.button.x;
+		int y = event.type == SDL_MOUSEMOTION ? event.motion.y : event.button.y;
+		bool held = event.type == SDL_MOUSEBUTTONDOWN ? event.button.button == SDL_BUTTON_LEFT :
+			(event.motion.state & SDL_BUTTON_LMASK) != 0;
+		if (held && x >= REPLAY_BAR.x && x <= REPLAY_BAR.x + REPLAY_BAR.w &&
+			y >= REPLAY_BAR.y && y <= REPLAY_BAR.y + REPLAY_BAR.h)
+		{
+			replay->seek((x - REPLAY_BAR.x) * replay->length() / REPLAY_BAR.w);
+		}
+		break;
+	}
+	case SDL_KEYDOWN:
+		switch (event.key.keysym.sym)
+		{
+		case SDLK_SPACE:
+			replay->setPlaying(!replay->playing());
+			break;
+		case SDLK_LEFT:
+			replay->seek(replay->position() - 1);
+			break;
+		case SDLK_RIGHT:
+			replay->seek(replay->position() + 1);
+			break;
+		case SDLK_PAGEUP:
+			replay->seek(replay->position() - 10);
+			break;
+		case SDLK_PAGEDOWN:
+			replay->seek(replay->position() + 10);
+			break;
+		case SDLK_HOME:
+			replay->seek(0);
+			break;
+		case SDLK_END:
+			replay->seek(replay->length());
+			break;
+		case SDLK_UP:
+			replay->setSpeed(replay->speed() * 2);
+			break;
+		case SDLK_DOWN:
+			replay->setSpeed(replay->speed() / 2);
+			break;
+		}
+		break;
+	}
+}
+
+bool opponentsTurn()
+{
+	return opponent && !opponentPaused && !board->gameOver() && board->currentPlayer() == opponent->side();
+}
+
+void updateOpponent()
+{
+	if (!opponentsTurn())
+	{
+		if (opponent && !opponentPaused && !board->gameOver())
+		{
+			opponent->ponder(*board); // Think ahead while the player decides
+		}
+		return;
+	}
+
+	// Check before polling, so an action that lands in between isn't asked for twice
+	bool thinking = opponent->thinking();
+	Action action;
+	if (opponent->poll(action))
+	{
+		board->doAction(action);
+		history->record();
+	}
+	else if (!thinking)
+	{
+		opponent->think(*board);
+	}
+}
+
 void cleanup()
 {
+	delete renderer; // Goes first, since it listens to the board
+	delete replay;
+	delete history;
+	delete opponent; // Waits for the AI to finish thinking
+	delete analysis;
+	delete database;
 	delete board;
-	delete renderer;
 }
\ No newline at end of file
@@ -1,9 +1,47 @@
 #pragma once
 #include "Board.h"
 #include "Renderer.h"
+#include "Replay.h"
+#include "History.h"
+#include "AsyncAI.h"
+#include "PositionDatabase.h"
+#include "Analysis.h"
 
 Board* board;
 Renderer* renderer;
+Replay* replay; // Only set when watching a replay
+History* history; // Only set when playing
+AsyncAI* opponent; // Only set when playing against an AI
+bool opponentPaused = false; // Escape pauses the AI, handing its side to the player
+PositionDatabase* database; // Only set if groundwar.gwd could be loaded
+bool showAnalysis = true; // Tab shows and hides the database results
+Analysis* analysis; // Searches the board in the background while H has it shown
+bool showSearch = false;
 
-int main(int, char**);
+/*
+Runs the game, or plays back the replay file given as the first argument. With
+"--ai <name> [red|blue]", the named AI plays one side (blue by default). If there's a
+position database called groundwar.gwd in the working directory, how the games in it went
+from the position on the board is shown alongside. H turns on a live analysis of the
+position.
+*/
+int main(int argc, char** argv);
+
+/*
+Handles input while watching a replay: space plays and pauses, left and right step one
+action, page up and down jump ten, home and end go to either end, up and down change the
+speed, and clicking or dragging on the seek bar jumps there.
+*/
+void onReplayEvent(const SDL_Event& event);
+
+/*
+Checks if it's the AI's turn to move.
+*/
+bool opponentsTurn();
+
+/*
+Applies any action the AI has chosen, and starts it thinking when it's its turn.
+Otherwise lets it ponder the player's position.
+*/
+void updateOpponent();
 void cleanup();
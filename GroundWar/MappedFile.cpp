@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+#include <algorithm>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const char* path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	HANDLE map = GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart > 0 ?
+		CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	const char* view = map ? (const char*)MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view)
+	{
+		if (map) CloseHandle(map);
+		CloseHandle(handle);
+		return false;
+	}
+	m_view = view;
+	m_size = (size_t)fileSize.QuadPart;
+	m_file = handle;
+	m_mapping = map;
+#else
+	int handle = ::open(path, O_RDONLY);
+	if (handle < 0)
+	{
+		return false;
+	}
+	struct stat info;
+	void* mapped = fstat(handle, &info) == 0 && info.st_size > 0 ?
+		mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, handle, 0) : MAP_FAILED;
+	::close(handle); // The mapping stays valid without it
+	if (mapped == MAP_FAILED)
+	{
+		return false;
+	}
+	m_view = (const char*)mapped;
+	m_size = (size_t)info.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_view)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_view);
+		CloseHandle((HANDLE)m_mapping);
+		CloseHandle((HANDLE)m_file);
+#else
+		munmap((void*)m_view, m_size);
+#endif
+	}
+	m_view = nullptr;
+	m_size = 0;
+	m_file = nullptr;
+	m_mapping = nullptr;
+}
+
+bool MappedFile::isOpen() const
+{
+	return m_view != nullptr;
+}
+
+const char* MappedFile::data() const
+{
+	return m_view;
+}
+
+size_t MappedFile::size() const
+{
+	return m_size;
+}
+
+void MappedFile::swap(MappedFile& other)
+{
+	std::swap(m_view, other.m_view);
+	std::swap(m_size, other.m_size);
+	std::swap(m_file, other.m_file);
+	std::swap(m_mapping, other.m_mapping);
+}
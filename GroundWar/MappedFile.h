@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+
+/*
+A whole file mapped read-only into memory, so large tables can be opened instantly and
+shared between everything that reads them. Pages are only read from disk when they're
+first touched.
+*/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	/*
+	Maps the given file, unmapping any file already mapped. Returns false, leaving
+	nothing mapped, if the file can't be opened or is empty.
+	*/
+	bool open(const char* path);
+	void close();
+
+	bool isOpen() const;
+	const char* data() const;
+	size_t size() const;
+
+	/*
+	Trades mappings with another MappedFile, so a new file can be checked before it
+	replaces the one in use.
+	*/
+	void swap(MappedFile& other);
+
+private:
+	const char* m_view = nullptr;
+	size_t m_size = 0;
+	void* m_file = nullptr; // Handles Windows needs to keep while a file is mapped
+	void* m_mapping = nullptr;
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
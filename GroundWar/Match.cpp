@@ -0,0 +1,279 @@
+#include "Match.h"
+#include <cstdio>
+
+Match::Match(int id, unsigned seed) :
+	m_id(id), m_board(Rules::standard(), seed), m_encoder(0)
+{
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			m_changed[x][y] = false;
+		}
+	}
+	m_board.addListener(this);
+	m_encoder.encode(m_board, m_record); // Sets the starting point for the deltas
+}
+
+Match::~Match()
+{
+	m_board.removeListener(this);
+}
+
+int Match::id()
+{
+	return m_id;
+}
+
+Board& Match::board()
+{
+	return m_board;
+}
+
+bool Match::join(int client, Sides sides, bool deltas)
+{
+	for (size_t i = 0; i < m_clients.size(); ++i)
+	{
+		if (m_clients[i] != client && (m_sides[i] & sides))
+		{
+			return false; // Someone else is playing that side
+		}
+	}
+	for (size_t i = 0; i < m_clients.size(); ++i)
+	{
+		if (m_clients[i] == client)
+		{
+			m_sides[i] = sides;
+			m_deltas[i] = deltas;
+			return true;
+		}
+	}
+	m_clients.push_back(client);
+	m_sides.push_back(sides);
+	m_deltas.push_back(deltas);
+	return true;
+}
+
+void Match::leave(int client)
+{
+	for (size_t i = 0; i < m_clients.size(); ++i)
+	{
+		if (m_clients[i] == client)
+		{
+			m_clients.erase(m_clients.begin() + i);
+			m_sides.erase(m_sides.begin() + i);
+			m_deltas.erase(m_deltas.begin() + i);
+			return;
+		}
+	}
+}
+
+const std::vector<int>& Match::clients()
+{
+	return m_clients;
+}
+
+Match::Sides Match::sidesOf(int client)
+{
+	for (size_t i = 0; i < m_clients.size(); ++i)
+	{
+		if (m_clients[i] == client)
+		{
+			return m_sides[i];
+		}
+	}
+	return WATCH;
+}
+
+bool Match::wantsDeltas(int client)
+{
+	for (size_t i = 0; i < m_clients.size(); ++i)
+	{
+		if (m_clients[i] == client)
+		{
+			return m_deltas[i];
+		}
+	}
+	return false;
+}
+
+bool Match::apply(int client, const Action& action, std::string& changes, std::string& delta, std::string& error)
+{
+	if (m_board.gameOver())
+	{
+		error = "game is over";
+		return false;
+	}
+	if (!(sidesOf(client) & (m_board.currentPlayer() == RED ? PLAY_RED : PLAY_BLUE)))
+	{
+		error = "not your turn";
+		return false;
+	}
+	if (const char* reason = check(action))
+	{
+		error = reason;
+		return false;
+	}
+
+	m_changedTiles.clear();
+	bool done = m_board.doAction(action);
+	for (size_t i = 0; i < m_changedTiles.size(); ++i)
+	{
+		Tile* tile = m_changedTiles[i];
+		m_changed[tile->x()][tile->y()] = false;
+		if (done)
+		{
+			writeTile(tile, changes);
+		}
+	}
+	if (!done)
+	{
+		error = "illegal action";
+		return false;
+	}
+	writeState(changes);
+
+	m_record.clear();
+	m_encoder.encode(m_board, m_record);
+	delta = "delta " + toHex(m_record) + "\n";
+	return true;
+}
+
+void Match::writeFull(int client, std::string& out)
+{
+	if (wantsDeltas(client))
+	{
+		BoardState state;
+		m_board.saveState(state);
+		m_record.clear();
+		DeltaEncoder::encodeKeyframe(state, m_record);
+		out += "keyframe " + toHex(m_record) + "\n";
+		return;
+	}
+
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			if (Tile* tile = m_board.getTile(x, y))
+			{
+				writeTile(tile, out);
+			}
+		}
+	}
+	writeState(out);
+}
+
+bool Match::parseSides(const std::string& name, Sides& sides)
+{
+	if (name == "red") sides = PLAY_RED;
+	else if (name == "blue") sides = PLAY_BLUE;
+	else if (name == "both") sides = PLAY_BOTH;
+	else if (name == "watch") sides = WATCH;
+	else return false;
+	return true;
+}
+
+void Match::tileChanged(Board& board, int x, int y)
+{
+	if (!m_changed[x][y])
+	{
+		m_changed[x][y] = true;
+		m_changedTiles.push_back(board.getTile(x, y));
+	}
+}
+
+const char* Match::check(const Action& action)
+{
+	Tile* from = m_board.getTile(action.fromX, action.fromY);
+	Tile* to = m_board.getTile(action.toX, action.toY);
+	switch (action.type)
+	{
+	case Action::MOVE:
+		if (!from || !to)
+		{
+			return "no such tile";
+		}
+		if (!m_board.canMove(from->unit()))
+		{
+			return "can't move that unit";
+		}
+		if (!m_board.validMove(from, to))
+		{
+			return "can't move there";
+		}
+		return nullptr;
+	case Action::ATTACK:
+		if (!from || !to)
+		{
+			return "no such tile";
+		}
+		if (!m_board.canAttack(from, to))
+		{
+			return "can't attack that";
+		}
+		if (!m_board.canMove(from->unit()))
+		{
+			return "not enough movement points";
+		}
+		return nullptr;
+	case Action::SPAWN:
+		// The same checks as Board::canSpawnOn, without making a unit to ask about
+		if (!to)
+		{
+			return "no such tile";
+		}
+		if (m_board.money(m_board.currentPlayer()) < m_board.rules().goldCost[action.unitType])
+		{
+			return "not enough gold";
+		}
+		if (!to->openForMovement() || !to->spawnableFor(m_board.currentPlayer()))
+		{
+			return "can't spawn there";
+		}
+		return nullptr;
+	case Action::END_TURN:
+		return nullptr; // Board knows whether there's been a move yet
+	}
+	return "unknown action";
+}
+
+void Match::writeTile(Tile* tile, std::string& out)
+{
+	char contents[8];
+	int length = 0;
+	if (Unit* unit = tile->unit())
+	{
+		contents[length++] = unit->owner() == RED ? 'r' : 'b';
+		contents[length++] = "mat"[unit->type()];
+	}
+	if (Flag* flag = tile->flag())
+	{
+		contents[length++] = 'f';
+		contents[length++] = flag->owner() == RED ? 'r' : 'b';
+	}
+	if (length == 0)
+	{
+		contents[length++] = '-';
+	}
+	contents[length] = '\0';
+
+	char line[48];
+	sprintf(line, "tile %d %d %s\n", tile->x(), tile->y(), contents);
+	out += line;
+}
+
+void Match::writeState(std::string& out)
+{
+	const char* winner = "-";
+	if (m_board.gameOver())
+	{
+		winner = m_board.winner() == RED ? "red" : "blue";
+	}
+
+	char line[96];
+	sprintf(line, "state %d %s %d %d %d %s\n", m_board.turn(),
+		m_board.currentPlayer() == RED ? "red" : "blue", m_board.movementPoints(),
+		m_board.money(RED), m_board.money(BLUE), winner);
+	out += line;
+}
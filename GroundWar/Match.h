@@ -0,0 +1,102 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Board.h"
+#include "BoardListener.h"
+#include "Delta.h"
+
+/*
+One game hosted by a server, along with the clients following it. Clients send actions
+as text (see Action::parse) and get back text lines describing what changed:
+
+	tile <x> <y> <contents>
+	state <turn> <player> <movement points> <red gold> <blue gold> <winner>
+
+Tile contents are "-" for an empty tile, otherwise the unit as owner and type letters
+("rm", "ba", "rt", ...) followed by "f" and the flag owner's letter if there's a flag on
+the tile, so "btfr" is a blue tank carrying the red flag and "fb" is the blue flag lying
+on its own. The winner is "-" while the game is still going.
+
+Clients can ask for the binary encoding from Delta.h instead, as hex:
+
+	keyframe <hex>          The whole state, sent when joining
+	delta <hex>             What one action changed
+*/
+class Match :
+	public BoardListener
+{
+public:
+	/*
+	Which players a client may play as.
+	*/
+	enum Sides
+	{
+		WATCH = 0, PLAY_RED = 1, PLAY_BLUE = 2, PLAY_BOTH = 3
+	};
+
+	Match(int id, unsigned seed);
+	~Match();
+
+	int id();
+	Board& board();
+
+	/*
+	Adds a client, or changes the sides and format of one that has already joined.
+	Clients that want deltas get keyframe and delta lines instead of tile and state lines.
+	Each side can only be played by one client at a time: returns false, and changes
+	nothing, if another client already plays one of the given sides. Leaving frees the
+	client's sides.
+	*/
+	bool join(int client, Sides sides, bool deltas = false);
+	void leave(int client);
+
+	/*
+	Gets the clients following this match, and what they may play as. A client that
+	hasn't joined plays as WATCH.
+	*/
+	const std::vector<int>& clients();
+	Sides sidesOf(int client);
+	bool wantsDeltas(int client);
+
+	/*
+	Checks and performs an action for the given client. On success, appends the change
+	lines to changes, sets delta to the delta line, and returns true. Otherwise sets
+	error to a short reason and leaves the board alone.
+	*/
+	bool apply(int client, const Action& action, std::string& changes, std::string& delta, std::string& error);
+
+	/*
+	Appends lines describing every tile and the state, for a client that just joined,
+	in the format that client asked for.
+	*/
+	void writeFull(int client, std::string& out);
+
+	/*
+	Parses a side name ("red", "blue", "both" or "watch"). Returns false if it isn't one.
+	*/
+	static bool parseSides(const std::string& name, Sides& sides);
+
+	void tileChanged(Board& board, int x, int y);
+
+private:
+	int m_id;
+	Board m_board;
+	std::vector<int> m_clients;
+	std::vector<Sides> m_sides; // Parallel to m_clients
+	std::vector<bool> m_deltas; // Parallel to m_clients
+	DeltaEncoder m_encoder;
+	std::vector<unsigned char> m_record;
+
+	// Tiles changed by the action being applied
+	bool m_changed[BOARD_WIDTH][BOARD_HEIGHT];
+	std::vector<Tile*> m_changedTiles;
+
+	/*
+	Finds out why an action isn't allowed, using the same checks Board does.
+	Returns nullptr if it looks fine.
+	*/
+	const char* check(const Action& action);
+
+	void writeTile(Tile* tile, std::string& out);
+	void writeState(std::string& out);
+};
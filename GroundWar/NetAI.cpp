@@ -0,0 +1,234 @@
+#include "NetAI.h"
+#include <algorithm>
+#include <cmath>
+
+static const float EXPLORATION = 1.5f; // How much the priors count against results so far
+static const float VIRTUAL_LOSS = 1.0f; // Counted against a path while a thread is exploring it
+
+NetAI::NetAI(unsigned seed, int playouts, unsigned threads, const char* weights) :
+	m_net(seed), m_pool(threads), m_workers(m_pool.size()), m_playouts(std::max(1, playouts))
+{
+	if (weights)
+	{
+		m_net.load(weights); // Keeps the random weights if there's no file
+	}
+	m_queue = new InferenceQueue(m_net, (int)m_pool.size());
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i].board = nullptr;
+		m_workers[i].rng.seed(seed + (unsigned)i * 0x9e3779b9u);
+	}
+}
+
+NetAI::~NetAI()
+{
+	m_pool.wait();
+	delete m_queue;
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		delete m_workers[i].board;
+	}
+}
+
+const char* NetAI::name()
+{
+	return "net";
+}
+
+PolicyNet& NetAI::net()
+{
+	return m_net;
+}
+
+int NetAI::playouts()
+{
+	return m_started;
+}
+
+long long NetAI::batches()
+{
+	return m_batches;
+}
+
+const std::vector<Action>& NetAI::searchActions()
+{
+	return m_searchActions;
+}
+
+const std::vector<float>& NetAI::searchPolicy()
+{
+	return m_searchPolicy;
+}
+
+Action NetAI::chooseAction(Board& board)
+{
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		if (!m_workers[i].board)
+		{
+			m_workers[i].board = new Board(board.rules(), 0);
+		}
+	}
+	m_started = 0;
+	m_batches = 0;
+
+	// No need to search if there's nothing to choose
+	std::vector<Action>& actions = m_searchActions;
+	board.legalActions(actions);
+	m_searchPolicy.assign(actions.size(), 1.0f);
+	if (actions.size() <= 1)
+	{
+		return actions.empty() ? Action::endTurn() : actions[0];
+	}
+
+	m_nodes.clear();
+	m_nodes.push_back(Node());
+	Node& root = m_nodes.back();
+	board.saveState(root.state);
+	root.expanded = false;
+	root.visits = 0;
+
+	m_batchesBefore = m_queue->batches();
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		Worker* worker = &m_workers[i];
+		m_pool.submit([this, worker]()
+		{
+			search(*worker);
+		});
+	}
+	m_pool.wait();
+	m_batches = m_queue->batches() - m_batchesBefore;
+
+	// The most explored action is the one the search trusts most
+	Action best = actions[0];
+	int mostVisits = -1;
+	int totalVisits = std::max(1, root.visits);
+	for (size_t i = 0; i < root.edges.size(); ++i)
+	{
+		if (root.edges[i].visits > mostVisits)
+		{
+			mostVisits = root.edges[i].visits;
+			best = root.edges[i].action;
+		}
+		m_searchPolicy[i] = (float)root.edges[i].visits / totalVisits; // Edges are in the same order as the actions
+	}
+	m_nodes.clear();
+	return best;
+}
+
+void NetAI::search(Worker& worker)
+{
+	std::vector<std::pair<Node*, Edge*>> path;
+	std::uniform_real_distribution<float> roll(0.0f, 1.0f);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_started < m_playouts)
+	{
+		++m_started;
+
+		// Walk down to a position that hasn't been looked at yet, or the end of a game
+		path.clear();
+		Node* node = &m_nodes.front();
+		while (node->expanded && node->state.winner < 0 && !node->edges.empty())
+		{
+			Edge* edge = select(*node);
+			edge->visits += 1;
+			edge->total -= VIRTUAL_LOSS;
+			node->visits += 1;
+			path.push_back(std::make_pair(node, edge));
+			int outcome = edge->action.type == Action::ATTACK && roll(worker.rng) >= edge->odds ? 1 : 0;
+			node = child(worker, *node, *edge, outcome);
+		}
+
+		float value = 0.0f; // For the player to move at node
+		if (node->state.winner >= 0)
+		{
+			value = node->state.winner == node->state.player ? 1.0f : -1.0f;
+		}
+		else if (!node->expanded)
+		{
+			BoardState state = node->state;
+			lock.unlock();
+
+			NetOutput output;
+			m_queue->evaluate(state, output);
+			value = output.value;
+			worker.board->loadState(state);
+			worker.board->legalActions(worker.actions);
+			PolicyNet::priors(output, worker.actions, worker.priors);
+			const Rules& rules = worker.board->rules();
+			std::vector<Edge> edges(worker.actions.size());
+			for (size_t i = 0; i < edges.size(); ++i)
+			{
+				Edge& edge = edges[i];
+				edge.action = worker.actions[i];
+				edge.prior = worker.priors[i];
+				edge.odds = 1.0f;
+				if (edge.action.type == Action::ATTACK)
+				{
+					edge.odds = rules.odds[worker.board->getTile(edge.action.fromX, edge.action.fromY)->unit()->type()]
+						[worker.board->getTile(edge.action.toX, edge.action.toY)->unit()->type()];
+				}
+				edge.visits = 0;
+				edge.total = 0.0f;
+				edge.children[0] = edge.children[1] = nullptr;
+			}
+
+			lock.lock();
+			if (!node->expanded) // Another thread may have got here first
+			{
+				node->edges.swap(edges);
+				node->expanded = true;
+			}
+		}
+
+		// Take the virtual losses back off, and add the result for whoever chose each action
+		for (size_t i = path.size(); i-- > 0;)
+		{
+			float result = path[i].first->state.player == node->state.player ? value : -value;
+			path[i].second->total += VIRTUAL_LOSS + result;
+		}
+	}
+}
+
+NetAI::Node* NetAI::child(Worker& worker, Node& node, Edge& edge, int outcome)
+{
+	if (!edge.children[outcome])
+	{
+		worker.board->loadState(node.state);
+		if (edge.action.type == Action::ATTACK)
+		{
+			worker.board->doAction(edge.action, outcome == 0);
+		}
+		else
+		{
+			worker.board->doAction(edge.action);
+		}
+		m_nodes.push_back(Node());
+		Node& made = m_nodes.back();
+		worker.board->saveState(made.state);
+		made.expanded = false;
+		made.visits = 0;
+		edge.children[outcome] = &made;
+	}
+	return edge.children[outcome];
+}
+
+NetAI::Edge* NetAI::select(Node& node)
+{
+	float explore = EXPLORATION * std::sqrt((float)std::max(1, node.visits));
+	Edge* best = &node.edges[0];
+	float bestScore = -1e30f;
+	for (size_t i = 0; i < node.edges.size(); ++i)
+	{
+		Edge& edge = node.edges[i];
+		float q = edge.visits > 0 ? edge.total / edge.visits : 0.0f;
+		float score = q + explore * edge.prior / (1 + edge.visits);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			best = &edge;
+		}
+	}
+	return best;
+}
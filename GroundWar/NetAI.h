@@ -0,0 +1,111 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "AI.h"
+#include "PolicyNet.h"
+#include "InferenceQueue.h"
+#include "ThreadPool.h"
+
+/*
+Plays with a Monte Carlo tree search guided by a PolicyNet, in the style of AlphaZero:
+each playout walks down the tree picking actions by how well they've done so far and how
+likely the network thinks they are, and the position it ends up at is scored by the
+network instead of being played out. An attack goes one way or the other by a roll
+against the odds, so its two outcomes grow their own subtrees.
+
+Several threads run playouts on the same tree, with a virtual loss on the path a thread
+is exploring so others spread out. Their evaluations go through an InferenceQueue, so
+the network runs on batches with a position from each thread.
+*/
+class NetAI :
+	public AI
+{
+public:
+	/*
+	Uses the weights in the given file if it can be loaded, otherwise random weights
+	from the seed. Runs the given number of playouts per action, split between the given
+	number of threads (0 means one per hardware thread).
+	*/
+	NetAI(unsigned seed, int playouts = 256, unsigned threads = 0, const char* weights = "groundwar.net");
+	~NetAI();
+
+	Action chooseAction(Board& board);
+	const char* name();
+
+	PolicyNet& net();
+
+	/*
+	Stats for the last call to chooseAction: playouts run and network batches used.
+	*/
+	int playouts();
+	long long batches();
+
+	/*
+	Gets what the last call to chooseAction found: each legal action and its share of
+	the playouts. This is what the network's policy is trained towards.
+	*/
+	const std::vector<Action>& searchActions();
+	const std::vector<float>& searchPolicy();
+
+private:
+	struct Node;
+
+	struct Edge
+	{
+		Action action;
+		float prior;
+		float odds; // Chance of winning, for an attack
+		int visits;
+		float total; // Sum of results for the player taking the action
+		Node* children[2]; // The position after the action, or after winning and losing an attack
+	};
+
+	struct Node
+	{
+		BoardState state;
+		bool expanded;
+		int visits;
+		std::vector<Edge> edges;
+	};
+
+	struct Worker
+	{
+		Board* board;
+		std::mt19937 rng;
+		std::vector<Action> actions;
+		std::vector<float> priors;
+	};
+
+	PolicyNet m_net;
+	InferenceQueue* m_queue;
+	ThreadPool m_pool;
+	std::vector<Worker> m_workers;
+	int m_playouts;
+	std::vector<Action> m_searchActions;
+	std::vector<float> m_searchPolicy;
+
+	// The search in progress, guarded by m_mutex
+	std::mutex m_mutex;
+	std::deque<Node> m_nodes; // Every node of the tree; a deque so pointers to them stay good
+	int m_started = 0;
+	long long m_batchesBefore = 0;
+	long long m_batches = 0;
+
+	/*
+	Runs playouts on one worker until the search has started enough of them.
+	*/
+	void search(Worker& worker);
+
+	/*
+	Gets the child reached by the given edge and outcome, making it if it doesn't exist
+	yet. Called with the lock held.
+	*/
+	Node* child(Worker& worker, Node& node, Edge& edge, int outcome);
+
+	/*
+	Picks the edge to explore from an expanded node. Called with the lock held.
+	*/
+	Edge* select(Node& node);
+};
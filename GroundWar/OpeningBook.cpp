@@ -0,0 +1,284 @@
+#include "OpeningBook.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static const char BOOK_MAGIC[4] = { 'G', 'W', 'B', '1' };
+
+/*
+The start of a book file. The slots follow, then the moves.
+*/
+struct BookHeader
+{
+	char magic[4];
+	unsigned slots;
+	unsigned positions;
+	unsigned moves;
+	Rules rules;
+};
+
+static unsigned char packCoord(int value)
+{
+	return (unsigned char)(value < 0 ? 255 : value);
+}
+
+static int unpackCoord(unsigned char value)
+{
+	return value == 255 ? -1 : value;
+}
+
+OpeningBookBuilder::OpeningBookBuilder(const Rules& rules) :
+	m_rules(rules) {}
+
+void OpeningBookBuilder::add(const BoardState& state, const Action& action, float score)
+{
+	std::vector<Stats>& moves = m_positions[state.hash()];
+	int halfPoints = (int)(score * 2 + 0.5f);
+	for (size_t i = 0; i < moves.size(); ++i)
+	{
+		if (moves[i].action == action)
+		{
+			++moves[i].games;
+			moves[i].halfPoints += halfPoints;
+			return;
+		}
+	}
+	Stats stats = { action, 1, halfPoints };
+	moves.push_back(stats);
+}
+
+void OpeningBookBuilder::merge(const OpeningBookBuilder& other)
+{
+	for (auto it = other.m_positions.begin(); it != other.m_positions.end(); ++it)
+	{
+		std::vector<Stats>& moves = m_positions[it->first];
+		for (size_t i = 0; i < it->second.size(); ++i)
+		{
+			const Stats& added = it->second[i];
+			size_t j = 0;
+			while (j < moves.size() && moves[j].action != added.action)
+			{
+				++j;
+			}
+			if (j == moves.size())
+			{
+				moves.push_back(added);
+			}
+			else
+			{
+				moves[j].games += added.games;
+				moves[j].halfPoints += added.halfPoints;
+			}
+		}
+	}
+}
+
+int OpeningBookBuilder::positions() const
+{
+	return (int)m_positions.size();
+}
+
+bool OpeningBookBuilder::save(const char* path, int minGames) const
+{
+	// Count what's kept first, to size the table at most half full
+	unsigned positions = 0;
+	for (auto it = m_positions.begin(); it != m_positions.end(); ++it)
+	{
+		for (size_t i = 0; i < it->second.size(); ++i)
+		{
+			if (it->second[i].games >= minGames)
+			{
+				++positions;
+				break;
+			}
+		}
+	}
+	unsigned slots = 16;
+	while (slots < positions * 2)
+	{
+		slots *= 2;
+	}
+
+	OpeningBook::Slot empty = { 0, 0, 0 };
+	std::vector<OpeningBook::Slot> table(slots, empty);
+	std::vector<OpeningBook::Move> moves;
+	std::vector<Stats> kept;
+	for (auto it = m_positions.begin(); it != m_positions.end(); ++it)
+	{
+		kept.clear();
+		for (size_t i = 0; i < it->second.size(); ++i)
+		{
+			if (it->second[i].games >= minGames)
+			{
+				kept.push_back(it->second[i]);
+			}
+		}
+		if (kept.empty())
+		{
+			continue;
+		}
+		std::sort(kept.begin(), kept.end(), [](const Stats& a, const Stats& b) { return a.games > b.games; });
+
+		unsigned slot = (unsigned)it->first & (slots - 1);
+		while (table[slot].count)
+		{
+			slot = (slot + 1) & (slots - 1);
+		}
+		table[slot].hash = it->first;
+		table[slot].first = (unsigned)moves.size();
+		table[slot].count = (unsigned)kept.size();
+		for (size_t i = 0; i < kept.size(); ++i)
+		{
+			const Action& action = kept[i].action;
+			OpeningBook::Move move = { (unsigned char)action.type, (unsigned char)action.unitType,
+				packCoord(action.fromX), packCoord(action.fromY), packCoord(action.toX), packCoord(action.toY),
+				0, (unsigned)kept[i].games, (unsigned)kept[i].halfPoints };
+			moves.push_back(move);
+		}
+	}
+
+	BookHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+	header.slots = slots;
+	header.positions = positions;
+	header.moves = (unsigned)moves.size();
+	header.rules = m_rules;
+
+	std::ofstream out(path, std::ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)&table[0], sizeof(OpeningBook::Slot) * table.size());
+	if (!moves.empty())
+	{
+		out.write((const char*)&moves[0], sizeof(OpeningBook::Move) * moves.size());
+	}
+	return out.good();
+}
+
+OpeningBook::OpeningBook() :
+	m_rules(Rules::standard()) {}
+
+bool OpeningBook::load(const char* path)
+{
+	std::ifstream in(path, std::ios::binary);
+	BookHeader header;
+	if (!in.read((char*)&header, sizeof(header)) || !std::equal(header.magic, header.magic + sizeof(BOOK_MAGIC), BOOK_MAGIC) ||
+		header.slots == 0 || (header.slots & (header.slots - 1)) != 0 || header.positions >= header.slots)
+	{
+		return false;
+	}
+
+	std::vector<Slot> slots(header.slots);
+	std::vector<Move> moves(header.moves);
+	if (!in.read((char*)&slots[0], sizeof(Slot) * slots.size()) ||
+		(!moves.empty() && !in.read((char*)&moves[0], sizeof(Move) * moves.size())))
+	{
+		return false;
+	}
+	for (size_t i = 0; i < slots.size(); ++i)
+	{
+		if (slots[i].count && (slots[i].first > moves.size() || slots[i].count > moves.size() - slots[i].first))
+		{
+			return false;
+		}
+	}
+
+	m_rules = header.rules;
+	m_slots.swap(slots);
+	m_moves.swap(moves);
+	m_positions = (int)header.positions;
+	return true;
+}
+
+bool OpeningBook::ready() const
+{
+	return !m_slots.empty();
+}
+
+bool OpeningBook::matches(const Rules& rules) const
+{
+	return m_rules.startMoney == rules.startMoney && m_rules.movementPoints == rules.movementPoints &&
+		std::equal(m_rules.goldCost, m_rules.goldCost + UNIT_TYPES, rules.goldCost) &&
+		std::equal(m_rules.movementCost, m_rules.movementCost + UNIT_TYPES, rules.movementCost) &&
+		std::equal(&m_rules.odds[0][0], &m_rules.odds[0][0] + UNIT_TYPES * UNIT_TYPES, &rules.odds[0][0]);
+}
+
+int OpeningBook::positions() const
+{
+	return m_positions;
+}
+
+const OpeningBook::Slot* OpeningBook::find(unsigned long long hash) const
+{
+	if (m_slots.empty())
+	{
+		return nullptr;
+	}
+	size_t mask = m_slots.size() - 1;
+	for (size_t slot = (size_t)hash & mask; m_slots[slot].count; slot = (slot + 1) & mask)
+	{
+		if (m_slots[slot].hash == hash)
+		{
+			return &m_slots[slot];
+		}
+	}
+	return nullptr;
+}
+
+Action OpeningBook::unpack(const Move& move)
+{
+	Action action;
+	action.type = (Action::ActionType)move.type;
+	action.unitType = (Unit::UnitType)move.unitType;
+	action.fromX = unpackCoord(move.fromX);
+	action.fromY = unpackCoord(move.fromY);
+	action.toX = unpackCoord(move.toX);
+	action.toY = unpackCoord(move.toY);
+	return action;
+}
+
+bool OpeningBook::probe(const BoardState& state, std::vector<BookMove>& moves) const
+{
+	moves.clear();
+	const Slot* slot = find(state.hash());
+	if (!slot)
+	{
+		return false;
+	}
+	for (unsigned i = 0; i < slot->count; ++i)
+	{
+		const Move& move = m_moves[slot->first + i];
+		BookMove bookMove;
+		bookMove.action = unpack(move);
+		bookMove.games = (int)move.games;
+		bookMove.score = move.halfPoints * 0.5f / move.games;
+		moves.push_back(bookMove);
+	}
+	return true;
+}
+
+bool OpeningBook::choose(const BoardState& state, Action& action, int minGames) const
+{
+	const Slot* slot = find(state.hash());
+	if (!slot)
+	{
+		return false;
+	}
+	const Move* best = nullptr;
+	for (unsigned i = 0; i < slot->count; ++i)
+	{
+		const Move& move = m_moves[slot->first + i];
+		// Compare scores as halfPoints / games without dividing
+		if ((int)move.games >= minGames && (!best ||
+			(unsigned long long)move.halfPoints * best->games > (unsigned long long)best->halfPoints * move.games))
+		{
+			best = &move;
+		}
+	}
+	if (!best)
+	{
+		return false;
+	}
+	action = unpack(*best);
+	return true;
+}
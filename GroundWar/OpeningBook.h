@@ -0,0 +1,128 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "Action.h"
+#include "BoardState.h"
+#include "Rules.h"
+
+/*
+How one action has done from a position in the games a book was built from. score is
+the average result for the player who took it: 1 for a win, 0.5 for a draw, 0 for a loss.
+*/
+struct BookMove
+{
+	Action action;
+	int games;
+	float score;
+};
+
+/*
+Collects the actions taken in the opening of many games, and how those games ended, then
+writes them out as an OpeningBook.
+*/
+class OpeningBookBuilder
+{
+public:
+	/*
+	Starts an empty book for games played by the given rules.
+	*/
+	OpeningBookBuilder(const Rules& rules);
+
+	/*
+	Records that the given action was taken in the given position, in a game that scored
+	the given result for the player who took it.
+	*/
+	void add(const BoardState& state, const Action& action, float score);
+
+	/*
+	Adds everything in another builder, so builders filled on separate threads can be
+	merged.
+	*/
+	void merge(const OpeningBookBuilder& other);
+
+	int positions() const;
+
+	/*
+	Writes the book, leaving out actions taken in fewer than minGames games, and positions
+	left with no actions. Returns false if the file can't be written.
+	*/
+	bool save(const char* path, int minGames = 1) const;
+
+private:
+	struct Stats
+	{
+		Action action;
+		int games;
+		int halfPoints; // Twice the total score, so a draw counts exactly
+	};
+
+	Rules m_rules;
+	std::unordered_map<unsigned long long, std::vector<Stats>> m_positions; // By BoardState::hash
+};
+
+/*
+A book of opening actions, looked up by position. The file is a hash table: a header, a
+power of two of slots each holding a position's hash and where its actions start, then
+every action and its results. Slots are found by linear probing from the hash, so a
+lookup touches a slot or two, whatever the size of the book.
+
+Positions are matched by BoardState::hash, which leaves out the turn number, so the same
+position reached on different turns shares its results. The rules the book was built
+with, starting money included, are stored with it, since openings under other rules
+have little to do with it.
+*/
+class OpeningBook
+{
+public:
+	OpeningBook();
+
+	/*
+	Reads a book. Returns false, leaving the book as it was, if the file can't be read or
+	isn't a book.
+	*/
+	bool load(const char* path);
+
+	bool ready() const;
+	bool matches(const Rules& rules) const;
+	int positions() const;
+
+	/*
+	Gets every action the book has for the position, most played first. Returns false if
+	the position isn't in the book.
+	*/
+	bool probe(const BoardState& state, std::vector<BookMove>& moves) const;
+
+	/*
+	Picks the action with the best score from those played in at least minGames games.
+	Returns false if there isn't one.
+	*/
+	bool choose(const BoardState& state, Action& action, int minGames = 8) const;
+
+private:
+	struct Slot
+	{
+		unsigned long long hash;
+		unsigned first; // Index of the position's first move
+		unsigned count; // 0 for an empty slot
+	};
+
+	struct Move
+	{
+		unsigned char type;
+		unsigned char unitType;
+		unsigned char fromX, fromY, toX, toY;
+		unsigned short padding;
+		unsigned games;
+		unsigned halfPoints;
+	};
+
+	friend class OpeningBookBuilder;
+
+	Rules m_rules;
+	std::vector<Slot> m_slots;
+	std::vector<Move> m_moves;
+	int m_positions = 0;
+
+	const Slot* find(unsigned long long hash) const;
+	static Action unpack(const Move& move);
+};
@@ -0,0 +1,126 @@
+#include "PathFinder.h"
+#include <algorithm>
+#include <cstdlib>
+#include "Board.h"
+
+PathFinder::PathFinder()
+{
+	m_open.reserve(TILES * 6); // A tile is pushed at most once per neighbour
+	m_path.reserve(TILES);
+	std::fill(m_seen, m_seen + TILES, 0u);
+}
+
+bool PathFinder::OpenEntry::operator<(const OpenEntry& other) const
+{
+	return estimate > other.estimate; // Reversed so std::push_heap keeps the cheapest on top
+}
+
+bool PathFinder::find(Board& board, Tile* from, Tile* to, int budget)
+{
+	m_path.clear();
+	m_pathCost = 0;
+	if (!from || !to || from == to || !from->unit() || !to->openForMovement())
+	{
+		return false;
+	}
+
+	// Start a new search by bumping the stamp instead of clearing every buffer
+	if (++m_search == 0)
+	{
+		std::fill(m_seen, m_seen + TILES, 0u);
+		m_search = 1;
+	}
+
+	const int stepCost = board.rules().movementCost[from->unit()->type()];
+	const int start = from->x() * BOARD_HEIGHT + from->y();
+	const int goal = to->x() * BOARD_HEIGHT + to->y();
+	m_open.clear();
+	m_seen[start] = m_search;
+	m_cost[start] = 0;
+	m_parent[start] = -1;
+	OpenEntry first = { hexDistance(from->x(), from->y(), to->x(), to->y()) * stepCost, start };
+	m_open.push_back(first);
+
+	while (!m_open.empty())
+	{
+		std::pop_heap(m_open.begin(), m_open.end());
+		OpenEntry entry = m_open.back();
+		m_open.pop_back();
+		int tile = entry.tile;
+		int x = tile / BOARD_HEIGHT;
+		int y = tile % BOARD_HEIGHT;
+		if (entry.estimate > m_cost[tile] + hexDistance(x, y, to->x(), to->y()) * stepCost)
+		{
+			continue; // Stale entry, the tile has been reached more cheaply since
+		}
+		if (tile == goal)
+		{
+			break;
+		}
+
+		int cost = m_cost[tile] + stepCost;
+		if (cost > budget)
+		{
+			continue;
+		}
+		for (int dir = 0; dir < 6; ++dir)
+		{
+			int adjX, adjY;
+			if (!Board::adjacentPosition(x, y, dir, adjX, adjY))
+			{
+				continue;
+			}
+			Tile* adj = board.getTile(adjX, adjY);
+			int next = adjX * BOARD_HEIGHT + adjY;
+			if (!adj || !adj->openForMovement() || (m_seen[next] == m_search && m_cost[next] <= cost))
+			{
+				continue;
+			}
+			int estimate = cost + hexDistance(adjX, adjY, to->x(), to->y()) * stepCost;
+			if (estimate > budget)
+			{
+				continue; // Can't make it there in time even in a straight line
+			}
+			m_seen[next] = m_search;
+			m_cost[next] = cost;
+			m_parent[next] = tile;
+			OpenEntry open = { estimate, next };
+			m_open.push_back(open);
+			std::push_heap(m_open.begin(), m_open.end());
+		}
+	}
+
+	if (m_seen[goal] != m_search)
+	{
+		return false;
+	}
+
+	// Walk back from the goal, then flip the route around
+	for (int tile = goal; tile != start; tile = m_parent[tile])
+	{
+		m_path.push_back(board.getTile(tile / BOARD_HEIGHT, tile % BOARD_HEIGHT));
+	}
+	std::reverse(m_path.begin(), m_path.end());
+	m_pathCost = m_cost[goal];
+	return true;
+}
+
+const std::vector<Tile*>& PathFinder::path()
+{
+	return m_path;
+}
+
+int PathFinder::cost()
+{
+	return m_pathCost;
+}
+
+int PathFinder::hexDistance(int x1, int y1, int x2, int y2)
+{
+	// Convert to axial coordinates. Even columns sit half a tile lower than odd ones.
+	int r1 = y1 - (x1 + (x1 & 1)) / 2;
+	int r2 = y2 - (x2 + (x2 & 1)) / 2;
+	int dq = x2 - x1;
+	int dr = r2 - r1;
+	return (std::abs(dq) + std::abs(dr) + std::abs(dq + dr)) / 2;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include "Constants.h"
+
+class Board;
+class Tile;
+
+/*
+Finds the cheapest multi-step route for a unit with A* on the hex grid. Every step costs
+the unit's movement cost from the board's rules, and a route can only go through tiles
+that are open for movement. All of the search buffers are allocated once up front, so
+planning a route on every mouse move doesn't allocate.
+*/
+class PathFinder
+{
+public:
+	PathFinder();
+
+	/*
+	Finds the cheapest route for the unit on the first tile to the second tile, costing
+	at most the given number of movement points. Returns false if there's no unit on the
+	first tile or no such route. The route can be read with path and cost until the next
+	call to find.
+	*/
+	bool find(Board& board, Tile* from, Tile* to, int budget);
+
+	/*
+	Gets the tiles of the last route found, in order, not including the starting tile.
+	Empty if the last search failed.
+	*/
+	const std::vector<Tile*>& path();
+
+	/*
+	Gets the movement points the last route found costs.
+	*/
+	int cost();
+
+	/*
+	Gets the number of steps between two board positions, ignoring what's on the tiles.
+	*/
+	static int hexDistance(int x1, int y1, int x2, int y2);
+
+private:
+	static const int TILES = BOARD_WIDTH * BOARD_HEIGHT;
+
+	struct OpenEntry
+	{
+		int estimate; // Cost so far plus the heuristic
+		int tile;
+
+		bool operator<(const OpenEntry& other) const;
+	};
+
+	std::vector<OpenEntry> m_open; // Binary heap, cheapest estimate on top
+	std::vector<Tile*> m_path;
+	int m_cost[TILES];
+	int m_parent[TILES];
+	unsigned m_seen[TILES]; // Equal to m_search if the tile has been reached this search
+	unsigned m_search = 0;
+	int m_pathCost = 0;
+};
@@ -0,0 +1,25 @@
+#include "PlannerAI.h"
+
+PlannerAI::PlannerAI(unsigned seed, unsigned threads, int maxPerLayer) :
+	m_planner(threads, maxPerLayer, seed) {}
+
+Action PlannerAI::chooseAction(Board& board)
+{
+	BoardState state;
+	board.saveState(state);
+	if (m_next >= m_plan.actions.size() || m_plan.positions[m_next] != state.hash())
+	{
+		m_plan = m_planner.plan(board);
+		m_next = 0;
+		if (m_plan.actions.empty())
+		{
+			return Action::endTurn();
+		}
+	}
+	return m_plan.actions[m_next++];
+}
+
+const char* PlannerAI::name()
+{
+	return "planner";
+}
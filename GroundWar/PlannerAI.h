@@ -0,0 +1,22 @@
+#pragma once
+#include "AI.h"
+#include "TurnPlanner.h"
+
+/*
+Plays whole turns planned by TurnPlanner. At the first action of a turn, or whenever
+the board isn't where the plan expected (after an attack, say), it plans the rest of the
+turn again; otherwise it just takes the next action of the plan.
+*/
+class PlannerAI :
+	public AI
+{
+public:
+	PlannerAI(unsigned seed, unsigned threads = 0, int maxPerLayer = 2000);
+	Action chooseAction(Board& board);
+	const char* name();
+
+private:
+	TurnPlanner m_planner;
+	TurnPlan m_plan;
+	size_t m_next = 0; // Index in the plan of the next action to take
+};
@@ -0,0 +1,673 @@
+#include "PlayoutBatch.h"
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The AVX2 kernels are always compiled with MSVC, which allows intrinsics without /arch.
+// Other compilers need AVX2 enabled for the whole file.
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define PLAYOUT_AVX2
+#endif
+
+// Cell encoding: which unit (if any) stands on a tile, and which flag lies on the ground there
+static const int UNIT_MASK = 3; // Unit type + 1, 0 if the tile is empty
+static const int OWNER_BIT = 4; // Set if the unit is blue
+static const int CARRY_BIT = 8; // Set if the unit is carrying the enemy flag
+static const int GROUND_SHIFT = 4; // Flag on the ground: 0 none, 1 red, 2 blue
+static const int GROUND_MASK = 3 << GROUND_SHIFT;
+
+// Decision kinds
+static const int TRY_FAILED = 0;
+static const int DO_MOVE = 1;
+static const int DO_ATTACK = 2;
+static const int DO_SPAWN = 3;
+
+static const int SPAWN_CHANCE = 64; // Out of 256: how often a try is a spawn instead of a move
+static const int FAIL_LIMIT = 8; // Failed tries in a row before ending a turn that has had a move
+static const int HARD_FAIL_LIMIT = 64; // Failed tries in a row before assuming there's nothing to do at all
+static const int MAX_TILES = BOARD_WIDTH * BOARD_HEIGHT;
+
+static int* allocInts(size_t count)
+{
+	int* p = (int*)_mm_malloc(count * sizeof(int), 32);
+	for (size_t i = 0; i < count; ++i)
+	{
+		p[i] = 0;
+	}
+	return p;
+}
+
+static unsigned nextRandom(unsigned& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+bool PlayoutBatch::simdAvailable()
+{
+#if !defined(PLAYOUT_AVX2)
+	return false;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27))) // OS has to save the AVX registers (OSXSAVE)
+	{
+		return false;
+	}
+	if ((_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+PlayoutBatch::PlayoutBatch(int lanes, unsigned seed)
+{
+	m_lanes = (lanes + 7) / 8 * 8;
+	if (m_lanes < 8)
+	{
+		m_lanes = 8;
+	}
+	m_useSimd = simdAvailable();
+
+	m_neighbors = allocInts(MAX_TILES * 6);
+	m_passable = allocInts(MAX_TILES);
+	m_baseOwner = allocInts(MAX_TILES);
+	m_spawnOf = allocInts(MAX_TILES);
+	m_goldTiles = allocInts(MAX_TILES);
+	m_spawnCandidates = allocInts(MAX_TILES * 2);
+	m_startCells = allocInts(MAX_TILES);
+
+	m_cells = allocInts(MAX_TILES * m_lanes);
+	m_money[0] = allocInts(m_lanes);
+	m_money[1] = allocInts(m_lanes);
+	m_movementLeft = allocInts(m_lanes);
+	m_player = allocInts(m_lanes);
+	m_turn = allocInts(m_lanes);
+	m_result = allocInts(m_lanes);
+	m_failures = allocInts(m_lanes);
+	m_units[0] = allocInts(m_lanes);
+	m_units[1] = allocInts(m_lanes);
+	m_rng = (unsigned*)allocInts(m_lanes);
+	for (int lane = 0; lane < m_lanes; ++lane)
+	{
+		// xorshift can't start from 0, and neighbouring lanes shouldn't start correlated
+		unsigned state = seed ^ (0x9e3779b9u * (lane + 1));
+		m_rng[lane] = state ? state : 1;
+		nextRandom(m_rng[lane]);
+	}
+}
+
+PlayoutBatch::~PlayoutBatch()
+{
+	int* arrays[] = { m_neighbors, m_passable, m_baseOwner, m_spawnOf, m_goldTiles, m_spawnCandidates,
+		m_startCells, m_cells, m_money[0], m_money[1], m_movementLeft, m_player, m_turn, m_result,
+		m_failures, m_units[0], m_units[1], (int*)m_rng };
+	for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); ++i)
+	{
+		_mm_free(arrays[i]);
+	}
+}
+
+void PlayoutBatch::load(Board& board)
+{
+	// Number the real tiles compactly
+	int index[BOARD_WIDTH][BOARD_HEIGHT];
+	m_tileCount = 0;
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			index[x][y] = board.getTile(x, y) ? m_tileCount++ : -1;
+		}
+	}
+
+	m_goldCount = 0;
+	m_spawnCandidateCount[0] = m_spawnCandidateCount[1] = 0;
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = board.getTile(x, y);
+			if (!tile)
+			{
+				continue;
+			}
+			int t = index[x][y];
+			m_spawnOf[t] = -1;
+			for (int i = 0; i < 6; ++i)
+			{
+				int adjX, adjY;
+				int n = Board::adjacentPosition(x, y, i, adjX, adjY) ? index[adjX][adjY] : -1;
+				m_neighbors[t * 6 + i] = n;
+				// A spawnable tile is controlled by the first spawn tile next to it, like SpawnableTile
+				if (tile->type() == Tile::SPAWNABLE && m_spawnOf[t] < 0 && n >= 0 &&
+					board.getTile(adjX, adjY)->type() == Tile::SPAWN)
+				{
+					m_spawnOf[t] = n;
+				}
+			}
+			m_passable[t] = tile->type() != Tile::MOUNTAIN;
+			m_baseOwner[t] = tile->type() == Tile::BASE ? (tile->spawnableFor(RED) ? RED : BLUE) : -1;
+			if (tile->type() == Tile::GOLD)
+			{
+				m_goldTiles[m_goldCount++] = t;
+			}
+			for (int p = 0; p < 2; ++p)
+			{
+				if (m_baseOwner[t] == p || m_spawnOf[t] >= 0)
+				{
+					m_spawnCandidates[p * MAX_TILES + m_spawnCandidateCount[p]++] = t;
+				}
+			}
+
+			int cell = 0;
+			Unit* unit = tile->unit();
+			if (unit)
+			{
+				cell |= (unit->type() + 1) | (unit->owner() == BLUE ? OWNER_BIT : 0) | (unit->flag() ? CARRY_BIT : 0);
+			}
+			if ((!unit || !unit->flag()) && tile->flag())
+			{
+				cell |= (tile->flag()->owner() + 1) << GROUND_SHIFT;
+			}
+			m_startCells[t] = cell;
+		}
+	}
+
+	const Rules& rules = board.rules();
+	m_minMovementCost = m_minGoldCost = 1 << 30;
+	for (int i = 0; i < 8; ++i)
+	{
+		m_movementCost[i] = i < UNIT_TYPES ? rules.movementCost[i] : 0;
+		m_goldCost[i] = i < UNIT_TYPES ? rules.goldCost[i] : 0;
+	}
+	for (int i = 0; i < 16; ++i)
+	{
+		m_odds[i] = i < UNIT_TYPES * UNIT_TYPES ? rules.odds[i / UNIT_TYPES][i % UNIT_TYPES] : 0.0f;
+	}
+	for (int i = 0; i < UNIT_TYPES; ++i)
+	{
+		m_minMovementCost = rules.movementCost[i] < m_minMovementCost ? rules.movementCost[i] : m_minMovementCost;
+		m_minGoldCost = rules.goldCost[i] < m_minGoldCost ? rules.goldCost[i] : m_minGoldCost;
+	}
+	m_movementPoints = rules.movementPoints;
+
+	m_startMoney[0] = board.money(RED);
+	m_startMoney[1] = board.money(BLUE);
+	m_startMovementPoints = board.movementPoints();
+	m_startPlayer = board.currentPlayer();
+	m_startResult = board.gameOver() ? board.winner() + 1 : 0;
+}
+
+void PlayoutBatch::resetLanes()
+{
+	int units[2] = { 0, 0 };
+	for (int t = 0; t < m_tileCount; ++t)
+	{
+		int cell = m_startCells[t];
+		if (cell & UNIT_MASK)
+		{
+			++units[(cell & OWNER_BIT) ? BLUE : RED];
+		}
+		int* row = m_cells + t * m_lanes;
+		for (int lane = 0; lane < m_lanes; ++lane)
+		{
+			row[lane] = cell;
+		}
+	}
+	for (int lane = 0; lane < m_lanes; ++lane)
+	{
+		m_money[0][lane] = m_startMoney[0];
+		m_money[1][lane] = m_startMoney[1];
+		m_movementLeft[lane] = m_startMovementPoints;
+		m_player[lane] = m_startPlayer;
+		m_turn[lane] = 0;
+		m_result[lane] = m_startResult;
+		m_failures[lane] = 0;
+		m_units[0][lane] = units[0];
+		m_units[1][lane] = units[1];
+	}
+}
+
+void PlayoutBatch::run(int maxTurns)
+{
+	resetLanes();
+	if (m_startResult != 0)
+	{
+		return; // Already decided
+	}
+	if (maxTurns <= 0)
+	{
+		for (int lane = 0; lane < m_lanes; ++lane)
+		{
+			m_result[lane] = 3;
+		}
+		return;
+	}
+
+	int groups = m_lanes / 8;
+	int playing = m_lanes;
+	while (playing > 0)
+	{
+		for (int group = 0; group < groups; ++group)
+		{
+			int base = group * 8;
+			bool any = false;
+			for (int i = 0; i < 8 && !any; ++i)
+			{
+				any = m_result[base + i] == 0;
+			}
+			if (!any)
+			{
+				continue;
+			}
+
+			if (m_useSimd)
+			{
+				decideSimd(group);
+			}
+			else
+			{
+				decideScalar(group);
+			}
+			for (int i = 0; i < 8; ++i)
+			{
+				if (m_result[base + i] == 0)
+				{
+					apply(base + i, m_kind[i], m_from[i], m_to[i], m_extra[i]);
+					if (m_result[base + i] != 0)
+					{
+						--playing;
+					}
+				}
+			}
+			playing -= m_useSimd ? endTurnsSimd(group, maxTurns) : endTurnsScalar(group, maxTurns);
+		}
+	}
+}
+
+void PlayoutBatch::decideScalar(int group)
+{
+	for (int i = 0; i < 8; ++i)
+	{
+		int lane = group * 8 + i;
+		unsigned r1 = nextRandom(m_rng[lane]);
+		unsigned r2 = nextRandom(m_rng[lane]);
+		unsigned r3 = nextRandom(m_rng[lane]);
+		int player = m_player[lane];
+		m_kind[i] = TRY_FAILED;
+
+		if ((int)((r1 >> 16) & 0xff) < SPAWN_CHANCE)
+		{
+			// Try to spawn a random unit type on a random candidate tile
+			int type = (int)(((r1 & 0xffff) * 3) >> 16);
+			int candidate = m_spawnCandidates[player * MAX_TILES + (int)(((r3 & 0xff) * m_spawnCandidateCount[player]) >> 8)];
+			int cell = m_cells[candidate * m_lanes + lane];
+			int spawn = m_spawnOf[candidate];
+			int spawnCell = spawn >= 0 ? m_cells[spawn * m_lanes + lane] : 0;
+			bool spawnable = m_baseOwner[candidate] == player ||
+				(spawn >= 0 && (spawnCell & UNIT_MASK) && ((spawnCell & OWNER_BIT) != 0) == (player == BLUE));
+			if (!(cell & UNIT_MASK) && spawnable && m_money[player][lane] >= m_goldCost[type])
+			{
+				m_kind[i] = DO_SPAWN;
+				m_to[i] = candidate;
+				m_extra[i] = type;
+			}
+			continue;
+		}
+
+		// Try to move or attack from a random tile in a random direction
+		int from = (int)(((r2 >> 16) * m_tileCount) >> 16);
+		int direction = (int)(((r2 & 0xffff) * 6) >> 16);
+		int cell = m_cells[from * m_lanes + lane];
+		int type = (cell & UNIT_MASK) - 1;
+		if (type < 0 || ((cell & OWNER_BIT) != 0) != (player == BLUE) || m_movementLeft[lane] < m_movementCost[type])
+		{
+			continue;
+		}
+		int to = m_neighbors[from * 6 + direction];
+		if (to < 0)
+		{
+			continue;
+		}
+		int target = m_cells[to * m_lanes + lane];
+		if (!(target & UNIT_MASK))
+		{
+			if (m_passable[to])
+			{
+				m_kind[i] = DO_MOVE;
+				m_from[i] = from;
+				m_to[i] = to;
+			}
+		}
+		else if (((target & OWNER_BIT) != 0) != (player == BLUE))
+		{
+			float roll = (float)(r3 >> 8) * (1.0f / 16777216.0f);
+			m_kind[i] = DO_ATTACK;
+			m_from[i] = from;
+			m_to[i] = to;
+			m_extra[i] = roll < m_odds[type * UNIT_TYPES + (target & UNIT_MASK) - 1];
+		}
+	}
+}
+
+#ifdef PLAYOUT_AVX2
+static inline __m256i xorshift8(__m256i& state)
+{
+	state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+	state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+	state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+	return state;
+}
+#endif
+
+void PlayoutBatch::decideSimd(int group)
+{
+#ifdef PLAYOUT_AVX2
+	const int base = group * 8;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i unitMask = _mm256_set1_epi32(UNIT_MASK);
+	const __m256i lane = _mm256_add_epi32(_mm256_set1_epi32(base), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	const __m256i lanes = _mm256_set1_epi32(m_lanes);
+	const __m256i low16 = _mm256_set1_epi32(0xffff);
+
+	__m256i state = _mm256_load_si256((__m256i*)(m_rng + base));
+	__m256i r1 = xorshift8(state);
+	__m256i r2 = xorshift8(state);
+	__m256i r3 = xorshift8(state);
+	_mm256_store_si256((__m256i*)(m_rng + base), state);
+
+	__m256i player = _mm256_load_si256((__m256i*)(m_player + base));
+	__m256i isBlue = _mm256_cmpeq_epi32(player, one);
+	__m256i movementLeft = _mm256_load_si256((__m256i*)(m_movementLeft + base));
+	__m256i money = _mm256_blendv_epi8(_mm256_load_si256((__m256i*)(m_money[0] + base)),
+		_mm256_load_si256((__m256i*)(m_money[1] + base)), isBlue);
+	__m256i movementCost = _mm256_loadu_si256((__m256i*)m_movementCost);
+	__m256i goldCost = _mm256_loadu_si256((__m256i*)m_goldCost);
+
+	// Move masking: pick a tile and direction per lane, gather both cells and see what the try would do
+	__m256i from = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(r2, 16), _mm256_set1_epi32(m_tileCount)), 16);
+	__m256i direction = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_and_si256(r2, low16), _mm256_set1_epi32(6)), 16);
+	__m256i cell = _mm256_i32gather_epi32(m_cells, _mm256_add_epi32(_mm256_mullo_epi32(from, lanes), lane), 4);
+	__m256i unit = _mm256_and_si256(cell, unitMask);
+	__m256i type = _mm256_max_epi32(_mm256_sub_epi32(unit, one), zero);
+	__m256i ownerIsBlue = _mm256_cmpeq_epi32(_mm256_and_si256(cell, _mm256_set1_epi32(OWNER_BIT)), _mm256_set1_epi32(OWNER_BIT));
+	__m256i ours = _mm256_andnot_si256(_mm256_cmpeq_epi32(unit, zero), _mm256_cmpeq_epi32(ownerIsBlue, isBlue));
+	__m256i affordable = _mm256_cmpgt_epi32(_mm256_add_epi32(movementLeft, one), _mm256_permutevar8x32_epi32(movementCost, type));
+	__m256i canMove = _mm256_and_si256(ours, affordable);
+
+	__m256i to = _mm256_i32gather_epi32(m_neighbors, _mm256_add_epi32(_mm256_mullo_epi32(from, _mm256_set1_epi32(6)), direction), 4);
+	__m256i onBoard = _mm256_cmpgt_epi32(to, _mm256_set1_epi32(-1));
+	__m256i safeTo = _mm256_and_si256(to, onBoard); // Tile 0 stands in for "no tile" so the gathers stay in bounds
+	__m256i target = _mm256_i32gather_epi32(m_cells, _mm256_add_epi32(_mm256_mullo_epi32(safeTo, lanes), lane), 4);
+	__m256i passable = _mm256_cmpeq_epi32(_mm256_i32gather_epi32(m_passable, safeTo, 4), one);
+	__m256i targetUnit = _mm256_and_si256(target, unitMask);
+	__m256i targetEmpty = _mm256_cmpeq_epi32(targetUnit, zero);
+	__m256i targetIsBlue = _mm256_cmpeq_epi32(_mm256_and_si256(target, _mm256_set1_epi32(OWNER_BIT)), _mm256_set1_epi32(OWNER_BIT));
+	__m256i targetIsEnemy = _mm256_andnot_si256(_mm256_or_si256(targetEmpty, _mm256_cmpeq_epi32(targetIsBlue, isBlue)), _mm256_set1_epi32(-1));
+	__m256i reachable = _mm256_and_si256(canMove, onBoard);
+	__m256i moveMask = _mm256_and_si256(reachable, _mm256_and_si256(passable, targetEmpty));
+	__m256i attackMask = _mm256_and_si256(reachable, targetIsEnemy);
+
+	// Combat resolution: look up the odds for each attacker/defender pair and roll against them
+	__m256i targetType = _mm256_max_epi32(_mm256_sub_epi32(targetUnit, one), zero);
+	__m256i oddsIndex = _mm256_add_epi32(_mm256_mullo_epi32(type, _mm256_set1_epi32(UNIT_TYPES)), targetType);
+	__m256 odds = _mm256_i32gather_ps(m_odds, oddsIndex, 4);
+	__m256 roll = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(r3, 8)), _mm256_set1_ps(1.0f / 16777216.0f));
+	__m256i wins = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(roll, odds, _CMP_LT_OQ)), one);
+
+	// Spawn tries: a random unit type on a random candidate tile for the current player
+	__m256i spawnTry = _mm256_cmpgt_epi32(_mm256_set1_epi32(SPAWN_CHANCE), _mm256_and_si256(_mm256_srli_epi32(r1, 16), _mm256_set1_epi32(0xff)));
+	__m256i spawnType = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_and_si256(r1, low16), _mm256_set1_epi32(3)), 16);
+	__m256i candidateCount = _mm256_blendv_epi8(_mm256_set1_epi32(m_spawnCandidateCount[0]), _mm256_set1_epi32(m_spawnCandidateCount[1]), isBlue);
+	__m256i candidateIndex = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_and_si256(r3, _mm256_set1_epi32(0xff)), candidateCount), 8);
+	__m256i candidate = _mm256_i32gather_epi32(m_spawnCandidates, _mm256_add_epi32(_mm256_mullo_epi32(player, _mm256_set1_epi32(MAX_TILES)), candidateIndex), 4);
+	__m256i candidateCell = _mm256_i32gather_epi32(m_cells, _mm256_add_epi32(_mm256_mullo_epi32(candidate, lanes), lane), 4);
+	__m256i candidateEmpty = _mm256_cmpeq_epi32(_mm256_and_si256(candidateCell, unitMask), zero);
+	__m256i ownBase = _mm256_cmpeq_epi32(_mm256_i32gather_epi32(m_baseOwner, candidate, 4), player);
+	__m256i spawn = _mm256_i32gather_epi32(m_spawnOf, candidate, 4);
+	__m256i hasSpawn = _mm256_cmpgt_epi32(spawn, _mm256_set1_epi32(-1));
+	__m256i spawnCell = _mm256_i32gather_epi32(m_cells, _mm256_add_epi32(_mm256_mullo_epi32(_mm256_and_si256(spawn, hasSpawn), lanes), lane), 4);
+	__m256i spawnIsBlue = _mm256_cmpeq_epi32(_mm256_and_si256(spawnCell, _mm256_set1_epi32(OWNER_BIT)), _mm256_set1_epi32(OWNER_BIT));
+	__m256i spawnHeld = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(spawnCell, unitMask), zero),
+		_mm256_and_si256(hasSpawn, _mm256_cmpeq_epi32(spawnIsBlue, isBlue)));
+	__m256i canPay = _mm256_cmpgt_epi32(_mm256_add_epi32(money, one), _mm256_permutevar8x32_epi32(goldCost, spawnType));
+	__m256i spawnMask = _mm256_and_si256(spawnTry, _mm256_and_si256(candidateEmpty, _mm256_and_si256(canPay, _mm256_or_si256(ownBase, spawnHeld))));
+
+	// Combine into one decision per lane: spawn tries only spawn, other tries move or attack
+	__m256i kind = _mm256_or_si256(_mm256_and_si256(moveMask, _mm256_set1_epi32(DO_MOVE)),
+		_mm256_and_si256(attackMask, _mm256_set1_epi32(DO_ATTACK)));
+	kind = _mm256_blendv_epi8(kind, _mm256_and_si256(spawnMask, _mm256_set1_epi32(DO_SPAWN)), spawnTry);
+	_mm256_storeu_si256((__m256i*)m_kind, kind);
+	_mm256_storeu_si256((__m256i*)m_from, from);
+	_mm256_storeu_si256((__m256i*)m_to, _mm256_blendv_epi8(to, candidate, spawnTry));
+	_mm256_storeu_si256((__m256i*)m_extra, _mm256_blendv_epi8(wins, spawnType, spawnTry));
+#else
+	decideScalar(group);
+#endif
+}
+
+void PlayoutBatch::apply(int lane, int kind, int from, int to, int extra)
+{
+	if (kind == TRY_FAILED)
+	{
+		++m_failures[lane];
+		return;
+	}
+	m_failures[lane] = 0;
+
+	int player = m_player[lane];
+	int enemy = 1 - player;
+	int& target = m_cells[to * m_lanes + lane];
+	switch (kind)
+	{
+	case DO_MOVE:
+		moveLane(lane, from, to);
+		break;
+	case DO_ATTACK:
+		if (extra) // Attacker wins: the defender dies and the attacker takes its tile
+		{
+			if (target & CARRY_BIT)
+			{
+				// The defender was carrying the attacker's flag; drop it
+				target = (target & ~GROUND_MASK) | ((player + 1) << GROUND_SHIFT);
+			}
+			target &= GROUND_MASK;
+			--m_units[enemy][lane];
+			moveLane(lane, from, to);
+			++m_money[player][lane];
+			checkStalemate(lane, enemy);
+		}
+		else // Defender wins
+		{
+			int& attacker = m_cells[from * m_lanes + lane];
+			if (attacker & CARRY_BIT)
+			{
+				attacker = (attacker & ~GROUND_MASK) | ((enemy + 1) << GROUND_SHIFT);
+			}
+			attacker &= GROUND_MASK;
+			--m_units[player][lane];
+			++m_money[enemy][lane];
+			checkStalemate(lane, player);
+		}
+		break;
+	case DO_SPAWN:
+		target |= (extra + 1) | (player == BLUE ? OWNER_BIT : 0);
+		// Marines spawned onto the enemy flag pick it up, like Tile::setUnit
+		if (extra == Unit::MARINES && ((target & GROUND_MASK) >> GROUND_SHIFT) == enemy + 1)
+		{
+			target = (target & ~GROUND_MASK) | CARRY_BIT;
+		}
+		m_money[player][lane] -= m_goldCost[extra];
+		++m_units[player][lane];
+		break;
+	}
+}
+
+void PlayoutBatch::moveLane(int lane, int from, int to)
+{
+	int& source = m_cells[from * m_lanes + lane];
+	int& target = m_cells[to * m_lanes + lane];
+	int player = m_player[lane];
+	int type = (source & UNIT_MASK) - 1;
+	int unit = source & (UNIT_MASK | OWNER_BIT | CARRY_BIT);
+
+	m_movementLeft[lane] -= m_movementCost[type];
+	source &= GROUND_MASK;
+	target |= unit;
+	if (type == Unit::MARINES && !(target & CARRY_BIT) && ((target & GROUND_MASK) >> GROUND_SHIFT) == 2 - player)
+	{
+		target = (target & ~GROUND_MASK) | CARRY_BIT;
+	}
+
+	// Victory: carrying the enemy flag onto your own base
+	if ((target & CARRY_BIT) && m_baseOwner[to] == player)
+	{
+		m_result[lane] = player + 1;
+	}
+}
+
+void PlayoutBatch::checkStalemate(int lane, int player)
+{
+	if (m_result[lane] == 0 && m_units[player][lane] == 0 && m_money[player][lane] == 0)
+	{
+		m_result[lane] = 2 - player; // The other player wins
+	}
+}
+
+int PlayoutBatch::endTurnsScalar(int group, int maxTurns)
+{
+	int finished = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		int lane = group * 8 + i;
+		if (m_result[lane] != 0)
+		{
+			continue;
+		}
+		int player = m_player[lane];
+		int failures = m_failures[lane];
+		bool stuck = m_movementLeft[lane] < m_minMovementCost && m_money[player][lane] < m_minGoldCost;
+		if (!stuck && failures < HARD_FAIL_LIMIT && (failures < FAIL_LIMIT || m_movementLeft[lane] >= m_movementPoints))
+		{
+			continue;
+		}
+
+		// Gold tiles pay whoever is standing on them
+		for (int g = 0; g < m_goldCount; ++g)
+		{
+			int cell = m_cells[m_goldTiles[g] * m_lanes + lane];
+			if (cell & UNIT_MASK)
+			{
+				++m_money[(cell & OWNER_BIT) ? BLUE : RED][lane];
+			}
+		}
+		m_player[lane] = 1 - player;
+		m_movementLeft[lane] = m_movementPoints;
+		m_failures[lane] = 0;
+		if (++m_turn[lane] >= maxTurns)
+		{
+			m_result[lane] = 3;
+			++finished;
+		}
+	}
+	return finished;
+}
+
+int PlayoutBatch::endTurnsSimd(int group, int maxTurns)
+{
+#ifdef PLAYOUT_AVX2
+	const int base = group * 8;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+
+	__m256i result = _mm256_load_si256((__m256i*)(m_result + base));
+	__m256i player = _mm256_load_si256((__m256i*)(m_player + base));
+	__m256i isBlue = _mm256_cmpeq_epi32(player, one);
+	__m256i movementLeft = _mm256_load_si256((__m256i*)(m_movementLeft + base));
+	__m256i failures = _mm256_load_si256((__m256i*)(m_failures + base));
+	__m256i money0 = _mm256_load_si256((__m256i*)(m_money[0] + base));
+	__m256i money1 = _mm256_load_si256((__m256i*)(m_money[1] + base));
+
+	__m256i money = _mm256_blendv_epi8(money0, money1, isBlue);
+	__m256i stuck = _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(m_minMovementCost), movementLeft),
+		_mm256_cmpgt_epi32(_mm256_set1_epi32(m_minGoldCost), money));
+	__m256i moved = _mm256_cmpgt_epi32(_mm256_set1_epi32(m_movementPoints), movementLeft);
+	__m256i tired = _mm256_and_si256(moved, _mm256_cmpgt_epi32(failures, _mm256_set1_epi32(FAIL_LIMIT - 1)));
+	__m256i hopeless = _mm256_cmpgt_epi32(failures, _mm256_set1_epi32(HARD_FAIL_LIMIT - 1));
+	__m256i ending = _mm256_and_si256(_mm256_cmpeq_epi32(result, zero), _mm256_or_si256(stuck, _mm256_or_si256(tired, hopeless)));
+	if (_mm256_testz_si256(ending, ending))
+	{
+		return 0;
+	}
+
+	// Gold accumulation: every gold tile pays its occupier, in all eight lanes at once
+	const __m256i unitMask = _mm256_set1_epi32(UNIT_MASK);
+	const __m256i ownerBit = _mm256_set1_epi32(OWNER_BIT);
+	for (int g = 0; g < m_goldCount; ++g)
+	{
+		__m256i cell = _mm256_load_si256((__m256i*)(m_cells + m_goldTiles[g] * m_lanes + base));
+		__m256i occupied = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(cell, unitMask), zero), ending);
+		__m256i blueHere = _mm256_cmpeq_epi32(_mm256_and_si256(cell, ownerBit), ownerBit);
+		// Masks are -1 where true, so subtracting them adds one
+		money0 = _mm256_sub_epi32(money0, _mm256_andnot_si256(blueHere, occupied));
+		money1 = _mm256_sub_epi32(money1, _mm256_and_si256(blueHere, occupied));
+	}
+	_mm256_store_si256((__m256i*)(m_money[0] + base), money0);
+	_mm256_store_si256((__m256i*)(m_money[1] + base), money1);
+
+	__m256i endingOne = _mm256_and_si256(ending, one);
+	_mm256_store_si256((__m256i*)(m_player + base), _mm256_xor_si256(player, endingOne));
+	_mm256_store_si256((__m256i*)(m_movementLeft + base), _mm256_blendv_epi8(movementLeft, _mm256_set1_epi32(m_movementPoints), ending));
+	_mm256_store_si256((__m256i*)(m_failures + base), _mm256_andnot_si256(ending, failures));
+	__m256i turn = _mm256_add_epi32(_mm256_load_si256((__m256i*)(m_turn + base)), endingOne);
+	_mm256_store_si256((__m256i*)(m_turn + base), turn);
+
+	__m256i outOfTurns = _mm256_and_si256(ending, _mm256_cmpgt_epi32(turn, _mm256_set1_epi32(maxTurns - 1)));
+	_mm256_store_si256((__m256i*)(m_result + base), _mm256_blendv_epi8(result, _mm256_set1_epi32(3), outOfTurns));
+	int finished = 0;
+	for (int bits = _mm256_movemask_ps(_mm256_castsi256_ps(outOfTurns)); bits; bits &= bits - 1)
+	{
+		++finished;
+	}
+	return finished;
+#else
+	return endTurnsScalar(group, maxTurns);
+#endif
+}
+
+int PlayoutBatch::lanes()
+{
+	return m_lanes;
+}
+
+int PlayoutBatch::winner(int lane)
+{
+	int result = m_result[lane];
+	return result == 1 ? RED : result == 2 ? BLUE : -1;
+}
+
+int PlayoutBatch::wins(Player player)
+{
+	int count = 0;
+	for (int lane = 0; lane < m_lanes; ++lane)
+	{
+		count += m_result[lane] == player + 1;
+	}
+	return count;
+}
+
+bool PlayoutBatch::setUseSimd(bool useSimd)
+{
+	m_useSimd = useSimd && simdAvailable();
+	return m_useSimd;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "Board.h"
+#include "Rules.h"
+
+/*
+Plays many random games at once from the same starting position, for Monte Carlo
+evaluation. Games are kept in a structure-of-arrays layout with one lane per game,
+and lanes are advanced in lockstep, eight at a time with AVX2 when the CPU has it.
+
+The random policy is "pick a random unit tile and direction, or sometimes a random
+spawn, and retry on failure", which is much cheaper than enumerating legal actions.
+A turn ends after enough failed tries in a row. Outcomes follow the same rules as
+Board (flag captures, stalemate, gold tiles, combat odds from the Rules).
+*/
+class PlayoutBatch
+{
+public:
+	/*
+	Creates a batch with at least the given number of lanes (rounded up to a multiple
+	of 8). The seed drives every random choice and combat roll.
+	*/
+	PlayoutBatch(int lanes, unsigned seed);
+	~PlayoutBatch();
+
+	/*
+	Copies the map, rules and current position of the given board into every lane.
+	Has to be called before run.
+	*/
+	void load(Board& board);
+
+	/*
+	Plays every lane from the loaded position until it's decided or maxTurns more
+	turns have been played.
+	*/
+	void run(int maxTurns);
+
+	/*
+	Gets the number of lanes (games) in this batch.
+	*/
+	int lanes();
+
+	/*
+	Gets the winner of the game in the given lane after run: RED, BLUE, or -1 if the
+	game hit the turn limit.
+	*/
+	int winner(int lane);
+
+	/*
+	Gets the number of lanes the given player won in the last run.
+	*/
+	int wins(Player player);
+
+	/*
+	Turns the AVX2 kernels on or off. They're on by default when the CPU supports them;
+	turning them off is mostly useful for benchmarking. Returns whether they're on.
+	*/
+	bool setUseSimd(bool useSimd);
+
+	/*
+	True if this CPU supports the AVX2 kernels.
+	*/
+	static bool simdAvailable();
+
+private:
+	int m_lanes;
+	int m_tileCount = 0; // Number of real tiles on the map
+	bool m_useSimd;
+
+	// Map tables, indexed by compact tile index
+	int* m_neighbors; // 6 per tile, -1 where there is no tile
+	int* m_passable; // 1 unless the tile is a mountain
+	int* m_baseOwner; // Player who owns the base here, -1 if it isn't a base
+	int* m_spawnOf; // For spawnable tiles, the spawn tile that controls it, otherwise -1
+	int* m_goldTiles;
+	int m_goldCount = 0;
+	int* m_spawnCandidates; // 2 rows of m_tileCount: tiles each player could ever spawn on
+	int m_spawnCandidateCount[2];
+
+	// Rules, laid out for vector lookups
+	int m_movementCost[8];
+	int m_goldCost[8];
+	float m_odds[16]; // [attacker * 3 + defender]
+	int m_movementPoints;
+	int m_minMovementCost;
+	int m_minGoldCost;
+
+	// Starting position, one entry per tile plus the per-game values
+	int* m_startCells;
+	int m_startMoney[2];
+	int m_startMovementPoints;
+	Player m_startPlayer;
+	int m_startResult; // Same meaning as m_result
+
+	// Per-lane state. Cells are stored tile-major: m_cells[tile * m_lanes + lane].
+	int* m_cells;
+	int* m_money[2];
+	int* m_movementLeft;
+	int* m_player;
+	int* m_turn;
+	int* m_result; // 0 while playing, 1 red won, 2 blue won, 3 turn limit
+	int* m_failures; // Failed tries in a row this turn
+	int* m_units[2];
+	unsigned* m_rng; // xorshift32 state
+
+	// Decisions for the current group of 8 lanes
+	int m_kind[8];
+	int m_from[8];
+	int m_to[8];
+	int m_extra[8]; // Combat outcome for attacks, unit type for spawns
+
+	void resetLanes();
+	void decideScalar(int group);
+	void decideSimd(int group);
+	void apply(int lane, int kind, int from, int to, int extra);
+	void moveLane(int lane, int from, int to);
+	void checkStalemate(int lane, int player);
+	int endTurnsScalar(int group, int maxTurns);
+	int endTurnsSimd(int group, int maxTurns);
+};
@@ -0,0 +1,456 @@
+#include "PolicyNet.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <immintrin.h>
+#include "PlayoutBatch.h"
+
+// Same as PlayoutBatch: MSVC always compiles the AVX2 kernels, other compilers need AVX2
+// enabled for the whole file.
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define NET_AVX2
+#endif
+
+static const char NET_MAGIC[4] = { 'G', 'W', 'N', '1' };
+static const int BATCH_ROWS = 4; // Positions the first layer kernels take at once
+static const float MONEY_SCALE = 1.0f / 30.0f; // Money this high or more encodes as 1
+
+// Input planes
+static const int UNIT_PLANE = 0; // Six planes: unit type, then 3 more for blue
+static const int CARRIED_PLANE = 6; // Red flag, then blue
+static const int LYING_PLANE = 8; // Red flag, then blue
+static const int TERRAIN_PLANE = 10; // One per Tile::TileType
+
+#ifdef NET_AVX2
+static float horizontalSum(__m256 v)
+{
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+
+static int horizontalSum(__m256i v)
+{
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+static int tileIndex(int x, int y)
+{
+	return x * BOARD_HEIGHT + y;
+}
+
+PolicyNet::PolicyNet(unsigned seed) :
+	m_w1(HIDDEN1 * INPUT_STRIDE, 0.0f), m_b1(HIDDEN1, 0.0f),
+	m_w2(HIDDEN2 * HIDDEN1), m_b2(HIDDEN2, 0.0f),
+	m_wValue(HIDDEN2 + 1, 0.0f),
+	m_wPolicy(POLICY * HIDDEN2), m_bPolicy(POLICY, 0.0f)
+{
+	m_useSimd = PlayoutBatch::simdAvailable();
+	m_movementPoints = Rules::standard().movementPoints;
+
+	// The map never changes, so its planes are worked out once
+	memset(m_terrain, 0, sizeof(m_terrain));
+	Board board;
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = board.getTile(x, y);
+			if (tile)
+			{
+				m_terrain[tileIndex(x, y)][tile->type()] = 1.0f;
+			}
+		}
+	}
+
+	// Scaled so every layer starts out passing on about as much as it takes in
+	std::mt19937 rng(seed);
+	std::normal_distribution<float> first(0.0f, std::sqrt(2.0f / INPUTS));
+	for (int o = 0; o < HIDDEN1; ++o)
+	{
+		for (int i = 0; i < INPUTS; ++i)
+		{
+			m_w1[o * INPUT_STRIDE + i] = first(rng);
+		}
+	}
+	std::normal_distribution<float> second(0.0f, std::sqrt(2.0f / HIDDEN1));
+	for (size_t i = 0; i < m_w2.size(); ++i)
+	{
+		m_w2[i] = second(rng);
+	}
+	std::normal_distribution<float> heads(0.0f, std::sqrt(1.0f / HIDDEN2));
+	for (int i = 0; i < HIDDEN2; ++i)
+	{
+		m_wValue[i] = heads(rng);
+	}
+	for (size_t i = 0; i < m_wPolicy.size(); ++i)
+	{
+		m_wPolicy[i] = heads(rng);
+	}
+}
+
+void PolicyNet::encode(const BoardState& state, float* input) const
+{
+	memset(input, 0, INPUT_STRIDE * sizeof(float));
+	for (int t = 0; t < BOARD_TILES; ++t)
+	{
+		float* planes = input + t * PLANES;
+		unsigned char bits = state.tiles[t];
+		if (bits & BoardState::UNIT_MASK)
+		{
+			planes[UNIT_PLANE + (bits & BoardState::UNIT_MASK) - 1 + (bits & BoardState::UNIT_BLUE ? 3 : 0)] = 1.0f;
+		}
+		if (bits & BoardState::CARRIED_FLAG)
+		{
+			planes[CARRIED_PLANE + (bits & BoardState::CARRIED_BLUE ? 1 : 0)] = 1.0f;
+		}
+		if (bits & BoardState::LYING_FLAG)
+		{
+			planes[LYING_PLANE + (bits & BoardState::LYING_BLUE ? 1 : 0)] = 1.0f;
+		}
+		memcpy(planes + TERRAIN_PLANE, m_terrain[t], sizeof(m_terrain[t]));
+	}
+
+	float* game = input + BOARD_TILES * PLANES;
+	game[0] = std::min(1.0f, state.money[RED] * MONEY_SCALE);
+	game[1] = std::min(1.0f, state.money[BLUE] * MONEY_SCALE);
+	game[2] = std::min(1.0f, (float)state.movementPoints / m_movementPoints);
+	game[3] = state.player == BLUE ? 1.0f : 0.0f;
+}
+
+void PolicyNet::evaluate(const BoardState* states, int count, NetOutput* outputs) const
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	std::vector<float> inputs(count * INPUT_STRIDE);
+	for (int b = 0; b < count; ++b)
+	{
+		encode(states[b], &inputs[b * INPUT_STRIDE]);
+	}
+	std::vector<float> hidden1(count * HIDDEN1);
+	if (m_precision == INT8)
+	{
+		firstLayerQuantized(&inputs[0], count, &hidden1[0]);
+	}
+	else
+	{
+		firstLayer(&inputs[0], count, &hidden1[0]);
+	}
+
+	float hidden2[HIDDEN2];
+	float policy[POLICY];
+	for (int b = 0; b < count; ++b)
+	{
+		const float* in = &hidden1[b * HIDDEN1];
+		for (int o = 0; o < HIDDEN2; ++o)
+		{
+			const float* w = &m_w2[o * HIDDEN1];
+			float sum = m_b2[o];
+			for (int i = 0; i < HIDDEN1; ++i)
+			{
+				sum += w[i] * in[i];
+			}
+			hidden2[o] = std::max(0.0f, sum);
+		}
+
+		float value = m_wValue[HIDDEN2];
+		for (int i = 0; i < HIDDEN2; ++i)
+		{
+			value += m_wValue[i] * hidden2[i];
+		}
+		for (int o = 0; o < POLICY; ++o)
+		{
+			const float* w = &m_wPolicy[o * HIDDEN2];
+			float sum = m_bPolicy[o];
+			for (int i = 0; i < HIDDEN2; ++i)
+			{
+				sum += w[i] * hidden2[i];
+			}
+			policy[o] = sum;
+		}
+
+		NetOutput& out = outputs[b];
+		out.value = std::tanh(value);
+		memcpy(out.from, policy, sizeof(out.from));
+		memcpy(out.to, policy + BOARD_TILES, sizeof(out.to));
+		memcpy(out.spawn, policy + BOARD_TILES * 2, sizeof(out.spawn));
+		out.end = policy[POLICY - 1];
+	}
+}
+
+void PolicyNet::firstLayer(const float* inputs, int count, float* outputs) const
+{
+	for (int b = 0; b < count; b += BATCH_ROWS)
+	{
+		const float* rows[BATCH_ROWS];
+		int n = std::min(BATCH_ROWS, count - b); // The last group can be short
+		for (int k = 0; k < n; ++k)
+		{
+			rows[k] = inputs + (b + k) * INPUT_STRIDE;
+		}
+
+		for (int o = 0; o < HIDDEN1; ++o)
+		{
+			const float* w = &m_w1[o * INPUT_STRIDE];
+			float sums[BATCH_ROWS];
+#ifdef NET_AVX2
+			if (m_useSimd)
+			{
+				__m256 acc[BATCH_ROWS];
+				for (int k = 0; k < n; ++k)
+				{
+					acc[k] = _mm256_setzero_ps();
+				}
+				for (int i = 0; i < INPUT_STRIDE; i += 8)
+				{
+					__m256 weights = _mm256_loadu_ps(w + i);
+					for (int k = 0; k < n; ++k)
+					{
+						acc[k] = _mm256_add_ps(acc[k], _mm256_mul_ps(weights, _mm256_loadu_ps(rows[k] + i)));
+					}
+				}
+				for (int k = 0; k < n; ++k)
+				{
+					sums[k] = horizontalSum(acc[k]);
+				}
+			}
+			else
+#endif
+			{
+				for (int k = 0; k < n; ++k)
+				{
+					sums[k] = 0.0f;
+				}
+				for (int i = 0; i < INPUT_STRIDE; ++i)
+				{
+					for (int k = 0; k < n; ++k)
+					{
+						sums[k] += w[i] * rows[k][i];
+					}
+				}
+			}
+			for (int k = 0; k < n; ++k)
+			{
+				outputs[(b + k) * HIDDEN1 + o] = std::max(0.0f, sums[k] + m_b1[o]);
+			}
+		}
+	}
+}
+
+void PolicyNet::firstLayerQuantized(const float* inputs, int count, float* outputs) const
+{
+	// Inputs go from 0 to 1, so 0 to 127 keeps each pair of products within 16 bits
+	std::vector<unsigned char> quantized(count * INPUT_STRIDE);
+	for (size_t i = 0; i < quantized.size(); ++i)
+	{
+		quantized[i] = (unsigned char)(inputs[i] * 127.0f + 0.5f);
+	}
+
+	for (int b = 0; b < count; b += BATCH_ROWS)
+	{
+		const unsigned char* rows[BATCH_ROWS];
+		int n = std::min(BATCH_ROWS, count - b);
+		for (int k = 0; k < n; ++k)
+		{
+			rows[k] = &quantized[(b + k) * INPUT_STRIDE];
+		}
+
+		for (int o = 0; o < HIDDEN1; ++o)
+		{
+			const signed char* w = &m_q1[o * INPUT_STRIDE];
+			int sums[BATCH_ROWS];
+#ifdef NET_AVX2
+			if (m_useSimd)
+			{
+				const __m256i ones = _mm256_set1_epi16(1);
+				__m256i acc[BATCH_ROWS];
+				for (int k = 0; k < n; ++k)
+				{
+					acc[k] = _mm256_setzero_si256();
+				}
+				for (int i = 0; i < INPUT_STRIDE; i += 32)
+				{
+					__m256i weights = _mm256_loadu_si256((const __m256i*)(w + i));
+					for (int k = 0; k < n; ++k)
+					{
+						// 32 byte products summed in pairs to 16 bits, then in pairs again to 32
+						__m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(rows[k] + i)), weights);
+						acc[k] = _mm256_add_epi32(acc[k], _mm256_madd_epi16(products, ones));
+					}
+				}
+				for (int k = 0; k < n; ++k)
+				{
+					sums[k] = horizontalSum(acc[k]);
+				}
+			}
+			else
+#endif
+			{
+				for (int k = 0; k < n; ++k)
+				{
+					sums[k] = 0;
+				}
+				for (int i = 0; i < INPUT_STRIDE; ++i)
+				{
+					for (int k = 0; k < n; ++k)
+					{
+						sums[k] += w[i] * rows[k][i];
+					}
+				}
+			}
+			float scale = m_q1Scale[o] / (127.0f * 127.0f);
+			for (int k = 0; k < n; ++k)
+			{
+				outputs[(b + k) * HIDDEN1 + o] = std::max(0.0f, sums[k] * scale + m_b1[o]);
+			}
+		}
+	}
+}
+
+void PolicyNet::priors(const NetOutput& output, const std::vector<Action>& actions, std::vector<float>& probabilities)
+{
+	probabilities.resize(actions.size());
+	float highest = -1e30f;
+	for (size_t i = 0; i < actions.size(); ++i)
+	{
+		const Action& action = actions[i];
+		float logit;
+		switch (action.type)
+		{
+		case Action::MOVE:
+		case Action::ATTACK:
+			logit = output.from[tileIndex(action.fromX, action.fromY)] + output.to[tileIndex(action.toX, action.toY)];
+			break;
+		case Action::SPAWN:
+			logit = output.spawn[action.unitType] + output.to[tileIndex(action.toX, action.toY)];
+			break;
+		default:
+			logit = output.end;
+			break;
+		}
+		probabilities[i] = logit;
+		highest = std::max(highest, logit);
+	}
+
+	float total = 0.0f;
+	for (size_t i = 0; i < probabilities.size(); ++i)
+	{
+		probabilities[i] = std::exp(probabilities[i] - highest);
+		total += probabilities[i];
+	}
+	for (size_t i = 0; i < probabilities.size(); ++i)
+	{
+		probabilities[i] /= total;
+	}
+}
+
+void PolicyNet::quantize()
+{
+	m_q1.assign(m_w1.size(), 0);
+	m_q1Scale.assign(HIDDEN1, 0.0f);
+	for (int o = 0; o < HIDDEN1; ++o)
+	{
+		const float* w = &m_w1[o * INPUT_STRIDE];
+		float largest = 0.0f;
+		for (int i = 0; i < INPUT_STRIDE; ++i)
+		{
+			largest = std::max(largest, std::fabs(w[i]));
+		}
+		m_q1Scale[o] = largest;
+		if (largest > 0.0f)
+		{
+			for (int i = 0; i < INPUT_STRIDE; ++i)
+			{
+				m_q1[o * INPUT_STRIDE + i] = (signed char)std::floor(w[i] / largest * 127.0f + 0.5f);
+			}
+		}
+	}
+}
+
+void PolicyNet::setPrecision(Precision precision)
+{
+	m_precision = precision;
+	if (precision == INT8)
+	{
+		quantize();
+	}
+}
+
+PolicyNet::Precision PolicyNet::precision() const
+{
+	return m_precision;
+}
+
+bool PolicyNet::setUseSimd(bool useSimd)
+{
+	m_useSimd = useSimd && PlayoutBatch::simdAvailable();
+	return m_useSimd;
+}
+
+static void writeFloats(std::ofstream& out, const std::vector<float>& values)
+{
+	out.write((const char*)&values[0], values.size() * sizeof(float));
+}
+
+static bool readFloats(std::ifstream& in, std::vector<float>& values)
+{
+	return (bool)in.read((char*)&values[0], values.size() * sizeof(float));
+}
+
+bool PolicyNet::save(const char* path) const
+{
+	std::ofstream out(path, std::ios::binary);
+	int sizes[4] = { INPUTS, HIDDEN1, HIDDEN2, POLICY };
+	out.write(NET_MAGIC, sizeof(NET_MAGIC));
+	out.write((const char*)sizes, sizeof(sizes));
+	writeFloats(out, m_w1);
+	writeFloats(out, m_b1);
+	writeFloats(out, m_w2);
+	writeFloats(out, m_b2);
+	writeFloats(out, m_wValue);
+	writeFloats(out, m_wPolicy);
+	writeFloats(out, m_bPolicy);
+	return out.good();
+}
+
+bool PolicyNet::load(const char* path)
+{
+	std::ifstream in(path, std::ios::binary);
+	char magic[sizeof(NET_MAGIC)];
+	int sizes[4];
+	if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), NET_MAGIC) ||
+		!in.read((char*)sizes, sizeof(sizes)) ||
+		sizes[0] != INPUTS || sizes[1] != HIDDEN1 || sizes[2] != HIDDEN2 || sizes[3] != POLICY)
+	{
+		return false;
+	}
+
+	std::vector<float> w1(m_w1.size()), b1(m_b1.size()), w2(m_w2.size()), b2(m_b2.size());
+	std::vector<float> value(m_wValue.size()), policy(m_wPolicy.size()), policyBias(m_bPolicy.size());
+	if (!readFloats(in, w1) || !readFloats(in, b1) || !readFloats(in, w2) || !readFloats(in, b2) ||
+		!readFloats(in, value) || !readFloats(in, policy) || !readFloats(in, policyBias))
+	{
+		return false;
+	}
+	m_w1.swap(w1);
+	m_b1.swap(b1);
+	m_w2.swap(w2);
+	m_b2.swap(b2);
+	m_wValue.swap(value);
+	m_wPolicy.swap(policy);
+	m_bPolicy.swap(policyBias);
+	if (m_precision == INT8)
+	{
+		quantize();
+	}
+	return true;
+}
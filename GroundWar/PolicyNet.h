@@ -0,0 +1,119 @@
+#pragma once
+#include <vector>
+#include "Board.h"
+#include "BoardState.h"
+#include "Rules.h"
+#include "Tile.h"
+
+/*
+What the network thinks of a position. The policy is split into parts that are added up
+to score an action: a move or attack scores from[start tile] + to[target tile], a spawn
+scores spawn[unit type] + to[tile], and ending the turn scores end. Tiles are indexed the
+same way as BoardState::tiles.
+*/
+struct NetOutput
+{
+	float value; // Expected result for the player to move, from -1 (a loss) to 1 (a win)
+	float from[BOARD_TILES];
+	float to[BOARD_TILES];
+	float spawn[UNIT_TYPES];
+	float end;
+};
+
+/*
+A small policy and value network, run on the CPU. The input is a set of planes over the
+tiles (each unit type and owner, carried and lying flags, and the terrain from
+Tile::TileType) plus the money, movement points and player to move. Two fully connected
+ReLU layers lead to the value and policy heads.
+
+The first layer holds almost all of the weights, so it has two kernels: one in float,
+and one with the weights quantized to 8 bits per output, which moves a quarter of the
+memory and does 32 multiply-adds per AVX2 instruction. Both process positions four at
+a time so each weight is loaded once per four positions, and both have AVX2 versions
+that are used when the CPU has it. The smaller layers are always float.
+
+Weights start out random (from a seed) and can be saved and loaded. Evaluating is const
+and allocates its own scratch space, so any number of threads can share one network.
+*/
+class PolicyNet
+{
+public:
+	enum Precision
+	{
+		FLOAT, INT8
+	};
+
+	static const int PLANES = 16; // Input planes per tile
+	static const int INPUTS = BOARD_TILES * PLANES + 4; // Planes, then the per-game values
+	static const int INPUT_STRIDE = (INPUTS + 31) / 32 * 32; // Padded for the kernels
+	static const int HIDDEN1 = 128;
+	static const int HIDDEN2 = 64;
+	static const int POLICY = BOARD_TILES * 2 + UNIT_TYPES + 1;
+
+	/*
+	Makes a network with random weights drawn from the given seed, for the standard map.
+	*/
+	PolicyNet(unsigned seed = 1);
+
+	/*
+	Evaluates count positions at once. Batches of four or more make the best use of the
+	first layer's kernels.
+	*/
+	void evaluate(const BoardState* states, int count, NetOutput* outputs) const;
+
+	/*
+	Turns the policy into a probability for each of the given actions, which should be
+	the legal actions in the position the output is for. The probabilities add up to 1.
+	*/
+	static void priors(const NetOutput& output, const std::vector<Action>& actions, std::vector<float>& probabilities);
+
+	/*
+	Fills in the network's input for a position: INPUT_STRIDE values, each from 0 to 1.
+	*/
+	void encode(const BoardState& state, float* input) const;
+
+	/*
+	Picks which first layer kernel evaluate uses. Switching to INT8 quantizes the current
+	weights. Defaults to FLOAT.
+	*/
+	void setPrecision(Precision precision);
+	Precision precision() const;
+
+	/*
+	Turns the AVX2 kernels on or off, like PlayoutBatch::setUseSimd. Returns whether they're on.
+	*/
+	bool setUseSimd(bool useSimd);
+
+	/*
+	Saves or loads the weights. Files are "GWN1", the layer sizes, then the weights as
+	floats. load returns false, leaving the weights alone, if the file can't be read or
+	has different layer sizes.
+	*/
+	bool save(const char* path) const;
+	bool load(const char* path);
+
+private:
+	float m_terrain[BOARD_TILES][Tile::SPAWNABLE + 1]; // One-hot tile types, all 0 off the map
+	int m_movementPoints;
+	Precision m_precision = FLOAT;
+	bool m_useSimd;
+
+	// Weights are stored by output, then input, and each layer has a bias per output
+	std::vector<float> m_w1, m_b1; // HIDDEN1 x INPUT_STRIDE
+	std::vector<float> m_w2, m_b2; // HIDDEN2 x HIDDEN1
+	std::vector<float> m_wValue; // HIDDEN2, then the bias
+	std::vector<float> m_wPolicy, m_bPolicy; // POLICY x HIDDEN2
+
+	// The first layer quantized: weight = m_q1[i] * m_q1Scale[output] / 127
+	std::vector<signed char> m_q1;
+	std::vector<float> m_q1Scale;
+
+	void quantize();
+
+	/*
+	The first layer, for count inputs of INPUT_STRIDE values each, giving HIDDEN1 values
+	each after the ReLU.
+	*/
+	void firstLayer(const float* inputs, int count, float* outputs) const;
+	void firstLayerQuantized(const float* inputs, int count, float* outputs) const;
+};
@@ -0,0 +1,394 @@
+#include "PositionDatabase.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include "Delta.h"
+#include "ThreadPool.h"
+
+static const char DATABASE_MAGIC[4] = { 'G', 'W', 'D', '1' };
+static const int SORT_BUCKETS = 256; // By the top byte of the hash, sorted separately
+
+/*
+The start of a database file. The slots follow, then the games, the postings and the
+paths.
+*/
+struct DatabaseHeader
+{
+	char magic[4];
+	int games;
+	unsigned long long slots;
+	long long positions;
+	unsigned long long postingBytes;
+	unsigned long long pathBytes;
+	char padding[24];
+};
+
+/*
+One game a position came up in, while building.
+*/
+struct Posting
+{
+	unsigned long long hash;
+	int game;
+	int position;
+
+	bool operator<(const Posting& other) const
+	{
+		return hash != other.hash ? hash < other.hash : game < other.game;
+	}
+};
+
+static void writeNumber(unsigned value, std::vector<unsigned char>& out)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+/*
+Reads a number written by writeNumber. Returns false if it runs past the end.
+*/
+static bool readNumber(const unsigned char*& data, const unsigned char* end, unsigned& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		if (data == end)
+		{
+			return false;
+		}
+		unsigned char byte = *data++;
+		value |= (unsigned)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+float PositionStats::score(int player) const
+{
+	return games ? (wins[player] + draws * 0.5f) / games : 0.5f;
+}
+
+int PositionDatabaseBuilder::add(const std::vector<std::string>& paths, unsigned threads,
+	const std::function<void(int done)>& progress)
+{
+	std::vector<Game> read(paths.size());
+	std::vector<char> valid(paths.size(), 0);
+	std::atomic<int> done(0);
+	{
+		ThreadPool pool(threads);
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			pool.submit([&, i]()
+			{
+				Game& game = read[i];
+				std::vector<unsigned char> records;
+				if (loadReplay(paths[i].c_str(), records) && !records.empty() && isKeyframe(&records[0], records.size()))
+				{
+					// Walk the records as Replay::load does, noting every position's hash
+					std::vector<std::pair<unsigned long long, int>> seen;
+					BoardState state;
+					size_t offset = 0;
+					while (offset < records.size())
+					{
+						size_t size = applyRecord(state, &records[offset], records.size() - offset);
+						if (!size)
+						{
+							break;
+						}
+						seen.push_back(std::make_pair(state.hash(), (int)seen.size()));
+						offset += size;
+					}
+					if (offset == records.size())
+					{
+						// Keep the first time each position came up
+						std::sort(seen.begin(), seen.end());
+						game.path = paths[i];
+						game.length = (int)seen.size() - 1;
+						game.winner = state.winner;
+						for (size_t j = 0; j < seen.size(); ++j)
+						{
+							if (j == 0 || seen[j].first != seen[j - 1].first)
+							{
+								game.hashes.push_back(seen[j].first);
+								game.positions.push_back(seen[j].second);
+							}
+						}
+						valid[i] = 1;
+					}
+				}
+				int count = ++done;
+				if (progress)
+				{
+					progress(count);
+				}
+			});
+		}
+	}
+
+	// Games keep the order they were given in, whichever thread read them
+	int added = 0;
+	for (size_t i = 0; i < read.size(); ++i)
+	{
+		if (valid[i])
+		{
+			m_games.push_back(Game());
+			std::swap(m_games.back(), read[i]);
+			++added;
+		}
+	}
+	return added;
+}
+
+int PositionDatabaseBuilder::games() const
+{
+	return (int)m_games.size();
+}
+
+bool PositionDatabaseBuilder::save(const char* path, unsigned threads) const
+{
+	// Spread the postings over buckets by the top of the hash, so each can be sorted alone
+	std::vector<std::vector<Posting>> buckets(SORT_BUCKETS);
+	for (size_t g = 0; g < m_games.size(); ++g)
+	{
+		const Game& game = m_games[g];
+		for (size_t i = 0; i < game.hashes.size(); ++i)
+		{
+			Posting posting = { game.hashes[i], (int)g, game.positions[i] };
+			buckets[game.hashes[i] >> 56].push_back(posting);
+		}
+	}
+	{
+		ThreadPool pool(threads);
+		for (int b = 0; b < SORT_BUCKETS; ++b)
+		{
+			std::vector<Posting>* bucket = &buckets[b];
+			pool.submit([bucket]() { std::sort(bucket->begin(), bucket->end()); });
+		}
+	}
+
+	long long positions = 0;
+	for (int b = 0; b < SORT_BUCKETS; ++b)
+	{
+		for (size_t i = 0; i < buckets[b].size(); ++i)
+		{
+			if (i == 0 || buckets[b][i].hash != buckets[b][i - 1].hash)
+			{
+				++positions;
+			}
+		}
+	}
+	unsigned long long slotCount = 16;
+	while (slotCount < (unsigned long long)positions * 3 / 2)
+	{
+		slotCount *= 2;
+	}
+
+	PositionDatabase::Slot empty;
+	memset(&empty, 0, sizeof(empty));
+	std::vector<PositionDatabase::Slot> slots((size_t)slotCount, empty);
+	std::vector<unsigned char> postings;
+	for (int b = 0; b < SORT_BUCKETS; ++b)
+	{
+		const std::vector<Posting>& bucket = buckets[b];
+		for (size_t start = 0, end; start < bucket.size(); start = end)
+		{
+			PositionDatabase::Slot slot = empty;
+			slot.hash = bucket[start].hash;
+			slot.postings = postings.size();
+			int lastGame = 0;
+			for (end = start; end < bucket.size() && bucket[end].hash == slot.hash; ++end)
+			{
+				const Game& game = m_games[bucket[end].game];
+				++slot.games;
+				if (game.winner == RED || game.winner == BLUE)
+				{
+					++slot.wins[game.winner];
+				}
+				writeNumber((unsigned)(bucket[end].game - lastGame), postings);
+				writeNumber((unsigned)bucket[end].position, postings);
+				lastGame = bucket[end].game;
+			}
+
+			size_t index = (size_t)slot.hash & (size_t)(slotCount - 1);
+			while (slots[index].games)
+			{
+				index = (index + 1) & (size_t)(slotCount - 1);
+			}
+			slots[index] = slot;
+		}
+	}
+
+	std::vector<PositionDatabase::GameEntry> games;
+	std::string paths;
+	for (size_t g = 0; g < m_games.size(); ++g)
+	{
+		PositionDatabase::GameEntry entry = { (unsigned)paths.size(), m_games[g].length, m_games[g].winner };
+		games.push_back(entry);
+		paths.append(m_games[g].path);
+		paths.push_back('\0');
+	}
+
+	DatabaseHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DATABASE_MAGIC, sizeof(DATABASE_MAGIC));
+	header.games = (int)games.size();
+	header.slots = slotCount;
+	header.positions = positions;
+	header.postingBytes = postings.size();
+	header.pathBytes = paths.size();
+
+	std::ofstream out(path, std::ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)&slots[0], sizeof(PositionDatabase::Slot) * slots.size());
+	if (!games.empty())
+	{
+		out.write((const char*)&games[0], sizeof(PositionDatabase::GameEntry) * games.size());
+		out.write((const char*)&postings[0], postings.size());
+		out.write(paths.data(), paths.size());
+	}
+	return out.good();
+}
+
+PositionDatabase::PositionDatabase() {}
+
+bool PositionDatabase::load(const char* path)
+{
+	MappedFile file;
+	DatabaseHeader header;
+	if (!file.open(path) || file.size() < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+	if (!std::equal(header.magic, header.magic + sizeof(DATABASE_MAGIC), DATABASE_MAGIC) || header.games < 0 ||
+		header.slots == 0 || (header.slots & (header.slots - 1)) != 0 || header.positions < 0 ||
+		(unsigned long long)header.positions >= header.slots || header.slots > file.size() / sizeof(Slot) ||
+		header.postingBytes > file.size() || header.pathBytes > file.size() ||
+		file.size() != sizeof(header) + header.slots * sizeof(Slot) + header.games * sizeof(GameEntry) +
+		header.postingBytes + header.pathBytes)
+	{
+		return false;
+	}
+
+	// Check the games' paths up front, so looking them up can't run off the end
+	const char* data = file.data() + sizeof(header);
+	const GameEntry* games = (const GameEntry*)(data + header.slots * sizeof(Slot));
+	const char* paths = (const char*)(games + header.games) + header.postingBytes;
+	if (header.games > 0 && (header.pathBytes == 0 || paths[header.pathBytes - 1] != '\0'))
+	{
+		return false;
+	}
+	for (int g = 0; g < header.games; ++g)
+	{
+		if (games[g].path >= header.pathBytes)
+		{
+			return false;
+		}
+	}
+
+	m_file.swap(file);
+	m_slots = (const Slot*)data;
+	m_games = games;
+	m_postings = (const unsigned char*)(games + header.games);
+	m_paths = paths;
+	m_gameCount = header.games;
+	m_positions = header.positions;
+	m_slotCount = header.slots;
+	m_postingBytes = header.postingBytes;
+	m_pathBytes = header.pathBytes;
+	return true;
+}
+
+bool PositionDatabase::ready() const
+{
+	return m_file.isOpen();
+}
+
+int PositionDatabase::games() const
+{
+	return m_gameCount;
+}
+
+long long PositionDatabase::positions() const
+{
+	return m_positions;
+}
+
+const PositionDatabase::Slot* PositionDatabase::find(unsigned long long hash) const
+{
+	if (!m_slots)
+	{
+		return nullptr;
+	}
+	size_t mask = (size_t)(m_slotCount - 1);
+	for (size_t index = (size_t)hash & mask; m_slots[index].games; index = (index + 1) & mask)
+	{
+		if (m_slots[index].hash == hash)
+		{
+			return &m_slots[index];
+		}
+	}
+	return nullptr;
+}
+
+bool PositionDatabase::lookup(const BoardState& state, PositionStats& stats) const
+{
+	const Slot* slot = find(state.hash());
+	if (!slot)
+	{
+		return false;
+	}
+	stats.games = (int)slot->games;
+	stats.wins[RED] = (int)slot->wins[RED];
+	stats.wins[BLUE] = (int)slot->wins[BLUE];
+	stats.draws = stats.games - stats.wins[RED] - stats.wins[BLUE];
+	return true;
+}
+
+bool PositionDatabase::occurrences(const BoardState& state, std::vector<Occurrence>& found, int limit) const
+{
+	found.clear();
+	const Slot* slot = find(state.hash());
+	if (!slot || slot->postings >= m_postingBytes)
+	{
+		return false;
+	}
+	const unsigned char* data = m_postings + slot->postings;
+	const unsigned char* end = m_postings + m_postingBytes;
+	unsigned game = 0;
+	for (unsigned i = 0; i < slot->games && (limit < 0 || (int)found.size() < limit); ++i)
+	{
+		unsigned gap, position;
+		if (!readNumber(data, end, gap) || !readNumber(data, end, position) || game + gap >= (unsigned)m_gameCount)
+		{
+			break; // Damaged postings; keep what was read
+		}
+		game += gap;
+		Occurrence occurrence = { (int)game, (int)position };
+		found.push_back(occurrence);
+	}
+	return true;
+}
+
+const char* PositionDatabase::gamePath(int game) const
+{
+	return m_paths + m_games[game].path;
+}
+
+int PositionDatabase::gameLength(int game) const
+{
+	return m_games[game].length;
+}
+
+int PositionDatabase::gameWinner(int game) const
+{
+	return m_games[game].winner;
+}
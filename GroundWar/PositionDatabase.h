@@ -0,0 +1,149 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "BoardState.h"
+#include "MappedFile.h"
+
+/*
+How the games a position came up in ended.
+*/
+struct PositionStats
+{
+	int games;
+	int wins[2]; // By Player
+	int draws; // Games that ran out of turns
+
+	/*
+	Gets the share of the games the given player won, counting draws as half.
+	*/
+	float score(int player) const;
+};
+
+/*
+A game a position came up in, and the first point in its replay where it did, for
+Replay::seek.
+*/
+struct Occurrence
+{
+	int game;
+	int position;
+};
+
+/*
+Reads replay files and writes out a PositionDatabase of every position in them.
+*/
+class PositionDatabaseBuilder
+{
+public:
+	/*
+	Reads the given replays on up to the given number of threads (0 means one per
+	hardware thread), adding every position in them. Files that can't be read as replays
+	are skipped. progress, if given, is called from the reading threads with the number
+	of files done so far. Returns the number of games added.
+	*/
+	int add(const std::vector<std::string>& paths, unsigned threads = 0,
+		const std::function<void(int done)>& progress = nullptr);
+
+	int games() const;
+
+	/*
+	Writes the database, sorting the positions on the given number of threads. Returns
+	false if the file can't be written.
+	*/
+	bool save(const char* path, unsigned threads = 0) const;
+
+private:
+	struct Game
+	{
+		std::string path;
+		int length; // Actions in the replay
+		int winner; // -1 if the game wasn't won
+		std::vector<unsigned long long> hashes; // Every position in the game, once
+		std::vector<int> positions; // Where each hash first came up
+	};
+
+	std::vector<Game> m_games;
+};
+
+/*
+An index of every position in a collection of replays. Looking a position up gives how
+the games it came up in ended at once, and which games those were.
+
+The file is a hash table, like an OpeningBook's: a header, the games, a power of two of
+slots found by linear probing from BoardState::hash, then the postings and the replay
+paths. Each slot holds a position's hash, its results and where its postings start, so
+results come from a single slot. Postings list a position's games in order, each as the
+gap from the last game and the replay position, both as variable length numbers, so most
+take two or three bytes. The file is mapped rather than read, so opening even a large
+database is instant, and a lookup only touches the pages it needs.
+
+As with the book, the turn number isn't part of the hash, so the same position reached
+on different turns counts as one.
+*/
+class PositionDatabase
+{
+public:
+	PositionDatabase();
+
+	/*
+	Maps a database into memory. Returns false, leaving the database as it was, if the
+	file can't be opened or isn't a database.
+	*/
+	bool load(const char* path);
+
+	bool ready() const;
+	int games() const;
+	long long positions() const;
+
+	/*
+	Gets how the games the position came up in ended. Returns false if it never came up.
+	*/
+	bool lookup(const BoardState& state, PositionStats& stats) const;
+
+	/*
+	Gets the games the position came up in, in the order they were added, up to the given
+	number of them (-1 for all). Returns false if it never came up.
+	*/
+	bool occurrences(const BoardState& state, std::vector<Occurrence>& found, int limit = -1) const;
+
+	/*
+	Gets details of a game, by its index in the database.
+	*/
+	const char* gamePath(int game) const;
+	int gameLength(int game) const;
+	int gameWinner(int game) const;
+
+	/*
+	The entry for each game, and for each slot of the table.
+	*/
+	struct GameEntry
+	{
+		unsigned path; // Offset of the replay path among the paths
+		int length;
+		int winner;
+	};
+
+	struct Slot
+	{
+		unsigned long long hash;
+		unsigned long long postings; // Offset of the position's first posting
+		unsigned games; // 0 for an empty slot
+		unsigned wins[2];
+		unsigned padding;
+	};
+
+private:
+	MappedFile m_file;
+	const GameEntry* m_games = nullptr;
+	const Slot* m_slots = nullptr;
+	const unsigned char* m_postings = nullptr;
+	const char* m_paths = nullptr;
+	int m_gameCount = 0;
+	long long m_positions = 0;
+	unsigned long long m_slotCount = 0;
+	unsigned long long m_postingBytes = 0;
+	unsigned long long m_pathBytes = 0;
+
+	const Slot* find(unsigned long long hash) const;
+};
@@ -0,0 +1,19 @@
+#include "RandomAI.h"
+
+RandomAI::RandomAI(unsigned seed) : m_rng(seed) {}
+
+Action RandomAI::chooseAction(Board& board)
+{
+	board.legalActions(m_actions);
+	if (m_actions.empty())
+	{
+		return Action::endTurn();
+	}
+	std::uniform_int_distribution<size_t> pick(0, m_actions.size() - 1);
+	return m_actions[pick(m_rng)];
+}
+
+const char* RandomAI::name()
+{
+	return "random";
+}
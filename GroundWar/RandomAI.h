@@ -0,0 +1,20 @@
+#pragma once
+#include <random>
+#include <vector>
+#include "AI.h"
+
+/*
+Plays a uniformly random legal action. Cheap enough to use for mass self-play.
+*/
+class RandomAI :
+	public AI
+{
+public:
+	RandomAI(unsigned seed);
+	Action chooseAction(Board& board);
+	const char* name();
+
+private:
+	std::mt19937 m_rng;
+	std::vector<Action> m_actions; // Reused between calls to avoid reallocating
+};
@@ -1,10 +1,31 @@
 #include "Renderer.h"
 #include <iostream>
 #include <cstdio>
+#include <algorithm>
 #include <SDL_image.h>
 #include "Constants.h"
 #include "Cleanup.h"
 
+static const float HEAT_RANGE = 4; // Gold worse than the best action at which a tile stops being tinted
+static const float HEAT_TINT = 0.6f; // Most a tile's background is tinted
+static const int HEAT_COLOR = 0x33cc33;
+static const int DANGER_COLOR = 0xff3333;
+
+/*
+Mixes the given share of one 0xRRGGBB color into another.
+*/
+static int blend(int color, int tint, float amount)
+{
+	int mixed = 0;
+	for (int shift = 0; shift <= 16; shift += 8)
+	{
+		int from = color >> shift & 0xff;
+		int to = tint >> shift & 0xff;
+		mixed |= (int)(from + (to - from) * amount + 0.5f) << shift;
+	}
+	return mixed;
+}
+
 Renderer::~Renderer()
 {
 	// Clean up renderer, window, and font
@@ -110,12 +131,15 @@ int Renderer::init()
 	return 0;
 }
 
-void Renderer::draw(Board* board)
+void Renderer::draw(Board* board, Replay* replay, AsyncAI* ai, const PositionDatabase* database,
+	const Analysis* analysis)
 {
 	SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
 	SDL_RenderClear(renderer);
+	const AnalysisResult* result = analysis ? analysis->result() : nullptr;
 
 	// Draw the board
+	const std::vector<Tile*>& route = board->routePreview();
 	for (int x = 0; x < BOARD_WIDTH; x++)
 	{
 		for (int y = 0; y < BOARD_HEIGHT; y++)
@@ -124,32 +148,21 @@ void Renderer::draw(Board* board)
 			if (tile)
 			{
 				SDL_Point* p = board->tilePosition(x, y);
-				int mode = 0;
 
-				// Set overlay mode
-				if (board->isSelected(tile))
+				// Set overlay mode: selected, movable, attackable or spawnable, from the board's cached masks
+				int mode = board->highlight(x, y);
+				if (std::find(route.begin(), route.end(), tile) != route.end())
 				{
-					mode = SELECTED; // Tile is selected. Draw with the appropriate highlight.
+					mode |= ROUTE; // Tile is on the planned route for the selected unit
 				}
-				else if (tile->isAdjacent(board->selectedTile()))
-				{
-					if (tile->openForMovement())
-					{
-						mode = MOVABLE; // Tile can be moved to. Draw with the appropriate highlight.
-					}
-					else if (board->canAttack(board->selectedTile(), tile))
-					{
-						mode = ATTACKABLE; // Tile can be attack. Draw with the appropriate highlight.
-					}
-				}
-				drawTile(tile, p->x, p->y, mode);
+				drawTile(tile, p->x, p->y, mode, result);
 				delete p;
 			}
 		}
 	}
 
 	// Write gold info on the screen
-	char s[20];
+	char s[64];
 	sprintf(s, "Gold: %d", board->money(RED));
 	writeText(s, RED_INFO.x, RED_INFO.y, RED_COLOR);
 	sprintf(s, "Gold: %d", board->money(BLUE));
@@ -167,6 +180,62 @@ void Renderer::draw(Board* board)
 		writeText(s, NEUTRAL_INFO.x, NEUTRAL_INFO.y + 20,
 			board->currentPlayer() == RED ? RED_COLOR : BLUE_COLOR);
 	}
+	// Write the cost of the planned route
+	if (!board->routePreview().empty())
+	{
+		sprintf(s, "Route: %d points", board->routePreviewCost());
+		writeText(s, NEUTRAL_INFO.x, NEUTRAL_INFO.y + 60,
+			board->currentPlayer() == RED ? RED_COLOR : BLUE_COLOR);
+	}
+
+	// Tell the player how far the selected flag carrier is from home, going around units
+	if (distancesBoard != board)
+	{
+		distances.attach(*board);
+		distancesBoard = board;
+	}
+	Tile* selected = board->selectedTile();
+	if (selected && selected->unit() && selected->unit()->flag())
+	{
+		int steps = distances.homeDistance(selected->unit()->owner(), selected->x(), selected->y());
+		if (steps == DistanceFields::UNREACHABLE)
+		{
+			sprintf(s, "Way home blocked");
+		}
+		else
+		{
+			sprintf(s, "Home is %d tiles away", steps);
+		}
+		writeText(s, NEUTRAL_INFO.x, NEUTRAL_INFO.y + 40,
+			selected->unit()->owner() == RED ? RED_COLOR : BLUE_COLOR);
+	}
+	// Show the chance of winning while hovering over a unit the selected one can attack
+	Tile* hovered = board->hoveredTile();
+	if (selected && hovered && board->canAttack(selected, hovered))
+	{
+		sprintf(s, "Win: %.0f%%", combat.winChance(*board, selected, hovered) * 100);
+		SDL_Point* p = board->tilePosition(hovered->x(), hovered->y());
+		drawTooltip(s, p->x + TILE_WIDTH * 3 / 4, p->y);
+		delete p;
+	}
+	if (replay)
+	{
+		drawReplay(replay);
+	}
+	if (database)
+	{
+		drawAnalysis(board, database);
+	}
+	if (result)
+	{
+		drawSearch(result);
+	}
+	if (ai && ai->thinking())
+	{
+		static const char* dots[] = { "", ".", "..", "..." };
+		sprintf(s, "%s is thinking%s", ai->ai()->name(), dots[SDL_GetTicks() / 300 % 4]);
+		writeText(s, NEUTRAL_INFO.x, NEUTRAL_INFO.y + 80, ai->side() == RED ? RED_COLOR : BLUE_COLOR);
+	}
 	if (board->gameOver()) // If the game is over, draw a victory screen
 	{
 		drawVictory(board->winner());
@@ -206,22 +275,35 @@ void Renderer::renderTexture(const char* texName, int x, int y)
 	SDL_RenderCopy(renderer, texture, nullptr, &dst);
 }
 
-void Renderer::drawTile(Tile* tile, int x, int y, int highlight)
+void Renderer::drawTile(Tile* tile, int x, int y, int highlight, const AnalysisResult* analysis)
 {
 	if (tile)
 	{
 		// Draw tile background
 		int color = tile->getBackgroundColor();
+		if (analysis)
+		{
+			const int index = tile->x() * BOARD_HEIGHT + tile->y();
+			if (analysis->best[index] >= 0 && analysis->best[index] < HEAT_RANGE)
+			{
+				color = blend(color, HEAT_COLOR, HEAT_TINT * (1 - analysis->best[index] / HEAT_RANGE));
+			}
+			color = blend(color, DANGER_COLOR, HEAT_TINT * analysis->danger[index]);
+		}
 		if (highlight & SELECTED)
 		{
 			color = 0xffffff;
 		}
+		else if (highlight & ROUTE)
+		{
+			color = 0xbbddff;
+		}
 		SDL_SetTextureColorMod(textures[TILE_BG], color >> 16 & 0xff, color >> 8 & 0xff, color & 0xff);
 		renderTexture(TILE_BG, x, y);
 
 		// Draw tile foreground (outline)
 		color = tile->getOutlineColor();
-		if (highlight & MOVABLE)
+		if (highlight & (MOVABLE | SPAWNABLE_HIGHLIGHT))
 		{
 			color = 0xffffff;
 		}
@@ -257,6 +339,78 @@ void Renderer::drawVictory(Player winner)
 	renderTexture(VICTORY_TEX, VICTORY_POS.x, VICTORY_POS.y);
 }
 
+void Renderer::drawReplay(Replay* replay)
+{
+	char s[40];
+	sprintf(s, "Replay: %d / %d", replay->position(), replay->length());
+	writeText(s, REPLAY_INFO.x, REPLAY_INFO.y);
+	sprintf(s, "%s at %g/s", replay->playing() ? "Playing" : "Paused", replay->speed());
+	writeText(s, REPLAY_INFO.x, REPLAY_INFO.y + 20);
+
+	SDL_Rect filled = REPLAY_BAR;
+	filled.w = replay->length() > 0 ? REPLAY_BAR.w * replay->position() / replay->length() : 0;
+	SDL_SetRenderDrawColor(renderer, 0x80, 0x80, 0x80, 0xff);
+	SDL_RenderFillRect(renderer, &filled);
+	SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xff);
+	SDL_RenderDrawRect(renderer, &REPLAY_BAR);
+}
+
+void Renderer::drawAnalysis(Board* board, const PositionDatabase* database)
+{
+	BoardState state;
+	board->saveState(state);
+	PositionStats stats;
+	if (!database->lookup(state, stats))
+	{
+		writeText("Not in the database", ANALYSIS_INFO.x, ANALYSIS_INFO.y);
+		return;
+	}
+	char s[64];
+	sprintf(s, "Seen in %d game%s", stats.games, stats.games == 1 ? "" : "s");
+	writeText(s, ANALYSIS_INFO.x, ANALYSIS_INFO.y);
+	sprintf(s, "Red won %.0f%%", stats.wins[RED] * 100.0 / stats.games);
+	writeText(s, ANALYSIS_INFO.x, ANALYSIS_INFO.y + 20, RED_COLOR);
+	sprintf(s, "Blue won %.0f%%", stats.wins[BLUE] * 100.0 / stats.games);
+	writeText(s, ANALYSIS_INFO.x, ANALYSIS_INFO.y + 40, BLUE_COLOR);
+	sprintf(s, "Drawn %.0f%%", stats.draws * 100.0 / stats.games);
+	writeText(s, ANALYSIS_INFO.x, ANALYSIS_INFO.y + 60);
+}
+
+void Renderer::drawSearch(const AnalysisResult* result)
+{
+	char s[64];
+	sprintf(s, "Analysis depth %d", result->depth);
+	writeText(s, SEARCH_INFO.x, SEARCH_INFO.y);
+	sprintf(s, "Red %.0f%%", result->redChance * 100);
+	writeText(s, SEARCH_INFO.x, SEARCH_INFO.y + 20, RED_COLOR);
+	sprintf(s, "Blue %.0f%%", (1 - result->redChance) * 100);
+	writeText(s, SEARCH_INFO.x + WIN_BAR.w / 2, SEARCH_INFO.y + 20, BLUE_COLOR);
+
+	SDL_Rect red = WIN_BAR;
+	red.w = (int)(WIN_BAR.w * result->redChance + 0.5f);
+	SDL_Rect blue = { red.x + red.w, WIN_BAR.y, WIN_BAR.w - red.w, WIN_BAR.h };
+	SDL_SetRenderDrawColor(renderer, RED_COLOR.r, RED_COLOR.g, RED_COLOR.b, 0xff);
+	SDL_RenderFillRect(renderer, &red);
+	SDL_SetRenderDrawColor(renderer, BLUE_COLOR.r, BLUE_COLOR.g, BLUE_COLOR.b, 0xff);
+	SDL_RenderFillRect(renderer, &blue);
+	SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xff);
+	SDL_RenderDrawRect(renderer, &WIN_BAR);
+}
+
+void Renderer::drawTooltip(const std::string& text, int x, int y)
+{
+	SDL_Texture* texture = createText(text, { 0, 0, 0 });
+	SDL_Rect dst = { x + 4, y + 2, 0, 0 };
+	SDL_QueryTexture(texture, nullptr, nullptr, &dst.w, &dst.h);
+	SDL_Rect box = { x, y, dst.w + 8, dst.h + 4 };
+	SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
+	SDL_RenderFillRect(renderer, &box);
+	SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xff);
+	SDL_RenderDrawRect(renderer, &box);
+	SDL_RenderCopy(renderer, texture, nullptr, &dst);
+	SDL_DestroyTexture(texture);
+}
+
 /**
 * Render the given text, in the given color, as a texture.
 */
@@ -4,6 +4,12 @@
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include "Board.h"
+#include "DistanceFields.h"
+#include "Replay.h"
+#include "AsyncAI.h"
+#include "CombatOdds.h"
+#include "PositionDatabase.h"
+#include "Analysis.h"
 
 typedef std::map <const char*, SDL_Texture*> TexMap;
 
@@ -12,7 +18,15 @@ class Renderer
 public:
 	~Renderer();
 	int init();
-	void draw(Board* board);
+	/*
+	Draws the board, and the playback controls if a replay is being watched on it. If an
+	AI is given, it's the AI's turn and a thinking indicator is shown while it works. If a
+	database is given, how the games in it went from the board's position is shown too. If
+	an analysis is given, its latest result for the board is shown as a win chance bar and
+	tinted onto the tiles.
+	*/
+	void draw(Board* board, Replay* replay = nullptr, AsyncAI* ai = nullptr,
+		const PositionDatabase* database = nullptr, const Analysis* analysis = nullptr);
 
 private:
 	std::string texPath;
@@ -20,6 +34,9 @@ private:
 	SDL_Renderer* renderer;
 	TTF_Font* font;
 	TexMap textures;
+	DistanceFields distances; // For the flag carrier hint, attached to the last board drawn
+	Board* distancesBoard = nullptr;
+	CombatOdds combat; // For the attack odds tooltip
 
 	/*
 	Prints an SDL error the to given ostream. The given error message is appended
@@ -39,15 +56,38 @@ private:
 
 	/*
 	Draws the given tile at the given x and y pixel coordinates. Highlights the tile with
-	the given highlight mode. Highlight modes are defined in Constants.h.
+	the given highlight mode. Highlight modes are defined in Constants.h. If an analysis
+	result is given, the background is tinted green the closer the best action ending on
+	the tile is to the best there is, and red the more likely its unit is to fall.
 	*/
-	void drawTile(Tile* tile, int x, int y, int highlight);
+	void drawTile(Tile* tile, int x, int y, int highlight, const AnalysisResult* analysis = nullptr);
 
 	/*
 	Draws a victory screen with the given winner.
 	*/
 	void drawVictory(Player);
 
+	/*
+	Draws the replay position, speed and a seek bar filled up to the current action.
+	*/
+	void drawReplay(Replay* replay);
+
+	/*
+	Draws how many games in the database reached the board's position, and how they ended.
+	*/
+	void drawAnalysis(Board* board, const PositionDatabase* database);
+
+	/*
+	Draws how deep the live analysis has searched, and each player's chance of winning.
+	*/
+	void drawSearch(const AnalysisResult* result);
+
+	/*
+	Writes text in a white box with a black border, with its top left corner at the given
+	x and y.
+	*/
+	void drawTooltip(const std::string& text, int x, int y);
+
 	SDL_Texture* createText(const std::string& text, SDL_Color color);
 	void writeText(const std::string& text, int x, int y);
 	void writeText(const std::string& text, int x, int y, SDL_Color color);
@@ -0,0 +1,138 @@
+#include "Replay.h"
+#include <algorithm>
+#include "Delta.h"
+
+Replay::Replay(Board& board, int snapshotInterval) :
+	m_board(board), m_interval(snapshotInterval > 0 ? snapshotInterval : 1) {}
+
+bool Replay::load(const char* path)
+{
+	std::vector<unsigned char> records;
+	return loadReplay(path, records) && load(records);
+}
+
+bool Replay::load(const std::vector<unsigned char>& records)
+{
+	m_records = records;
+	m_offsets.clear();
+	m_snapshots.clear();
+	m_position = 0;
+	m_playing = false;
+	m_pending = 0;
+
+	// Read every record once, checking it and keeping the snapshots along the way
+	BoardState state;
+	size_t offset = 0;
+	while (offset < m_records.size())
+	{
+		const unsigned char* record = &m_records[offset];
+		size_t size = m_records.size() - offset;
+		if (m_offsets.empty() && !isKeyframe(record, size))
+		{
+			break; // Nothing to apply the first delta to
+		}
+		size_t read = applyRecord(state, record, size);
+		if (!read)
+		{
+			break;
+		}
+		if (m_offsets.size() % m_interval == 0)
+		{
+			m_snapshots.push_back(state);
+		}
+		m_offsets.push_back(offset);
+		offset += read;
+	}
+
+	if (m_offsets.empty() || offset != m_records.size())
+	{
+		m_records.clear();
+		m_offsets.clear();
+		m_snapshots.clear();
+		return false;
+	}
+	m_board.loadState(m_snapshots[0]);
+	return true;
+}
+
+int Replay::length()
+{
+	return m_offsets.empty() ? 0 : (int)m_offsets.size() - 1;
+}
+
+int Replay::position()
+{
+	return m_position;
+}
+
+void Replay::stateAt(int position, BoardState& state)
+{
+	state = m_snapshots[position / m_interval];
+	for (int i = position / m_interval * m_interval + 1; i <= position; ++i)
+	{
+		size_t end = i + 1 < (int)m_offsets.size() ? m_offsets[i + 1] : m_records.size();
+		applyRecord(state, &m_records[m_offsets[i]], end - m_offsets[i]);
+	}
+}
+
+void Replay::seek(int position)
+{
+	if (m_offsets.empty())
+	{
+		return;
+	}
+	position = std::max(0, std::min(position, length()));
+	if (position == m_position + 1)
+	{
+		// Playing forward, so one record does it
+		size_t end = position + 1 < (int)m_offsets.size() ? m_offsets[position + 1] : m_records.size();
+		applyRecord(m_board, &m_records[m_offsets[position]], end - m_offsets[position]);
+	}
+	else if (position != m_position)
+	{
+		BoardState state;
+		stateAt(position, state);
+		m_board.loadState(state);
+	}
+	m_position = position;
+}
+
+bool Replay::playing()
+{
+	return m_playing;
+}
+
+void Replay::setPlaying(bool playing)
+{
+	m_playing = playing && m_position < length();
+	m_pending = 0;
+}
+
+double Replay::speed()
+{
+	return m_speed;
+}
+
+void Replay::setSpeed(double actionsPerSecond)
+{
+	m_speed = std::max(0.25, std::min(actionsPerSecond, 256.0));
+}
+
+void Replay::update(double seconds)
+{
+	if (!m_playing)
+	{
+		return;
+	}
+	m_pending += seconds * m_speed;
+	int steps = (int)m_pending;
+	m_pending -= steps;
+	if (steps > 0)
+	{
+		seek(m_position + steps);
+	}
+	if (m_position >= length())
+	{
+		m_playing = false;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include "Board.h"
+#include "BoardState.h"
+
+/*
+Plays back a recorded game (see Delta.h) on a board, and can jump to any point in it.
+Loading walks the records once, keeping where each one starts and a full snapshot every
+snapshotInterval actions. Seeking restores the nearest snapshot at or before the target
+and applies the few records after it, so it costs the same anywhere in a long game.
+
+Position 0 is the starting state, and position i is the state after the i-th action.
+*/
+class Replay
+{
+public:
+	Replay(Board& board, int snapshotInterval = 64);
+
+	/*
+	Loads a replay file, or records already in memory, and shows the start of the game
+	on the board. Returns false, leaving the replay empty, if the records are malformed.
+	*/
+	bool load(const char* path);
+	bool load(const std::vector<unsigned char>& records);
+
+	/*
+	Gets the number of actions in the replay. Positions go from 0 to length.
+	*/
+	int length();
+	int position();
+
+	/*
+	Works out the state at the given position without touching the board.
+	*/
+	void stateAt(int position, BoardState& state);
+
+	/*
+	Shows the given position on the board, clamped to the replay.
+	*/
+	void seek(int position);
+
+	/*
+	Playback. Speed is in actions per second. Update moves playback along by the given
+	number of seconds, and stops at the end.
+	*/
+	bool playing();
+	void setPlaying(bool playing);
+	double speed();
+	void setSpeed(double actionsPerSecond);
+	void update(double seconds);
+
+private:
+	Board& m_board;
+	int m_interval;
+	std::vector<unsigned char> m_records;
+	std::vector<size_t> m_offsets; // Where each record starts, by position
+	std::vector<BoardState> m_snapshots; // State at every m_interval-th position
+	int m_position = 0;
+	bool m_playing = false;
+	double m_speed = 4;
+	double m_pending = 0; // Fraction of an action played but not shown yet
+};
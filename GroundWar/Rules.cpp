@@ -0,0 +1,137 @@
+#include "Rules.h"
+#include "Constants.h"
+#include "Marines.h"
+#include "AntiTank.h"
+#include "Tank.h"
+
+static const char* UNIT_KEYS[UNIT_TYPES] = { "marines", "antitank", "tank" };
+
+Rules Rules::standard()
+{
+	Rules rules;
+	rules.startMoney = START_MONEY;
+	rules.movementPoints = MOVEMENT_POINTS;
+
+	// Take the costs and odds straight from the unit classes so they stay the single source
+	Unit* units[UNIT_TYPES] = { new Marines(RED), new AntiTank(RED), new Tank(RED) };
+	for (int i = 0; i < UNIT_TYPES; ++i)
+	{
+		rules.goldCost[i] = units[i]->goldCost();
+		rules.movementCost[i] = units[i]->movementCost();
+		for (int j = 0; j < UNIT_TYPES; ++j)
+		{
+			rules.odds[i][j] = units[i]->odds(units[j]);
+		}
+	}
+	for (int i = 0; i < UNIT_TYPES; ++i)
+	{
+		delete units[i];
+	}
+	return rules;
+}
+
+/*
+Finds the unit type for the given key, or -1 if there isn't one.
+*/
+static int unitForKey(const std::string& key)
+{
+	for (int i = 0; i < UNIT_TYPES; ++i)
+	{
+		if (key == UNIT_KEYS[i])
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+Finds the field with the given name. Exactly one of the two returned pointers is set,
+or neither if the name is unknown.
+*/
+static void findField(Rules& rules, const std::string& name, int*& intField, float*& floatField)
+{
+	intField = nullptr;
+	floatField = nullptr;
+	if (name == "startMoney")
+	{
+		intField = &rules.startMoney;
+		return;
+	}
+	if (name == "movementPoints")
+	{
+		intField = &rules.movementPoints;
+		return;
+	}
+
+	size_t dot = name.find('.');
+	if (dot == std::string::npos)
+	{
+		return;
+	}
+	std::string head = name.substr(0, dot);
+	std::string tail = name.substr(dot + 1);
+	if (head == "odds")
+	{
+		size_t dot2 = tail.find('.');
+		if (dot2 == std::string::npos)
+		{
+			return;
+		}
+		int attacker = unitForKey(tail.substr(0, dot2));
+		int defender = unitForKey(tail.substr(dot2 + 1));
+		if (attacker >= 0 && defender >= 0)
+		{
+			floatField = &rules.odds[attacker][defender];
+		}
+		return;
+	}
+
+	int unit = unitForKey(head);
+	if (unit < 0)
+	{
+		return;
+	}
+	if (tail == "gold")
+	{
+		intField = &rules.goldCost[unit];
+	}
+	else if (tail == "move")
+	{
+		intField = &rules.movementCost[unit];
+	}
+}
+
+bool Rules::set(const std::string& name, double value)
+{
+	int* intField;
+	float* floatField;
+	findField(*this, name, intField, floatField);
+	if (intField)
+	{
+		*intField = (int)(value + (value < 0 ? -0.5 : 0.5)); // Round to nearest
+		return true;
+	}
+	if (floatField)
+	{
+		*floatField = (float)value;
+		return true;
+	}
+	return false;
+}
+
+double Rules::get(const std::string& name) const
+{
+	int* intField;
+	float* floatField;
+	findField(const_cast<Rules&>(*this), name, intField, floatField);
+	if (intField)
+	{
+		return *intField;
+	}
+	if (floatField)
+	{
+		return *floatField;
+	}
+	return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include "Unit.h"
+
+static const int UNIT_TYPES = 3; // Number of values in Unit::UnitType
+
+/*
+The tunable numbers behind the game rules. A Board plays by one of these,
+so balance experiments can change them without recompiling.
+*/
+struct Rules
+{
+	int startMoney;
+	int movementPoints;
+	int goldCost[UNIT_TYPES]; // Indexed by Unit::UnitType
+	int movementCost[UNIT_TYPES]; // Indexed by Unit::UnitType
+	float odds[UNIT_TYPES][UNIT_TYPES]; // odds[attacker][defender], same meaning as Unit::odds
+
+	/*
+	Gets the standard rules: START_MONEY and MOVEMENT_POINTS from Constants.h, and
+	the costs and odds of the unit classes.
+	*/
+	static Rules standard();
+
+	/*
+	Sets a parameter by name. Names are "startMoney", "movementPoints",
+	"<unit>.gold", "<unit>.move" and "odds.<attacker>.<defender>", where <unit>
+	is marines, antitank or tank. Returns false if the name isn't recognized.
+	*/
+	bool set(const std::string& name, double value);
+
+	/*
+	Gets a parameter by name, using the same names as set. Returns 0 for unknown names.
+	*/
+	double get(const std::string& name) const;
+};
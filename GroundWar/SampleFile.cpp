@@ -0,0 +1,416 @@
+#include "SampleFile.h"
+#include <algorithm>
+#include <cstdio>
+#include "Delta.h"
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char SAMPLE_MAGIC[4] = { 'G', 'W', 'S', '1' };
+static const unsigned MAX_BLOCK = 1 << 26; // Anything bigger is taken to be corrupt
+
+static void writeShort(unsigned value, std::vector<unsigned char>& out)
+{
+	out.push_back((unsigned char)value);
+	out.push_back((unsigned char)(value >> 8));
+}
+
+static bool readShort(const unsigned char*& data, const unsigned char* end, unsigned& value)
+{
+	if (end - data < 2)
+	{
+		return false;
+	}
+	value = data[0] | data[1] << 8;
+	data += 2;
+	return true;
+}
+
+static void writeWord(unsigned value, unsigned char* out)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		out[i] = (unsigned char)(value >> (i * 8));
+	}
+}
+
+static unsigned readWord(const unsigned char* data)
+{
+	return data[0] | data[1] << 8 | data[2] << 16 | (unsigned)data[3] << 24;
+}
+
+/*
+32-bit FNV-1a, to catch blocks that were only partly written.
+*/
+static unsigned checksum(const unsigned char* data, size_t size)
+{
+	unsigned h = 2166136261u;
+	for (size_t i = 0; i < size; ++i)
+	{
+		h = (h ^ data[i]) * 16777619u;
+	}
+	return h;
+}
+
+/*
+Finds how much of a sample file is whole: the magic and every block up to the first
+one that's cut short or fails its checksum. Returns 0 for a missing file or one too
+short to have the magic, and -1 for one that isn't a sample file.
+*/
+static long long wholeLength(const std::string& path)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	char magic[sizeof(SAMPLE_MAGIC)];
+	if (!in.read(magic, sizeof(magic)))
+	{
+		return 0;
+	}
+	if (!std::equal(magic, magic + sizeof(magic), SAMPLE_MAGIC))
+	{
+		return -1;
+	}
+	long long length = sizeof(magic);
+	std::vector<unsigned char> payload;
+	unsigned char header[8];
+	while (in.read((char*)header, sizeof(header)))
+	{
+		unsigned size = readWord(header);
+		if (size > MAX_BLOCK)
+		{
+			break;
+		}
+		payload.resize(size);
+		if ((size > 0 && !in.read((char*)&payload[0], size)) ||
+			checksum(payload.empty() ? nullptr : &payload[0], size) != readWord(header + 4))
+		{
+			break;
+		}
+		length += sizeof(header) + size;
+	}
+	return length;
+}
+
+static bool truncateFile(const std::string& path, long long length)
+{
+#ifdef _WIN32
+	int file;
+	if (_sopen_s(&file, path.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0)
+	{
+		return false;
+	}
+	bool done = _chsize_s(file, length) == 0;
+	_close(file);
+	return done;
+#else
+	return truncate(path.c_str(), (off_t)length) == 0;
+#endif
+}
+
+/*
+Actions are their type, then the unit type for a spawn, then the tiles they use.
+*/
+static void writeAction(const Action& action, std::vector<unsigned char>& out)
+{
+	out.push_back((unsigned char)action.type);
+	switch (action.type)
+	{
+	case Action::MOVE:
+	case Action::ATTACK:
+		out.push_back((unsigned char)action.fromX);
+		out.push_back((unsigned char)action.fromY);
+		out.push_back((unsigned char)action.toX);
+		out.push_back((unsigned char)action.toY);
+		break;
+	case Action::SPAWN:
+		out.push_back((unsigned char)action.unitType);
+		out.push_back((unsigned char)action.toX);
+		out.push_back((unsigned char)action.toY);
+		break;
+	default:
+		break;
+	}
+}
+
+static bool readAction(const unsigned char*& data, const unsigned char* end, Action& action)
+{
+	if (data >= end)
+	{
+		return false;
+	}
+	switch (*data++)
+	{
+	case Action::MOVE:
+	case Action::ATTACK:
+		if (end - data < 4)
+		{
+			return false;
+		}
+		action = data[-1] == Action::MOVE ? Action::move(data[0], data[1], data[2], data[3]) :
+			Action::attack(data[0], data[1], data[2], data[3]);
+		data += 4;
+		return true;
+	case Action::SPAWN:
+		if (end - data < 3 || data[0] >= UNIT_TYPES)
+		{
+			return false;
+		}
+		action = Action::spawn((Unit::UnitType)data[0], data[1], data[2]);
+		data += 3;
+		return true;
+	case Action::END_TURN:
+		action = Action::endTurn();
+		return true;
+	default:
+		return false;
+	}
+}
+
+void encodeSamples(const std::vector<Sample>& game, std::vector<unsigned char>& out)
+{
+	writeShort((unsigned)game.size(), out);
+	for (size_t i = 0; i < game.size(); ++i)
+	{
+		const Sample& sample = game[i];
+		if (i == 0 || !encodeDelta(game[i - 1].state, sample.state, out))
+		{
+			DeltaEncoder::encodeKeyframe(sample.state, out);
+		}
+		out.push_back((unsigned char)(sample.result + 1));
+		writeShort((unsigned)sample.actions.size(), out);
+		for (size_t j = 0; j < sample.actions.size(); ++j)
+		{
+			writeAction(sample.actions[j], out);
+			float share = std::min(1.0f, std::max(0.0f, sample.policy[j]));
+			writeShort((unsigned)(share * 65535.0f + 0.5f), out);
+		}
+	}
+}
+
+bool decodeSamples(const unsigned char* data, size_t size, std::vector<Sample>& game)
+{
+	const unsigned char* end = data + size;
+	unsigned count;
+	if (!readShort(data, end, count))
+	{
+		return false;
+	}
+	game.resize(count);
+	BoardState state = {};
+	for (unsigned i = 0; i < count; ++i)
+	{
+		Sample& sample = game[i];
+		size_t read = applyRecord(state, data, end - data);
+		if (!read || (i == 0 && !isKeyframe(data, read)))
+		{
+			return false;
+		}
+		data += read;
+		sample.state = state;
+
+		unsigned actions;
+		if (data >= end || *data > 2)
+		{
+			return false;
+		}
+		sample.result = *data++ - 1;
+		if (!readShort(data, end, actions))
+		{
+			return false;
+		}
+		sample.actions.resize(actions);
+		sample.policy.resize(actions);
+		for (unsigned j = 0; j < actions; ++j)
+		{
+			unsigned share;
+			if (!readAction(data, end, sample.actions[j]) || !readShort(data, end, share))
+			{
+				return false;
+			}
+			sample.policy[j] = share / 65535.0f;
+		}
+	}
+	return data == end;
+}
+
+SampleWriter::SampleWriter(const std::string& path)
+{
+	long long size;
+	{
+		std::ifstream existing(path.c_str(), std::ios::binary | std::ios::ate);
+		size = existing ? (long long)existing.tellg() : 0;
+	}
+	long long whole = size > 0 ? wholeLength(path) : 0;
+	if (whole < 0)
+	{
+		return; // Something else is in the way, so leave it alone and stay not good
+	}
+	if (whole < size && !truncateFile(path, whole))
+	{
+		return; // A crash left part of a block, which has to go or new blocks would be read out of step
+	}
+	m_out.open(path.c_str(), std::ios::binary | std::ios::app);
+	if (whole == 0)
+	{
+		m_out.write(SAMPLE_MAGIC, sizeof(SAMPLE_MAGIC));
+		m_out.flush();
+	}
+}
+
+bool SampleWriter::good()
+{
+	return m_out.is_open() && m_out.good();
+}
+
+bool SampleWriter::write(const std::vector<Sample>& game)
+{
+	std::vector<unsigned char> block(8);
+	encodeSamples(game, block);
+	writeWord((unsigned)(block.size() - 8), &block[0]);
+	writeWord(checksum(&block[8], block.size() - 8), &block[4]);
+	m_out.write((const char*)&block[0], block.size());
+	m_out.flush();
+	if (!m_out.good())
+	{
+		return false;
+	}
+	m_samples += game.size();
+	m_bytes += block.size();
+	return true;
+}
+
+long long SampleWriter::samples()
+{
+	return m_samples;
+}
+
+long long SampleWriter::bytes()
+{
+	return m_bytes;
+}
+
+std::string SampleWriter::shardPath(const std::string& prefix, int shard)
+{
+	char suffix[16];
+	sprintf(suffix, "-%04d.gws", shard);
+	return prefix + suffix;
+}
+
+SampleReader::SampleReader(const std::vector<std::string>& paths, int bufferSize, unsigned seed) :
+	m_paths(paths), m_bufferSize(std::max(1, bufferSize)), m_rng(seed)
+{
+	open();
+}
+
+SampleReader::~SampleReader()
+{
+	close();
+}
+
+void SampleReader::open()
+{
+	for (size_t i = 0; i < m_paths.size(); ++i)
+	{
+		std::ifstream* in = new std::ifstream(m_paths[i].c_str(), std::ios::binary);
+		char magic[sizeof(SAMPLE_MAGIC)];
+		if (!in->read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), SAMPLE_MAGIC))
+		{
+			delete in; // Missing, empty or not a sample file
+			in = nullptr;
+		}
+		m_files.push_back(in);
+	}
+	m_nextFile = 0;
+}
+
+void SampleReader::close()
+{
+	for (size_t i = 0; i < m_files.size(); ++i)
+	{
+		delete m_files[i];
+	}
+	m_files.clear();
+}
+
+void SampleReader::rewind()
+{
+	close();
+	m_buffer.clear();
+	open();
+}
+
+long long SampleReader::skipped()
+{
+	return m_skipped;
+}
+
+bool SampleReader::next(Sample& sample)
+{
+	while (m_buffer.size() < m_bufferSize && readBlock())
+	{
+	}
+	if (m_buffer.empty())
+	{
+		return false;
+	}
+	size_t pick = std::uniform_int_distribution<size_t>(0, m_buffer.size() - 1)(m_rng);
+	std::swap(m_buffer[pick], m_buffer.back());
+	sample = m_buffer.back();
+	m_buffer.pop_back();
+	return true;
+}
+
+bool SampleReader::readBlock()
+{
+	std::vector<unsigned char> payload;
+	std::vector<Sample> game;
+	while (std::find_if(m_files.begin(), m_files.end(), [](std::ifstream* in) { return in != nullptr; }) != m_files.end())
+	{
+		// Take turns between the files, so games from every shard get mixed together
+		std::ifstream*& in = m_files[m_nextFile];
+		m_nextFile = (m_nextFile + 1) % m_files.size();
+		if (!in)
+		{
+			continue;
+		}
+
+		unsigned char header[8];
+		in->read((char*)header, sizeof(header));
+		if (in->gcount() != sizeof(header))
+		{
+			m_skipped += in->gcount() > 0 ? 1 : 0; // Cut short partway through the header
+			delete in;
+			in = nullptr;
+			continue;
+		}
+		unsigned size = readWord(header);
+		if (size > MAX_BLOCK)
+		{
+			++m_skipped; // No telling where the next block starts
+			delete in;
+			in = nullptr;
+			continue;
+		}
+		payload.resize(size);
+		if (size > 0 && !in->read((char*)&payload[0], size))
+		{
+			++m_skipped;
+			delete in;
+			in = nullptr;
+			continue;
+		}
+		if (checksum(payload.empty() ? nullptr : &payload[0], size) != readWord(header + 4) ||
+			!decodeSamples(payload.empty() ? nullptr : &payload[0], size, game))
+		{
+			++m_skipped; // The file may still have good blocks after this one
+			continue;
+		}
+		m_buffer.insert(m_buffer.end(), game.begin(), game.end());
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Action.h"
+#include "BoardState.h"
+
+/*
+One position from a self-play game, for training a PolicyNet.
+*/
+struct Sample
+{
+	BoardState state;
+	std::vector<Action> actions; // Legal actions in the position
+	std::vector<float> policy; // Share of the search's playouts that went to each action
+	int result; // 1 if the player to move went on to win, -1 if they lost, 0 if undecided
+};
+
+/*
+Appends self-play games to a sample file. A file is "GWS1" followed by one block per
+game, each block being its length, a checksum and then the game's samples. Positions
+are written as Delta.h records: a keyframe for the first one in the block and a delta
+from the one before for the rest, so a sample takes a few dozen bytes, mostly policy.
+
+Blocks are only ever added to the end, and a block cut short by a crash is caught by
+its length or checksum and skipped when reading. Opening the file to write again cuts
+any such block off first, so the blocks after it are read in step. Several generators write in parallel
+by each having its own file, a shard of the same data set (see shardPath).
+*/
+class SampleWriter
+{
+public:
+	/*
+	Opens the given file for appending, starting it if it doesn't exist yet, and cutting
+	off anything after the last whole block. Leaves a file that isn't a sample file alone,
+	and isn't good.
+	*/
+	SampleWriter(const std::string& path);
+
+	/*
+	False if the file couldn't be opened or a write failed.
+	*/
+	bool good();
+
+	/*
+	Appends the samples of one game as a block, and flushes it to the file.
+	*/
+	bool write(const std::vector<Sample>& game);
+
+	/*
+	Samples and bytes written through this writer.
+	*/
+	long long samples();
+	long long bytes();
+
+	/*
+	Gets the name of one shard of a data set: "<prefix>-0003.gws" for shard 3.
+	*/
+	static std::string shardPath(const std::string& prefix, int shard);
+
+private:
+	std::ofstream m_out;
+	long long m_samples = 0;
+	long long m_bytes = 0;
+};
+
+/*
+Streams samples back out of any number of sample files, in a shuffled order, without
+loading them all. Blocks are read from each file in turn into a shuffle buffer, and each
+sample handed out is a random one from the buffer, which is then topped up. Samples
+from the same game, which are much alike, end up spread over roughly a buffer's worth
+of the stream.
+*/
+class SampleReader
+{
+public:
+	/*
+	Reads the given files, keeping up to bufferSize samples in memory. The seed picks
+	the order.
+	*/
+	SampleReader(const std::vector<std::string>& paths, int bufferSize = 50000, unsigned seed = 1);
+	~SampleReader();
+
+	/*
+	Gets the next sample. Returns false once every file has been read and the buffer
+	is empty.
+	*/
+	bool next(Sample& sample);
+
+	/*
+	Starts again from the beginning of every file, for another pass over the data.
+	*/
+	void rewind();
+
+	/*
+	Blocks skipped because they were cut short or their checksum was wrong.
+	*/
+	long long skipped();
+
+private:
+	std::vector<std::string> m_paths;
+	std::vector<std::ifstream*> m_files; // nullptr once a file has been read to the end
+	size_t m_nextFile = 0;
+	size_t m_bufferSize;
+	std::vector<Sample> m_buffer;
+	std::mt19937 m_rng;
+	long long m_skipped = 0;
+
+	void open();
+	void close();
+
+	/*
+	Reads the next block from the next file that has one into the buffer. Returns false
+	if every file is done.
+	*/
+	bool readBlock();
+};
+
+/*
+Turns one game's samples into a block payload and back. decodeSamples returns false if
+the payload is malformed.
+*/
+void encodeSamples(const std::vector<Sample>& game, std::vector<unsigned char>& out);
+bool decodeSamples(const unsigned char* data, size_t size, std::vector<Sample>& game);
@@ -0,0 +1,581 @@
+#include "SearchAI.h"
+#include <algorithm>
+#include <cstring>
+
+static const int TABLE_SIZE = 1 << 18; // Entries, a power of two
+static const int MAX_PLY = 64;
+static const int CLOCK_MASK = 63; // The clock is checked every CLOCK_MASK + 1 nodes, well under a millisecond
+static const int PONDER_GUESSES = 12; // Most actions to guess ahead when pondering
+static const int PONDER_GUESS_DEPTH = 2;
+static const float SCORE_LIMIT = (float)Evaluation::WIN_SCORE; // No score is further from 0
+
+// Which depths each helper thread skips: helper i skips a depth when
+// (depth + SKIP_PHASE[i]) / SKIP_SIZE[i] is odd, so the helpers spread out over the depths
+static const int SKIP_PATTERNS = 8;
+static const int SKIP_SIZE[SKIP_PATTERNS] = { 1, 1, 2, 2, 2, 2, 3, 3 };
+static const int SKIP_PHASE[SKIP_PATTERNS] = { 0, 1, 0, 1, 2, 3, 0, 1 };
+
+// Where each field of an entry is packed in a slot's data
+static const int DEPTH_SHIFT = 32;
+static const int BOUND_SHIFT = 40;
+static const int AGE_SHIFT = 42;
+static const int MOVE_SHIFT = 50;
+
+SearchAI::SearchAI(int milliseconds, int maxDepth, const char* tablebase, const char* book, unsigned threads) :
+	m_time(milliseconds), m_maxDepth(std::min(maxDepth, MAX_PLY)),
+	m_threads(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+	m_table(new Slot[TABLE_SIZE]), m_halt(false)
+{
+	for (int i = 0; i < TABLE_SIZE; ++i)
+	{
+		m_table[i].check.store(0, std::memory_order_relaxed);
+		m_table[i].data.store(0, std::memory_order_relaxed);
+	}
+	if (tablebase)
+	{
+		m_tablebase.load(tablebase); // Plays without one if there's no file
+	}
+	if (book)
+	{
+		m_book.load(book);
+	}
+}
+
+SearchAI::~SearchAI()
+{
+	delete m_pool;
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i]->eval.detach();
+		delete m_workers[i]->board;
+		delete m_workers[i];
+	}
+	delete[] m_table;
+}
+
+const char* SearchAI::name()
+{
+	return "search";
+}
+
+void SearchAI::setMilliseconds(int milliseconds)
+{
+	m_time.setActionTime(milliseconds);
+}
+
+void SearchAI::setTurnTime(int milliseconds)
+{
+	m_time.setTurnTime(milliseconds);
+}
+
+void SearchAI::setGameTime(int milliseconds, int incrementMilliseconds)
+{
+	m_time.setGameTime(milliseconds, incrementMilliseconds);
+}
+
+TimeManager& SearchAI::timeManager()
+{
+	return m_time;
+}
+
+int SearchAI::depth()
+{
+	return m_depth;
+}
+
+long long SearchAI::nodes()
+{
+	long long nodes = 0;
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		nodes += m_workers[i]->nodes;
+	}
+	return nodes;
+}
+
+long long SearchAI::tableHits()
+{
+	long long hits = 0;
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		hits += m_workers[i]->hits;
+	}
+	return hits;
+}
+
+unsigned SearchAI::threads()
+{
+	return m_threads;
+}
+
+void SearchAI::prepare(Board& board)
+{
+	if (m_workers.empty())
+	{
+		for (unsigned i = 0; i < m_threads; ++i)
+		{
+			Worker* worker = new Worker();
+			worker->index = (int)i;
+			worker->board = new Board(board.rules(), 0);
+			worker->eval.attach(*worker->board);
+			worker->actions.resize(MAX_PLY + 1);
+			worker->children.resize(MAX_PLY + 1);
+			m_workers.push_back(worker);
+		}
+		if (m_threads > 1)
+		{
+			m_pool = new ThreadPool(m_threads - 1);
+		}
+		m_useTablebase = m_tablebase.ready() && m_tablebase.matches(board.rules());
+		m_useBook = m_book.ready() && m_book.matches(board.rules());
+	}
+	++m_age;
+	m_halt = false;
+	m_depth = 0;
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i]->aborted = false;
+		m_workers[i]->nodes = 0;
+		m_workers[i]->hits = 0;
+	}
+}
+
+Action SearchAI::chooseAction(Board& board)
+{
+	std::atomic<bool> never(false);
+	return chooseAction(board, never);
+}
+
+Action SearchAI::chooseAction(Board& board, const std::atomic<bool>& stop)
+{
+	BoardState root;
+	board.saveState(root);
+	m_time.startAction(root, board.rules()); // Before prepare, so the first call's setup is counted
+	prepare(board);
+	m_stop = &stop;
+	m_timed = true;
+	m_deadline = m_time.deadline();
+
+	Worker& main = *m_workers[0];
+	Action best = Action::endTurn();
+	float value;
+	bool found = m_useTablebase && m_tablebase.probe(root, value, &best);
+	if (!found && m_useBook && m_book.choose(root, best))
+	{
+		// Hashes can collide, so only trust the book with an action that's legal here
+		main.board->loadState(root);
+		main.board->legalActions(main.actions[0]);
+		found = std::find(main.actions[0].begin(), main.actions[0].end(), best) != main.actions[0].end();
+		if (!found)
+		{
+			best = Action::endTurn();
+		}
+	}
+	if (!found && !iterate(root, best))
+	{
+		// Not even one action deep in time, so take the best found so far, or anything legal
+		main.board->loadState(root);
+		main.board->legalActions(main.actions[0]);
+		if (std::find(main.actions[0].begin(), main.actions[0].end(), best) == main.actions[0].end())
+		{
+			best = main.actions[0].empty() ? Action::endTurn() : main.actions[0][0];
+		}
+	}
+	m_stop = nullptr;
+	m_time.finishAction();
+	return best;
+}
+
+void SearchAI::analyze(Board& board, const std::atomic<bool>& stop,
+	const std::function<void(int depth, const std::vector<ActionValue>& values)>& progress)
+{
+	prepare(board);
+	m_stop = &stop;
+	m_timed = false;
+
+	Worker& main = *m_workers[0];
+	BoardState root;
+	board.saveState(root);
+	Action best = Action::endTurn();
+	std::vector<ActionValue> values;
+	for (int depth = 1; depth <= m_maxDepth && root.winner < 0; ++depth)
+	{
+		values.clear();
+		if (!searchRoot(main, root, depth, best, &values))
+		{
+			break;
+		}
+		m_depth = depth;
+		progress(depth, values);
+	}
+	m_stop = nullptr;
+}
+
+void SearchAI::ponder(Board& board, const std::atomic<bool>& stop)
+{
+	prepare(board);
+	m_stop = &stop;
+	m_timed = false;
+
+	// Searching the other player's position as it is would put the positions this AI
+	// faces an action or more below the root, where the search is shallowest. Instead,
+	// guess how the other player finishes the turn, with a quick search for each of
+	// their actions, and search the position that leaves this AI in as deep as it can.
+	Worker& main = *m_workers[0];
+	BoardState root;
+	board.saveState(root);
+	Action best = Action::endTurn();
+	for (int i = 0; i < PONDER_GUESSES && root.winner < 0 && root.player == board.currentPlayer(); ++i)
+	{
+		// Deepen the way chooseAction does, since the order actions are tried in breaks ties
+		best = Action::endTurn();
+		int depth = 1;
+		while (depth <= PONDER_GUESS_DEPTH && searchRoot(main, root, depth, best))
+		{
+			++depth;
+		}
+		if (depth <= PONDER_GUESS_DEPTH)
+		{
+			break;
+		}
+		main.board->loadState(root);
+		if (best.type == Action::ATTACK)
+		{
+			// Go with whichever outcome is more likely
+			const Rules& rules = main.board->rules();
+			float odds = rules.odds[main.board->getTile(best.fromX, best.fromY)->unit()->type()]
+				[main.board->getTile(best.toX, best.toY)->unit()->type()];
+			main.board->doAction(best, odds >= 0.5f);
+		}
+		else
+		{
+			main.board->doAction(best);
+		}
+		main.board->saveState(root);
+	}
+
+	if (!main.aborted)
+	{
+		iterate(root, best);
+	}
+	m_stop = nullptr;
+}
+
+bool SearchAI::iterate(const BoardState& root, Action& best)
+{
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i]->aborted = false;
+		m_workers[i]->depth = 0;
+		m_workers[i]->best = best;
+	}
+	for (size_t i = 1; i < m_workers.size(); ++i)
+	{
+		SearchAI* self = this;
+		Worker* worker = m_workers[i];
+		const BoardState* position = &root;
+		m_pool->submit([self, worker, position]() { self->deepen(*worker, *position); });
+	}
+	deepen(*m_workers[0], root);
+	m_halt = true; // The main thread is out of time or depth, so the helpers are too
+	if (m_pool)
+	{
+		m_pool->wait();
+	}
+	m_halt = false;
+
+	// Play the deepest search finished, preferring the main thread's
+	Worker* deepest = m_workers[0];
+	for (size_t i = 1; i < m_workers.size(); ++i)
+	{
+		if (m_workers[i]->depth > deepest->depth)
+		{
+			deepest = m_workers[i];
+		}
+	}
+	m_depth = deepest->depth;
+	best = deepest->best;
+	return m_depth > 0;
+}
+
+void SearchAI::deepen(Worker& worker, const BoardState& root)
+{
+	const int pattern = (worker.index + SKIP_PATTERNS - 1) % SKIP_PATTERNS;
+	double last = 0, previous = 0; // How long the last two depths took
+	for (int depth = 1; depth <= m_maxDepth; ++depth)
+	{
+		if (worker.index > 0 && depth < m_maxDepth && (depth + SKIP_PHASE[pattern]) / SKIP_SIZE[pattern] % 2 != 0)
+		{
+			continue;
+		}
+		// The main thread decides when to stop, since the helpers stop with it
+		if (worker.index == 0 && m_timed && depth > 1 && !m_time.worthDeepening(last, previous))
+		{
+			return;
+		}
+		double start = m_timed ? m_time.elapsed() : 0;
+		if (!searchRoot(worker, root, depth, worker.best))
+		{
+			return;
+		}
+		worker.depth = depth;
+		previous = last;
+		last = m_timed ? m_time.elapsed() - start : 0;
+	}
+}
+
+bool SearchAI::searchRoot(Worker& worker, const BoardState& root, int depth, Action& best,
+	std::vector<ActionValue>* values)
+{
+	worker.board->loadState(root);
+	std::vector<Action> actions; // Not worker.actions[0], since searching the children reloads the board
+	worker.board->legalActions(actions);
+	if (actions.empty())
+	{
+		return false;
+	}
+
+	// The last search's best is most likely still best, and makes the rest cheaper to rule out
+	std::vector<Action>::iterator previous = std::find(actions.begin(), actions.end(), best);
+	if (previous != actions.end())
+	{
+		std::rotate(actions.begin(), previous, previous + 1);
+	}
+
+	const bool maximizing = root.player == RED;
+	float alpha = -SCORE_LIMIT - 1;
+	float beta = SCORE_LIMIT + 1;
+	float bestValue = 0;
+	Action bestAction = actions[0];
+	for (size_t i = 0; i < actions.size(); ++i)
+	{
+		float value = searchAction(worker, root, actions[i], depth, 0, alpha, beta);
+		if (worker.aborted)
+		{
+			// Anything that beat the last depth's best in full is better than it
+			best = bestAction;
+			return false;
+		}
+		if (values)
+		{
+			ActionValue actionValue = { actions[i], value };
+			values->push_back(actionValue);
+		}
+		if (i == 0 || (maximizing ? value > bestValue : value < bestValue))
+		{
+			bestValue = value;
+			bestAction = actions[i];
+			if (values)
+			{
+				continue; // Keep the window open, so every action gets its exact value
+			}
+			if (maximizing)
+			{
+				alpha = value;
+			}
+			else
+			{
+				beta = value;
+			}
+		}
+	}
+	best = bestAction;
+	return true;
+}
+
+float SearchAI::search(Worker& worker, const BoardState& state, int depth, int ply, float alpha, float beta)
+{
+	++worker.nodes;
+	if ((worker.nodes & CLOCK_MASK) == 0 && outOfTime(worker))
+	{
+		worker.aborted = true;
+	}
+	if (worker.aborted)
+	{
+		return 0;
+	}
+	if (state.winner >= 0)
+	{
+		// Sooner wins are better, and later losses less bad
+		float score = (float)(Evaluation::WIN_SCORE - ply);
+		return state.winner == RED ? score : -score;
+	}
+	float value;
+	if (m_useTablebase && m_tablebase.probe(state, value))
+	{
+		// An exact chance of winning is worth the same as that share of a win
+		value *= Evaluation::WIN_SCORE - ply;
+		return state.player == RED ? value : -value;
+	}
+
+	unsigned long long key = state.hash();
+	Entry entry;
+	int first = 0;
+	if (probe(key, entry))
+	{
+		if (entry.depth >= depth && (entry.bound == EXACT || (entry.bound == LOWER && entry.value >= beta) ||
+			(entry.bound == UPPER && entry.value <= alpha)))
+		{
+			++worker.hits;
+			return entry.value;
+		}
+		first = entry.move;
+	}
+
+	Board& board = *worker.board;
+	board.loadState(state);
+	if (depth == 0 || ply >= MAX_PLY)
+	{
+		return std::max(-SCORE_LIMIT, std::min(SCORE_LIMIT, worker.eval.score(RED)));
+	}
+
+	std::vector<Action>& actions = worker.actions[ply];
+	board.legalActions(actions);
+	if (first < 0 || first >= (int)actions.size())
+	{
+		first = 0;
+	}
+	const bool maximizing = state.player == RED;
+	float low = alpha, high = beta;
+	float best = 0;
+	int bestIndex = -1;
+	for (int k = 0; k < (int)actions.size(); ++k)
+	{
+		// The table's best action first, then the rest in order
+		int i = k == 0 ? first : k <= first ? k - 1 : k;
+		float value = searchAction(worker, state, actions[i], depth, ply, low, high);
+		if (worker.aborted)
+		{
+			return 0;
+		}
+		if (bestIndex < 0 || (maximizing ? value > best : value < best))
+		{
+			best = value;
+			bestIndex = i;
+			if (maximizing)
+			{
+				low = std::max(low, best);
+			}
+			else
+			{
+				high = std::min(high, best);
+			}
+		}
+		if (low >= high)
+		{
+			break;
+		}
+	}
+
+	store(key, best, depth, best <= alpha ? UPPER : best >= beta ? LOWER : EXACT, bestIndex);
+	return best;
+}
+
+float SearchAI::searchAction(Worker& worker, const BoardState& state, const Action& action, int depth, int ply,
+	float alpha, float beta)
+{
+	BoardState& child = worker.children[ply];
+	Board& board = *worker.board;
+	board.loadState(state);
+	if (action.type != Action::ATTACK)
+	{
+		board.doAction(action);
+		board.saveState(child);
+		return search(worker, child, depth - 1, ply + 1, alpha, beta);
+	}
+
+	// A chance node: weigh both outcomes by the odds
+	const Rules& rules = board.rules();
+	float odds = rules.odds[board.getTile(action.fromX, action.fromY)->unit()->type()]
+		[board.getTile(action.toX, action.toY)->unit()->type()];
+	if (odds <= 0 || odds >= 1)
+	{
+		board.doAction(action, odds >= 1);
+		board.saveState(child);
+		return search(worker, child, depth - 1, ply + 1, alpha, beta);
+	}
+
+	// Winning only needs to be searched as far as it could take the total across the
+	// window, whatever losing turns out to be worth
+	board.doAction(action, true);
+	board.saveState(child);
+	float winAlpha = std::max(-SCORE_LIMIT, (alpha - (1 - odds) * SCORE_LIMIT) / odds);
+	float winBeta = std::min(SCORE_LIMIT, (beta + (1 - odds) * SCORE_LIMIT) / odds);
+	float win = search(worker, child, depth - 1, ply + 1, winAlpha, winBeta);
+	if (worker.aborted)
+	{
+		return 0;
+	}
+	float upper = odds * win + (1 - odds) * SCORE_LIMIT;
+	if (upper <= alpha)
+	{
+		return upper;
+	}
+	float lower = odds * win - (1 - odds) * SCORE_LIMIT;
+	if (lower >= beta)
+	{
+		return lower;
+	}
+
+	board.loadState(state);
+	board.doAction(action, false);
+	board.saveState(child);
+	float loseAlpha = std::max(-SCORE_LIMIT, (alpha - odds * win) / (1 - odds));
+	float loseBeta = std::min(SCORE_LIMIT, (beta - odds * win) / (1 - odds));
+	float lose = search(worker, child, depth - 1, ply + 1, loseAlpha, loseBeta);
+	return odds * win + (1 - odds) * lose;
+}
+
+bool SearchAI::probe(unsigned long long key, Entry& entry)
+{
+	const Slot& slot = m_table[key & (TABLE_SIZE - 1)];
+	unsigned long long data = slot.data.load(std::memory_order_relaxed);
+	unsigned long long check = slot.check.load(std::memory_order_relaxed);
+	if (data == 0 || (check ^ data) != key)
+	{
+		return false;
+	}
+	unsigned bits = (unsigned)data;
+	memcpy(&entry.value, &bits, sizeof(bits));
+	entry.depth = (int)(data >> DEPTH_SHIFT & 0xff) - 1;
+	entry.bound = (Bound)(data >> BOUND_SHIFT & 0x3);
+	entry.age = (int)(data >> AGE_SHIFT & 0xff);
+	entry.move = (int)(data >> MOVE_SHIFT & 0xff) - 1;
+	return true;
+}
+
+void SearchAI::store(unsigned long long key, float value, int depth, Bound bound, int move)
+{
+	Slot& slot = m_table[key & (TABLE_SIZE - 1)];
+
+	// Deeper results are worth more, so they only replace shallower ones, unless what's
+	// there is left over from an older search
+	unsigned long long old = slot.data.load(std::memory_order_relaxed);
+	int oldDepth = (int)(old >> DEPTH_SHIFT & 0xff) - 1;
+	int oldAge = (int)(old >> AGE_SHIFT & 0xff);
+	if (old != 0 && oldDepth > depth && oldAge == m_age)
+	{
+		return;
+	}
+
+	unsigned bits;
+	memcpy(&bits, &value, sizeof(bits));
+	unsigned long long data = bits |
+		(unsigned long long)(depth + 1) << DEPTH_SHIFT |
+		(unsigned long long)bound << BOUND_SHIFT |
+		(unsigned long long)m_age << AGE_SHIFT |
+		(unsigned long long)(move >= 0 && move < 0xff ? move + 1 : 0) << MOVE_SHIFT;
+	slot.data.store(data, std::memory_order_relaxed);
+	slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+bool SearchAI::outOfTime(Worker& worker)
+{
+	if (m_halt.load(std::memory_order_relaxed))
+	{
+		return true;
+	}
+	// Only the main thread watches the clock, and halts the helpers when it stops
+	return worker.index == 0 && ((m_stop && m_stop->load(std::memory_order_relaxed)) ||
+		(m_timed && std::chrono::steady_clock::now() >= m_deadline));
+}
@@ -0,0 +1,207 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "AI.h"
+#include "Evaluation.h"
+#include "BoardState.h"
+#include "Tablebase.h"
+#include "OpeningBook.h"
+#include "ThreadPool.h"
+#include "TimeManager.h"
+
+/*
+Looks ahead a few actions with expectimax and alpha-beta pruning: the player to move picks
+their best action, and an attack is worth both of its outcomes weighted by the combat
+odds. Since every score lies within plus or minus a win, an attack's second outcome is
+only searched if it can still move the total across the window, and the first is
+searched with a window widened to match (Ballard's Star1). Positions where the search
+stops are scored by Evaluation. The search deepens one action at a time until its time
+runs out.
+
+A transposition table keyed by BoardState::hash keeps the value or bound of every position
+searched, and which action was best there to try first next time, so a position is only
+searched once however it's reached, whether that's earlier in the same search, in the
+search for the previous action, or while pondering during the other player's turn.
+
+With more than one thread, the search is a Lazy SMP: every thread searches the same root
+with its own board and shares nothing but the table, which takes entries without locks.
+Helper threads skip some depths, each on its own schedule, so they run ahead of the main
+thread and fill in the table for it; the deepest search any thread finishes is played.
+
+How long each action is searched for is up to a TimeManager. The search only starts
+another depth if it's likely to finish in time, and gives up on the one in progress at
+the hard limit, or as soon as the caller's stop flag is set. Either way it plays the best
+action it knows of: the last finished depth's, or one the unfinished depth has already
+found to be better.
+
+Endgames that are in a Tablebase aren't searched at all: the table gives their value
+anywhere in the search, and at the root it picks the action outright. Openings in an
+OpeningBook aren't searched either; the book's best scoring action is played.
+*/
+class SearchAI :
+	public AI
+{
+public:
+	/*
+	Searches for up to the given number of milliseconds per action, and at most maxDepth
+	actions deep, on the given number of threads (0 means one per hardware thread). Uses
+	the endgame table and opening book in the given files if they can be loaded and were
+	made for the rules being played.
+	*/
+	SearchAI(int milliseconds = 100, int maxDepth = 8, const char* tablebase = "groundwar.gwt",
+		const char* book = "groundwar.gwb", unsigned threads = 1);
+	~SearchAI();
+
+	Action chooseAction(Board& board);
+
+	/*
+	Chooses an action the same way, but stops early with the best action so far if stop
+	is set.
+	*/
+	Action chooseAction(Board& board, const std::atomic<bool>& stop);
+	const char* name();
+
+	/*
+	Guesses how the other player will finish their turn, then searches the position that
+	would leave this AI in deeper and deeper until stop is set. If the guess comes true,
+	the search for this AI's first action starts out with the table already full.
+	*/
+	void ponder(Board& board, const std::atomic<bool>& stop);
+
+	/*
+	An action at the root and its value, from red's point of view.
+	*/
+	struct ActionValue
+	{
+		Action action;
+		float value;
+	};
+
+	/*
+	Searches the position deeper and deeper on one thread until stop is set or maxDepth
+	is reached, calling progress with the exact value of every legal action after each
+	depth. Slower than chooseAction, which only needs to know which action is best, but
+	it's what an analysis display wants.
+	*/
+	void analyze(Board& board, const std::atomic<bool>& stop,
+		const std::function<void(int depth, const std::vector<ActionValue>& values)>& progress);
+
+	/*
+	Changes how long each action is searched for, or gives the time per turn or for the
+	rest of the game instead, to be shared out by the TimeManager.
+	*/
+	void setMilliseconds(int milliseconds);
+	void setTurnTime(int milliseconds);
+	void setGameTime(int milliseconds, int incrementMilliseconds = 0);
+	TimeManager& timeManager();
+
+	/*
+	Stats for the last call to chooseAction or ponder: the deepest search that finished,
+	and the positions visited by all threads and how many of those were found in the
+	table.
+	*/
+	int depth();
+	long long nodes();
+	long long tableHits();
+	unsigned threads();
+
+private:
+	/*
+	A table entry. The key is stored XORed with the data, so an entry torn by two threads
+	writing it at once doesn't match any key, and reads as a miss.
+	*/
+	struct Slot
+	{
+		std::atomic<unsigned long long> check; // Key ^ data
+		std::atomic<unsigned long long> data; // Packed Entry
+	};
+
+	enum Bound { EXACT, LOWER, UPPER };
+
+	struct Entry
+	{
+		float value; // From red's point of view
+		int depth; // Actions searched below this position
+		Bound bound;
+		int age; // Which search stored it, mod 256
+		int move; // Index of the best action among the legal ones, -1 for none
+	};
+
+	/*
+	What each thread searches with. Only the table is shared.
+	*/
+	struct Worker
+	{
+		int index; // 0 for the main thread
+		Board* board; // Scratch board the search plays on
+		Evaluation eval;
+		std::vector<std::vector<Action>> actions; // Legal actions, by ply
+		std::vector<BoardState> children; // Scratch states, by ply
+		bool aborted;
+		int depth; // Deepest search finished
+		Action best; // Best action found by that search
+		long long nodes;
+		long long hits;
+	};
+
+	TimeManager m_time;
+	int m_maxDepth;
+	unsigned m_threads;
+	std::vector<Worker*> m_workers; // Made on first use
+	ThreadPool* m_pool = nullptr; // Runs the helpers, if there's more than one thread
+	Tablebase m_tablebase;
+	bool m_useTablebase = false; // Whether the table is for the rules being played
+	OpeningBook m_book;
+	bool m_useBook = false;
+	Slot* m_table;
+	unsigned char m_age = 0; // Bumped every search, so entries from old searches can be replaced
+
+	// Limits and stats for the search in progress
+	const std::atomic<bool>* m_stop = nullptr;
+	bool m_timed = false;
+	std::chrono::steady_clock::time_point m_deadline;
+	std::atomic<bool> m_halt; // Set when the main thread is done, to stop the helpers
+	int m_depth = 0;
+
+	void prepare(Board& board);
+
+	/*
+	Deepens the search of the root on every thread until the time runs out or maxDepth
+	is reached, and sets best to the action from the deepest search finished. Returns
+	false if no search finished, leaving best alone.
+	*/
+	bool iterate(const BoardState& root, Action& best);
+
+	/*
+	One thread's part in iterate.
+	*/
+	void deepen(Worker& worker, const BoardState& root);
+
+	/*
+	Searches every action at the root to the given depth, starting with best. Returns
+	false if the search ran out of time before finishing. best is then only changed if an
+	action searched in full has beaten the one it started with. If values is given, every
+	action is searched with the full window and its value added to it.
+	*/
+	bool searchRoot(Worker& worker, const BoardState& root, int depth, Action& best,
+		std::vector<ActionValue>* values = nullptr);
+
+	/*
+	Gets the value of the given position, searched the given number of actions deep.
+	Values at or below alpha only bound the value from above, and values at or above beta
+	only bound it from below.
+	*/
+	float search(Worker& worker, const BoardState& state, int depth, int ply, float alpha, float beta);
+
+	/*
+	Gets the value of taking the given action in the given position, bounded the same way.
+	*/
+	float searchAction(Worker& worker, const BoardState& state, const Action& action, int depth, int ply,
+		float alpha, float beta);
+
+	bool probe(unsigned long long key, Entry& entry);
+	void store(unsigned long long key, float value, int depth, Bound bound, int move);
+	bool outOfTime(Worker& worker);
+};
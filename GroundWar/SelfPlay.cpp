@@ -0,0 +1,87 @@
+#include "SelfPlay.h"
+#include <numeric>
+#include <random>
+#include "Delta.h"
+
+GameResult playGame(const Rules& rules, AI& red, AI& blue, unsigned seed, int maxTurns,
+	std::vector<unsigned char>* replay)
+{
+	Board board(rules, seed);
+	DeltaEncoder encoder;
+	if (replay)
+	{
+		encoder.encode(board, *replay);
+	}
+	std::vector<Action> legal;
+	GameResult result;
+	result.actions = 0;
+
+	while (!board.gameOver() && board.turn() < maxTurns)
+	{
+		AI& ai = board.currentPlayer() == RED ? red : blue;
+		if (!board.doAction(ai.chooseAction(board)))
+		{
+			// A misbehaving AI shouldn't hang the game; fall back to any legal action
+			board.legalActions(legal);
+			if (legal.empty() || !board.doAction(legal[0]))
+			{
+				break;
+			}
+		}
+		++result.actions;
+		if (replay)
+		{
+			encoder.encode(board, *replay);
+		}
+	}
+
+	result.decided = board.gameOver();
+	result.winner = result.decided ? board.winner() : RED;
+	result.turns = board.turn();
+	return result;
+}
+
+GameResult playTrainingGame(NetAI& ai, unsigned seed, int maxTurns, int sampledActions,
+	std::vector<Sample>& samples)
+{
+	Board board(Rules::standard(), seed);
+	std::mt19937 rng(seed);
+	size_t first = samples.size();
+	GameResult result;
+	result.actions = 0;
+
+	while (!board.gameOver() && board.turn() < maxTurns)
+	{
+		Action action = ai.chooseAction(board);
+		const std::vector<Action>& actions = ai.searchActions();
+		const std::vector<float>& policy = ai.searchPolicy();
+		if (actions.size() > 1)
+		{
+			samples.push_back(Sample());
+			Sample& sample = samples.back();
+			board.saveState(sample.state);
+			sample.actions = actions;
+			sample.policy = policy;
+			sample.result = 0;
+			if (result.actions < sampledActions && std::accumulate(policy.begin(), policy.end(), 0.0f) > 0)
+			{
+				std::discrete_distribution<int> pick(policy.begin(), policy.end());
+				action = actions[pick(rng)];
+			}
+		}
+		if (!board.doAction(action))
+		{
+			break;
+		}
+		++result.actions;
+	}
+
+	result.decided = board.gameOver();
+	result.winner = result.decided ? board.winner() : RED;
+	result.turns = board.turn();
+	for (size_t i = first; i < samples.size() && result.decided; ++i)
+	{
+		samples[i].result = samples[i].state.player == result.winner ? 1 : -1;
+	}
+	return result;
+}
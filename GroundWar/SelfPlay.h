@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include "Board.h"
+#include "AI.h"
+#include "Rules.h"
+#include "NetAI.h"
+#include "SampleFile.h"
+
+/*
+The outcome of one headless game.
+*/
+struct GameResult
+{
+	bool decided; // False if the game hit the turn limit without a winner
+	Player winner; // Only meaningful if decided
+	int turns;
+	int actions;
+};
+
+/*
+Plays one game between the two AIs on a fresh board with the given rules and combat
+seed, stopping after maxTurns turns if no one has won by then. If replay is given,
+the game's records (see Delta.h) are appended to it.
+*/
+GameResult playGame(const Rules& rules, AI& red, AI& blue, unsigned seed, int maxTurns,
+	std::vector<unsigned char>* replay = nullptr);
+
+/*
+Plays one game of the AI against itself on a fresh standard board, adding a Sample for
+every position where there was a choice to make. For the first sampledActions actions,
+the action is drawn at random in proportion to the search's policy instead of being the
+most searched one, so games from the same start go different ways. Every sample's
+result is filled in once the game is over.
+*/
+GameResult playTrainingGame(NetAI& ai, unsigned seed, int maxTurns, int sampledActions,
+	std::vector<Sample>& samples);
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+
+/*
+A fixed-size lock-free queue for exactly one producer thread and one consumer thread.
+Neither side ever blocks: push fails if the queue is full, and pop fails if it's empty.
+The head and tail live on separate cache lines so the two threads don't fight over them.
+*/
+template <typename T, unsigned Capacity>
+class SpscQueue
+{
+public:
+	SpscQueue() :
+		m_head(0), m_tail(0) {}
+
+	/*
+	Adds an item. Only call from the producer thread. Returns false if the queue is full.
+	*/
+	bool push(const T& item)
+	{
+		unsigned tail = m_tail.load(std::memory_order_relaxed);
+		unsigned next = (tail + 1) % Capacity;
+		if (next == m_head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		m_items[tail] = item;
+		m_tail.store(next, std::memory_order_release); // Publishes the item
+		return true;
+	}
+
+	/*
+	Takes the oldest item. Only call from the consumer thread. Returns false if the queue
+	is empty.
+	*/
+	bool pop(T& item)
+	{
+		unsigned head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		item = m_items[head];
+		m_head.store((head + 1) % Capacity, std::memory_order_release); // Frees the slot
+		return true;
+	}
+
+private:
+	T m_items[Capacity]; // One slot is always left empty to tell full from empty
+	std::atomic<unsigned> m_head; // Next slot to pop, written by the consumer
+	char m_padding[64];
+	std::atomic<unsigned> m_tail; // Next slot to push, written by the producer
+};
@@ -0,0 +1,519 @@
+#include "Tablebase.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include "Board.h"
+#include "ThreadPool.h"
+
+static const char TABLE_MAGIC[4] = { 'G', 'W', 'T', '1' };
+static const int TABLE_TILES = 97; // Tiles a unit can stand on in the standard map
+static const int MAX_TURNS = 2000; // Give up on values settling after this many turns
+static const float SETTLED = 1e-6f; // Largest change in a turn that counts as settled
+static const int CHUNK = 4096; // Positions per job while solving
+
+/*
+The start of a table file. The entries follow straight after, as Tablebase::Entry.
+*/
+struct TableHeader
+{
+	char magic[4];
+	int tiles;
+	int entries;
+	int movementPoints;
+	int goldCost[UNIT_TYPES];
+	int movementCost[UNIT_TYPES];
+	float odds[UNIT_TYPES][UNIT_TYPES];
+	char padding[52]; // Keeps the entries 128 bytes in
+};
+
+static unsigned short quantize(float value)
+{
+	return (unsigned short)((value + 1) * 0.5f * Tablebase::VALUE_SCALE + 0.5f);
+}
+
+static float unquantize(unsigned short value)
+{
+	return value * 2.0f / Tablebase::VALUE_SCALE - 1;
+}
+
+static bool sameRules(const Rules& a, const Rules& b)
+{
+	return a.movementPoints == b.movementPoints &&
+		std::equal(a.goldCost, a.goldCost + UNIT_TYPES, b.goldCost) &&
+		std::equal(a.movementCost, a.movementCost + UNIT_TYPES, b.movementCost) &&
+		std::equal(&a.odds[0][0], &a.odds[0][0] + UNIT_TYPES * UNIT_TYPES, &b.odds[0][0]);
+}
+
+Tablebase::Tablebase() :
+	m_tileIndex(BOARD_TILES, -1), m_rules(Rules::standard())
+{
+	Board board;
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = board.getTile(x, y);
+			if (!tile || tile->type() == Tile::MOUNTAIN)
+			{
+				continue;
+			}
+			int index = (int)m_tiles.size();
+			m_tileIndex[x * BOARD_HEIGHT + y] = index;
+			m_tiles.push_back(x * BOARD_HEIGHT + y);
+			for (int p = 0; p < 2; ++p)
+			{
+				m_base[p].push_back(tile->type() == Tile::BASE && tile->spawnableFor(Player(p)));
+				if (tile->lyingFlag() && tile->lyingFlag()->owner() == p)
+				{
+					m_flagHome[p] = index;
+				}
+			}
+		}
+	}
+
+	m_neighbors.assign(m_tiles.size() * 6, -1);
+	for (size_t i = 0; i < m_tiles.size(); ++i)
+	{
+		for (int direction = 0; direction < 6; ++direction)
+		{
+			int x, y;
+			if (Board::adjacentPosition(m_tiles[i] / BOARD_HEIGHT, m_tiles[i] % BOARD_HEIGHT, direction, x, y))
+			{
+				m_neighbors[i * 6 + direction] = m_tileIndex[x * BOARD_HEIGHT + y];
+			}
+		}
+	}
+}
+
+Tablebase::~Tablebase()
+{
+	unmap();
+}
+
+int Tablebase::positions()
+{
+	return 2 * UNIT_TYPES * TABLE_TILES * UNIT_TYPES * TABLE_TILES * 4;
+}
+
+int Tablebase::index(const Position& position) const
+{
+	int index = position.player;
+	index = index * UNIT_TYPES + position.type[RED];
+	index = index * TABLE_TILES + position.tile[RED];
+	index = index * UNIT_TYPES + position.type[BLUE];
+	index = index * TABLE_TILES + position.tile[BLUE];
+	return index * 4 + (position.carrying[RED] ? 1 : 0) + (position.carrying[BLUE] ? 2 : 0);
+}
+
+bool Tablebase::possible(const Position& position) const
+{
+	if (position.tile[RED] == position.tile[BLUE])
+	{
+		return false;
+	}
+	for (int p = 0; p < 2; ++p)
+	{
+		if (position.carrying[p] && (position.type[p] != Unit::MARINES || m_base[p][position.tile[p]]))
+		{
+			return false; // Only marines carry flags, and bringing one home ends the game
+		}
+		if (!position.carrying[p] && position.type[p] == Unit::MARINES && position.tile[p] == m_flagHome[1 - p])
+		{
+			return false; // Would have picked it up
+		}
+	}
+	return true;
+}
+
+bool Tablebase::decode(const BoardState& state, Position& position) const
+{
+	if (state.winner >= 0 || state.money[RED] != 0 || state.money[BLUE] != 0)
+	{
+		return false;
+	}
+	position.player = state.player;
+	int units[2] = { 0, 0 };
+	bool lying[2] = { false, false };
+	for (int i = 0; i < BOARD_TILES; ++i)
+	{
+		unsigned char bits = state.tiles[i];
+		if (!bits)
+		{
+			continue;
+		}
+		int tile = m_tileIndex[i];
+		if (bits & BoardState::LYING_FLAG)
+		{
+			int owner = bits & BoardState::LYING_BLUE ? BLUE : RED;
+			if (tile != m_flagHome[owner])
+			{
+				return false; // Only flags that have never moved
+			}
+			lying[owner] = true;
+		}
+		if (bits & BoardState::UNIT_MASK)
+		{
+			int owner = bits & BoardState::UNIT_BLUE ? BLUE : RED;
+			if (tile < 0 || ++units[owner] > 1)
+			{
+				return false;
+			}
+			position.type[owner] = (bits & BoardState::UNIT_MASK) - 1;
+			position.tile[owner] = tile;
+			position.carrying[owner] = (bits & BoardState::CARRIED_FLAG) != 0;
+		}
+	}
+	for (int p = 0; p < 2; ++p)
+	{
+		if (units[p] != 1 || lying[1 - p] == position.carrying[p])
+		{
+			return false; // Each flag is either at home or carried
+		}
+	}
+	return possible(position);
+}
+
+void Tablebase::expand(const Position& position, int movementPoints, bool fresh, const Rules& rules,
+	std::vector<Option>& options) const
+{
+	struct Step
+	{
+		int tile;
+		bool carrying;
+		Action first;
+	};
+
+	options.clear();
+	const int player = position.player;
+	const int enemy = 1 - player;
+	const int type = position.type[player];
+	const int cost = rules.movementCost[type];
+	const int steps = cost > 0 ? movementPoints / cost : 0;
+	const int tileCount = (int)m_tiles.size();
+	const int enemyTile = position.tile[enemy];
+	const float attackValue = 2 * rules.odds[type][position.type[enemy]] - 1;
+
+	// Walk the turn a step at a time, keeping one entry per tile and flag each step
+	std::vector<Step> layer(1), next;
+	layer[0].tile = position.tile[player];
+	layer[0].carrying = position.carrying[player];
+	std::vector<int> seen(tileCount * 2, -1); // Step a tile and flag was last added at
+	std::vector<bool> ended(tileCount * 2, false); // Already an option to end the turn there
+	bool acted = false;
+	for (int step = 0; step <= steps; ++step)
+	{
+		for (size_t i = 0; i < layer.size(); ++i)
+		{
+			const Step& at = layer[i];
+			int key = at.tile * 2 + (at.carrying ? 1 : 0);
+			if ((step > 0 || !fresh) && !ended[key])
+			{
+				ended[key] = true;
+				Position after = position;
+				after.player = enemy;
+				after.tile[player] = at.tile;
+				after.carrying[player] = at.carrying;
+				Option option = { 0, index(after), step > 0 ? at.first : Action::endTurn() };
+				options.push_back(option);
+			}
+			if (step == steps)
+			{
+				continue;
+			}
+
+			int x = m_tiles[at.tile] / BOARD_HEIGHT, y = m_tiles[at.tile] % BOARD_HEIGHT;
+			for (int direction = 0; direction < 6; ++direction)
+			{
+				int to = m_neighbors[at.tile * 6 + direction];
+				if (to < 0)
+				{
+					continue;
+				}
+				int toX = m_tiles[to] / BOARD_HEIGHT, toY = m_tiles[to] % BOARD_HEIGHT;
+				Action action = to == enemyTile ? Action::attack(x, y, toX, toY) : Action::move(x, y, toX, toY);
+				Action first = step == 0 ? action : at.first;
+				acted = true;
+				if (to == enemyTile)
+				{
+					Option option = { attackValue, -1, first };
+					options.push_back(option);
+					continue;
+				}
+				bool carrying = at.carrying || (type == Unit::MARINES && to == m_flagHome[enemy]);
+				if (carrying && m_base[player][to])
+				{
+					Option option = { 1, -1, first };
+					options.push_back(option);
+					continue;
+				}
+				int toKey = to * 2 + (carrying ? 1 : 0);
+				if (seen[toKey] != step + 1)
+				{
+					seen[toKey] = step + 1;
+					Step reached = { to, carrying, first };
+					next.push_back(reached);
+				}
+			}
+		}
+		layer.swap(next);
+		next.clear();
+	}
+
+	if (fresh && !acted)
+	{
+		// Nothing to do but end the turn where it started
+		Position after = position;
+		after.player = enemy;
+		Option option = { 0, index(after), Action::endTurn() };
+		options.push_back(option);
+	}
+}
+
+bool Tablebase::bestOption(const std::vector<Option>& options, float& value, Action& first) const
+{
+	// Best value first; between equal values, win in the fewest turns or lose in the most
+	bool found = false;
+	float bestValue = 0;
+	int bestTurns = 0;
+	for (size_t i = 0; i < options.size(); ++i)
+	{
+		const Option& option = options[i];
+		float optionValue = option.value;
+		int turns = 0;
+		if (option.successor >= 0)
+		{
+			const Entry& entry = m_entries[option.successor];
+			if (entry.value == NO_VALUE)
+			{
+				continue;
+			}
+			optionValue = -unquantize(entry.value);
+			turns = entry.turns + 1;
+		}
+		bool better = !found || optionValue > bestValue + 1.0f / VALUE_SCALE;
+		if (found && !better && optionValue >= bestValue - 1.0f / VALUE_SCALE)
+		{
+			better = bestValue > 0 ? turns < bestTurns : bestValue < 0 && turns > bestTurns;
+		}
+		if (better)
+		{
+			found = true;
+			bestValue = optionValue;
+			bestTurns = turns;
+			first = option.first;
+		}
+	}
+	value = bestValue;
+	return found;
+}
+
+void Tablebase::build(const Rules& rules, unsigned threads,
+	const std::function<void(int turns, float change)>& progress)
+{
+	const int count = positions();
+
+	// Every position's options, with successors in one flat list
+	std::vector<int> offsets(count + 1, 0);
+	std::vector<int> successors;
+	std::vector<float> results(count, -2); // Best option that ends the game, -2 for none
+	std::vector<bool> valid(count, false);
+	std::vector<Option> options;
+	Position position;
+	for (int i = 0; i < count; ++i)
+	{
+		int rest = i;
+		position.carrying[RED] = (rest & 1) != 0;
+		position.carrying[BLUE] = (rest & 2) != 0;
+		rest /= 4;
+		position.tile[BLUE] = rest % TABLE_TILES;
+		rest /= TABLE_TILES;
+		position.type[BLUE] = rest % UNIT_TYPES;
+		rest /= UNIT_TYPES;
+		position.tile[RED] = rest % TABLE_TILES;
+		rest /= TABLE_TILES;
+		position.type[RED] = rest % UNIT_TYPES;
+		position.player = rest / UNIT_TYPES;
+
+		offsets[i] = (int)successors.size();
+		if (!possible(position))
+		{
+			continue;
+		}
+		valid[i] = true;
+		expand(position, rules.movementPoints, true, rules, options);
+		for (size_t j = 0; j < options.size(); ++j)
+		{
+			if (options[j].successor >= 0)
+			{
+				successors.push_back(options[j].successor);
+			}
+			else
+			{
+				results[i] = std::max(results[i], options[j].value);
+			}
+		}
+	}
+	offsets[count] = (int)successors.size();
+
+	// Improve every value by a turn at a time until none of them change
+	std::vector<float> values(count, 0), nextValues(count, 0);
+	std::vector<unsigned short> turns(count, 0);
+	ThreadPool pool(threads);
+	int chunks = (count + CHUNK - 1) / CHUNK;
+	std::vector<float> changes(chunks);
+	for (int turn = 1; turn <= MAX_TURNS; ++turn)
+	{
+		for (int c = 0; c < chunks; ++c)
+		{
+			pool.submit([&, c, turn]()
+			{
+				float largest = 0;
+				int end = std::min(count, (c + 1) * CHUNK);
+				for (int i = c * CHUNK; i < end; ++i)
+				{
+					if (!valid[i])
+					{
+						continue;
+					}
+					float best = results[i];
+					for (int j = offsets[i]; j < offsets[i + 1]; ++j)
+					{
+						best = std::max(best, -values[successors[j]]);
+					}
+					float change = std::fabs(best - values[i]);
+					if (change > 0.5f / VALUE_SCALE)
+					{
+						turns[i] = (unsigned short)std::min(turn, 65535);
+					}
+					largest = std::max(largest, change);
+					nextValues[i] = best;
+				}
+				changes[c] = largest;
+			});
+		}
+		pool.wait();
+		values.swap(nextValues);
+		float change = *std::max_element(changes.begin(), changes.end());
+		if (progress)
+		{
+			progress(turn, change);
+		}
+		if (change < SETTLED)
+		{
+			break;
+		}
+	}
+
+	unmap();
+	m_built.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		m_built[i].value = valid[i] ? quantize(values[i]) : NO_VALUE;
+		m_built[i].turns = turns[i];
+	}
+	m_entries = &m_built[0];
+	m_rules = rules;
+	m_hasRules = true;
+}
+
+bool Tablebase::save(const char* path) const
+{
+	if (!m_entries)
+	{
+		return false;
+	}
+	TableHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+	header.tiles = TABLE_TILES;
+	header.entries = positions();
+	header.movementPoints = m_rules.movementPoints;
+	memcpy(header.goldCost, m_rules.goldCost, sizeof(header.goldCost));
+	memcpy(header.movementCost, m_rules.movementCost, sizeof(header.movementCost));
+	memcpy(header.odds, m_rules.odds, sizeof(header.odds));
+
+	std::ofstream out(path, std::ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)m_entries, sizeof(Entry) * positions());
+	return out.good();
+}
+
+bool Tablebase::load(const char* path)
+{
+	if ((int)m_tiles.size() != TABLE_TILES)
+	{
+		return false; // The map isn't the one tables are made for
+	}
+	const size_t size = sizeof(TableHeader) + sizeof(Entry) * positions();
+	MappedFile file;
+	if (!file.open(path) || file.size() != size)
+	{
+		return false;
+	}
+
+	TableHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (!std::equal(header.magic, header.magic + sizeof(TABLE_MAGIC), TABLE_MAGIC) ||
+		header.tiles != TABLE_TILES || header.entries != positions())
+	{
+		return false;
+	}
+
+	unmap();
+	m_file.swap(file);
+	m_rules = Rules::standard();
+	m_rules.movementPoints = header.movementPoints;
+	memcpy(m_rules.goldCost, header.goldCost, sizeof(header.goldCost));
+	memcpy(m_rules.movementCost, header.movementCost, sizeof(header.movementCost));
+	memcpy(m_rules.odds, header.odds, sizeof(header.odds));
+	m_hasRules = true;
+	m_entries = (const Entry*)(m_file.data() + sizeof(TableHeader));
+	return true;
+}
+
+void Tablebase::unmap()
+{
+	m_file.close();
+	m_entries = nullptr;
+	m_built.clear();
+	m_hasRules = false;
+}
+
+bool Tablebase::ready() const
+{
+	return m_entries != nullptr;
+}
+
+bool Tablebase::matches(const Rules& rules) const
+{
+	return m_hasRules && sameRules(m_rules, rules);
+}
+
+bool Tablebase::probe(const BoardState& state, float& value, Action* best) const
+{
+	Position position;
+	if (!m_entries || !decode(state, position))
+	{
+		return false;
+	}
+	bool fresh = state.movementPoints >= m_rules.movementPoints;
+	if (fresh && !best)
+	{
+		value = unquantize(m_entries[index(position)].value);
+		return true;
+	}
+
+	std::vector<Option> options;
+	expand(position, state.movementPoints, fresh, m_rules, options);
+	Action first = Action::endTurn();
+	if (!bestOption(options, value, first))
+	{
+		return false;
+	}
+	if (best)
+	{
+		*best = first;
+	}
+	return true;
+}
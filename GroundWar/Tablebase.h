@@ -0,0 +1,137 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "Action.h"
+#include "BoardState.h"
+#include "MappedFile.h"
+#include "Rules.h"
+
+/*
+Solved endgames: every position on the standard map with one unit per side and no gold
+in either bank. With nothing to spend, losing a unit loses the game, so a flag can only
+be at home or carried, and an attack settles the game on the spot. That leaves about
+290,000 positions at the start of a turn, which solve in around a second.
+
+Positions are solved a whole turn at a time. A turn is every path the unit to move can
+walk with its movement points, picking up the enemy flag on the way, and ending on its
+base with the flag (a win), with an attack (won with the combat odds) or anywhere else
+(handing the turn over). Values start out as draws and are improved one turn at a time
+until they stop changing, so a value is exact for as long a game as anyone will play.
+The one thing left out is gold: a turn ending on the gold tile earns a gold, which takes
+the game out of the table, and it's valued as if it hadn't.
+
+Values are the chance of winning minus the chance of losing for the player to move,
+from -1 to 1, stored as 16 bits each along with how many turns the value took to settle,
+so winning positions can be played out without wandering. The file is a small header
+followed by the entries as they are in memory, and load maps it instead of reading it,
+so any number of AIs can share one copy and opening it costs nothing until it's probed.
+*/
+class Tablebase
+{
+public:
+	Tablebase();
+	~Tablebase();
+
+	/*
+	Solves every position for the given rules on up to the given number of threads (0
+	means one per hardware thread). progress, if given, is called after every turn of
+	solving with the number of turns so far and the largest change in any value.
+	*/
+	void build(const Rules& rules, unsigned threads = 0,
+		const std::function<void(int turns, float change)>& progress = nullptr);
+
+	/*
+	Saves the table, or maps a saved one into memory. load returns false, leaving the
+	table as it was, if the file can't be opened or isn't a table for the standard map.
+	*/
+	bool save(const char* path) const;
+	bool load(const char* path);
+
+	/*
+	Checks if there's a table, and whether it was solved for the given rules. Only the
+	starting money is allowed to differ.
+	*/
+	bool ready() const;
+	bool matches(const Rules& rules) const;
+
+	/*
+	Looks up a position, at the start of a turn or partway through one. Returns false if
+	the position isn't one the table covers. Otherwise sets value for the player to move,
+	and if best is given, the action that starts their best way to finish the turn.
+	Positions at the start of a turn are a single lookup; partway through, the rest of
+	the turn is walked first.
+	*/
+	bool probe(const BoardState& state, float& value, Action* best = nullptr) const;
+
+	/*
+	Number of entries in the table, including ones for impossible positions.
+	*/
+	static int positions();
+
+	/*
+	The entry for each position.
+	*/
+	struct Entry
+	{
+		unsigned short value; // 0 to VALUE_SCALE for -1 to 1, NO_VALUE for an impossible position
+		unsigned short turns; // Turns it took for the value to settle
+	};
+
+	static const unsigned short VALUE_SCALE = 65534;
+	static const unsigned short NO_VALUE = 65535;
+
+private:
+	/*
+	A position the table covers, as the fields it's indexed by.
+	*/
+	struct Position
+	{
+		int player; // To move
+		int type[2]; // Unit::UnitType of each player's unit, by Player
+		int tile[2]; // Where each player's unit is, as an index into m_tiles
+		bool carrying[2]; // Whether each player's unit has the other player's flag
+	};
+
+	/*
+	One way to finish the turn: with a result, or by ending the turn with the next
+	position as successor.
+	*/
+	struct Option
+	{
+		float value; // For the player to move, if successor is -1
+		int successor;
+		Action first; // Action the way starts with
+	};
+
+	// The standard map, as the tiles a unit can stand on
+	std::vector<int> m_tiles; // Board index of each tile
+	std::vector<int> m_tileIndex; // Index in m_tiles by board index, -1 for none
+	std::vector<int> m_neighbors; // 6 per tile, -1 for none
+	std::vector<bool> m_base[2]; // Base tiles of each player, by tile
+	int m_flagHome[2]; // Tile each player's flag starts on
+
+	Rules m_rules;
+	bool m_hasRules = false;
+	std::vector<Entry> m_built; // Entries, if they were built rather than loaded
+	const Entry* m_entries = nullptr;
+	MappedFile m_file; // The saved table, if it was loaded
+
+	void unmap();
+	int index(const Position& position) const;
+	bool possible(const Position& position) const;
+	bool decode(const BoardState& state, Position& position) const;
+
+	/*
+	Finds every way to finish the turn with the given movement points left. fresh is
+	whether the turn has just started, in which case at least one action has to be
+	taken if one can be.
+	*/
+	void expand(const Position& position, int movementPoints, bool fresh, const Rules& rules,
+		std::vector<Option>& options) const;
+
+	/*
+	Picks the best option, using the table for successors. Returns false if there are
+	none.
+	*/
+	bool bestOption(const std::vector<Option>& options, float& value, Action& first) const;
+};
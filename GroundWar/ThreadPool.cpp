@@ -0,0 +1,82 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+	if (threads == 0)
+	{
+		threads = std::thread::hardware_concurrency();
+		if (threads == 0)
+		{
+			threads = 1; // hardware_concurrency is allowed to not know
+		}
+	}
+	for (unsigned i = 0; i < threads; ++i)
+	{
+		m_workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_jobAvailable.notify_all();
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i].join();
+	}
+}
+
+void ThreadPool::submit(const std::function<void()>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+	}
+	m_jobAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_jobs.empty() || m_running > 0)
+	{
+		m_idle.wait(lock);
+	}
+}
+
+unsigned ThreadPool::size()
+{
+	return (unsigned)m_workers.size();
+}
+
+void ThreadPool::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		while (m_jobs.empty() && !m_stopping)
+		{
+			m_jobAvailable.wait(lock);
+		}
+		if (m_jobs.empty()) // Stopping, and nothing left to do
+		{
+			return;
+		}
+
+		std::function<void()> job = m_jobs.front();
+		m_jobs.pop_front();
+		++m_running;
+		lock.unlock();
+		job();
+		lock.lock();
+		--m_running;
+		if (m_jobs.empty() && m_running == 0)
+		{
+			m_idle.notify_all();
+		}
+	}
+}
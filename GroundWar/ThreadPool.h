@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+/*
+A fixed set of worker threads that run submitted jobs in FIFO order.
+Jobs may submit more jobs.
+*/
+class ThreadPool
+{
+public:
+	/*
+	Starts the given number of workers. 0 means one per hardware thread.
+	*/
+	ThreadPool(unsigned threads = 0);
+
+	/*
+	Waits for all queued jobs to finish, then stops the workers.
+	*/
+	~ThreadPool();
+
+	/*
+	Queues a job to be run on one of the workers.
+	*/
+	void submit(const std::function<void()>& job);
+
+	/*
+	Blocks until the queue is empty and no job is running.
+	*/
+	void wait();
+
+	/*
+	Gets the number of worker threads.
+	*/
+	unsigned size();
+
+private:
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobAvailable;
+	std::condition_variable m_idle;
+	unsigned m_running = 0; // Jobs currently being run
+	bool m_stopping = false;
+
+	void workerLoop();
+};
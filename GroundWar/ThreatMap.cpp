@@ -0,0 +1,272 @@
+#include "ThreatMap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#include "PlayoutBatch.h"
+
+// Same as PlayoutBatch: MSVC always compiles the AVX2 kernel, other compilers need AVX2
+// enabled for the whole file.
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define THREAT_AVX2
+#endif
+
+static int bitCount(unsigned bits)
+{
+	bits = bits - ((bits >> 1) & 0x55555555);
+	bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+	return (int)((((bits + (bits >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24);
+}
+
+ThreatMap::ThreatMap() :
+	m_useSimd(PlayoutBatch::simdAvailable())
+{
+	memset(m_sides, 0, sizeof(m_sides));
+	memset(m_open, 0, sizeof(m_open));
+	memset(m_reach, 0, sizeof(m_reach));
+	memset(m_next, 0, sizeof(m_next));
+}
+
+ThreatMap::~ThreatMap()
+{
+	detach();
+}
+
+void ThreatMap::compute(Board& board)
+{
+	detach();
+	for (int i = 0; i < KERNEL_TILES; ++i)
+	{
+		for (int dir = 0; dir < 6; ++dir)
+		{
+			m_neighbors[dir][i] = NOWHERE;
+		}
+	}
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = board.getTile(x, y);
+			const int i = x * BOARD_HEIGHT + y;
+			m_open[i] = tile && tile->openForMovement() ? ~0u : 0;
+			for (int dir = 0; dir < 6; ++dir)
+			{
+				int adjX, adjY;
+				if (tile && Board::adjacentPosition(x, y, dir, adjX, adjY) && board.getTile(adjX, adjY))
+				{
+					m_neighbors[dir][i] = adjX * BOARD_HEIGHT + adjY;
+				}
+			}
+		}
+	}
+	refresh(board, RED);
+	refresh(board, BLUE);
+}
+
+void ThreatMap::attach(Board& board)
+{
+	compute(board);
+	m_board = &board;
+	board.addListener(this);
+}
+
+void ThreatMap::detach()
+{
+	if (m_board)
+	{
+		m_board->removeListener(this);
+		m_board = nullptr;
+	}
+}
+
+float ThreatMap::threat(Player player, Unit::UnitType type, int x, int y)
+{
+	return threats(player, type)[x * BOARD_HEIGHT + y];
+}
+
+const float* ThreatMap::threats(Player player, Unit::UnitType type)
+{
+	const Player enemy = Player(1 - player);
+	if (m_board && m_sides[enemy].dirty)
+	{
+		refresh(*m_board, enemy);
+	}
+	return m_sides[enemy].threat[type];
+}
+
+int ThreatMap::attackers(Player player, int x, int y)
+{
+	if (m_board && m_sides[player].dirty)
+	{
+		refresh(*m_board, player);
+	}
+	return m_sides[player].attackers[x * BOARD_HEIGHT + y];
+}
+
+bool ThreatMap::setUseSimd(bool useSimd)
+{
+	m_useSimd = useSimd && PlayoutBatch::simdAvailable();
+	return m_useSimd;
+}
+
+void ThreatMap::tileChanged(Board& board, int x, int y)
+{
+	const int i = x * BOARD_HEIGHT + y;
+	Tile* tile = board.getTile(x, y);
+	m_open[i] = tile && tile->openForMovement() ? ~0u : 0;
+	for (int player = 0; player < 2; ++player)
+	{
+		// Units only see tiles they could get to or attack, so the rest can come and go
+		if (m_sides[player].footprint[i] || (tile && tile->unit() && tile->unit()->owner() == player))
+		{
+			m_sides[player].dirty = true;
+		}
+	}
+}
+
+void ThreatMap::stateChanged(Board& board)
+{
+	for (int player = 0; player < 2; ++player)
+	{
+		int movementPoints = player == board.currentPlayer() ? board.movementPoints() : board.rules().movementPoints;
+		if (movementPoints != m_sides[player].movementPoints)
+		{
+			m_sides[player].dirty = true;
+		}
+	}
+}
+
+void ThreatMap::refresh(Board& board, Player player)
+{
+	Side& side = m_sides[player];
+	const Rules& rules = board.rules();
+	side.dirty = false;
+	side.movementPoints = player == board.currentPlayer() ? board.movementPoints() : rules.movementPoints;
+
+	int unitTiles[BOARD_TILES];
+	int unitTypes[BOARD_TILES];
+	int units = 0;
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			Tile* tile = board.getTile(x, y);
+			if (tile && tile->unit() && tile->unit()->owner() == player)
+			{
+				unitTiles[units] = x * BOARD_HEIGHT + y;
+				unitTypes[units] = tile->unit()->type();
+				++units;
+			}
+		}
+	}
+
+	int counts[UNIT_TYPES][BOARD_TILES]; // Attackers of each type
+	memset(counts, 0, sizeof(counts));
+	memset(side.attackers, 0, sizeof(side.attackers));
+	memset(side.footprint, 0, sizeof(side.footprint));
+	for (int first = 0; first < units; first += LANES)
+	{
+		// Each unit in the batch starts out on its own tile, in its own lane
+		const int lanes = std::min(LANES, units - first);
+		unsigned typeLanes[UNIT_TYPES] = { 0 };
+		unsigned canAttack = 0;
+		int moves[LANES]; // Steps each unit can take and still attack
+		int mostMoves = 0;
+		memset(m_reach, 0, sizeof(m_reach));
+		for (int lane = 0; lane < lanes; ++lane)
+		{
+			const unsigned bit = 1u << lane;
+			const int type = unitTypes[first + lane];
+			const int steps = side.movementPoints / std::max(1, rules.movementCost[type]);
+			m_reach[unitTiles[first + lane]] |= bit;
+			typeLanes[type] |= bit;
+			canAttack |= steps > 0 ? bit : 0;
+			moves[lane] = steps - 1;
+			mostMoves = std::max(mostMoves, moves[lane]);
+		}
+
+		// Walk every unit that still has the points for another step, then attack from wherever they got to
+		unsigned* from = m_reach;
+		unsigned* to = m_next;
+		for (int step = 1; step <= mostMoves; ++step)
+		{
+			unsigned active = 0;
+			for (int lane = 0; lane < lanes; ++lane)
+			{
+				active |= moves[lane] >= step ? 1u << lane : 0;
+			}
+			spread(from, to, active, false);
+			std::swap(from, to);
+		}
+		for (int i = 0; i < BOARD_TILES; ++i)
+		{
+			side.footprint[i] = side.footprint[i] || from[i] != 0;
+		}
+		spread(from, to, canAttack, true);
+
+		for (int i = 0; i < BOARD_TILES; ++i)
+		{
+			const unsigned attacks = to[i];
+			side.footprint[i] = side.footprint[i] || attacks != 0;
+			side.attackers[i] += bitCount(attacks);
+			for (int type = 0; type < UNIT_TYPES; ++type)
+			{
+				counts[type][i] += bitCount(attacks & typeLanes[type]);
+			}
+		}
+	}
+
+	for (int defender = 0; defender < UNIT_TYPES; ++defender)
+	{
+		for (int i = 0; i < BOARD_TILES; ++i)
+		{
+			// Each attack is a separate roll, and the defender has to survive them all
+			double survives = 1;
+			for (int attacker = 0; attacker < UNIT_TYPES; ++attacker)
+			{
+				if (counts[attacker][i] > 0)
+				{
+					survives *= pow(1.0 - std::max(0.0f, rules.odds[attacker][defender]), counts[attacker][i]);
+				}
+			}
+			side.threat[defender][i] = (float)(1 - survives);
+		}
+	}
+}
+
+void ThreatMap::spread(const unsigned* from, unsigned* to, unsigned lanes, bool attack)
+{
+#ifdef THREAT_AVX2
+	if (m_useSimd)
+	{
+		const __m256i laneMask = _mm256_set1_epi32((int)lanes);
+		for (int i = 0; i < KERNEL_TILES; i += 8)
+		{
+			__m256i gathered = _mm256_setzero_si256();
+			for (int dir = 0; dir < 6; ++dir)
+			{
+				__m256i neighbors = _mm256_loadu_si256((const __m256i*)(m_neighbors[dir] + i));
+				gathered = _mm256_or_si256(gathered, _mm256_i32gather_epi32((const int*)from, neighbors, 4));
+			}
+			gathered = _mm256_and_si256(gathered, laneMask);
+			if (!attack)
+			{
+				gathered = _mm256_and_si256(gathered, _mm256_loadu_si256((const __m256i*)(m_open + i)));
+				gathered = _mm256_or_si256(gathered, _mm256_loadu_si256((const __m256i*)(from + i)));
+			}
+			_mm256_storeu_si256((__m256i*)(to + i), gathered);
+		}
+		return;
+	}
+#endif
+	for (int i = 0; i < KERNEL_TILES; ++i)
+	{
+		unsigned gathered = 0;
+		for (int dir = 0; dir < 6; ++dir)
+		{
+			gathered |= from[m_neighbors[dir][i]];
+		}
+		gathered &= lanes;
+		to[i] = attack ? gathered : from[i] | (gathered & m_open[i]);
+	}
+}
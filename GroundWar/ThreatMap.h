@@ -0,0 +1,108 @@
+#pragma once
+#include "Board.h"
+#include "BoardListener.h"
+#include "BoardState.h"
+#include "Rules.h"
+
+/*
+For every tile and unit type, the chance that a unit of that type standing there is lost
+if every enemy unit that can reach it attacks: one minus the product of each attacker's
+chance of losing, from the rules' odds. A unit can reach a tile if it can walk next to it
+through empty tiles and still have the movement points left to attack. The player to move
+gets what's left of their movement points, and the other player a full turn's worth. Each
+unit is given all of them, so it's how exposed a tile is rather than what one turn could
+actually do.
+
+Also keeps how many units of each player could attack each tile, as a map of influence.
+
+All of one player's units are walked at once. Each tile holds a bit mask with one bit per
+unit, for the units that can get there, and each step spreads every mask to the
+neighbouring tiles in one pass over flat arrays, with the neighbours looked up in a table
+(eight tiles at a time with AVX2 gathers, when the CPU has them). A player with more than
+32 units takes a pass for every 32.
+
+While attached to a board, changes mark the maps out of date, and they're only worked out
+again when next asked for. A change only affects a player whose units could reach it, or
+whose movement points changed, so after most actions the other player's maps stay as
+they are.
+*/
+class ThreatMap :
+	public BoardListener
+{
+public:
+	ThreatMap();
+	~ThreatMap();
+
+	/*
+	Works out the maps for the given board, without listening for changes.
+	*/
+	void compute(Board& board);
+
+	/*
+	Works out the maps as they're needed, and keeps track of what changes on the board.
+	The board has to outlive this object, or be detached from it first.
+	*/
+	void attach(Board& board);
+	void detach();
+
+	/*
+	Gets the chance that a unit of the given player and type at (x, y) would be lost.
+	*/
+	float threat(Player player, Unit::UnitType type, int x, int y);
+
+	/*
+	Gets the same for every tile, by x * BOARD_HEIGHT + y.
+	*/
+	const float* threats(Player player, Unit::UnitType type);
+
+	/*
+	Gets how many of the given player's units could attack (x, y).
+	*/
+	int attackers(Player player, int x, int y);
+
+	/*
+	Turns the AVX2 kernel on or off, like PlayoutBatch::setUseSimd. Returns whether it's on.
+	*/
+	bool setUseSimd(bool useSimd);
+
+	void tileChanged(Board& board, int x, int y);
+	void stateChanged(Board& board);
+
+private:
+	static const int LANES = 32; // Units walked at once, one per bit
+	static const int KERNEL_TILES = (BOARD_TILES + 7) / 8 * 8; // Tiles the kernels run over
+	static const int NOWHERE = KERNEL_TILES; // Where missing neighbours point: a tile that's never reached
+	static const int PADDED_TILES = KERNEL_TILES + 8;
+
+	/*
+	The maps made by one player's units.
+	*/
+	struct Side
+	{
+		bool dirty;
+		int movementPoints; // Given to each unit when the maps were made
+		float threat[UNIT_TYPES][BOARD_TILES]; // To the other player's units
+		int attackers[BOARD_TILES];
+		bool footprint[BOARD_TILES]; // Tiles any of the units could get to or attack
+	};
+
+	Board* m_board = nullptr;
+	bool m_useSimd;
+	Side m_sides[2];
+	int m_neighbors[6][KERNEL_TILES]; // Index of each neighbour, NOWHERE for none
+	unsigned m_open[PADDED_TILES]; // All ones for tiles a unit can walk onto, 0 for the rest
+	unsigned m_reach[PADDED_TILES]; // Scratch: the units that can get to each tile
+	unsigned m_next[PADDED_TILES];
+
+	/*
+	Works out the maps made by the given player's units on the board.
+	*/
+	void refresh(Board& board, Player player);
+
+	/*
+	Spreads the units in the given lanes one step, from from into to: each tile gets those
+	lanes of its neighbours' masks. For a move, only open tiles take them, and each tile
+	keeps its own; for an attack, every tile takes them, and keeps nothing else.
+	*/
+	void spread(const unsigned* from, unsigned* to, unsigned lanes, bool attack);
+};
@@ -28,6 +28,22 @@ void Tile::setAdjacents(Tile** adjacents)
 	m_adjacentTiles = adjacents; // This needs to be deleted later on (in destructor)
 }
 
+void Tile::setPosition(int x, int y)
+{
+	m_x = x;
+	m_y = y;
+}
+
+int Tile::x()
+{
+	return m_x;
+}
+
+int Tile::y()
+{
+	return m_y;
+}
+
 bool Tile::isAdjacent(Tile* tile)
 {
 	if (!tile)
@@ -93,6 +109,17 @@ void Tile::spawnFlag(Player owner)
 	m_flag = new Flag(owner);
 }
 
+Flag* Tile::lyingFlag()
+{
+	return m_flag;
+}
+
+void Tile::setLyingFlag(Flag* flag)
+{
+	delete m_flag;
+	m_flag = flag;
+}
+
 Tile::TileType Tile::type()
 {
 	return m_type;
@@ -28,6 +28,13 @@ public:
 	*/
 	virtual void setAdjacents(Tile**);
 
+	/*
+	Sets the board indices of this tile. Should be called once, shortly after construction.
+	*/
+	void setPosition(int x, int y);
+	int x();
+	int y();
+
 	/*
 	Checks if the given Tile is adjacent to this one.
 	*/
@@ -52,6 +59,14 @@ public:
 	*/
 	Flag* flag();
 	void spawnFlag(Player);
+
+	/*
+	Gets or replaces the flag lying on this tile, ignoring any flag the unit here is
+	carrying. setLyingFlag deletes the flag it replaces.
+	*/
+	Flag* lyingFlag();
+	void setLyingFlag(Flag*);
+
 	TileType type();
 
 	virtual int getBackgroundColor();
@@ -59,6 +74,8 @@ public:
 	
 private:
 	Tile** m_adjacentTiles;
+	int m_x = -1;
+	int m_y = -1;
 	Unit* m_unit = nullptr;
 	Flag* m_flag = nullptr;
 	TileType m_type;
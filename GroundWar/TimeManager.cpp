@@ -0,0 +1,182 @@
+#include "TimeManager.h"
+#include <algorithm>
+
+static const double HARD_RATIO = 3; // How far past its soft limit an action can go
+static const double MIN_ACTION_MS = 1; // Kept back for each action still to come in the turn
+static const double MAX_TURN_SHARE = 0.5; // Most of the game clock one turn can use
+static const double MIN_GROWTH = 2; // Least an iteration is assumed to grow by
+static const double MAX_GROWTH = 8;
+static const double DEFAULT_GROWTH = 4; // When there's no previous iteration to go by
+static const int MAX_SPAWNS = 3; // Most spawns counted in a turn
+static const int MAX_ACTIONS = 16;
+static const int MIN_TURNS = 8;
+static const int MAX_TURNS = 60;
+static const int TURNS_PER_UNIT = 2; // Each unit on the board, or that can be bought, adds this many turns
+
+/*
+Counts the player's units, and the cheapest move cost among them.
+*/
+static int countUnits(const BoardState& state, int player, const Rules& rules, int& cheapestMove)
+{
+	int units = 0;
+	cheapestMove = 0;
+	for (int i = 0; i < BOARD_TILES; ++i)
+	{
+		unsigned char tile = state.tiles[i];
+		if ((tile & BoardState::UNIT_MASK) && ((tile & BoardState::UNIT_BLUE) ? BLUE : RED) == player)
+		{
+			int cost = rules.movementCost[(tile & BoardState::UNIT_MASK) - 1];
+			if (units == 0 || cost < cheapestMove)
+			{
+				cheapestMove = cost;
+			}
+			++units;
+		}
+	}
+	return units;
+}
+
+static int cheapestUnit(const Rules& rules)
+{
+	return std::max(1, *std::min_element(rules.goldCost, rules.goldCost + UNIT_TYPES));
+}
+
+TimeManager::TimeManager(int actionMilliseconds) :
+	m_actionTime(actionMilliseconds) {}
+
+void TimeManager::setActionTime(int milliseconds)
+{
+	m_mode = PER_ACTION;
+	m_actionTime = milliseconds;
+}
+
+void TimeManager::setTurnTime(int milliseconds)
+{
+	if (m_mode != PER_TURN)
+	{
+		m_mode = PER_TURN;
+		m_turn = -1;
+	}
+	m_turnTime = milliseconds;
+}
+
+void TimeManager::setGameTime(int milliseconds, int incrementMilliseconds)
+{
+	if (m_mode != PER_GAME)
+	{
+		m_mode = PER_GAME;
+		m_turn = -1;
+	}
+	m_gameTime = milliseconds;
+	m_increment = incrementMilliseconds;
+	m_clockSet = true;
+}
+
+void TimeManager::startAction(const BoardState& state, const Rules& rules)
+{
+	m_start = std::chrono::steady_clock::now();
+	m_running = true;
+	if (m_mode == PER_ACTION)
+	{
+		m_soft = m_hard = std::max(0.0, m_actionTime);
+		return;
+	}
+
+	if (state.turn != m_turn || state.player != m_player || state.movementPoints > m_movementPoints)
+	{
+		if (m_mode == PER_TURN)
+		{
+			m_turnLeft = m_turnTime;
+		}
+		else
+		{
+			if (m_turn >= 0 && !m_clockSet)
+			{
+				m_gameTime += m_increment;
+			}
+			double share = m_gameTime / expectedTurns(state, rules) + m_increment;
+			m_turnLeft = std::min(share, m_gameTime * MAX_TURN_SHARE);
+		}
+		m_turn = state.turn;
+		m_player = state.player;
+		m_clockSet = false;
+	}
+	m_movementPoints = state.movementPoints;
+
+	const int actions = expectedActions(state, rules);
+	const double left = std::max(0.0, m_turnLeft);
+	m_soft = left / actions;
+	m_hard = std::min(m_soft * HARD_RATIO, left - (actions - 1) * MIN_ACTION_MS);
+	m_hard = std::max(m_hard, std::min(left, MIN_ACTION_MS));
+	m_soft = std::min(m_soft, m_hard);
+}
+
+void TimeManager::finishAction()
+{
+	if (!m_running)
+	{
+		return;
+	}
+	m_running = false;
+	double used = elapsed();
+	m_turnLeft -= used;
+	if (m_mode == PER_GAME)
+	{
+		m_gameTime -= used;
+	}
+}
+
+double TimeManager::softLimit() const
+{
+	return m_soft;
+}
+
+double TimeManager::hardLimit() const
+{
+	return m_hard;
+}
+
+std::chrono::steady_clock::time_point TimeManager::deadline() const
+{
+	return m_start + std::chrono::microseconds((long long)(m_hard * 1000));
+}
+
+double TimeManager::elapsed() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+bool TimeManager::worthDeepening(double lastMilliseconds, double previousMilliseconds) const
+{
+	double now = elapsed();
+	if (m_mode == PER_ACTION)
+	{
+		// Time left over isn't kept for later actions, so there's no point saving it
+		return now < m_hard;
+	}
+	double growth = previousMilliseconds > 0 ?
+		std::min(MAX_GROWTH, std::max(MIN_GROWTH, lastMilliseconds / previousMilliseconds)) : DEFAULT_GROWTH;
+	return now < m_soft && now + lastMilliseconds * growth < m_hard;
+}
+
+int TimeManager::expectedActions(const BoardState& state, const Rules& rules)
+{
+	int cheapestMove;
+	int units = countUnits(state, state.player, rules, cheapestMove);
+	int spawns = std::min(MAX_SPAWNS, state.money[state.player] / cheapestUnit(rules));
+	if (units == 0 && spawns > 0)
+	{
+		// Anything bought can still move this turn
+		cheapestMove = *std::min_element(rules.movementCost, rules.movementCost + UNIT_TYPES);
+	}
+	int moves = units > 0 || spawns > 0 ? state.movementPoints / std::max(1, cheapestMove) : 0;
+	return std::max(1, std::min(MAX_ACTIONS, moves + spawns));
+}
+
+int TimeManager::expectedTurns(const BoardState& state, const Rules& rules)
+{
+	int cheapestMove;
+	int units = countUnits(state, RED, rules, cheapestMove) + countUnits(state, BLUE, rules, cheapestMove);
+	int affordable = (state.money[RED] + state.money[BLUE]) / cheapestUnit(rules);
+	return std::max(MIN_TURNS, std::min(MAX_TURNS, MIN_TURNS + TURNS_PER_UNIT * (units + affordable)));
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <chrono>
+#include "BoardState.h"
+#include "Rules.h"
+
+/*
+Decides how long an AI can think about each action. There are three ways to give it time:
+
+- Per action: every action gets the same time.
+- Per turn: a turn gets a budget, shared between its actions. A turn can be many actions,
+  as many as the movement points and gold allow, so each action gets the time left in the
+  turn divided by the actions the turn is likely to still need.
+- Per game: a clock for the whole game, with an optional increment each turn. Each turn
+  gets the clock divided by the turns the game is likely to still last, then shares that
+  out as above. Games with more units and gold on the board tend to last longer, so that's
+  what the guess goes by.
+
+Each action gets two limits. The soft limit is what it should take: a deepening search
+shouldn't start another iteration past it, or one that won't finish before the hard
+limit. The hard limit is what it must not go past: the search gives up on the iteration
+in progress and plays the best action from the last one it finished. Time saved on one
+action is left for the rest of the turn.
+*/
+class TimeManager
+{
+public:
+	/*
+	Starts out giving every action the given number of milliseconds.
+	*/
+	TimeManager(int actionMilliseconds = 100);
+
+	void setActionTime(int milliseconds);
+
+	/*
+	Gives each turn the given time, from the next turn on.
+	*/
+	void setTurnTime(int milliseconds);
+
+	/*
+	Sets the time left on the game clock, and what's added to it at the start of each
+	turn. Can be called again at any point, for a clock kept somewhere else; the increment
+	is then left for that clock to add.
+	*/
+	void setGameTime(int milliseconds, int incrementMilliseconds = 0);
+
+	/*
+	Starts the clock for an action in the given position, and works out its limits.
+	*/
+	void startAction(const BoardState& state, const Rules& rules);
+
+	/*
+	Stops the clock, charging the time since startAction to the turn and the game.
+	*/
+	void finishAction();
+
+	/*
+	Limits for the current action, in milliseconds from when it started, and the time
+	the hard limit falls at.
+	*/
+	double softLimit() const;
+	double hardLimit() const;
+	std::chrono::steady_clock::time_point deadline() const;
+
+	/*
+	Milliseconds since startAction.
+	*/
+	double elapsed() const;
+
+	/*
+	Checks if a deepening search should start its next iteration, given how long its last
+	two took (0 for one that didn't happen). Each iteration is assumed to take as much
+	longer than the last as the last did than the one before.
+	*/
+	bool worthDeepening(double lastMilliseconds, double previousMilliseconds) const;
+
+	/*
+	Guesses how many more actions the player to move will take this turn, counting the
+	one that ends it, from their movement points, units and gold.
+	*/
+	static int expectedActions(const BoardState& state, const Rules& rules);
+
+	/*
+	Guesses how many more turns the player to move will get in the game.
+	*/
+	static int expectedTurns(const BoardState& state, const Rules& rules);
+
+private:
+	enum Mode { PER_ACTION, PER_TURN, PER_GAME };
+
+	Mode m_mode = PER_ACTION;
+	double m_actionTime;
+	double m_turnTime = 0;
+	double m_gameTime = 0; // Left on the clock
+	double m_increment = 0;
+
+	bool m_clockSet = false; // Since the last turn started
+	int m_turn = -1; // Turn the current budget is for
+	int m_player = -1;
+	int m_movementPoints = 0; // Left at the last action, since they only go up at a new turn
+	double m_turnLeft = 0; // Of the current turn's budget
+	double m_soft = 0;
+	double m_hard = 0;
+	std::chrono::steady_clock::time_point m_start;
+	bool m_running = false;
+};
@@ -0,0 +1,266 @@
+#include "Tournament.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "SelfPlay.h"
+#include "ThreadPool.h"
+#include "RandomAI.h"
+#include "SearchAI.h"
+#include "PlannerAI.h"
+#include "NetAI.h"
+
+static const double MIN_SCORE = 1e-6; // Keeps the Elo finite when one side wins every game
+
+/*
+Spreads a pair's index over the whole range of seeds, so neighbouring pairs don't get
+related combat streams.
+*/
+static unsigned pairSeed(unsigned seed, unsigned index)
+{
+	unsigned h = seed ^ (index * 0x9e3779b9u);
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+static double gameScore(const GameResult& result, Player player)
+{
+	if (!result.decided)
+	{
+		return 0.5;
+	}
+	return result.winner == player ? 1.0 : 0.0;
+}
+
+TournamentStats::TournamentStats() :
+	wins(0), losses(0), draws(0)
+{
+	std::fill(pairs, pairs + 5, 0);
+}
+
+void TournamentStats::addPair(double first, double second)
+{
+	++pairs[(int)((first + second) * 2 + 0.5)];
+	double games[2] = { first, second };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (games[i] > 0.75) ++wins;
+		else if (games[i] < 0.25) ++losses;
+		else ++draws;
+	}
+}
+
+int TournamentStats::pairCount() const
+{
+	return pairs[0] + pairs[1] + pairs[2] + pairs[3] + pairs[4];
+}
+
+int TournamentStats::games() const
+{
+	return wins + losses + draws;
+}
+
+double TournamentStats::score() const
+{
+	int count = pairCount();
+	if (count == 0)
+	{
+		return 0.5;
+	}
+	double total = 0;
+	for (int i = 0; i < 5; ++i)
+	{
+		total += pairs[i] * (i / 4.0);
+	}
+	return total / count;
+}
+
+double TournamentStats::variance() const
+{
+	int count = pairCount();
+	if (count == 0)
+	{
+		return 0;
+	}
+	double mean = score();
+	double meanSquare = 0;
+	for (int i = 0; i < 5; ++i)
+	{
+		meanSquare += pairs[i] * (i / 4.0) * (i / 4.0);
+	}
+	return std::max(0.0, meanSquare / count - mean * mean);
+}
+
+double TournamentStats::elo() const
+{
+	return scoreToElo(score());
+}
+
+double TournamentStats::eloMargin(double z) const
+{
+	int count = pairCount();
+	if (count == 0)
+	{
+		return 0;
+	}
+	// Map the score's interval through the Elo curve, which isn't symmetric away from 0.5
+	double spread = z * std::sqrt(variance() / count);
+	return (scoreToElo(score() + spread) - scoreToElo(score() - spread)) / 2;
+}
+
+double TournamentStats::llr(double elo0, double elo1) const
+{
+	double var = variance();
+	if (var <= 0)
+	{
+		return 0; // Nothing to go on until the pairs differ
+	}
+	double score0 = eloToScore(elo0);
+	double score1 = eloToScore(elo1);
+	return pairCount() * (score1 - score0) * (2 * score() - score0 - score1) / (2 * var);
+}
+
+double TournamentStats::eloToScore(double elo)
+{
+	return 1 / (1 + std::pow(10.0, -elo / 400));
+}
+
+double TournamentStats::scoreToElo(double score)
+{
+	score = std::min(1 - MIN_SCORE, std::max(MIN_SCORE, score));
+	return -400 * std::log10(1 / score - 1);
+}
+
+Tournament::Tournament(const TournamentSettings& settings) :
+	m_settings(settings), m_nextPair(0), m_stop(false) {}
+
+AI* Tournament::createAI(const std::string& spec, unsigned seed)
+{
+	size_t colon = spec.find(':');
+	std::string name = spec.substr(0, colon);
+	int strength = colon == std::string::npos ? 0 : atoi(spec.c_str() + colon + 1);
+	if (colon != std::string::npos && strength <= 0)
+	{
+		return nullptr;
+	}
+
+	// Only search takes a thread count, as a second setting after another colon
+	size_t second = colon == std::string::npos ? colon : spec.find(':', colon + 1);
+	int threads = second == std::string::npos ? 1 : atoi(spec.c_str() + second + 1);
+	if (second != std::string::npos && (name != "search" || threads <= 0))
+	{
+		return nullptr;
+	}
+
+	if (name == "search" && strength > 0)
+	{
+		return new SearchAI(strength, 8, "groundwar.gwt", "groundwar.gwb", threads);
+	}
+	if (name == "planner")
+	{
+		return strength > 0 ? new PlannerAI(seed, 1, strength) : new PlannerAI(seed, 1);
+	}
+	if (name == "net")
+	{
+		return strength > 0 ? new NetAI(seed, strength, 1) : new NetAI(seed, 256, 1);
+	}
+	if (strength > 0 && name != "random")
+	{
+		return nullptr;
+	}
+	return AI::create(name, seed);
+}
+
+bool Tournament::run(const std::function<void(const TournamentStats&)>& progress)
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		AI* check = createAI(i == 0 ? m_settings.first : m_settings.second, 0);
+		if (!check)
+		{
+			return false;
+		}
+		delete check;
+	}
+
+	ThreadPool pool(m_settings.threads);
+	Tournament* self = this;
+	for (unsigned i = 0; i < pool.size(); ++i)
+	{
+		pool.submit([self, &progress]() { self->worker(progress); });
+	}
+	pool.wait();
+	return true;
+}
+
+void Tournament::stop()
+{
+	m_stop = true;
+}
+
+TournamentStats Tournament::stats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+Tournament::Verdict Tournament::verdict()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_verdict;
+}
+
+void Tournament::worker(const std::function<void(const TournamentStats&)>& progress)
+{
+	double lower = std::log(m_settings.beta / (1 - m_settings.alpha));
+	double upper = std::log((1 - m_settings.beta) / m_settings.alpha);
+	while (!m_stop)
+	{
+		int index = m_nextPair++;
+		if (index >= m_settings.maxPairs)
+		{
+			return;
+		}
+		double first, second;
+		playPair(index, first, second);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.addPair(first, second);
+		if (m_settings.sprt && m_verdict == UNDECIDED)
+		{
+			double llr = m_stats.llr(m_settings.elo0, m_settings.elo1);
+			if (llr >= upper || llr <= lower)
+			{
+				m_verdict = llr >= upper ? ACCEPTED : REJECTED;
+				m_stop = true;
+			}
+		}
+		if (progress)
+		{
+			progress(m_stats);
+		}
+	}
+}
+
+void Tournament::playPair(int index, double& first, double& second)
+{
+	unsigned seed = pairSeed(m_settings.seed, (unsigned)index);
+	unsigned firstSeed = pairSeed(seed, 1);
+	unsigned secondSeed = pairSeed(seed, 2);
+
+	// Fresh AIs for each game, so nothing learned in the first game carries over
+	AI* red = createAI(m_settings.first, firstSeed);
+	AI* blue = createAI(m_settings.second, secondSeed);
+	first = gameScore(playGame(m_settings.rules, *red, *blue, seed, m_settings.maxTurns), RED);
+	delete red;
+	delete blue;
+
+	red = createAI(m_settings.second, secondSeed);
+	blue = createAI(m_settings.first, firstSeed);
+	second = gameScore(playGame(m_settings.rules, *red, *blue, seed, m_settings.maxTurns), BLUE);
+	delete red;
+	delete blue;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include "AI.h"
+#include "Rules.h"
+
+/*
+Results of a tournament between two AIs, from the first one's point of view. Games are
+played in pairs, one with each AI as red, so most of the luck of the map and the combat
+rolls cancels out within a pair. Pairs are what the statistics are done on: each one is
+worth 0, 0.5, 1, 1.5 or 2 points to the first AI (a pentanomial), and pairs are much less
+spread out than single games would be.
+*/
+struct TournamentStats
+{
+	int pairs[5]; // Number of pairs by the first AI's points, in half points
+	int wins;
+	int losses;
+	int draws;
+
+	TournamentStats();
+
+	/*
+	Adds a pair, given the first AI's score in each of its games: 1 for a win, 0.5 for a
+	draw and 0 for a loss.
+	*/
+	void addPair(double first, double second);
+
+	int pairCount() const;
+	int games() const;
+
+	/*
+	The first AI's average score per game, and its variance per pair (of the average
+	over the pair).
+	*/
+	double score() const;
+	double variance() const;
+
+	/*
+	Elo difference between the two AIs, and half the width of its confidence interval
+	for the given normal quantile (1.96 for 95%).
+	*/
+	double elo() const;
+	double eloMargin(double z = 1.96) const;
+
+	/*
+	Log-likelihood ratio that the first AI is elo1 stronger rather than elo0 stronger,
+	using the normal approximation to the generalized SPRT.
+	*/
+	double llr(double elo0, double elo1) const;
+
+	/*
+	Converts between an Elo difference and the expected score.
+	*/
+	static double eloToScore(double elo);
+	static double scoreToElo(double score);
+};
+
+/*
+Settings for a tournament. AIs are given as a name for AI::create, optionally followed by
+a colon and a strength setting: milliseconds per action for search, playouts per action
+for net, or positions kept per layer for planner, so "search:50" is a quicker search.
+Search can take a thread count after a second colon, so "search:100:4" searches on four
+threads; lower threads below to match, or the games will fight over the cores.
+*/
+struct TournamentSettings
+{
+	std::string first = "search";
+	std::string second = "random";
+	Rules rules = Rules::standard();
+	int maxPairs = 1000;
+	int maxTurns = 200; // Games that last longer than this are draws
+	unsigned seed = 1;
+	unsigned threads = 0; // 0 means all cores
+	bool sprt = false; // Stop as soon as the SPRT below is decided
+	double elo0 = 0;
+	double elo1 = 10;
+	double alpha = 0.05; // Chance of accepting elo1 when elo0 is true
+	double beta = 0.05; // Chance of accepting elo0 when elo1 is true
+};
+
+/*
+Plays pairs of games between two AIs across several threads. Both games of a pair use
+the same combat seed, so the two AIs face the same rolls from each side of the board.
+Every AI used in a game runs on one thread unless its spec asks for more, since the games
+themselves are spread over all of them.
+*/
+class Tournament
+{
+public:
+	enum Verdict
+	{
+		UNDECIDED, // Still going, or ran out of pairs before the SPRT was decided
+		ACCEPTED, // The first AI is at least elo1 stronger
+		REJECTED // The first AI is at most elo0 stronger
+	};
+
+	Tournament(const TournamentSettings& settings);
+
+	/*
+	Plays until maxPairs pairs are done or the SPRT is decided. progress, if given, is
+	called after every pair, on whichever thread played it but never two at once.
+	Returns false without playing if either AI can't be created.
+	*/
+	bool run(const std::function<void(const TournamentStats&)>& progress = nullptr);
+
+	/*
+	Stops run early, for instance from a progress callback. Games being played are
+	finished and counted.
+	*/
+	void stop();
+
+	TournamentStats stats();
+	Verdict verdict();
+
+	/*
+	Creates an AI from a name and optional strength setting, as in TournamentSettings.
+	Returns nullptr if there's no such AI.
+	*/
+	static AI* createAI(const std::string& spec, unsigned seed);
+
+private:
+	TournamentSettings m_settings;
+	std::mutex m_mutex;
+	TournamentStats m_stats;
+	Verdict m_verdict = UNDECIDED;
+	std::atomic<int> m_nextPair;
+	std::atomic<bool> m_stop;
+
+	/*
+	Plays one pair and returns the first AI's score in each game.
+	*/
+	void playPair(int index, double& first, double& second);
+	void worker(const std::function<void(const TournamentStats&)>& progress);
+};
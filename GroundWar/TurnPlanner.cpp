@@ -0,0 +1,203 @@
+#include "TurnPlanner.h"
+#include <algorithm>
+#include <unordered_set>
+
+TurnPlanner::TurnPlanner(unsigned threads, int maxPerLayer, unsigned seed) :
+	m_pool(threads), m_maxPerLayer(maxPerLayer), m_rng(seed)
+{
+	for (unsigned i = 0; i < m_pool.size(); ++i)
+	{
+		m_workers.push_back(new Worker());
+		m_workers.back()->board = nullptr;
+	}
+}
+
+TurnPlanner::~TurnPlanner()
+{
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i]->eval.detach();
+		delete m_workers[i]->board;
+		delete m_workers[i];
+	}
+}
+
+void TurnPlanner::setWeights(const EvalWeights& weights)
+{
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i]->eval.setWeights(weights);
+	}
+}
+
+int TurnPlanner::positions()
+{
+	return m_positions;
+}
+
+int TurnPlanner::duplicates()
+{
+	return m_duplicates;
+}
+
+int TurnPlanner::endings()
+{
+	return m_endings;
+}
+
+TurnPlan TurnPlanner::plan(Board& board)
+{
+	TurnPlan result;
+	result.value = 0;
+	m_nodes.clear();
+	m_positions = 1;
+	m_duplicates = 0;
+	m_endings = 0;
+	if (board.gameOver())
+	{
+		return result;
+	}
+
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		if (!m_workers[i]->board)
+		{
+			m_workers[i]->board = new Board(board.rules(), 0);
+			m_workers[i]->eval.attach(*m_workers[i]->board);
+		}
+		m_workers[i]->best.node = -1;
+		m_workers[i]->endings = 0;
+	}
+
+	Node root;
+	board.saveState(root.state);
+	root.parent = -1;
+	m_nodes.push_back(root);
+	const Player player = board.currentPlayer();
+	std::unordered_set<unsigned long long> seen;
+	seen.insert(root.state.hash());
+
+	int first = 0;
+	while (first < (int)m_nodes.size())
+	{
+		// Split the layer between the workers
+		const int last = (int)m_nodes.size();
+		const int chunk = (last - first + (int)m_workers.size() - 1) / (int)m_workers.size();
+		for (size_t i = 0; i < m_workers.size(); ++i)
+		{
+			Worker* worker = m_workers[i];
+			const int from = std::min(last, first + (int)i * chunk);
+			const int to = std::min(last, from + chunk);
+			worker->children.clear();
+			m_pool.submit([this, worker, from, to, player]()
+			{
+				expand(*worker, from, to, player);
+			});
+		}
+		m_pool.wait();
+
+		// Gather the next layer, dropping positions that have been reached already
+		std::vector<Node> next;
+		for (size_t i = 0; i < m_workers.size(); ++i)
+		{
+			std::vector<Node>& children = m_workers[i]->children;
+			for (size_t j = 0; j < children.size(); ++j)
+			{
+				if (seen.insert(children[j].state.hash()).second)
+				{
+					next.push_back(children[j]);
+				}
+				else
+				{
+					++m_duplicates;
+				}
+			}
+		}
+		if ((int)next.size() > m_maxPerLayer)
+		{
+			std::shuffle(next.begin(), next.end(), m_rng);
+			next.resize(m_maxPerLayer);
+		}
+		m_positions += (int)next.size();
+		first = last;
+		m_nodes.insert(m_nodes.end(), next.begin(), next.end());
+	}
+
+	// Pick the best ending, then walk back up to the root for the actions that lead there
+	const Ending* best = nullptr;
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_endings += m_workers[i]->endings;
+		const Ending& ending = m_workers[i]->best;
+		if (ending.node >= 0 && (!best || ending.value > best->value ||
+			(ending.value == best->value && ending.node < best->node)))
+		{
+			best = &ending;
+		}
+	}
+	if (!best)
+	{
+		return result;
+	}
+	result.value = best->value;
+	result.actions.push_back(best->action);
+	result.positions.push_back(m_nodes[best->node].state.hash());
+	for (int node = best->node; m_nodes[node].parent >= 0; node = m_nodes[node].parent)
+	{
+		result.actions.push_back(m_nodes[node].action);
+		result.positions.push_back(m_nodes[m_nodes[node].parent].state.hash());
+	}
+	std::reverse(result.actions.begin(), result.actions.end());
+	std::reverse(result.positions.begin(), result.positions.end());
+	return result;
+}
+
+void TurnPlanner::expand(Worker& worker, int first, int last, Player player)
+{
+	Board& board = *worker.board;
+	for (int i = first; i < last; ++i)
+	{
+		const BoardState& state = m_nodes[i].state;
+		board.loadState(state);
+		board.legalActions(worker.actions);
+		for (size_t j = 0; j < worker.actions.size(); ++j)
+		{
+			const Action& action = worker.actions[j];
+			board.loadState(state);
+			float value;
+			if (action.type == Action::ATTACK)
+			{
+				float odds = board.rules().odds[board.getTile(action.fromX, action.fromY)->unit()->type()]
+					[board.getTile(action.toX, action.toY)->unit()->type()];
+				board.doAction(action, true);
+				value = odds * worker.eval.score(player);
+				board.loadState(state);
+				board.doAction(action, false);
+				value += (1 - odds) * worker.eval.score(player);
+			}
+			else
+			{
+				board.doAction(action);
+				if (action.type != Action::END_TURN && !board.gameOver())
+				{
+					// Not the end of the plan, so it's a position for the next layer
+					Node child;
+					board.saveState(child.state);
+					child.parent = i;
+					child.action = action;
+					worker.children.push_back(child);
+					continue;
+				}
+				value = worker.eval.score(player);
+			}
+
+			++worker.endings;
+			if (worker.best.node < 0 || value > worker.best.value)
+			{
+				worker.best.node = i;
+				worker.best.action = action;
+				worker.best.value = value;
+			}
+		}
+	}
+}
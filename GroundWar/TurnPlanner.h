@@ -0,0 +1,99 @@
+#pragma once
+#include <random>
+#include <vector>
+#include "Board.h"
+#include "BoardState.h"
+#include "Evaluation.h"
+#include "ThreadPool.h"
+
+/*
+A plan for the rest of a turn.
+*/
+struct TurnPlan
+{
+	std::vector<Action> actions; // Ends by ending the turn, winning, or with an attack whose outcome has to be seen first
+	std::vector<unsigned long long> positions; // BoardState::hash of the position before each action
+	float value; // Expected evaluation once the plan is done, for the player making it
+};
+
+/*
+Plans a whole turn at once. Every move and spawn the current player could make is
+tried, one action deeper per layer, and a position reached by a different order of the
+same actions is only kept once (by BoardState::hash), which is where most of the
+sequences go. Any position can end the plan by ending the turn, and any attack ends the
+plan too, valued at both outcomes weighted by the odds, since there's no knowing what
+to do next until the dice are rolled. If a layer has more positions than the planner is
+allowed, it keeps a random sample of them.
+
+Each layer is split between the threads of a pool, each with its own scratch board and
+Evaluation, so expanding and scoring run in parallel.
+*/
+class TurnPlanner
+{
+public:
+	/*
+	Plans with the given number of threads (0 means one per hardware thread), keeping at
+	most maxPerLayer positions in each layer.
+	*/
+	TurnPlanner(unsigned threads = 0, int maxPerLayer = 2000, unsigned seed = 1);
+	~TurnPlanner();
+
+	/*
+	Finds the best plan for the current player on the given board, which isn't changed.
+	The plan is empty if the game is over.
+	*/
+	TurnPlan plan(Board& board);
+
+	void setWeights(const EvalWeights& weights);
+
+	/*
+	Stats for the last plan: distinct positions reached, sequences dropped because
+	another order of actions had already reached their position, and plan endings scored.
+	*/
+	int positions();
+	int duplicates();
+	int endings();
+
+private:
+	struct Node
+	{
+		BoardState state;
+		int parent; // Index in m_nodes, -1 for the root
+		Action action; // What the parent did to get here
+	};
+
+	/*
+	An ending found by a worker: a node, plus the action that ends the plan from there.
+	*/
+	struct Ending
+	{
+		int node;
+		Action action;
+		float value;
+	};
+
+	struct Worker
+	{
+		Board* board;
+		Evaluation eval;
+		std::vector<Action> actions;
+		std::vector<Node> children;
+		Ending best;
+		int endings;
+	};
+
+	ThreadPool m_pool;
+	std::vector<Worker*> m_workers;
+	int m_maxPerLayer;
+	std::mt19937 m_rng; // For sampling layers that are too big
+	std::vector<Node> m_nodes; // Every position kept, layer after layer
+	int m_positions = 0;
+	int m_duplicates = 0;
+	int m_endings = 0;
+
+	/*
+	Expands the nodes from first to last on the given worker, scoring every ending and
+	collecting the positions one move or spawn further on.
+	*/
+	void expand(Worker& worker, int first, int last, Player player);
+};
@@ -0,0 +1,382 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Tools.h"
+#include "Board.h"
+#include "RandomAI.h"
+#include "SelfPlay.h"
+#include "PlayoutBatch.h"
+#include "Evaluation.h"
+#include "PathFinder.h"
+#include "Replay.h"
+#include "SearchAI.h"
+#include "TurnPlanner.h"
+#include "PolicyNet.h"
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/*
+Random playouts through Board and RandomAI, one game at a time.
+*/
+static double boardPlayoutRate(double seconds, int maxTurns)
+{
+	Rules rules = Rules::standard();
+	RandomAI red(1), blue(2);
+	int games = 0;
+	Clock::time_point start = Clock::now();
+	while (secondsSince(start) < seconds)
+	{
+		playGame(rules, red, blue, (unsigned)games, maxTurns);
+		++games;
+	}
+	return games / secondsSince(start);
+}
+
+/*
+Random playouts through PlayoutBatch, with or without the SIMD kernels.
+*/
+static double batchPlayoutRate(double seconds, int maxTurns, bool simd)
+{
+	Board board;
+	PlayoutBatch batch(256, 1);
+	batch.setUseSimd(simd);
+	batch.load(board);
+	long long games = 0;
+	Clock::time_point start = Clock::now();
+	while (secondsSince(start) < seconds)
+	{
+		batch.run(maxTurns);
+		games += batch.lanes();
+	}
+	return games / secondsSince(start);
+}
+
+/*
+Nanoseconds per Evaluation::score call, and per incremental update from a move.
+*/
+static void evaluationCost(double seconds, double& scoreNs, double& updateNs)
+{
+	Board board;
+	board.doAction(Action::spawn(Unit::TANK, 0, 7));
+	Evaluation eval;
+	eval.attach(board);
+
+	volatile float sink = 0;
+	long long calls = 0;
+	Clock::time_point start = Clock::now();
+	while (secondsSince(start) < seconds / 2)
+	{
+		for (int i = 0; i < 100000; ++i)
+		{
+			sink = sink + eval.score(Player(i & 1));
+		}
+		calls += 100000;
+	}
+	scoreNs = secondsSince(start) * 1e9 / calls;
+
+	// Shuffle a tile's contents back and forth; each change is one incremental update
+	Tile* tile = board.getTile(0, 7);
+	calls = 0;
+	start = Clock::now();
+	while (secondsSince(start) < seconds / 2)
+	{
+		for (int i = 0; i < 100000; ++i)
+		{
+			eval.tileChanged(board, tile->x(), tile->y());
+		}
+		calls += 100000;
+	}
+	updateNs = secondsSince(start) * 1e9 / calls;
+}
+
+/*
+Nanoseconds per route search across the whole board, which is what hovering costs.
+*/
+static double pathCost(double seconds)
+{
+	Board board;
+	board.doAction(Action::spawn(Unit::TANK, 0, 7));
+	PathFinder paths;
+	Tile* from = board.getTile(0, 7);
+	Tile* to = board.getTile(11, 1);
+
+	long long calls = 0;
+	Clock::time_point start = Clock::now();
+	while (secondsSince(start) < seconds)
+	{
+		for (int i = 0; i < 1000; ++i)
+		{
+			paths.find(board, from, to, 1000); // Big enough budget to reach anywhere
+		}
+		calls += 1000;
+	}
+	return secondsSince(start) * 1e9 / calls;
+}
+
+/*
+Nanoseconds per jump to a random point in a long replay, with and without the snapshot index.
+*/
+static double replaySeekCost(double seconds, int snapshotInterval, int& length)
+{
+	RandomAI red(1), blue(2);
+	std::vector<unsigned char> records;
+	playGame(Rules::standard(), red, blue, 3, 2000, &records);
+	Board board;
+	Replay replay(board, snapshotInterval);
+	replay.load(records);
+	length = replay.length();
+
+	unsigned position = 12345;
+	long long calls = 0;
+	Clock::time_point start = Clock::now();
+	while (secondsSince(start) < seconds)
+	{
+		for (int i = 0; i < 100; ++i)
+		{
+			position = position * 1103515245u + 12345u;
+			replay.seek((int)(position >> 8) % (length + 1));
+		}
+		calls += 100;
+	}
+	return secondsSince(start) * 1e9 / calls;
+}
+
+/*
+Depth SearchAI reaches in 100 ms on its first action of a turn, with and without having
+pondered the turn before it for the given number of seconds. The other player is a
+shallow search, so it plays the way pondering guesses it will.
+*/
+static void ponderDepth(double seconds, double& fresh, double& pondered)
+{
+	const int positions = 4;
+	fresh = pondered = 0;
+	for (int i = 0; i < positions; ++i)
+	{
+		Board board(Rules::standard(), i);
+		RandomAI random(i);
+		for (int j = 0; j < 10 + i || board.currentPlayer() != RED; ++j)
+		{
+			board.doAction(random.chooseAction(board));
+		}
+
+		SearchAI withPonder(100), without(100), other(20, 2);
+		std::atomic<bool> stop(false);
+		std::thread ponderer([&]()
+		{
+			withPonder.ponder(board, stop);
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds((int)(seconds / positions * 1000)));
+		stop = true;
+		ponderer.join();
+
+		while (board.currentPlayer() == RED && !board.gameOver())
+		{
+			board.doAction(other.chooseAction(board), true);
+		}
+		without.chooseAction(board);
+		withPonder.chooseAction(board);
+		fresh += (double)without.depth() / positions;
+		pondered += (double)withPonder.depth() / positions;
+	}
+}
+
+/*
+Milliseconds for SearchAI to search a few midgame positions to the given depth on the
+given number of threads, and the average depth it finishes in 100 ms.
+*/
+static double searchCost(unsigned threads, int depth, double& depthIn100)
+{
+	const int positions = 4;
+	double milliseconds = 0;
+	depthIn100 = 0;
+	for (int i = 0; i < positions; ++i)
+	{
+		Board board(Rules::standard(), i);
+		RandomAI random(i);
+		for (int j = 0; j < 30 + i * 10 || board.currentPlayer() != RED; ++j)
+		{
+			board.doAction(random.chooseAction(board));
+		}
+
+		SearchAI fixed(1000000, depth, nullptr, nullptr, threads);
+		Clock::time_point start = Clock::now();
+		fixed.chooseAction(board);
+		milliseconds += secondsSince(start) * 1000 / positions;
+
+		SearchAI timed(100, 64, nullptr, nullptr, threads);
+		timed.chooseAction(board);
+		depthIn100 += (double)timed.depth() / positions;
+	}
+	return milliseconds;
+}
+
+/*
+How far past its hard limit SearchAI goes, in milliseconds, at the given percentiles (out
+of 1) over every action of games played with the given time per turn. Negative when
+it stopped early.
+*/
+static void deadlineOvershoot(double seconds, int turnMilliseconds, unsigned threads, const double* percentiles,
+	int count, double* overshoot, int& actions)
+{
+	std::vector<double> samples;
+	Clock::time_point start = Clock::now();
+	for (unsigned game = 0; secondsSince(start) < seconds; ++game)
+	{
+		Board board(Rules::standard(), game);
+		SearchAI red(100, 64, nullptr, nullptr, threads), blue(100, 64, nullptr, nullptr, threads);
+		red.setTurnTime(turnMilliseconds);
+		blue.setTurnTime(turnMilliseconds);
+		for (int i = 0; i < 400 && !board.gameOver() && secondsSince(start) < seconds; ++i)
+		{
+			SearchAI& ai = board.currentPlayer() == RED ? red : blue;
+			Clock::time_point actionStart = Clock::now();
+			Action action = ai.chooseAction(board);
+			samples.push_back(secondsSince(actionStart) * 1000 - ai.timeManager().hardLimit());
+			board.doAction(action, true);
+		}
+	}
+	std::sort(samples.begin(), samples.end());
+	actions = (int)samples.size();
+	for (int i = 0; i < count; ++i)
+	{
+		overshoot[i] = samples.empty() ? 0 : samples[std::min(samples.size() - 1, (size_t)(percentiles[i] * samples.size()))];
+	}
+}
+
+/*
+Milliseconds to plan the opening turn, with the given number of threads.
+*/
+static double planCost(double seconds, unsigned threads, int& positions, int& duplicates)
+{
+	Board board;
+	TurnPlanner planner(threads);
+	int plans = 0;
+	Clock::time_point start = Clock::now();
+	while (plans == 0 || secondsSince(start) < seconds)
+	{
+		planner.plan(board);
+		++plans;
+	}
+	positions = planner.positions();
+	duplicates = planner.duplicates();
+	return secondsSince(start) * 1000 / plans;
+}
+
+/*
+Microseconds per position for the network, evaluating the given number at once.
+*/
+static double netCost(double seconds, int batch, PolicyNet::Precision precision, bool simd)
+{
+	PolicyNet net;
+	net.setPrecision(precision);
+	net.setUseSimd(simd);
+	Board board;
+	std::vector<BoardState> states(batch);
+	std::vector<NetOutput> outputs(batch);
+	for (int i = 0; i < batch; ++i)
+	{
+		board.saveState(states[i]);
+		states[i].money[RED] += i; // Not all the same position
+	}
+	long long positions = 0;
+	Clock::time_point start = Clock::now();
+	while (positions == 0 || secondsSince(start) < seconds)
+	{
+		net.evaluate(&states[0], batch, &outputs[0]);
+		positions += batch;
+	}
+	return secondsSince(start) * 1e6 / positions;
+}
+
+int benchMain(int argc, char** argv)
+{
+	double seconds = argc > 0 ? atof(argv[0]) : 2.0;
+	const int maxTurns = 200;
+
+	std::cout << "Random playouts per second (single thread, " << maxTurns << " turn limit):" << std::endl;
+	double board = boardPlayoutRate(seconds, maxTurns);
+	std::cout << "  Board + RandomAI      " << board << std::endl;
+	double scalar = batchPlayoutRate(seconds, maxTurns, false);
+	std::cout << "  PlayoutBatch scalar   " << scalar << "  (" << scalar / board << "x)" << std::endl;
+	if (PlayoutBatch::simdAvailable())
+	{
+		double simd = batchPlayoutRate(seconds, maxTurns, true);
+		std::cout << "  PlayoutBatch AVX2     " << simd << "  (" << simd / board << "x)" << std::endl;
+	}
+	else
+	{
+		std::cout << "  PlayoutBatch AVX2     not supported on this CPU" << std::endl;
+	}
+
+	double scoreNs, updateNs;
+	evaluationCost(seconds, scoreNs, updateNs);
+	std::cout << "Evaluation:" << std::endl
+		<< "  score                 " << scoreNs << " ns" << std::endl
+		<< "  tile update           " << updateNs << " ns" << std::endl;
+	std::cout << "Path preview:" << std::endl
+		<< "  route across board    " << pathCost(seconds) << " ns" << std::endl;
+	int length;
+	double indexed = replaySeekCost(seconds / 2, 64, length);
+	double unindexed = replaySeekCost(seconds / 2, 1 << 30, length);
+	std::cout << "Replay seek (" << length << " actions):" << std::endl
+		<< "  snapshot every 64     " << indexed << " ns" << std::endl
+		<< "  from the start        " << unindexed << " ns" << std::endl;
+	double fresh, pondered;
+	ponderDepth(seconds, fresh, pondered);
+	std::cout << "SearchAI depth in 100 ms:" << std::endl
+		<< "  without pondering     " << fresh << std::endl
+		<< "  after pondering       " << pondered << std::endl;
+	const int searchDepth = 8;
+	std::cout << "SearchAI Lazy SMP (time to depth " << searchDepth << ", and depth in 100 ms):" << std::endl;
+	double single = 0;
+	for (unsigned threads = 1; threads <= std::max(1u, std::thread::hardware_concurrency()); threads *= 2)
+	{
+		double depthIn100;
+		double milliseconds = searchCost(threads, searchDepth, depthIn100);
+		single = threads == 1 ? milliseconds : single;
+		std::cout << "  " << threads << (threads == 1 ? " thread " : " threads") << "             " << milliseconds
+			<< " ms  (" << single / milliseconds << "x)  depth " << depthIn100 << std::endl;
+	}
+	const int turnMilliseconds = 20;
+	const double percentiles[] = { 0.5, 0.99, 0.999, 1 };
+	const char* percentileNames[] = { "median", "99th percentile", "99.9th percentile", "worst" };
+	const int percentileCount = sizeof(percentiles) / sizeof(percentiles[0]);
+	for (unsigned threads = 1; threads <= std::min(2u, std::max(1u, std::thread::hardware_concurrency())); ++threads)
+	{
+		double overshoot[percentileCount];
+		int actions;
+		deadlineOvershoot(seconds, turnMilliseconds, threads, percentiles, percentileCount, overshoot, actions);
+		std::cout << "SearchAI past its hard limit (" << turnMilliseconds << " ms turns, " << threads
+			<< (threads == 1 ? " thread, " : " threads, ") << actions << " actions):" << std::endl;
+		for (int i = 0; i < percentileCount; ++i)
+		{
+			std::cout << "  " << percentileNames[i] << std::string(22 - strlen(percentileNames[i]), ' ')
+				<< overshoot[i] << " ms" << std::endl;
+		}
+	}
+	int positions, duplicates;
+	double oneThread = planCost(seconds / 2, 1, positions, duplicates);
+	double allThreads = planCost(seconds / 2, 0, positions, duplicates);
+	std::cout << "Turn planner (" << positions << " positions, " << duplicates << " duplicate orders dropped):" << std::endl
+		<< "  1 thread              " << oneThread << " ms" << std::endl
+		<< "  " << std::thread::hardware_concurrency() << " threads             " << allThreads << " ms" << std::endl;
+	std::cout << "PolicyNet per position:" << std::endl;
+	for (int simd = 0; simd <= (PlayoutBatch::simdAvailable() ? 1 : 0); ++simd)
+	{
+		const char* kernel = simd ? "AVX2  " : "scalar";
+		std::cout << "  float " << kernel << " batch 1  " << netCost(seconds / 6, 1, PolicyNet::FLOAT, simd != 0) << " us" << std::endl
+			<< "  float " << kernel << " batch 16 " << netCost(seconds / 6, 16, PolicyNet::FLOAT, simd != 0) << " us" << std::endl
+			<< "  int8  " << kernel << " batch 16 " << netCost(seconds / 6, 16, PolicyNet::INT8, simd != 0) << " us" << std::endl;
+	}
+	return 0;
+}
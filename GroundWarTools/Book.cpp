@@ -0,0 +1,149 @@
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Tools.h"
+#include "SelfPlay.h"
+#include "OpeningBook.h"
+#include "Tournament.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*
+Plays like the AI it wraps, except that in the opening it sometimes takes a random
+action instead, so games spread out over more openings. Remembers every opening
+position and the action taken.
+*/
+class OpeningRecorder :
+	public AI
+{
+public:
+	OpeningRecorder(AI* ai, unsigned seed, int turns, float explore) :
+		m_ai(ai), m_rng(seed), m_turns(turns), m_explore(explore) {}
+
+	~OpeningRecorder()
+	{
+		delete m_ai;
+	}
+
+	Action chooseAction(Board& board)
+	{
+		if (board.turn() >= m_turns)
+		{
+			return m_ai->chooseAction(board);
+		}
+		Action action;
+		board.legalActions(m_legal);
+		if (!m_legal.empty() && std::uniform_real_distribution<float>(0, 1)(m_rng) < m_explore)
+		{
+			action = m_legal[std::uniform_int_distribution<size_t>(0, m_legal.size() - 1)(m_rng)];
+		}
+		else
+		{
+			action = m_ai->chooseAction(board);
+		}
+		states.push_back(BoardState());
+		board.saveState(states.back());
+		actions.push_back(action);
+		return action;
+	}
+
+	const char* name()
+	{
+		return m_ai->name();
+	}
+
+	std::vector<BoardState> states;
+	std::vector<Action> actions;
+
+private:
+	AI* m_ai;
+	std::mt19937 m_rng;
+	int m_turns;
+	float m_explore;
+	std::vector<Action> m_legal;
+};
+
+int bookMain(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		std::cout << "Usage: GroundWarTools book <file> [games] [turns] [threads] [AI] [seed] [min games]" << std::endl;
+		return 1;
+	}
+	const char* path = argv[0];
+	const int games = argc > 1 ? atoi(argv[1]) : 200;
+	const int turns = argc > 2 ? atoi(argv[2]) : 4;
+	const int workers = argc > 3 && atoi(argv[3]) > 0 ? atoi(argv[3]) : (int)std::max(1u, std::thread::hardware_concurrency());
+	const std::string ai = argc > 4 ? argv[4] : "search:20";
+	const unsigned seed = argc > 5 ? (unsigned)strtoul(argv[5], nullptr, 10) : 1;
+	const int minGames = argc > 6 ? atoi(argv[6]) : 2;
+	const int maxTurns = 200;
+	const float explore = 0.2f;
+
+	AI* check = Tournament::createAI(ai, 0);
+	if (!check)
+	{
+		std::cout << "Unknown AI: " << ai << std::endl;
+		return 1;
+	}
+	delete check;
+
+	// Each worker fills its own builder, and they're merged at the end
+	const Rules rules = Rules::standard();
+	std::vector<OpeningBookBuilder> builders(workers, OpeningBookBuilder(rules));
+	std::atomic<int> nextGame(0);
+	std::atomic<long long> recorded(0);
+	Clock::time_point start = Clock::now();
+	std::vector<std::thread> threads;
+	for (int w = 0; w < workers; ++w)
+	{
+		threads.push_back(std::thread([&, w]()
+		{
+			for (int g = nextGame++; g < games; g = nextGame++)
+			{
+				unsigned gameSeed = mixSeed(seed, g, 0);
+				OpeningRecorder red(Tournament::createAI(ai, mixSeed(gameSeed, 1, 0)), mixSeed(gameSeed, 1, 1), turns, explore);
+				OpeningRecorder blue(Tournament::createAI(ai, mixSeed(gameSeed, 2, 0)), mixSeed(gameSeed, 2, 1), turns, explore);
+				GameResult result = playGame(rules, red, blue, gameSeed, maxTurns);
+
+				OpeningRecorder* sides[2] = { &red, &blue };
+				for (int p = 0; p < 2; ++p)
+				{
+					OpeningRecorder& side = *sides[p];
+					float score = !result.decided ? 0.5f : result.winner == p ? 1.0f : 0.0f;
+					for (size_t i = 0; i < side.states.size(); ++i)
+					{
+						builders[w].add(side.states[i], side.actions[i], score);
+					}
+					recorded += side.states.size();
+				}
+			}
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); ++i)
+	{
+		threads[i].join();
+	}
+
+	OpeningBookBuilder& book = builders[0];
+	for (int w = 1; w < workers; ++w)
+	{
+		book.merge(builders[w]);
+	}
+	if (!book.save(path, minGames))
+	{
+		std::cout << "Couldn't write " << path << std::endl;
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	OpeningBook saved;
+	saved.load(path);
+	std::cout << games << " games in " << seconds << " s, " << recorded << " opening actions over "
+		<< book.positions() << " positions, " << saved.positions() << " kept with " << minGames << "+ games" << std::endl;
+	return 0;
+}
@@ -0,0 +1,296 @@
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include "Tools.h"
+#include "Server.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*
+One connection playing both sides of one match, with just enough of a view of the board
+to make mostly sensible random actions.
+*/
+struct LoadGame
+{
+	Socket socket = NO_SOCKET;
+	std::string in;
+	int owner[BOARD_WIDTH][BOARD_HEIGHT]; // Player with a unit on the tile, -1 if none
+	Player player = RED;
+	int movementPoints = 0;
+	bool over = false;
+};
+
+/*
+Reads lines until the answer to the last command, keeping the game's view up to date.
+After a join, the answer is the state line that ends the board dump. Returns false if
+the connection broke. Sets ok to whether the command worked, and match to the id from
+a "match" answer.
+*/
+static bool readAnswer(LoadGame& game, bool joining, bool& ok, int& match)
+{
+	std::string line;
+	char buffer[4096];
+	while (true)
+	{
+		while (netTakeLine(game.in, line))
+		{
+			std::istringstream words(line);
+			std::string word;
+			words >> word;
+			if (word == "tile")
+			{
+				int x, y;
+				std::string contents;
+				words >> x >> y >> contents;
+				game.owner[x][y] = contents[0] == 'r' ? RED : contents[0] == 'b' ? BLUE : -1;
+			}
+			else if (word == "state")
+			{
+				int turn, red, blue;
+				std::string player, winner;
+				words >> turn >> player >> game.movementPoints >> red >> blue >> winner;
+				game.player = player == "red" ? RED : BLUE;
+				game.over = winner != "-";
+				if (joining)
+				{
+					ok = true;
+					return true;
+				}
+			}
+			else if (word == "match")
+			{
+				words >> match;
+				ok = true;
+				return true;
+			}
+			else if (word == "ok" || word == "error")
+			{
+				ok = word == "ok";
+				return true;
+			}
+		}
+		int received = netRecv(game.socket, buffer, sizeof(buffer));
+		if (received < 0)
+		{
+			return false;
+		}
+		game.in.append(buffer, received);
+	}
+}
+
+/*
+Starts a new match on the game's connection and joins it as both players.
+*/
+static bool startMatch(LoadGame& game)
+{
+	bool ok;
+	int match = -1;
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			game.owner[x][y] = -1;
+		}
+	}
+	if (!netSendAll(game.socket, "new\n") || !readAnswer(game, false, ok, match) || match < 0)
+	{
+		return false;
+	}
+	std::ostringstream join;
+	join << "join " << match << " both\n";
+	return netSendAll(game.socket, join.str()) && readAnswer(game, true, ok, match) && ok;
+}
+
+/*
+Picks a random action that has a fair chance of being legal.
+*/
+static Action randomAction(Board& map, LoadGame& game, std::mt19937& rng)
+{
+	int roll = rng() % 10;
+	if (game.movementPoints == 0 || roll == 0)
+	{
+		return Action::endTurn();
+	}
+
+	std::vector<int> units;
+	for (int x = 0; x < BOARD_WIDTH; ++x)
+	{
+		for (int y = 0; y < BOARD_HEIGHT; ++y)
+		{
+			if (game.owner[x][y] == game.player)
+			{
+				units.push_back(x * BOARD_HEIGHT + y);
+			}
+		}
+	}
+
+	if (roll < 4 || units.empty())
+	{
+		std::vector<int> spawns;
+		for (int x = 0; x < BOARD_WIDTH; ++x)
+		{
+			for (int y = 0; y < BOARD_HEIGHT; ++y)
+			{
+				Tile* tile = map.getTile(x, y);
+				if (tile && game.owner[x][y] < 0 && tile->spawnableFor(game.player))
+				{
+					spawns.push_back(x * BOARD_HEIGHT + y);
+				}
+			}
+		}
+		if (spawns.empty())
+		{
+			return Action::endTurn();
+		}
+		int tile = spawns[rng() % spawns.size()];
+		return Action::spawn(Unit::UnitType(rng() % UNIT_TYPES), tile / BOARD_HEIGHT, tile % BOARD_HEIGHT);
+	}
+
+	int tile = units[rng() % units.size()];
+	int x = tile / BOARD_HEIGHT, y = tile % BOARD_HEIGHT, toX, toY;
+	if (!Board::adjacentPosition(x, y, rng() % 6, toX, toY) || !map.getTile(toX, toY))
+	{
+		return Action::endTurn();
+	}
+	if (game.owner[toX][toY] < 0)
+	{
+		return Action::move(x, y, toX, toY);
+	}
+	return game.owner[toX][toY] == game.player ? Action::endTurn() : Action::attack(x, y, toX, toY);
+}
+
+/*
+Plays the given games in turn, one command in flight at a time, recording the round
+trip of every action in microseconds.
+*/
+static void loadWorker(int port, int games, int actions, unsigned seed, std::vector<double>& latencies, int& accepted, bool& failed)
+{
+	std::mt19937 rng(seed);
+	Board map; // Only used for the terrain
+	std::vector<LoadGame> loads(games);
+	for (int i = 0; i < games; ++i)
+	{
+		loads[i].socket = netConnect(port);
+		if (loads[i].socket == NO_SOCKET || !startMatch(loads[i]))
+		{
+			failed = true;
+			return;
+		}
+	}
+
+	for (int round = 0; round < actions; ++round)
+	{
+		for (int i = 0; i < games; ++i)
+		{
+			LoadGame& game = loads[i];
+			if (game.over && !startMatch(game))
+			{
+				failed = true;
+				return;
+			}
+
+			std::string command = randomAction(map, game, rng).toString() + "\n";
+			bool ok;
+			int match;
+			Clock::time_point start = Clock::now();
+			if (!netSendAll(game.socket, command) || !readAnswer(game, false, ok, match))
+			{
+				failed = true;
+				return;
+			}
+			latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+			accepted += ok;
+		}
+	}
+
+	for (int i = 0; i < games; ++i)
+	{
+		netClose(loads[i].socket);
+	}
+}
+
+int loadMain(int argc, char** argv)
+{
+	int matches = argc > 0 ? atoi(argv[0]) : 200;
+	int actions = argc > 1 ? atoi(argv[1]) : 100;
+	int threads = argc > 2 ? atoi(argv[2]) : 4;
+	int port = argc > 3 ? atoi(argv[3]) : 0;
+	if (matches < 1 || actions < 1 || threads < 1)
+	{
+		std::cout << "Usage: load [matches] [actions per match] [client threads] [port]" << std::endl;
+		return 1;
+	}
+	threads = std::min(threads, matches);
+	if (!netInit())
+	{
+		std::cout << "Can't start up sockets" << std::endl;
+		return 1;
+	}
+
+	// Without a port, test against a server in this process
+	GameServer* server = nullptr;
+	std::thread serverThread;
+	if (port == 0)
+	{
+		server = new GameServer(0, 1);
+		if (!server->listen(0))
+		{
+			std::cout << "Can't start a server" << std::endl;
+			delete server;
+			return 1;
+		}
+		port = server->port();
+		serverThread = std::thread([server]() { server->run(); });
+	}
+
+	std::vector<std::vector<double>> latencies(threads);
+	std::vector<int> accepted(threads, 0);
+	std::vector<char> failed(threads, 0);
+	std::vector<std::thread> workers;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < threads; ++i)
+	{
+		int games = matches / threads + (i < matches % threads ? 1 : 0);
+		workers.push_back(std::thread([=, &latencies, &accepted, &failed]()
+		{
+			bool broke = false;
+			loadWorker(port, games, actions, mixSeed(12345, i, 0), latencies[i], accepted[i], broke);
+			failed[i] = broke;
+		}));
+	}
+	for (size_t i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	if (server)
+	{
+		server->stop();
+		serverThread.join();
+		delete server;
+	}
+
+	std::vector<double> all;
+	int ok = 0;
+	for (int i = 0; i < threads; ++i)
+	{
+		all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+		ok += accepted[i];
+		if (failed[i])
+		{
+			std::cout << "A client lost its connection" << std::endl;
+			return 1;
+		}
+	}
+	std::sort(all.begin(), all.end());
+	std::cout << matches << " matches, " << all.size() << " actions (" << ok << " accepted) in "
+		<< seconds << " s, " << all.size() / seconds << " actions/s" << std::endl
+		<< "Round trip: median " << all[all.size() / 2] << " us, 99% " << all[all.size() * 99 / 100]
+		<< " us, max " << all.back() << " us" << std::endl;
+	return 0;
+}
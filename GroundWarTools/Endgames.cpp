@@ -0,0 +1,35 @@
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include "Tools.h"
+#include "Tablebase.h"
+
+typedef std::chrono::steady_clock Clock;
+
+int tablebaseMain(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		std::cout << "Usage: GroundWarTools tablebase <file> [threads]" << std::endl;
+		return 1;
+	}
+	unsigned threads = argc > 1 ? (unsigned)atoi(argv[1]) : 0;
+
+	Tablebase table;
+	Clock::time_point start = Clock::now();
+	table.build(Rules::standard(), threads, [](int turns, float change)
+	{
+		if (turns % 10 == 0)
+		{
+			std::cout << "Turn " << turns << ": values changed by up to " << change << std::endl;
+		}
+	});
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	if (!table.save(argv[0]))
+	{
+		std::cout << "Couldn't write " << argv[0] << std::endl;
+		return 1;
+	}
+	std::cout << "Solved " << Tablebase::positions() << " positions in " << seconds << " s" << std::endl;
+	return 0;
+}
@@ -0,0 +1,38 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "Tools.h"
+#include "EngineProtocol.h"
+
+int engineMain(int argc, char** argv)
+{
+	EngineProtocol engine;
+	std::string reply;
+	reply.reserve(4096);
+
+	// Output is fully buffered and flushed once per command, so each reply is one write
+	static char outBuffer[1 << 16];
+	setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));
+
+	static char line[1 << 16];
+	while (fgets(line, sizeof(line), stdin))
+	{
+		size_t length = strlen(line);
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+		{
+			line[--length] = '\0';
+		}
+		reply.clear();
+		bool more = engine.handle(line, reply);
+		if (!reply.empty())
+		{
+			fwrite(reply.data(), 1, reply.size(), stdout);
+			fflush(stdout);
+		}
+		if (!more)
+		{
+			break;
+		}
+	}
+	return 0;
+}
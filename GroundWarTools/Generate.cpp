@@ -0,0 +1,104 @@
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Tools.h"
+#include "SelfPlay.h"
+#include "SampleFile.h"
+
+typedef std::chrono::steady_clock Clock;
+
+int generateMain(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		std::cout << "Usage: GroundWarTools generate <prefix> [games] [workers] [playouts] [seed] [weights]" << std::endl;
+		return 1;
+	}
+	const std::string prefix = argv[0];
+	const int games = argc > 1 ? atoi(argv[1]) : 100;
+	const int workers = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : (int)std::max(1u, std::thread::hardware_concurrency());
+	const int playouts = argc > 3 ? atoi(argv[3]) : 64;
+	const unsigned seed = argc > 4 ? (unsigned)strtoul(argv[4], nullptr, 10) : 1;
+	const char* weights = argc > 5 ? argv[5] : "groundwar.net";
+	const int maxTurns = 200;
+	const int sampledActions = 30;
+
+	// Each worker plays whole games on its own search and writes its own shard, so
+	// they never wait on each other
+	std::atomic<int> nextGame(0);
+	std::atomic<long long> samples(0), bytes(0);
+	std::atomic<int> decided(0);
+	std::mutex logMutex;
+	Clock::time_point start = Clock::now();
+	std::vector<std::thread> threads;
+	for (int w = 0; w < workers; ++w)
+	{
+		threads.push_back(std::thread([&, w]()
+		{
+			NetAI ai(mixSeed(seed, w, 0), playouts, 1, weights);
+			SampleWriter writer(SampleWriter::shardPath(prefix, w));
+			std::vector<Sample> game;
+			for (int g = nextGame++; g < games && writer.good(); g = nextGame++)
+			{
+				game.clear();
+				GameResult result = playTrainingGame(ai, mixSeed(seed, g, 1), maxTurns, sampledActions, game);
+				if (!writer.write(game))
+				{
+					std::lock_guard<std::mutex> lock(logMutex);
+					std::cout << "Couldn't write " << SampleWriter::shardPath(prefix, w) << std::endl;
+					break;
+				}
+				decided += result.decided ? 1 : 0;
+			}
+			samples += writer.samples();
+			bytes += writer.bytes();
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); ++i)
+	{
+		threads[i].join();
+	}
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << games << " games (" << decided << " decided) in " << seconds << " s, "
+		<< samples << " samples, " << samples / seconds << " per second" << std::endl
+		<< bytes << " bytes over " << workers << " shards, " << (samples ? (double)bytes / samples : 0) << " per sample" << std::endl;
+	return 0;
+}
+
+int samplesMain(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: GroundWarTools samples <prefix> <shards> [buffer]" << std::endl;
+		return 1;
+	}
+	std::vector<std::string> paths;
+	for (int i = 0; i < atoi(argv[1]); ++i)
+	{
+		paths.push_back(SampleWriter::shardPath(argv[0], i));
+	}
+	SampleReader reader(paths, argc > 2 ? atoi(argv[2]) : 50000);
+
+	long long count = 0, wins = 0, losses = 0, actions = 0;
+	Sample sample;
+	Clock::time_point start = Clock::now();
+	while (reader.next(sample))
+	{
+		++count;
+		wins += sample.result > 0 ? 1 : 0;
+		losses += sample.result < 0 ? 1 : 0;
+		actions += sample.actions.size();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << count << " samples read in " << seconds << " s (" << count / std::max(seconds, 1e-9) << " per second), "
+		<< reader.skipped() << " damaged blocks skipped" << std::endl
+		<< "  " << wins << " won, " << losses << " lost, " << count - wins - losses << " undecided, "
+		<< (count ? (double)actions / count : 0) << " legal actions on average" << std::endl;
+	return 0;
+}
@@ -0,0 +1,330 @@
+#include "Net.h"
+#ifdef _WIN32
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+#endif
+
+static bool wouldBlock()
+{
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+static void setNonBlocking(Socket socket)
+{
+#ifdef _WIN32
+	u_long on = 1;
+	ioctlsocket(socket, FIONBIO, &on);
+#else
+	fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+static void setNoDelay(Socket socket)
+{
+	// Messages are small and latency matters more than packet count
+	int on = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+}
+
+static sockaddr_in loopback(int port)
+{
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons((unsigned short)port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return address;
+}
+
+bool netInit()
+{
+#ifdef _WIN32
+	WSADATA data;
+	return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+	signal(SIGPIPE, SIG_IGN); // Writing to a closed connection should fail, not kill us
+	return true;
+#endif
+}
+
+Socket netListen(int port)
+{
+	Socket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (listener == NO_SOCKET)
+	{
+		return NO_SOCKET;
+	}
+	int on = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+	sockaddr_in address = loopback(port);
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+	{
+		netClose(listener);
+		return NO_SOCKET;
+	}
+	setNonBlocking(listener);
+	return listener;
+}
+
+int netPort(Socket socket)
+{
+	sockaddr_in address;
+	socklen_t length = sizeof(address);
+	if (getsockname(socket, (sockaddr*)&address, &length) != 0)
+	{
+		return -1;
+	}
+	return ntohs(address.sin_port);
+}
+
+Socket netAccept(Socket listener)
+{
+	Socket client = accept(listener, nullptr, nullptr);
+	if (client != NO_SOCKET)
+	{
+		setNonBlocking(client);
+		setNoDelay(client);
+	}
+	return client;
+}
+
+Socket netConnect(int port)
+{
+	Socket client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (client == NO_SOCKET)
+	{
+		return NO_SOCKET;
+	}
+	sockaddr_in address = loopback(port);
+	if (connect(client, (sockaddr*)&address, sizeof(address)) != 0)
+	{
+		netClose(client);
+		return NO_SOCKET;
+	}
+	setNoDelay(client);
+	return client;
+}
+
+bool netPair(Socket& a, Socket& b)
+{
+	// Windows has no socketpair, so connect to ourselves through a throwaway listener
+	Socket listener = netListen(0);
+	if (listener == NO_SOCKET)
+	{
+		return false;
+	}
+	a = netConnect(netPort(listener));
+	b = NO_SOCKET;
+	for (int tries = 0; a != NO_SOCKET && b == NO_SOCKET && tries < 1000; ++tries)
+	{
+		b = netAccept(listener);
+	}
+	netClose(listener);
+	if (a == NO_SOCKET || b == NO_SOCKET)
+	{
+		netClose(a);
+		netClose(b);
+		return false;
+	}
+	setNonBlocking(a);
+	return true;
+}
+
+void netClose(Socket socket)
+{
+	if (socket == NO_SOCKET)
+	{
+		return;
+	}
+#ifdef _WIN32
+	closesocket(socket);
+#else
+	close(socket);
+#endif
+}
+
+int netSend(Socket socket, const char* data, int length)
+{
+	int sent = send(socket, data, length, 0);
+	if (sent < 0)
+	{
+		return wouldBlock() ? 0 : -1;
+	}
+	return sent;
+}
+
+int netRecv(Socket socket, char* data, int length)
+{
+	int received = recv(socket, data, length, 0);
+	if (received < 0)
+	{
+		return wouldBlock() ? 0 : -1;
+	}
+	return received == 0 ? -1 : received; // 0 from recv means the other end closed
+}
+
+bool netSendAll(Socket socket, const std::string& data)
+{
+	size_t done = 0;
+	while (done < data.size())
+	{
+		int sent = netSend(socket, data.data() + done, (int)(data.size() - done));
+		if (sent < 0)
+		{
+			return false;
+		}
+		done += sent;
+	}
+	return true;
+}
+
+bool netTakeLine(std::string& buffer, std::string& line)
+{
+	size_t end = buffer.find('\n');
+	if (end == std::string::npos)
+	{
+		return false;
+	}
+	line.assign(buffer, 0, end > 0 && buffer[end - 1] == '\r' ? end - 1 : end);
+	buffer.erase(0, end + 1);
+	return true;
+}
+
+#ifdef __linux__
+
+Poller::Poller()
+{
+	m_epoll = epoll_create1(0);
+}
+
+Poller::~Poller()
+{
+	close(m_epoll);
+}
+
+void Poller::add(Socket socket, bool writing)
+{
+	epoll_event event = {};
+	event.events = EPOLLIN | (writing ? EPOLLOUT : 0);
+	event.data.fd = socket;
+	epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &event);
+}
+
+void Poller::setWriting(Socket socket, bool writing)
+{
+	epoll_event event = {};
+	event.events = EPOLLIN | (writing ? EPOLLOUT : 0);
+	event.data.fd = socket;
+	epoll_ctl(m_epoll, EPOLL_CTL_MOD, socket, &event);
+}
+
+void Poller::remove(Socket socket)
+{
+	epoll_event event = {};
+	epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket, &event);
+}
+
+void Poller::wait(int timeoutMs, std::vector<Event>& events)
+{
+	epoll_event ready[256];
+	events.clear();
+	int count = epoll_wait(m_epoll, ready, 256, timeoutMs);
+	for (int i = 0; i < count; ++i)
+	{
+		Event event;
+		event.socket = ready[i].data.fd;
+		event.readable = (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+		event.writable = (ready[i].events & EPOLLOUT) != 0;
+		events.push_back(event);
+	}
+}
+
+#else
+
+#ifdef _WIN32
+typedef WSAPOLLFD PollFd;
+#define pollSockets WSAPoll
+#else
+typedef pollfd PollFd;
+#define pollSockets poll
+#endif
+
+Poller::Poller() {}
+
+Poller::~Poller() {}
+
+void Poller::add(Socket socket, bool writing)
+{
+	m_sockets.push_back(socket);
+	m_writing.push_back(writing);
+}
+
+void Poller::setWriting(Socket socket, bool writing)
+{
+	for (size_t i = 0; i < m_sockets.size(); ++i)
+	{
+		if (m_sockets[i] == socket)
+		{
+			m_writing[i] = writing;
+		}
+	}
+}
+
+void Poller::remove(Socket socket)
+{
+	for (size_t i = 0; i < m_sockets.size(); ++i)
+	{
+		if (m_sockets[i] == socket)
+		{
+			m_sockets.erase(m_sockets.begin() + i);
+			m_writing.erase(m_writing.begin() + i);
+			return;
+		}
+	}
+}
+
+void Poller::wait(int timeoutMs, std::vector<Event>& events)
+{
+	std::vector<PollFd> fds(m_sockets.size());
+	for (size_t i = 0; i < m_sockets.size(); ++i)
+	{
+		fds[i].fd = m_sockets[i];
+		fds[i].events = POLLIN | (m_writing[i] ? POLLOUT : 0);
+		fds[i].revents = 0;
+	}
+	events.clear();
+	if (pollSockets(fds.data(), (unsigned long)fds.size(), timeoutMs) <= 0)
+	{
+		return;
+	}
+	for (size_t i = 0; i < fds.size(); ++i)
+	{
+		if (fds[i].revents)
+		{
+			Event event;
+			event.socket = fds[i].fd;
+			event.readable = (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+			event.writable = (fds[i].revents & POLLOUT) != 0;
+			events.push_back(event);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET Socket;
+static const Socket NO_SOCKET = INVALID_SOCKET;
+#else
+typedef int Socket;
+static const Socket NO_SOCKET = -1;
+#endif
+
+/*
+A thin layer over the platform's sockets, just enough for the game server and its
+test client. Everything is TCP on the loopback interface.
+*/
+
+/*
+Starts up the socket library. Has to be called once before anything else here.
+*/
+bool netInit();
+
+/*
+Opens a non-blocking socket listening on 127.0.0.1 at the given port. Port 0 picks a
+free one, which netPort can tell. Returns NO_SOCKET on failure.
+*/
+Socket netListen(int port);
+int netPort(Socket socket);
+
+/*
+Accepts a waiting connection as a non-blocking socket, or returns NO_SOCKET if there
+isn't one.
+*/
+Socket netAccept(Socket listener);
+
+/*
+Opens a blocking connection to 127.0.0.1 at the given port. Returns NO_SOCKET on failure.
+*/
+Socket netConnect(int port);
+
+/*
+Makes two connected sockets, used to wake up a thread waiting in Poller::wait.
+*/
+bool netPair(Socket& a, Socket& b);
+
+void netClose(Socket socket);
+
+/*
+Sends or receives as much as possible without blocking (or blocks, for blocking sockets).
+Returns the number of bytes moved, 0 if the call would have blocked, or -1 if the
+connection is closed or broken.
+*/
+int netSend(Socket socket, const char* data, int length);
+int netRecv(Socket socket, char* data, int length);
+
+/*
+Sends all of the data on a blocking socket. Returns false if the connection broke.
+*/
+bool netSendAll(Socket socket, const std::string& data);
+
+/*
+Takes the first line (without its newline) out of a buffer of received text.
+Returns false if there isn't a whole line yet.
+*/
+bool netTakeLine(std::string& buffer, std::string& line);
+
+/*
+Waits for sockets to become readable or writable: epoll on Linux, WSAPoll on Windows
+and poll elsewhere. Level triggered.
+*/
+class Poller
+{
+public:
+	struct Event
+	{
+		Socket socket;
+		bool readable; // Also set when the connection closed or failed
+		bool writable;
+	};
+
+	Poller();
+	~Poller();
+
+	/*
+	Starts watching a socket for reading, and also for writing if asked.
+	*/
+	void add(Socket socket, bool writing);
+	void setWriting(Socket socket, bool writing);
+	void remove(Socket socket);
+
+	/*
+	Waits up to the given number of milliseconds (-1 for no limit) and fills events
+	with the sockets that are ready.
+	*/
+	void wait(int timeoutMs, std::vector<Event>& events);
+
+private:
+#ifdef __linux__
+	int m_epoll;
+#else
+	std::vector<Socket> m_sockets;
+	std::vector<bool> m_writing;
+#endif
+};
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Tools.h"
+#include "PositionDatabase.h"
+#include "Replay.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static void printUsage()
+{
+	std::cout << "Usage: GroundWarTools positions build <database> <replay files...>" << std::endl
+		<< "       GroundWarTools positions query <database> <replay file> [position] [games]" << std::endl
+		<< "A replay file of - reads the replay files to build from, one per line, from stdin." << std::endl;
+}
+
+static int build(int argc, char** argv)
+{
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-") == 0)
+		{
+			std::string line;
+			while (std::getline(std::cin, line))
+			{
+				if (!line.empty() && line[line.size() - 1] == '\r')
+				{
+					line.erase(line.size() - 1);
+				}
+				if (!line.empty())
+				{
+					paths.push_back(line);
+				}
+			}
+		}
+		else
+		{
+			paths.push_back(argv[i]);
+		}
+	}
+
+	PositionDatabaseBuilder builder;
+	Clock::time_point start = Clock::now();
+	const int total = (int)paths.size();
+	int games = builder.add(paths, 0, [total](int done)
+	{
+		if (done % 1000 == 0)
+		{
+			std::cout << "Read " << done << " / " << total << " replays" << std::endl;
+		}
+	});
+	double readSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+	if (games < total)
+	{
+		std::cout << "Skipped " << total - games << " files that aren't replays" << std::endl;
+	}
+	if (!builder.save(argv[0]))
+	{
+		std::cout << "Couldn't write " << argv[0] << std::endl;
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	PositionDatabase database;
+	database.load(argv[0]);
+	std::cout << games << " games, " << database.positions() << " positions, read in " << readSeconds
+		<< " s and written in " << seconds - readSeconds << " s" << std::endl;
+	return 0;
+}
+
+static int query(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return 1;
+	}
+	PositionDatabase database;
+	if (!database.load(argv[0]))
+	{
+		std::cout << "Couldn't load database " << argv[0] << std::endl;
+		return 1;
+	}
+	Board board;
+	Replay replay(board);
+	if (!replay.load(argv[1]))
+	{
+		std::cout << "Couldn't load replay " << argv[1] << std::endl;
+		return 1;
+	}
+	int position = argc > 2 ? atoi(argv[2]) : 0;
+	int limit = argc > 3 ? atoi(argv[3]) : 10;
+	position = position < 0 ? 0 : position > replay.length() ? replay.length() : position;
+	BoardState state;
+	replay.stateAt(position, state);
+
+	Clock::time_point start = Clock::now();
+	PositionStats stats;
+	std::vector<Occurrence> found;
+	bool seen = database.lookup(state, stats) && database.occurrences(state, found, limit);
+	double micros = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	if (!seen)
+	{
+		std::cout << "Position " << position << " isn't in any of the " << database.games() << " games ("
+			<< micros << " us)" << std::endl;
+		return 0;
+	}
+
+	std::cout << "Position " << position << " came up in " << stats.games << " games: red won " << stats.wins[RED]
+		<< ", blue won " << stats.wins[BLUE] << ", " << stats.draws << " drawn. " << (state.player == RED ? "Red" : "Blue")
+		<< " to move scores " << stats.score(state.player) * 100 << "% (" << micros << " us)" << std::endl;
+	for (size_t i = 0; i < found.size(); ++i)
+	{
+		int winner = database.gameWinner(found[i].game);
+		std::cout << "  " << database.gamePath(found[i].game) << " at " << found[i].position << " of "
+			<< database.gameLength(found[i].game) << ", " << (winner == RED ? "red won" : winner == BLUE ? "blue won" : "drawn")
+			<< std::endl;
+	}
+	if ((int)found.size() < stats.games)
+	{
+		std::cout << "  and " << stats.games - (int)found.size() << " more" << std::endl;
+	}
+	return 0;
+}
+
+int positionsMain(int argc, char** argv)
+{
+	if (argc >= 2 && strcmp(argv[0], "build") == 0)
+	{
+		return build(argc - 1, argv + 1);
+	}
+	if (argc >= 1 && strcmp(argv[0], "query") == 0)
+	{
+		return query(argc - 1, argv + 1);
+	}
+	printUsage();
+	return 1;
+}
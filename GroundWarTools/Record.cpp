@@ -0,0 +1,44 @@
+#include <iostream>
+#include <cstdlib>
+#include "Tools.h"
+#include "AI.h"
+#include "SelfPlay.h"
+#include "Delta.h"
+
+int recordMain(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		std::cout << "Usage: GroundWarTools record <replay file> [seed] [max turns] [red AI] [blue AI]" << std::endl;
+		return 1;
+	}
+	const unsigned seed = argc > 1 ? (unsigned)strtoul(argv[1], nullptr, 10) : 1;
+	const int maxTurns = argc > 2 ? atoi(argv[2]) : 200;
+	const std::string redName = argc > 3 ? argv[3] : "random";
+	const std::string blueName = argc > 4 ? argv[4] : "random";
+
+	AI* red = AI::create(redName, mixSeed(seed, 0, 1));
+	AI* blue = AI::create(blueName, mixSeed(seed, 0, 2));
+	if (!red || !blue)
+	{
+		std::cout << "Unknown AI: " << (red ? blueName : redName) << std::endl;
+		delete red;
+		delete blue;
+		return 1;
+	}
+
+	std::vector<unsigned char> records;
+	GameResult result = playGame(Rules::standard(), *red, *blue, seed, maxTurns, &records);
+	delete red;
+	delete blue;
+	if (!saveReplay(argv[0], records))
+	{
+		std::cout << "Couldn't write " << argv[0] << std::endl;
+		return 1;
+	}
+
+	std::cout << result.actions << " actions over " << result.turns << " turns, "
+		<< (result.decided ? (result.winner == RED ? "red won" : "blue won") : "undecided") << std::endl
+		<< records.size() << " bytes, " << (double)records.size() / (result.actions + 1) << " per record" << std::endl;
+	return 0;
+}
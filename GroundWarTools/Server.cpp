@@ -0,0 +1,383 @@
+#include "Server.h"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include "Tools.h"
+
+typedef std::vector<std::pair<int, std::string>> Messages;
+
+GameServer::GameServer(unsigned shards, unsigned seed) :
+	m_seed(seed), m_stopping(false)
+{
+	if (shards == 0)
+	{
+		shards = std::max(1u, std::thread::hardware_concurrency());
+	}
+	m_shards.resize(shards);
+	for (size_t i = 0; i < m_shards.size(); ++i)
+	{
+		m_shards[i].pool = new ThreadPool(1);
+	}
+}
+
+GameServer::~GameServer()
+{
+	// Let the shards finish first, since their jobs post back here
+	for (size_t i = 0; i < m_shards.size(); ++i)
+	{
+		delete m_shards[i].pool;
+		for (std::map<int, Match*>::iterator it = m_shards[i].matches.begin(); it != m_shards[i].matches.end(); ++it)
+		{
+			delete it->second;
+		}
+	}
+	for (std::map<int, Connection*>::iterator it = m_byId.begin(); it != m_byId.end(); ++it)
+	{
+		netClose(it->second->socket);
+		delete it->second;
+	}
+	netClose(m_listener);
+	netClose(m_wakeSend);
+	netClose(m_wakeReceive);
+}
+
+bool GameServer::listen(int port)
+{
+	m_listener = netListen(port);
+	if (m_listener == NO_SOCKET || !netPair(m_wakeSend, m_wakeReceive))
+	{
+		return false;
+	}
+	m_poller.add(m_listener, false);
+	m_poller.add(m_wakeReceive, false);
+	return true;
+}
+
+int GameServer::port()
+{
+	return netPort(m_listener);
+}
+
+void GameServer::run()
+{
+	std::vector<Poller::Event> events;
+	while (!m_stopping)
+	{
+		m_poller.wait(-1, events);
+		for (size_t i = 0; i < events.size(); ++i)
+		{
+			const Poller::Event& event = events[i];
+			if (event.socket == m_listener)
+			{
+				accept();
+			}
+			else if (event.socket == m_wakeReceive)
+			{
+				char drain[256];
+				while (netRecv(m_wakeReceive, drain, sizeof(drain)) > 0) {}
+				deliver();
+			}
+			else
+			{
+				// Look the connection up each time, since an earlier event may have closed it
+				std::map<Socket, Connection*>::iterator it = m_bySocket.find(event.socket);
+				if (it != m_bySocket.end() && event.readable)
+				{
+					read(it->second);
+				}
+				it = m_bySocket.find(event.socket);
+				if (it != m_bySocket.end() && event.writable)
+				{
+					write(it->second);
+				}
+			}
+		}
+	}
+}
+
+void GameServer::stop()
+{
+	m_stopping = true;
+	netSend(m_wakeSend, "x", 1);
+}
+
+void GameServer::accept()
+{
+	Socket socket;
+	while ((socket = netAccept(m_listener)) != NO_SOCKET)
+	{
+		Connection* connection = new Connection();
+		connection->socket = socket;
+		connection->id = m_nextConnection++;
+		m_bySocket[socket] = connection;
+		m_byId[connection->id] = connection;
+		m_poller.add(socket, false);
+	}
+}
+
+void GameServer::read(Connection* connection)
+{
+	char buffer[4096];
+	int received;
+	while ((received = netRecv(connection->socket, buffer, sizeof(buffer))) > 0)
+	{
+		connection->in.append(buffer, received);
+	}
+
+	std::string line;
+	while (netTakeLine(connection->in, line))
+	{
+		handleLine(connection, line);
+	}
+	if (received < 0 || connection->in.size() > 4096) // Closed, or sending garbage
+	{
+		close(connection);
+	}
+	else if (!connection->out.empty()) // Answers to bad commands are written straight away
+	{
+		write(connection);
+	}
+}
+
+void GameServer::write(Connection* connection)
+{
+	size_t done = 0;
+	int sent = 0;
+	while (done < connection->out.size() &&
+		(sent = netSend(connection->socket, connection->out.data() + done, (int)(connection->out.size() - done))) > 0)
+	{
+		done += sent;
+	}
+	if (sent < 0)
+	{
+		close(connection);
+		return;
+	}
+	connection->out.erase(0, done);
+
+	// Only ask to hear about writability while there's something left to write
+	bool writing = !connection->out.empty();
+	if (writing != connection->writing)
+	{
+		connection->writing = writing;
+		m_poller.setWriting(connection->socket, writing);
+	}
+}
+
+void GameServer::close(Connection* connection)
+{
+	if (connection->match >= 0)
+	{
+		leave(connection->id, connection->match);
+	}
+	for (size_t i = 0; i < connection->created.size(); ++i)
+	{
+		leave(-1, connection->created[i]);
+	}
+	m_poller.remove(connection->socket);
+	netClose(connection->socket);
+	m_bySocket.erase(connection->socket);
+	m_byId.erase(connection->id);
+	delete connection;
+}
+
+void GameServer::handleLine(Connection* connection, const std::string& line)
+{
+	std::istringstream words(line);
+	std::string command;
+	if (!(words >> command))
+	{
+		return;
+	}
+
+	const int client = connection->id;
+	if (command == "new")
+	{
+		const int id = m_nextMatch++;
+		connection->created.push_back(id);
+		const unsigned seed = mixSeed(m_seed, id, 0);
+		toShard(id, [this, client, id, seed](Shard& shard)
+		{
+			shard.matches[id] = new Match(id, seed);
+			std::ostringstream reply;
+			reply << "match " << id << "\n";
+			Messages messages(1, std::make_pair(client, reply.str()));
+			post(messages);
+		});
+		return;
+	}
+
+	if (command == "join")
+	{
+		int id;
+		std::string side;
+		std::string format = "text";
+		Match::Sides sides;
+		if (!(words >> id >> side) || !Match::parseSides(side, sides) ||
+			((words >> format) && format != "text" && format != "delta"))
+		{
+			connection->out += "error usage: join <match> <red|blue|both|watch> [text|delta]\n";
+			return;
+		}
+		const bool deltas = format == "delta";
+		if (connection->match >= 0 && connection->match != id)
+		{
+			leave(client, connection->match);
+		}
+		connection->match = id;
+		toShard(id, [this, client, id, side, sides, deltas](Shard& shard)
+		{
+			std::map<int, Match*>::iterator it = shard.matches.find(id);
+			std::ostringstream reply;
+			bool joined = false;
+			if (it == shard.matches.end())
+			{
+				reply << "error no such match\n";
+			}
+			else if (!it->second->join(client, sides, deltas))
+			{
+				reply << "error side taken\n";
+			}
+			else
+			{
+				reply << "joined " << id << " " << side << "\n";
+				joined = true;
+			}
+			std::string text = reply.str();
+			if (joined)
+			{
+				it->second->writeFull(client, text);
+			}
+			Messages messages(1, std::make_pair(client, text));
+			post(messages);
+		});
+		return;
+	}
+
+	Action action;
+	if (!Action::parse(line, action))
+	{
+		connection->out += "error unknown command\n";
+		return;
+	}
+	if (connection->match < 0)
+	{
+		connection->out += "error join a match first\n";
+		return;
+	}
+	const int id = connection->match;
+	toShard(id, [this, client, id, action](Shard& shard)
+	{
+		Messages messages;
+		std::map<int, Match*>::iterator it = shard.matches.find(id);
+		std::string changes, delta, error;
+		if (it == shard.matches.end())
+		{
+			messages.push_back(std::make_pair(client, std::string("error no such match\n")));
+		}
+		else if (!it->second->apply(client, action, changes, delta, error))
+		{
+			messages.push_back(std::make_pair(client, "error " + error + "\n"));
+		}
+		else
+		{
+			// Everyone sees the changes, and the client who sent the action also gets its answer.
+			// Only clients following the match can get this far.
+			const std::vector<int>& clients = it->second->clients();
+			for (size_t i = 0; i < clients.size(); ++i)
+			{
+				const std::string& update = it->second->wantsDeltas(clients[i]) ? delta : changes;
+				messages.push_back(std::make_pair(clients[i], clients[i] == client ? update + "ok\n" : update));
+			}
+		}
+		post(messages);
+	});
+}
+
+void GameServer::leave(int client, int match)
+{
+	toShard(match, [client, match](Shard& shard)
+	{
+		std::map<int, Match*>::iterator it = shard.matches.find(match);
+		if (it != shard.matches.end())
+		{
+			it->second->leave(client);
+			if (it->second->clients().empty())
+			{
+				delete it->second;
+				shard.matches.erase(it);
+			}
+		}
+	});
+}
+
+void GameServer::toShard(int match, const std::function<void(Shard&)>& job)
+{
+	Shard& shard = m_shards[match % m_shards.size()];
+	shard.pool->submit([&shard, job]()
+	{
+		job(shard);
+	});
+}
+
+void GameServer::post(Messages& messages)
+{
+	bool wake;
+	{
+		std::lock_guard<std::mutex> lock(m_outboxMutex);
+		wake = m_outbox.empty(); // Otherwise a wake-up is already on its way
+		m_outbox.insert(m_outbox.end(), messages.begin(), messages.end());
+	}
+	if (wake)
+	{
+		netSend(m_wakeSend, "x", 1);
+	}
+}
+
+void GameServer::deliver()
+{
+	Messages messages;
+	{
+		std::lock_guard<std::mutex> lock(m_outboxMutex);
+		messages.swap(m_outbox);
+	}
+	for (size_t i = 0; i < messages.size(); ++i)
+	{
+		std::map<int, Connection*>::iterator it = m_byId.find(messages[i].first);
+		if (it != m_byId.end()) // The client may have gone away since
+		{
+			it->second->out += messages[i].second;
+		}
+	}
+	for (size_t i = 0; i < messages.size(); ++i)
+	{
+		std::map<int, Connection*>::iterator it = m_byId.find(messages[i].first);
+		if (it != m_byId.end() && !it->second->out.empty())
+		{
+			write(it->second);
+		}
+	}
+}
+
+int serveMain(int argc, char** argv)
+{
+	int port = argc > 0 ? atoi(argv[0]) : 7777;
+	unsigned shards = argc > 1 ? (unsigned)atoi(argv[1]) : 0;
+	if (!netInit())
+	{
+		std::cout << "Can't start up sockets" << std::endl;
+		return 1;
+	}
+
+	GameServer server(shards, (unsigned)time(nullptr));
+	if (!server.listen(port))
+	{
+		std::cout << "Can't listen on port " << port << std::endl;
+		return 1;
+	}
+	std::cout << "Listening on 127.0.0.1:" << server.port() << std::endl;
+	server.run();
+	return 0;
+}
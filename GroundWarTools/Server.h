@@ -0,0 +1,111 @@
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "Net.h"
+#include "ThreadPool.h"
+#include "Match.h"
+
+/*
+Hosts any number of matches for clients on the loopback interface. One thread runs the
+event loop, doing all socket reads and writes. Each line a client sends is handed to
+the shard that owns the client's match; shards are single-thread pools, so each match
+is only ever touched by one thread and its actions stay in order without locking.
+Replies and broadcasts come back to the event loop through an outbox.
+
+Commands, one per line:
+	new                     Creates a match and replies "match <id>". A match is deleted
+	                        once everyone has left it, or when its creator disconnects
+	                        if nobody ever joined
+	join <id> <side> [fmt]  Follows a match as red, blue, both or watch, getting updates
+	                        as text (the default) or delta. Replies "joined <id> <side>"
+	                        followed by the whole board, or "error side taken" if
+	                        another client already plays red or blue
+	<action>                Anything Action::parse takes, for the joined match. Replies "ok"
+	                        or "error <reason>". Everyone following the match gets the
+	                        changed tiles and state first (see Match).
+*/
+class GameServer
+{
+public:
+	/*
+	Sets up a server with the given number of shards (0 means one per hardware thread)
+	whose matches draw combat rolls from the given seed.
+	*/
+	GameServer(unsigned shards, unsigned seed);
+	~GameServer();
+
+	/*
+	Starts listening on the given port (0 picks a free one). Returns false on failure.
+	*/
+	bool listen(int port);
+	int port();
+
+	/*
+	Runs the event loop until stop is called.
+	*/
+	void run();
+
+	/*
+	Makes run return soon. Safe to call from any thread.
+	*/
+	void stop();
+
+private:
+	struct Connection
+	{
+		Socket socket;
+		int id;
+		int match = -1; // Match this connection last joined
+		std::vector<int> created; // Matches this connection made, reaped when it closes if nobody joined
+		std::string in;
+		std::string out;
+		bool writing = false; // Waiting for the socket to become writable
+	};
+
+	struct Shard
+	{
+		ThreadPool* pool;
+		std::map<int, Match*> matches; // Only touched from the shard's own thread
+	};
+
+	unsigned m_seed;
+	Socket m_listener = NO_SOCKET;
+	Socket m_wakeSend = NO_SOCKET; // Written to by shards to wake up the event loop
+	Socket m_wakeReceive = NO_SOCKET;
+	Poller m_poller;
+	std::atomic<bool> m_stopping;
+	std::map<Socket, Connection*> m_bySocket;
+	std::map<int, Connection*> m_byId;
+	int m_nextConnection = 0;
+	int m_nextMatch = 0;
+	std::vector<Shard> m_shards;
+
+	std::mutex m_outboxMutex;
+	std::vector<std::pair<int, std::string>> m_outbox; // Messages by connection id
+
+	void accept();
+	void read(Connection* connection);
+	void write(Connection* connection);
+	void close(Connection* connection);
+	void handleLine(Connection* connection, const std::string& line);
+
+	/*
+	Takes the client out of the given match, and deletes the match if that leaves nobody
+	following it. A client of -1 just deletes the match if it's empty.
+	*/
+	void leave(int client, int match);
+
+	/*
+	Queues a job on the shard that owns the given match.
+	*/
+	void toShard(int match, const std::function<void(Shard&)>& job);
+
+	/*
+	Called from shards to send messages. Wakes up the event loop if it might be waiting.
+	*/
+	void post(std::vector<std::pair<int, std::string>>& messages);
+	void deliver();
+};
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <cstring>
+#include "Tools.h"
+
+static void printUsage()
+{
+	std::cout << "Usage: GroundWarTools <tool> [args...]" << std::endl
+		<< "Tools:" << std::endl
+		<< "  tune <spec file> <results file>   Parameter-sweep balance tuning" << std::endl
+		<< "  bench [seconds]                   Performance benchmarks" << std::endl
+		<< "  serve [port] [shards]             Host matches for local clients" << std::endl
+		<< "  load [matches] [actions] [threads] [port]" << std::endl
+		<< "                                    Play random matches against a server" << std::endl
+		<< "  record <file> [seed] [max turns] [red AI] [blue AI]" << std::endl
+		<< "                                    Play one game and save its replay" << std::endl
+		<< "  generate <prefix> [games] [workers] [playouts] [seed] [weights]" << std::endl
+		<< "                                    Write self-play training samples" << std::endl
+		<< "  samples <prefix> <shards> [buffer]" << std::endl
+		<< "                                    Read back training samples, shuffled" << std::endl
+		<< "  engine                            Run an AI over a line protocol on stdin/stdout" << std::endl
+		<< "  versus <first AI> <second AI> [pairs] [threads] [seed] [elo0 elo1]" << std::endl
+		<< "                                    Play paired games and measure Elo, with an SPRT" << std::endl
+		<< "  tablebase <file> [threads]        Solve the one unit a side endgames" << std::endl
+		<< "  book <file> [games] [turns] [threads] [AI] [seed] [min games]" << std::endl
+		<< "                                    Build an opening book from self-play" << std::endl
+		<< "  positions build <database> <replays...>" << std::endl
+		<< "  positions query <database> <replay> [position] [games]" << std::endl
+		<< "                                    Index replays by position, and look positions up" << std::endl;
+}
+
+unsigned mixSeed(unsigned seed, unsigned a, unsigned b)
+{
+	// A couple of rounds of a 32-bit integer hash, so neighbouring indices don't give related streams
+	unsigned h = seed ^ (a * 0x9e3779b9u) ^ (b * 0x85ebca6bu);
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	if (strcmp(argv[1], "tune") == 0)
+	{
+		return tuneMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "bench") == 0)
+	{
+		return benchMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "serve") == 0)
+	{
+		return serveMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "load") == 0)
+	{
+		return loadMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "record") == 0)
+	{
+		return recordMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "generate") == 0)
+	{
+		return generateMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "samples") == 0)
+	{
+		return samplesMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "engine") == 0)
+	{
+		return engineMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "versus") == 0)
+	{
+		return versusMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "tablebase") == 0)
+	{
+		return tablebaseMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "book") == 0)
+	{
+		return bookMain(argc - 2, argv + 2);
+	}
+	if (strcmp(argv[1], "positions") == 0)
+	{
+		return positionsMain(argc - 2, argv + 2);
+	}
+
+	std::cout << "Unknown tool: " << argv[1] << std::endl;
+	printUsage();
+	return 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+/*
+Entry points for each of the tools. Each one takes the arguments after the tool name
+and returns the process exit code.
+*/
+int tuneMain(int argc, char** argv);
+int benchMain(int argc, char** argv);
+int serveMain(int argc, char** argv);
+int loadMain(int argc, char** argv);
+int recordMain(int argc, char** argv);
+int generateMain(int argc, char** argv);
+int samplesMain(int argc, char** argv);
+int engineMain(int argc, char** argv);
+int versusMain(int argc, char** argv);
+int tablebaseMain(int argc, char** argv);
+int bookMain(int argc, char** argv);
+int positionsMain(int argc, char** argv);
+
+/*
+Mixes a base seed with up to two indices into a well-spread seed, so that every
+game in a batch run gets its own reproducible combat stream.
+*/
+unsigned mixSeed(unsigned seed, unsigned a, unsigned b);
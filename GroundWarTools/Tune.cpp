@@ -0,0 +1,367 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cmath>
+#include <random>
+#include <set>
+#include "Tools.h"
+#include "Rules.h"
+#include "AI.h"
+#include "SelfPlay.h"
+#include "ThreadPool.h"
+
+/*
+One rules parameter being swept, and the values to try for it.
+*/
+struct SweepParameter
+{
+	std::string name;
+	std::vector<double> values;
+};
+
+/*
+Settings for a tuning run. Everything here can be set from the spec file.
+*/
+struct TuneSettings
+{
+	int samples = 0; // 0 runs the full grid, otherwise this many different random picks from it
+	int minGames = 200; // Never stop a configuration before this many games
+	int maxGames = 20000; // Always stop a configuration after this many games
+	int batch = 50; // Games played per job
+	double halfWidth = 0.02; // Stop once the confidence interval on red's score is this tight
+	double z = 1.96; // Normal quantile for the confidence interval (1.96 = 95%)
+	int maxTurns = 200; // Games that last longer than this are draws
+	unsigned seed = 1;
+	unsigned threads = 0; // 0 means all cores
+	std::string ai = "random";
+};
+
+/*
+One set of rules being measured, and the results so far.
+*/
+struct TuneConfig
+{
+	Rules rules;
+	std::vector<double> values; // Value of each swept parameter, in the same order as the parameters
+	int games = 0;
+	int redWins = 0;
+	int blueWins = 0;
+	int draws = 0;
+	long long turns = 0;
+	int batchesStarted = 0;
+	int batchesInFlight = 0;
+	bool done = false;
+
+	/*
+	Red's average score, counting a draw as half a win.
+	*/
+	double score() const
+	{
+		return games ? (redWins + 0.5 * draws) / games : 0.5;
+	}
+
+	/*
+	Half the width of the confidence interval on score(), for the given normal quantile.
+	*/
+	double halfWidth(double z) const
+	{
+		if (games == 0)
+		{
+			return 1.0;
+		}
+		// Scores are 0, 0.5 or 1, so the sample variance comes straight from the counts
+		double mean = score();
+		double meanSquare = (redWins + 0.25 * draws) / games;
+		double variance = meanSquare - mean * mean;
+		return z * std::sqrt(variance > 0 ? variance / games : 0);
+	}
+};
+
+/*
+Shared state of a tuning run. Results are only touched while holding mutex.
+*/
+struct TuneRun
+{
+	TuneSettings settings;
+	std::vector<SweepParameter> parameters;
+	std::vector<TuneConfig> configs;
+	ThreadPool* pool;
+	std::mutex mutex;
+	int configsDone = 0;
+};
+
+static bool readSpec(const char* path, TuneSettings& settings, std::vector<SweepParameter>& parameters)
+{
+	std::ifstream in(path);
+	if (!in)
+	{
+		std::cout << "Can't open spec file " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(in, line))
+	{
+		++lineNumber;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line = line.substr(0, comment);
+		}
+		std::istringstream words(line);
+		std::string key;
+		if (!(words >> key))
+		{
+			continue; // Blank line
+		}
+
+		bool ok = true;
+		if (key == "samples") ok = (bool)(words >> settings.samples);
+		else if (key == "minGames") ok = (bool)(words >> settings.minGames);
+		else if (key == "maxGames") ok = (bool)(words >> settings.maxGames);
+		else if (key == "batch") ok = (bool)(words >> settings.batch);
+		else if (key == "halfWidth") ok = (bool)(words >> settings.halfWidth);
+		else if (key == "z") ok = (bool)(words >> settings.z);
+		else if (key == "maxTurns") ok = (bool)(words >> settings.maxTurns);
+		else if (key == "seed") ok = (bool)(words >> settings.seed);
+		else if (key == "threads") ok = (bool)(words >> settings.threads);
+		else if (key == "ai") ok = (bool)(words >> settings.ai);
+		else
+		{
+			// Anything else has to be a rules parameter followed by the values to try
+			Rules scratch = Rules::standard();
+			if (!scratch.set(key, 0))
+			{
+				std::cout << path << ":" << lineNumber << ": unknown parameter " << key << std::endl;
+				return false;
+			}
+			SweepParameter parameter;
+			parameter.name = key;
+			double value;
+			while (words >> value)
+			{
+				parameter.values.push_back(value);
+			}
+			ok = !parameter.values.empty();
+			parameters.push_back(parameter);
+		}
+
+		if (!ok)
+		{
+			std::cout << path << ":" << lineNumber << ": bad value for " << key << std::endl;
+			return false;
+		}
+	}
+
+	if (settings.batch < 1 || settings.minGames < 1 || settings.maxGames < settings.minGames)
+	{
+		std::cout << "Need batch >= 1 and 1 <= minGames <= maxGames" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/*
+Builds the configurations to measure: the full grid, or a random sample of it with no
+configuration picked twice. Asking for at least as many samples as the grid has runs the
+whole grid.
+*/
+static void buildConfigs(TuneRun& run)
+{
+	const std::vector<SweepParameter>& parameters = run.parameters;
+	unsigned long long gridSize = 1;
+	for (size_t i = 0; i < parameters.size(); ++i)
+	{
+		gridSize *= parameters[i].values.size();
+	}
+
+	// Each configuration is a number, with the first parameter's index changing fastest
+	std::vector<unsigned long long> points;
+	if (run.settings.samples > 0 && (unsigned long long)run.settings.samples < gridSize)
+	{
+		// Floyd's algorithm: distinct picks without listing the whole grid
+		std::mt19937_64 rng(run.settings.seed);
+		std::set<unsigned long long> chosen;
+		for (unsigned long long top = gridSize - run.settings.samples; top < gridSize; ++top)
+		{
+			unsigned long long point = std::uniform_int_distribution<unsigned long long>(0, top)(rng);
+			if (!chosen.insert(point).second)
+			{
+				point = top; // Already picked, and top never has been
+				chosen.insert(point);
+			}
+			points.push_back(point);
+		}
+	}
+	else
+	{
+		for (unsigned long long point = 0; point < gridSize; ++point)
+		{
+			points.push_back(point);
+		}
+	}
+
+	for (size_t p = 0; p < points.size(); ++p)
+	{
+		TuneConfig config;
+		config.rules = Rules::standard();
+		unsigned long long point = points[p];
+		for (size_t i = 0; i < parameters.size(); ++i)
+		{
+			double value = parameters[i].values[(size_t)(point % parameters[i].values.size())];
+			point /= parameters[i].values.size();
+			config.rules.set(parameters[i].name, value);
+			config.values.push_back(config.rules.get(parameters[i].name)); // Record the value after rounding
+		}
+		run.configs.push_back(config);
+	}
+}
+
+static void startBatch(TuneRun& run, int configIndex);
+
+/*
+Plays one batch of games for a configuration, records the results, and decides
+whether the configuration needs more games.
+*/
+static void runBatch(TuneRun& run, int configIndex, int batchIndex)
+{
+	const TuneSettings& settings = run.settings;
+	TuneConfig& config = run.configs[configIndex];
+
+	int redWins = 0, blueWins = 0, draws = 0;
+	long long turns = 0;
+	for (int i = 0; i < settings.batch; ++i)
+	{
+		unsigned game = (unsigned)(batchIndex * settings.batch + i);
+		unsigned seed = mixSeed(settings.seed, (unsigned)configIndex, game);
+		AI* red = AI::create(settings.ai, mixSeed(seed, 1, 0));
+		AI* blue = AI::create(settings.ai, mixSeed(seed, 2, 0));
+		GameResult result = playGame(config.rules, *red, *blue, seed, settings.maxTurns);
+		delete red;
+		delete blue;
+
+		if (!result.decided) ++draws;
+		else if (result.winner == RED) ++redWins;
+		else ++blueWins;
+		turns += result.turns;
+	}
+
+	std::lock_guard<std::mutex> lock(run.mutex);
+	config.redWins += redWins;
+	config.blueWins += blueWins;
+	config.draws += draws;
+	config.games += settings.batch;
+	config.turns += turns;
+	--config.batchesInFlight;
+	if (config.done)
+	{
+		return; // Another batch already settled this configuration
+	}
+
+	bool tight = config.games >= settings.minGames && config.halfWidth(settings.z) <= settings.halfWidth;
+	if (tight || config.games >= settings.maxGames)
+	{
+		config.done = true;
+		++run.configsDone;
+		std::cout << "[" << run.configsDone << "/" << run.configs.size() << "] config " << configIndex
+			<< ": red score " << config.score() << " +/- " << config.halfWidth(settings.z)
+			<< " after " << config.games << " games" << std::endl;
+		return;
+	}
+	startBatch(run, configIndex);
+}
+
+/*
+Queues the next batch for a configuration, unless enough are already running to
+reach maxGames. Must be called while holding run.mutex.
+*/
+static void startBatch(TuneRun& run, int configIndex)
+{
+	TuneConfig& config = run.configs[configIndex];
+	int planned = config.games + config.batchesInFlight * run.settings.batch;
+	if (planned >= run.settings.maxGames)
+	{
+		return;
+	}
+	int batchIndex = config.batchesStarted++;
+	++config.batchesInFlight;
+	TuneRun* runPtr = &run;
+	run.pool->submit([runPtr, configIndex, batchIndex]() { runBatch(*runPtr, configIndex, batchIndex); });
+}
+
+static bool writeResults(const char* path, TuneRun& run)
+{
+	std::ofstream out(path);
+	if (!out)
+	{
+		std::cout << "Can't open results file " << path << std::endl;
+		return false;
+	}
+
+	for (size_t i = 0; i < run.parameters.size(); ++i)
+	{
+		out << run.parameters[i].name << "\t";
+	}
+	out << "games\tredWins\tblueWins\tdraws\tredScore\tciLow\tciHigh\tavgTurns" << std::endl;
+
+	for (size_t c = 0; c < run.configs.size(); ++c)
+	{
+		const TuneConfig& config = run.configs[c];
+		for (size_t i = 0; i < config.values.size(); ++i)
+		{
+			out << config.values[i] << "\t";
+		}
+		double halfWidth = config.halfWidth(run.settings.z);
+		out << config.games << "\t" << config.redWins << "\t" << config.blueWins << "\t" << config.draws << "\t"
+			<< config.score() << "\t" << config.score() - halfWidth << "\t" << config.score() + halfWidth << "\t"
+			<< (config.games ? (double)config.turns / config.games : 0) << std::endl;
+	}
+	return true;
+}
+
+int tuneMain(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: GroundWarTools tune <spec file> <results file>" << std::endl;
+		return 1;
+	}
+
+	TuneRun run;
+	if (!readSpec(argv[0], run.settings, run.parameters))
+	{
+		return 1;
+	}
+	AI* check = AI::create(run.settings.ai, 0);
+	if (!check)
+	{
+		std::cout << "Unknown AI: " << run.settings.ai << std::endl;
+		return 1;
+	}
+	delete check;
+
+	buildConfigs(run);
+	ThreadPool pool(run.settings.threads);
+	run.pool = &pool;
+	std::cout << "Measuring " << run.configs.size() << " configurations on " << pool.size() << " threads" << std::endl;
+
+	// Keep every worker busy even when there are fewer configurations than threads
+	int batchesPerConfig = (int)(pool.size() / run.configs.size()) + 1;
+	{
+		std::lock_guard<std::mutex> lock(run.mutex);
+		for (size_t c = 0; c < run.configs.size(); ++c)
+		{
+			for (int b = 0; b < batchesPerConfig; ++b)
+			{
+				startBatch(run, (int)c);
+			}
+		}
+	}
+	pool.wait();
+
+	return writeResults(argv[1], run) ? 0 : 1;
+}
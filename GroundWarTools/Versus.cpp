@@ -0,0 +1,71 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+#include "Tools.h"
+#include "Tournament.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static void printStats(const TournamentStats& stats, const TournamentSettings& settings)
+{
+	char line[256];
+	sprintf(line, "%d pairs, +%d -%d =%d, score %.3f, Elo %.1f +/- %.1f", stats.pairCount(),
+		stats.wins, stats.losses, stats.draws, stats.score(), stats.elo(), stats.eloMargin());
+	std::cout << line;
+	if (settings.sprt)
+	{
+		sprintf(line, ", LLR %.2f (%.2f, %.2f)", stats.llr(settings.elo0, settings.elo1),
+			std::log(settings.beta / (1 - settings.alpha)), std::log((1 - settings.beta) / settings.alpha));
+		std::cout << line;
+	}
+	std::cout << std::endl;
+}
+
+int versusMain(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: GroundWarTools versus <first AI> <second AI> [pairs] [threads] [seed] [elo0 elo1]" << std::endl;
+		return 1;
+	}
+	TournamentSettings settings;
+	settings.first = argv[0];
+	settings.second = argv[1];
+	settings.maxPairs = argc > 2 ? atoi(argv[2]) : 1000;
+	settings.threads = argc > 3 ? (unsigned)atoi(argv[3]) : 0;
+	settings.seed = argc > 4 ? (unsigned)strtoul(argv[4], nullptr, 10) : 1;
+	if (argc > 6)
+	{
+		settings.sprt = true;
+		settings.elo0 = atof(argv[5]);
+		settings.elo1 = atof(argv[6]);
+	}
+
+	Tournament tournament(settings);
+	Clock::time_point start = Clock::now();
+	bool ok = tournament.run([&settings](const TournamentStats& stats)
+	{
+		if (stats.pairCount() % 10 == 0)
+		{
+			printStats(stats, settings);
+		}
+	});
+	if (!ok)
+	{
+		std::cout << "Unknown AI: " << (Tournament::createAI(settings.first, 0) ? settings.second : settings.first) << std::endl;
+		return 1;
+	}
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	TournamentStats stats = tournament.stats();
+	std::cout << settings.first << " vs " << settings.second << " in " << seconds << " s:" << std::endl;
+	printStats(stats, settings);
+	if (settings.sprt)
+	{
+		const char* verdicts[] = { "undecided", "accepted (elo1)", "rejected (elo0)" };
+		std::cout << "SPRT " << verdicts[tournament.verdict()] << std::endl;
+	}
+	return 0;
+}